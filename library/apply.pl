@@ -15,6 +15,10 @@ partition([], _, [], []).
 :- meta_predicate(maplist(6, ?, ?, ?, ?, ?, ?)).
 :- meta_predicate(maplist(7, ?, ?, ?, ?, ?, ?, ?)).
 
+maplist(G, L) :-
+	'$maplist'(G, L, Goal),
+	!,
+	call(Goal).
 maplist(G, L) :-
 	maplist_(L, G).
 
@@ -23,6 +27,10 @@ maplist_([E|T], G) :-
 	call(G, E),
 	maplist_(T, G).
 
+maplist(G, L1, L2) :-
+	'$maplist'(G, L1, L2, Goal),
+	!,
+	call(Goal).
 maplist(G, L1, L2) :-
 	maplist_(L1, L2, G).
 
@@ -31,6 +39,10 @@ maplist_([E1|T1], [E2|T2], G) :-
 	call(G, E1, E2),
 	maplist_(T1, T2, G).
 
+maplist(G, L1, L2, L3) :-
+	'$maplist'(G, L1, L2, L3, Goal),
+	!,
+	call(Goal).
 maplist(G, L1, L2, L3) :-
 	maplist_(L1, L2, L3, G).
 
@@ -39,6 +51,10 @@ maplist_([E1|T1], [E2|T2], [E3|T3], G) :-
 	call(G, E1, E2, E3),
 	maplist_(T1, T2, T3, G).
 
+maplist(G, L1, L2, L3, L4) :-
+	'$maplist'(G, L1, L2, L3, L4, Goal),
+	!,
+	call(Goal).
 maplist(G, L1, L2, L3, L4) :-
 	maplist_(L1, L2, L3, L4, G).
 
@@ -47,6 +63,10 @@ maplist_([E1|T1], [E2|T2], [E3|T3], [E4|T4], G) :-
 	call(G, E1, E2, E3, E4),
 	maplist_(T1, T2, T3, T4, G).
 
+maplist(G, L1, L2, L3, L4, L5) :-
+	'$maplist'(G, L1, L2, L3, L4, L5, Goal),
+	!,
+	call(Goal).
 maplist(G, L1, L2, L3, L4, L5) :-
 	maplist_(L1, L2, L3, L4, L5, G).
 
@@ -55,6 +75,10 @@ maplist_([E1|T1], [E2|T2], [E3|T3], [E4|T4], [E5|T5], G) :-
 	call(G, E1, E2, E3, E4, E5),
 	maplist_(T1, T2, T3, T4, T5, G).
 
+maplist(G, L1, L2, L3, L4, L5, L6) :-
+	'$maplist'(G, L1, L2, L3, L4, L5, L6, Goal),
+	!,
+	call(Goal).
 maplist(G, L1, L2, L3, L4, L5, L6) :-
 	maplist_(L1, L2, L3, L4, L5, L6, G).
 
@@ -63,6 +87,10 @@ maplist_([E1|T1], [E2|T2], [E3|T3], [E4|T4], [E5|T5], [E6|T6], G) :-
 	call(G, E1, E2, E3, E4, E5, E6),
 	maplist_(T1, T2, T3, T4, T5, T6, G).
 
+maplist(G, L1, L2, L3, L4, L5, L6, L7) :-
+	'$maplist'(G, L1, L2, L3, L4, L5, L6, L7, Goal),
+	!,
+	call(Goal).
 maplist(G, L1, L2, L3, L4, L5, L6, L7) :-
 	maplist_(L1, L2, L3, L4, L5, L6, L7, G).
 
@@ -138,6 +166,10 @@ tasklist_([E1|T1], [E2|T2], [E3|T3], [E4|T4], [E5|T5], [E6|T6], [E7|T7], G) :-
 
 
 
+foldl(G, L, V0, V) :-
+	'$foldl'(G, L, V0, V, Goal),
+	!,
+	call(Goal).
 foldl(G, L, V0, V) :-
 	foldl_(L, G, V0, V).
 
@@ -146,6 +178,10 @@ foldl_([H|T], G, V0, V) :-
 	call(G, H, V0, V1),
 	foldl_(T, G, V1, V).
 
+foldl(G, L1, L2, V0, V) :-
+	'$foldl'(G, L1, L2, V0, V, Goal),
+	!,
+	call(Goal).
 foldl(G, L1, L2, V0, V) :-
 	foldl_(L1, L2, G, V0, V).
 
@@ -154,6 +190,10 @@ foldl_([H1|T1], [H2|T2], G, V0, V) :-
 	call(G, H1, H2, V0, V1),
 	foldl_(T1, T2, G, V1, V).
 
+foldl(G, L1, L2, L3, V0, V) :-
+	'$foldl'(G, L1, L2, L3, V0, V, Goal),
+	!,
+	call(Goal).
 foldl(G, L1, L2, L3, V0, V) :-
 	foldl_(L1, L2, L3, G, V0, V).
 
@@ -162,6 +202,10 @@ foldl_([H1|T1], [H2|T2], [H3|T3], G, V0, V) :-
 	call(G, H1, H2, H3, V0, V1),
 	foldl_(T1, T2, T3, G, V1, V).
 
+foldl(G, L1, L2, L3, L4, V0, V) :-
+	'$foldl'(G, L1, L2, L3, L4, V0, V, Goal),
+	!,
+	call(Goal).
 foldl(G, L1, L2, L3, L4, V0, V) :-
 	foldl_(L1, L2, L3, L4, G, V0, V).
 
@@ -170,6 +214,10 @@ foldl_([H1|T1], [H2|T2], [H3|T3], [H4|T4], G, V0, V) :-
 	call(G, H1, H2, H3, H4, V0, V1),
 	foldl_(T1, T2, T3, T4, G, V1, V).
 
+include(G, L, Included) :-
+	'$include'(G, L, Included, Goal),
+	!,
+	call(Goal).
 include(G, L, Included) :-
 	include_(L, G, Included).
 
@@ -180,6 +228,10 @@ include(G, L, Included) :-
 		),
 		include_(Xs1, P, Included1).
 
+exclude(G, L, Included) :-
+	'$exclude'(G, L, Included, Goal),
+	!,
+	call(Goal).
 exclude(G, L, Included) :-
 	exclude_(L, G, Included).
 
@@ -59,6 +59,10 @@
 Assocs are Key-Value associations implemented as  a balanced binary tree
 (AVL tree).
 
+get_assoc/3, put_assoc/4, del_assoc/4, list_to_assoc/2 and
+ord_list_to_assoc/2 walk and build the same t/5 trees in C. They fall
+back to the Prolog code below for anything out of the ordinary.
+
 @see            library(pairs), library(rbtrees)
 @author         R.A.O'Keefe, L.Damas, V.S.Costa and Jan Wielemaker
 */
@@ -178,8 +182,12 @@ gen_assoc_(Key, t(_,_,_,_,R), Val) :-
 %   @error type_error(assoc, Assoc) if Assoc is not an association list.
 
 get_assoc(Key, Assoc, Val) :-
-    must_be(assoc, Assoc),
-    get_assoc_(Key, Assoc, Val).
+    '$assoc_get'(Key, Assoc, Val, Tree),
+    (   Tree == t
+    ->  true
+    ;   must_be(assoc, Tree),
+        get_assoc_(Key, Tree, Val)
+    ).
 
 /*
 :- if(current_predicate('$btree_find_node'/5)).
@@ -223,6 +231,11 @@ get_assoc(>, Key, V, L, R, Val, V, L, NR, NVal) :-
 %
 %   @error domain_error(unique_key_pairs, List) if List contains duplicate keys
 
+list_to_assoc(List, Assoc) :-
+    is_list(List),
+    keysort(List, Sorted),
+    '$assoc_from_ord_list'(Sorted, Assoc0), !,
+    Assoc = Assoc0.
 list_to_assoc(List, Assoc) :-
     (  List = [] -> Assoc = t
     ;  keysort(List, Sorted),
@@ -254,6 +267,10 @@ list_to_assoc(N, List, More, Depth, t(K,V,Balance,L,R)) :-
 %
 %   @error domain_error(key_ordered_pairs, List) if pairs are not ordered.
 
+ord_list_to_assoc(Sorted, Assoc) :-
+    is_list(Sorted),
+    '$assoc_from_ord_list'(Sorted, Assoc0), !,
+    Assoc = Assoc0.
 ord_list_to_assoc(Sorted, Assoc) :-
     (  Sorted = [] -> Assoc = t
     ;  (  ord_pairs(Sorted)
@@ -331,6 +348,9 @@ min_assoc(t(K,V,_,L,_), _, _, Key, Val) :-
 %   Assoc is Assoc0, except that Key is associated with
 %   Value. This can be used to insert and change associations.
 
+put_assoc(Key, A0, Value, A) :-
+    '$assoc_put'(A0, Key, Value, A1), !,
+    A = A1.
 put_assoc(Key, A0, Value, A) :-
     insert(A0, Key, Value, A, _).
 
@@ -394,6 +414,9 @@ del_max_assoc(t(K,V,B,L,R), Key, Val, NewTree, Changed) :-
 %   True if Key-Value is  in  Assoc0.   Assoc  is  Assoc0 with
 %   Key-Value removed.
 
+del_assoc(Key, A0, Value, A) :-
+    '$assoc_del'(A0, Key, Value, A1), !,
+    A = A1.
 del_assoc(Key, A0, Value, A) :-
     delete(A0, Key, Value, A, _).
 
@@ -681,6 +681,32 @@ get_atts(Var, Attr) :- !,
 	Attr =.. [Module,_],
 	dict:get(D, Module, Attr).
 
+% freeze/2, dif/2 & when/2 keep an open-ended list of s(Done,Goal)
+% suspensions in an attribute Module(List), which the post-unify hook
+% wakes natively. Adding one just binds the tail of the list...
+
+'$suspend'(Var, Module, Susp) :-
+	Attr =.. [Module,L],
+	(	get_atts(Var, Attr)
+	->	'$suspend_'(L, Susp)
+	;	Attr2 =.. [Module,[Susp|_]],
+		put_atts(Var, Attr2)
+	).
+
+'$suspend_'(L, Susp) :- var(L), !, L = [Susp|_].
+'$suspend_'([_|L], Susp) :- '$suspend_'(L, Susp).
+
+% The goals still pending, not copied so that they share variables
+% with the caller...
+
+'$suspended_goals'(L, []) :- var(L), !.
+'$suspended_goals'([s(Done,G)|L], Gs) :-
+	(	var(Done)
+	->	Gs = [G|Gs1]
+	;	Gs = Gs1
+	),
+	'$suspended_goals'(L, Gs1).
+
 del_atts(Var) :-
 	var(Var),
 	'$erase_attribute'(Var).
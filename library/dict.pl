@@ -1,25 +1,66 @@
-:- module(dict, [get/4, get/3, set/4, app/4, del/3, lst/2, match/3]).
+:- module(dict, [get/4, get/3, set/4, app/4, del/3, lst/2, match/3,
+	new/1, size/2, from_list/2, to_list/2]).
 
+% A dict is either a list of Key:Value pairs or a native dict made
+% with new/1 or from_list/2. Native dicts are persistent hash tries,
+% so lookups and updates are O(log n) and old versions are kept on
+% backtracking. Their keys and values must be ground.
+
+new(D) :-
+	'$dict_new'(D).
+
+size(D, N) :-
+	is_dict(D), !,
+	'$dict_size'(D, N).
+size(D, N) :-
+	length(D, N).
+
+from_list(L, D) :-
+	'$dict_from_list'(L, D).
+
+to_list(D, L) :-
+	is_dict(D), !,
+	'$dict_to_list'(D, L).
+to_list(L, L).
+
+get(D, N, V, Def) :-
+	is_dict(D), !,
+	(	'$dict_get'(D, N, V0)
+	->	V = V0
+	;	V = Def
+	).
 get([], _, D, D) :- !.
 get([N:V|_], N, V, _) :- !.
 get([_|T], N, V, D) :-
 	get(T, N, V, D).
 
+get(D, N, V) :-
+	is_dict(D), !,
+	'$dict_get'(D, N, V).
 get([], _, _) :- !,
 	fail.
 get([N:V|_], N, V) :- !.
 get([_|T], N, V) :-
 	get(T, N, V).
 
+set(D, N, V, D2) :-
+	is_dict(D), !,
+	'$dict_set'(D, N, V, D2).
 set([], N, V, [N:V]) :- !.
 set(D, N, V, D2) :-
 	del(D, N, D3),
 	D2=[N:V|D3].
 
+app(D, N, V, D2) :-
+	is_dict(D), !,
+	'$dict_set'(D, N, V, D2).
 app([], N, V, [N:V]) :- !.
 app(D, N, V, D2) :-
 	D2=[N:V|D].
 
+del(D, N, D2) :-
+	is_dict(D), !,
+	'$dict_del'(D, N, D2).
 del([], _, []) :- !.
 del([N:_|T], N, T) :- !.
 del([H|T], N, [H|D]) :-
@@ -29,6 +70,10 @@ lst0([], L, L) :- !.
 lst0([_:V|T], L1, L) :-
 	lst0(T, [V|L1], L).
 
+lst(D, L) :-
+	is_dict(D), !,
+	'$dict_to_list'(D, L0),
+	lst0(L0, [], L).
 lst(D, L) :-
 	lst0(D, [], L).
 
@@ -40,5 +85,9 @@ match([H:V|T], Template, L1, L) :-
 	;	match(T, Template2, L1, L)
 	).
 
+match(D, Template, L) :-
+	is_dict(D), !,
+	'$dict_to_list'(D, L0),
+	match(L0, Template, [], L).
 match(D, Template, L) :-
 	match(D, Template, [], L).
@@ -13,27 +13,25 @@ frozen(Term, Goal) :-
 
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
-verify_attributes(Var, Other, Goals) :-
-        get_atts(Var, frozen(Fa)), !,       % are we involved?
-        (   var(Other) ->                   % must be attributed then
-            (   get_atts(Other,  frozen(Fb)) % has a pending goal?
-            ->  ( var(Fb) ->
-				  put_atts(Other,  frozen(Fa))
-				; put_atts(Other,  frozen((Fb,Fa))) % rescue conjunction
-				)
-            ;   put_atts(Other,  frozen(Fa)) % rescue the pending goal
-            ),
-            Goals = []
-        ;   Goals = [Fa]
-        ).
+% Suspensions are woken natively, see '$suspend'/3.
+
 verify_attributes(_, _, []).
 
 freeze(X, Goal) :-
-    put_atts(Fresh, frozen(Goal)),
-    Fresh = X.
+	nonvar(X), !,
+	call(Goal).
+freeze(X, Goal) :-
+	'$suspend'(X, frozen, s(_, freeze:freeze(X, Goal))).
 
 attribute_goals(Var) -->
-    { get_atts(Var, frozen(Goals)),
-      put_atts(Var, -frozen(_)) },
-    [freeze:freeze(Var, Goals)].
-
+	{ get_atts(Var, frozen(L)),
+	  put_atts(Var, -frozen(_)),
+	  '$suspended_goals'(L, Ss),
+	  goals_(Ss, Gs),
+	  Gs \= [],
+	  toconjunction(Gs, Goals) },
+	[freeze:freeze(Var, Goals)].
+
+goals_([], []).
+goals_([freeze:freeze(_, G)|Ss], [G|Gs]) :-
+	goals_(Ss, Gs).
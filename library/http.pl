@@ -1,37 +1,11 @@
 :- module(http, [
 	http_open/3, http_get/3, http_post/4, http_patch/4, http_put/4, http_delete/3,
-	http_server/2, http_request/5
+	http_server/2, http_serve/2, http_request/5, http_keep_alive/2
 	]).
 
 :- use_module(library(lists)).
 :- use_module(library(dict)).
 
-read_response(S, Code) :-
-	getline(S, Line),
-	split(Line, ' ' ,_Ver, Rest),
-	split(Rest, ' ', Code2, _),
-	number_chars(Code, Code2).
-
-read_header(S, Pair) :-
-	getline(S, Line),
-	split(Line,':', K, V),
-	(K \= [] -> true ; (!, fail)),
-	string_lower(K, K2),
-	Pair=K2:V.
-read_header(S, Pair) :-
-	\+ at_end_of_stream(S),
-	read_header(S, Pair).
-
-read_chunks(S, Tmp, Data) :-
-	getline(S, Line),
-	hex_chars(Len, Line),
-	Len > 0,
-	bread(S, Len, Tmp2),
-	getline(S, _),
-	append(Tmp, Tmp2, Tmp3),
-	read_chunks(S, Tmp3, Data).
-read_chunks(_, Data, Data).
-
 read_body(S, Hdrs, Data) :-
 	dict:get(Hdrs, "content-length", V, _),
 	number_chars(Len, V),
@@ -53,8 +27,7 @@ http_open(UrlList, S, Opts) :-
 	client(Host, _Host, _Path, S, OptList),
 	string_upper(Method, UMethod),
 	format(S, '~s /~s HTTP/~d.~d\r~nHost: ~s\r~nConnection: keep-alive\r~n\r~n', [UMethod,Path,Major,Minor,Host]),
-	read_response(S, Code),
-	findall(Hdr, read_header(S, Hdr), Hdrs),
+	http_parse_response(S, Code, Hdrs),
 	append(Host, Path, Url),
 	dict:get(Hdrs, "location", Location, Url),
 	ignore(memberchk(status_code(Code), OptList)),
@@ -81,8 +54,7 @@ process(Url, S, Opts) :-
 	),
 	format(S, "~s /~s HTTP/~d.~d\r~nHost: ~s\r~nConnection: close\r~n~a~a\r~n", [UMethod,Path,Major,Minor,Host,Ctype,Clen]),
 	(nonvar(DataLen) -> bwrite(S, PostData) ; true),
-	read_response(S, Code),
-	findall(Hdr, read_header(S, Hdr), Hdrs),
+	http_parse_response(S, Code, Hdrs),
 	ignore(memberchk(status_code2(Code), OptList)),
 	ignore(memberchk(headers2(Hdrs), OptList)).
 
@@ -94,7 +66,7 @@ http_get(Url, Data, Opts) :-
 	process(Url, S, Opts3),
 	dict:get(Hdrs, "transfer-encoding", TE, ''),
 	(	TE == "chunked"
-	->	read_chunks(S, '', Body)
+	->	http_read_chunked(S, Body)
 	; read_body(S, Hdrs, Body)
 	),
 	close(S),
@@ -122,22 +94,55 @@ http_delete(Url, Data, Opts) :-
 % Handle a server request...
 
 http_request(S, Method, Path, Ver, Hdrs) :-
-	getline(S, Line),
-	split(Line, ' ', Method2, Rest),
-	split(Rest, ' ', Path, Rest2),
-	split(Rest2, '/', _, Ver),
-	string_upper(Method2, Method),
-	findall(Hdr, read_header(S, Hdr), Hdrs).
+	http_parse_request(S, request(Method, Path, Ver), Hdrs).
+
+% Serve pipelined requests on a connection until the client closes
+% it or asks to. Responses are buffered and go out together before
+% the next read would block...
+
+http_keep_alive(Goal, S) :-
+	catch(
+		http_parse_request(S, request(Method, Path, Ver), Hdrs),
+		error(resource_error(http_headers), _),
+		(http_write_response(S, 431, ["Connection":"close"], []), fail)
+	),
+	!,
+	call(Goal, S, Method, Path, Ver, Hdrs),
+	dict:get(Hdrs, "connection", Conn, ''),
+	string_lower(Conn, Conn2),
+	(	(Conn2 == "close" ; (Ver == "1.0", Conn2 \== "keep-alive"))
+	->	close(S)
+	;	http_keep_alive(Goal, S)
+	).
+http_keep_alive(_, S) :-
+	close(S).
 
 % Create a server...
 
 http_server(Goal, Opts) :-
 	(memberchk(port(Port), Opts) -> true ; Port = 0),
 	(	integer(Port)
-	->	format(atom(Host), ':~d', Port)
-	;	format(atom(Host), '~w', Port)
+	->	format(atom(Host), ':~d', [Port])
+	;	format(atom(Host), '~w', [Port])
 	),
 	server(Host, S, []),
 	accept(S, S2),
 		fork,
 		call(Goal, S2).
+
+% Create a keep-alive server, each connection is served by its own
+% task, which yields while the connection is idle...
+
+http_serve(Goal, Opts) :-
+	(memberchk(port(Port), Opts) -> true ; Port = 0),
+	(	integer(Port)
+	->	format(atom(Host), ':~d', [Port])
+	;	format(atom(Host), '~w', [Port])
+	),
+	fork,
+	server(Host, S, []),
+	accept(S, S2),
+		fork,
+		http_keep_alive(Goal, S2).
+http_serve(_, _) :-
+	wait.
@@ -40,6 +40,10 @@
     POSSIBILITY OF SUCH DAMAGE.
 */
 
+reverse(Xs, Ys) :-
+    '$reverse'(Xs, Ys0),
+    !,
+    Ys = Ys0.
 reverse(Xs, Ys) :-
     (	nonvar(Xs)
 	->	reverse_(Xs, Ys, [], Xs)
@@ -55,13 +59,21 @@ append([L0|Ls0], Ls) :-
     append(L0, Rest, Ls),
     append(Ls0, Rest).
 
-append([], R, R).
-append([X|L], R, [X|S]) :- append(L, R, S).
+append(L, R, S) :- '$append'(L, R, S0), !, S = S0.
+append(L, R, S) :- append_(L, R, S).
+
+append_([], R, R).
+append_([X|L], R, [X|S]) :- append_(L, R, S).
 
 member(X, [X|_]).
 member(X, [_|Xs]) :- member(X, Xs).
 
-memberchk(X, Xs) :- member(X, Xs), !.
+memberchk(X, Xs) :-
+	'$memberchk'(X, Xs, Tail),
+	(	Tail == []
+	->	true
+	;	member(X, Tail), !
+	).
 
 select(X, [X|T], T).
 select(X, [H|T], [H|Rest]) :- select(X, T, Rest).
@@ -176,6 +188,10 @@ flatten_(NonList, Tl, [NonList|Tl]).
 same_length([], []).
 same_length([_|As], [_|Bs]) :- same_length(As, Bs).
 
+sum_list(Xs, Sum) :-
+	'$sum_list'(Xs, Sum0),
+	!,
+	Sum = Sum0.
 sum_list(Xs, Sum) :-
 	sum_list_(Xs, 0, Sum).
 
@@ -185,6 +201,10 @@ sum_list_([X|Xs], Sum0, Sum) :-
 	Sum1 is Sum0 + X,
 	sum_list_(Xs, Sum1, Sum).
 
+prod_list(Xs, Prod) :-
+	'$prod_list'(Xs, Prod0),
+	!,
+	Prod = Prod0.
 prod_list(Xs, Prod) :-
 	prod_list_(Xs, 1, Prod).
 
@@ -194,6 +214,10 @@ prod_list_([X|Xs], Prod0, Prod) :-
 	Prod1 is Prod0 * X,
 	prod_list_(Xs, Prod1, Prod).
 
+max_list(Xs, Max) :-
+	'$max_list'(Xs, Max0),
+	!,
+	Max = Max0.
 max_list([H|T], Max) :-
 	max_list_(T, H, Max).
 max_list([], _) :- fail.
@@ -204,6 +228,10 @@ max_list_([H|T], Max0, Max) :-
 	Max1 is max(H, Max0),
 	max_list_(T, Max1, Max).
 
+min_list(Xs, Min) :-
+	'$min_list'(Xs, Min0),
+	!,
+	Min = Min0.
 min_list([H|T], Min) :-
 	min_list_(T, H, Min).
 min_list([], _) :- fail.
@@ -230,7 +258,10 @@ numlist(L, U, Ns) :-
 	must_be(L, integer, numlist/3, _),
 	must_be(U, integer, numlist/3, _),
 	L =< U,
-	numlist_(L, U, Ns).
+	(	'$numlist'(L, U, Ns0)
+	->	Ns = Ns0
+	;	numlist_(L, U, Ns)
+	).
 
 numlist_(U, U, List) :-
 	!,
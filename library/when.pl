@@ -2,72 +2,72 @@
 
 :- use_module(library(atts)).
 :- use_module(library(dcgs)).
+:- use_module(library(lists), [append/3]).
 
-:- meta_predicate(when(*, 0)).
+:- meta_predicate(when(+, 0)).
 :- attribute when/1.
 
-when(Cond, Goal) :-
-	Cond = nonvar(Var), !,
-	process_var_(Var, Cond, Goal).
-
-when(Cond, Goal) :-
-	Cond = ground(Var), !,
-	process_var_(Var, Cond, Goal).
+% A goal waiting on Cond is suspended on just enough vars that
+% Cond can't become true without one of them being bound, and is
+% tested again then. Suspensions are woken natively, see
+% '$suspend'/3.
 
+when(Cond, _) :-
+	var(Cond), !,
+	throw(error(instantiation_error, when/2)).
 when(Cond, Goal) :-
-	Cond = ?=(Var1, Var2), !,
-	process_var_(Var1, Cond, Goal),
-	process_var_(Var2, Cond, Goal).
+	(	when_true_(Cond)
+	->	call(Goal)
+	;	when_vars_(Cond, Vs),
+		suspend_(Vs, s(_, when:when(Cond, Goal)))
+	).
 
-when(Cond, Goal) :-
-	Cond = (Cond1,Cond2), !,
-	arg(1, Cond1, Var1),
-	arg(1, Cond2, Var2),
-	process_var_(Var1, Cond, Goal),
-	process_var_(Var2, Cond, Goal).
+when_true_(Cond) :-
+	var(Cond), !,
+	throw(error(instantiation_error, when/2)).
+when_true_(nonvar(X)) :- !,
+	nonvar(X).
+when_true_(ground(X)) :- !,
+	ground(X).
+when_true_(?=(X, Y)) :- !,
+	?=(X, Y).
+when_true_((A, B)) :- !,
+	when_true_(A),
+	when_true_(B).
+when_true_((A ; B)) :- !,
+	(	when_true_(A)
+	->	true
+	;	when_true_(B)
+	).
+when_true_(Cond) :-
+	throw(error(domain_error(when_condition, Cond), when/2)).
 
-when(Cond, Goal) :-
-	Cond = (Cond1;Cond2), !,
-	arg(1, Cond1, Var1),
-	arg(1, Cond2, Var2),
-	process_var_(Var1, Cond, Goal),
-	process_var_(Var2, Cond, Goal).
+when_vars_(nonvar(X), [X]).
+when_vars_(ground(X), [V]) :-
+	term_variables(X, [V|_]).
+when_vars_(?=(X, Y), Vs) :-
+	'$dif'(X, Y, Vs).
+when_vars_((A, B), Vs) :-
+	(	when_true_(A)
+	->	when_vars_(B, Vs)
+	;	when_vars_(A, Vs)
+	).
+when_vars_((A ; B), Vs) :-
+	when_vars_(A, Vs1),
+	when_vars_(B, Vs2),
+	append(Vs1, Vs2, Vs).
 
-process_var_(Var, Cond, Goal) :-
-	(	get_atts(Var, when(OldCond-OldGoal)) ->
-		(	NewCond = (Cond, OldCond),
-			NewGoal = (OldGoal, Goal),
-			put_atts(Var, -when(_))
-		)
-	;	(	NewCond = Cond,
-			NewGoal = Goal
-		)
-	),
-    put_atts(Var, when(NewCond-NewGoal)).
+suspend_([], _).
+suspend_([V|Vs], Susp) :-
+	'$suspend'(V, when, Susp),
+	suspend_(Vs, Susp).
 
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
-verify_attributes(Var, Other, Goals) :-
-	get_atts(Var, when(VarCond-VarGoal)),
-	(	var(Other) ->
-		get_atts(Other, when(OtherCond-OtherGoal)),
-		Goals =
-			(	VarCond
-			->	VarGoal
-			; 	(	VarCond == OtherCond
-				->	NewCond = VarCond
-				;	NewCond = (OtherCond,VarCond)
-				),
-			(	VarGoal == OtherGoal ->
-				NewGoal = VarGoal
-			;	NewGoal = (OtherGoal,VarGoal)
-			),
-			put_atts(Other, when(NewCond-NewGoal))
-			)
-	; Goals = [(VarCond -> VarGoal ; true)]
-	).
+verify_attributes(_, _, []).
 
 attribute_goals(Var) -->
-	{ get_atts(Var, when(Goals)),
-		put_atts(Var, -when(_)) },
-	[when:when(Var, Goals)].
+	{ get_atts(Var, when(L)),
+	  put_atts(Var, -when(_)),
+	  '$suspended_goals'(L, Gs) },
+	Gs.
@@ -0,0 +1,42 @@
+% maplist/3, foldl/4, include/3 and exclude/3 over one long list, with
+% the closure known where the call is written and with it only known
+% at run time, passed in by the caller.
+%
+%   tpl samples/apply.pl -g "bench(10000000),halt"
+
+inc(X, Y) :- Y is X + 1.
+add(X, S0, S) :- S is S0 + X.
+even(X) :- 0 is X /\ 1.
+
+known(maplist, L) :- maplist(inc, L, _).
+known(foldl, L) :- foldl(add, L, 0, _).
+known(include, L) :- include(even, L, _).
+known(exclude, L) :- exclude(even, L, _).
+
+passed(maplist, L, G) :- maplist(G, L, _).
+passed(foldl, L, G) :- foldl(G, L, 0, _).
+passed(include, L, G) :- include(G, L, _).
+passed(exclude, L, G) :- exclude(G, L, _).
+
+closure(maplist, inc).
+closure(foldl, add).
+closure(include, even).
+closure(exclude, even).
+
+bench(N) :-
+	numlist(1, N, L),
+	run(maplist, L),
+	run(foldl, L),
+	run(include, L),
+	run(exclude, L).
+
+run(Name, L) :-
+	closure(Name, G),
+	statistics(cputime, T0),
+	\+ \+ known(Name, L),
+	statistics(cputime, T1),
+	\+ \+ passed(Name, L, G),
+	statistics(cputime, T2),
+	Known is T1 - T0,
+	Passed is T2 - T1,
+	format("~w: known ~3f s, passed ~3f s~n", [Name, Known, Passed]).
@@ -0,0 +1,82 @@
+% library(assoc) through its C operations against the same t/5 trees
+% built by the Prolog code alone.
+%
+%   tpl samples/assoc.pl -g "bench,halt"
+
+:- use_module(library(assoc)).
+
+put(c, K, A0, V, A) :- put_assoc(K, A0, V, A).
+put(prolog, K, A0, V, A) :- assoc:insert(A0, K, V, A, _).
+
+get(c, K, A, V) :- get_assoc(K, A, V).
+get(prolog, K, A, V) :- assoc:get_assoc_(K, A, V).
+
+del(c, K, A0, V, A) :- del_assoc(K, A0, V, A).
+del(prolog, K, A0, V, A) :- assoc:delete(A0, K, V, A, _).
+
+% Insert N keys in a scattered order...
+
+build(N, Kind, A) :- build_(0, N, Kind, t, A).
+
+build_(N, N, _, A, A) :- !.
+build_(I, N, Kind, A0, A) :-
+    K is (I * 7919) mod N,
+    put(Kind, K, A0, v(I), A1),
+    I1 is I + 1,
+    build_(I1, N, Kind, A1, A).
+
+test1(N, Kind) :-
+    build(N, Kind, _).
+
+% Look up every key...
+
+test2(N, Kind) :-
+    build(N, Kind, A),
+    statistics(cputime, T0),
+    (between(1, N, K), get(Kind, K, A, _), fail ; true),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("  lookups ~w: ~3f~n", [Kind, T]).
+
+% Update a counter held in the assoc, as loop state...
+
+count(0, _, A, A) :- !.
+count(I, Kind, A0, A) :-
+    K is I mod 1000,
+    (get(Kind, K, A0, C0) -> true ; C0 = 0),
+    C is C0 + 1,
+    put(Kind, K, A0, C, A1),
+    I1 is I - 1,
+    count(I1, Kind, A1, A).
+
+test3(N, Kind) :-
+    count(N, Kind, t, _).
+
+% Insert then delete every key...
+
+drain(N, N, _, A, A) :- !.
+drain(I, N, Kind, A0, A) :-
+    del(Kind, I, A0, _, A1),
+    I1 is I + 1,
+    drain(I1, N, Kind, A1, A).
+
+test4(N, Kind) :-
+    build(N, Kind, A0), drain(0, N, Kind, A0, _).
+
+run(Kind, Goal) :-
+    statistics(cputime, T0),
+    call(Goal, Kind),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("~w ~w: ~3f~n", [Goal, Kind, T]).
+
+bench :-
+    forall(member(G, [test1(50000), test2(50000), test3(100000), test4(50000)]),
+        (run(c, G), run(prolog, G))),
+    numlist(1, 100000, L),
+    findall(K-K, member(K, L), Ps),
+    statistics(cputime, T0),
+    list_to_assoc(Ps, _),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("list_to_assoc(100000): ~3f~n", [T]).
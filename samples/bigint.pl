@@ -0,0 +1,35 @@
+% Big integer arithmetic: a factorial, a long Fibonacci run, modular
+% exponentiation with powm/3 and a sum of bigint differences that come
+% back into the small integer range. Build with 'make GMP=1' to compare
+% the GMP backend against the bundled imath.
+%
+%   tpl samples/bigint.pl -g "bench(5000),halt"
+
+fact(N, F) :- fact(N, 1, F).
+fact(0, F, F) :- !.
+fact(N, F0, F) :- F1 is F0 * N, N1 is N - 1, fact(N1, F1, F).
+
+fib(N, F) :- fib(N, 0, 1, F).
+fib(0, A, _, A) :- !.
+fib(N, A, B, F) :- C is A + B, N1 is N - 1, fib(N1, B, C, F).
+
+powms(0, _, S, S) :- !.
+powms(N, M, S0, S) :- S1 is (S0 + powm(N, 65537, M)) mod M, N1 is N - 1, powms(N1, M, S1, S).
+
+diffs(0, _, S, S) :- !.
+diffs(N, X, S0, S) :- S1 is S0 + ((X + N) - X), N1 is N - 1, diffs(N1, X, S1, S).
+
+run(factorial, N, D) :- fact(N, F), number_codes(F, Cs), length(Cs, D).
+run(fibonacci, N, D) :- M is N * 20, fib(M, F), D is msb(F) + 1.
+run(powm, N, D) :- M is 2^521 - 1, powms(N, M, 0, S), D is msb(S) + 1.
+run(diffs, N, S) :- X is 7^200, M is N * 100, diffs(M, X, 0, S).
+
+bench(N) :-
+    member(Kind, [factorial, fibonacci, powm, diffs]),
+    statistics(cputime, T0),
+    run(Kind, N, D),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("~w: ~d, ~3f~n", [Kind, D, T]),
+    fail.
+bench(_).
@@ -0,0 +1,31 @@
+% Meta-calls against direct calls: a loop calling a small predicate
+% directly and through call/N, and maplist/3 and foldl/4 over a list
+% with a user predicate and with a builtin.
+%
+%   tpl samples/calln.pl -g "bench(1000000),halt"
+
+inc(X, Y) :- Y is X + 1.
+add(X, Y, Z) :- Z is X + Y.
+
+direct(0) :- !.
+direct(N) :- inc(N, _), N1 is N - 1, direct(N1).
+
+meta(0, _) :- !.
+meta(N, G) :- call(G, N, _), N1 is N - 1, meta(N1, G).
+
+run(Name, Goal) :-
+	statistics(cputime, T0),
+	call(Goal),
+	statistics(cputime, T1),
+	T is T1 - T0,
+	format("~w: ~3f s~n", [Name, T]).
+
+bench(N) :-
+	numlist(1, N, L),
+	run(direct, direct(N)),
+	run('call/3', meta(N, inc)),
+	run('call/3 builtin', meta(N, succ)),
+	run('maplist/3', maplist(inc, L, _)),
+	run('maplist/3 builtin', maplist(succ, L, _)),
+	run('foldl/4', foldl(add, L, 0, _)),
+	run('foldl/4 builtin', foldl(plus, L, 0, _)).
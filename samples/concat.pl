@@ -0,0 +1,33 @@
+% Builds a long atom a piece at a time, with atom_concat/3 and with
+% atomic_list_concat/2, then splits a long string with split_string/4.
+% Each step extends the text built by the step before, so the time
+% should grow linearly with N rather than with its square.
+%
+%   tpl samples/concat.pl -g "bench(100000),halt"
+
+build_atom(0, A, A) :- !.
+build_atom(N, A0, A) :- atom_concat(A0, 'abcdefgh', A1), N1 is N - 1, build_atom(N1, A1, A).
+
+build_list(0, A, A) :- !.
+build_list(N, A0, A) :- atomic_list_concat([A0, N, ','], A1), N1 is N - 1, build_list(N1, A1, A).
+
+split(N, Len) :-
+    build_list(N, '', A),
+    atom_codes(A, Cs),
+    string_codes(S, Cs),
+    split_string(S, ",", "", L),
+    length(L, Len).
+
+run(atom_concat, N, Len) :- build_atom(N, '', A), atom_length(A, Len).
+run(atomic_list_concat, N, Len) :- build_list(N, '', A), atom_length(A, Len).
+run(split_string, N, Len) :- split(N, Len).
+
+bench(N) :-
+    member(Kind, [atom_concat, atomic_list_concat, split_string]),
+    statistics(cputime, T0),
+    run(Kind, N, Len),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("~w: ~d, ~3f~n", [Kind, Len, T]),
+    fail.
+bench(_).
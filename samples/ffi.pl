@@ -0,0 +1,40 @@
+% Per-call overhead of foreign functions: small libm and libc routines
+% called from a tight loop, as evaluable functions and as predicates.
+% The 'none' loop makes no call, it's the cost of the loop itself.
+%
+%   tpl samples/ffi.pl -g "bench(1000000),halt"
+
+:- dynamic(loop/2).
+:- initialization(register).
+
+% A clause compiled before a foreign function is registered won't see
+% it, so each loop is asserted afterwards with the call built by =../2.
+
+register :-
+	'$dlopen'('libm.so.6', 0, M),
+	'$register_function'(M, cbrt, [fp64], fp64),
+	'$register_function'(M, lround, [fp64], int64),
+	'$register_predicate'(M, fdim, [fp64,fp64], fp64),
+	'$dlopen'('libc.so.6', 0, C),
+	'$register_predicate'(C, labs, [int64], int64),
+	assertz((loop(_, 0) :- !)),
+	assertz((loop(none, N) :- N1 is N - 1, loop(none, N1))),
+	E1 =.. [cbrt, 27.0],
+	assertz((loop(cbrt, N) :- _ is E1, N1 is N - 1, loop(cbrt, N1))),
+	E2 =.. [lround, 2.6],
+	assertz((loop(lround, N) :- _ is E2, N1 is N - 1, loop(lround, N1))),
+	G1 =.. [fdim, 5.0, 2.0, _],
+	assertz((loop(fdim, N) :- G1, N1 is N - 1, loop(fdim, N1))),
+	G2 =.. [labs, -5, _],
+	assertz((loop(labs, N) :- G2, N1 is N - 1, loop(labs, N1))).
+
+bench(N) :-
+	member(F, [none, cbrt, lround, fdim, labs]),
+	statistics(cputime, T0),
+	loop(F, N),
+	statistics(cputime, T1),
+	T is T1 - T0,
+	Ns is integer(T * 1000000000 / N),
+	format("~w: ~3f s, ~d ns/call~n", [F, T, Ns]),
+	fail.
+bench(_).
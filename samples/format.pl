@@ -0,0 +1,31 @@
+% Calls format/3 with the same few format texts over and over, as
+% logging and report code does, writing to a stream and to an atom.
+% Reports the time for each and the calls per second.
+%
+%   tpl samples/format.pl -g "bench(1000000),halt"
+
+log(0, _) :- !.
+log(N, S) :-
+    format(S, "item ~w: ~a = ~d (~s)~n", [foo(N), bar, N, "abc"]),
+    N1 is N - 1,
+    log(N1, S).
+
+report(0) :- !.
+report(N) :-
+    format(atom(_), "~a~t~12|~d~n", [total, N]),
+    N1 is N - 1,
+    report(N1).
+
+run(stream, N) :- open('/dev/null', write, S), log(N, S), close(S).
+run(atom, N) :- report(N).
+
+bench(N) :-
+    member(Kind, [stream, atom]),
+    statistics(cputime, T0),
+    run(Kind, N),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    Rate is integer(N / max(T, 0.001)),
+    format("~w: ~3f, ~d calls/s~n", [Kind, T, Rate]),
+    fail.
+bench(_).
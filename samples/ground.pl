@@ -0,0 +1,34 @@
+% Copying a large ground term: copy_term/2, findall/3 and assertz/1
+% each take a fresh copy of it every time round.
+%
+%   tpl samples/ground.pl -g "bench(20000),halt"
+
+:- dynamic(fact/1).
+
+big(T) :-
+	numlist(1, 1000, L),
+	findall(f(X,g(X,"str"),[a,b,c]), member(X, L), T).
+
+loop_copy(0, _) :- !.
+loop_copy(N, T) :- copy_term(T, _), N1 is N - 1, loop_copy(N1, T).
+
+loop_findall(0, _) :- !.
+loop_findall(N, T) :- findall(T, true, _), N1 is N - 1, loop_findall(N1, T).
+
+loop_assert(0, _) :- !.
+loop_assert(N, T) :- assertz(fact(T)), retract(fact(_)), N1 is N - 1, loop_assert(N1, T).
+
+run(copy_term, N, T) :- loop_copy(N, T).
+run(findall, N, T) :- loop_findall(N, T).
+run(assertz, N, T) :- loop_assert(N, T).
+
+bench(N) :-
+	big(T),
+	member(Kind, [copy_term, findall, assertz]),
+	statistics(cputime, T0),
+	run(Kind, N, T),
+	statistics(cputime, T1),
+	T2 is T1 - T0,
+	format("~w: ~3f~n", [Kind, T2]),
+	fail.
+bench(_).
@@ -0,0 +1,25 @@
+% Deterministic library(lists) calls on a 100,000 element list.
+%
+%   tpl samples/lists.pl -g "bench,halt"
+
+:- use_module(library(lists)).
+
+test(reverse, L, N) :- between(1, N, _), reverse(L, _), fail.
+test(append, L, N) :- between(1, N, _), append(L, [x], _), fail.
+test(memberchk, L, N) :- between(1, N, _), memberchk(100000, L), fail.
+test(sum_list, L, N) :- between(1, N, _), sum_list(L, _), fail.
+test(max_list, L, N) :- between(1, N, _), max_list(L, _), fail.
+test(numlist, _, N) :- between(1, N, _), numlist(1, 100000, _), fail.
+test(length, L, N) :- between(1, N, _), length(L, _), fail.
+test(nth1, L, N) :- between(1, N, _), nth1(99999, L, _), fail.
+test(_, _, _).
+
+bench :-
+    numlist(1, 100000, L),
+    forall(member(T, [reverse, append, memberchk, sum_list, max_list, numlist, length, nth1]),
+        (   statistics(cputime, T0),
+            test(T, L, 50),
+            statistics(cputime, T1),
+            Time is T1 - T0,
+            format("~w: ~3f~n", [T, Time])
+        )).
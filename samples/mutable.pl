@@ -0,0 +1,81 @@
+% A 0/1 knapsack table kept as one row updated in place, held in an
+% array, a term changed with setarg/3 or nb_setarg/3, or dynamic
+% facts, and against rebuilding the row as a list for each item.
+%
+%   tpl samples/mutable.pl -g "bench,halt"
+
+:- dynamic(cell/2).
+
+item(I, Wt, V) :- Wt is 1 + (I * 37) mod 23, V is 1 + (I * 53) mod 31.
+
+% The capacity is kept under 127 as functor/3 won't make a bigger
+% row...
+
+new(array, W1, A) :- array_new(W1, 0, A).
+new(setarg, W1, T) :- functor(T, row, W1), zero(W1, T).
+new(nb_setarg, W1, T) :- functor(T, row, W1), zero(W1, T).
+new(assert, W1, db) :- retractall(cell(_, _)), forall(between(1, W1, J), assertz(cell(J, 0))).
+
+zero(0, _) :- !.
+zero(J, T) :- setarg(J, T, 0), J1 is J - 1, zero(J1, T).
+
+get(array, A, J, X) :- array_get(A, J, X).
+get(setarg, T, J, X) :- arg(J, T, X).
+get(nb_setarg, T, J, X) :- arg(J, T, X).
+get(assert, _, J, X) :- cell(J, X).
+
+set(array, A, J, X) :- array_set(A, J, X).
+set(setarg, T, J, X) :- setarg(J, T, X).
+set(nb_setarg, T, J, X) :- nb_setarg(J, T, X).
+set(assert, _, J, X) :- retract(cell(J, _)), assertz(cell(J, X)).
+
+knap(rebuild, N, W, Best) :- !,
+    W1 is W + 1,
+    length(R0, W1), maplist(=(0), R0),
+    rows(1, N, R0, R),
+    last(R, Best).
+knap(Kind, N, W, Best) :-
+    W1 is W + 1,
+    new(Kind, W1, S),
+    items(1, N, W1, Kind, S),
+    get(Kind, S, W1, Best).
+
+items(I, N, _, _, _) :- I > N, !.
+items(I, N, W1, Kind, S) :-
+    item(I, Wt, V),
+    cols(W1, Wt, V, Kind, S),
+    I1 is I + 1,
+    items(I1, N, W1, Kind, S).
+
+cols(J, Wt, _, _, _) :- J =< Wt, !.
+cols(J, Wt, V, Kind, S) :-
+    K is J - Wt,
+    get(Kind, S, J, X), get(Kind, S, K, Y),
+    Z is max(X, Y + V),
+    set(Kind, S, J, Z),
+    J1 is J - 1,
+    cols(J1, Wt, V, Kind, S).
+
+rows(I, N, R, R) :- I > N, !.
+rows(I, N, R0, R) :-
+    item(I, Wt, V),
+    row(R0, Wt, R0, V, R1),
+    I1 is I + 1,
+    rows(I1, N, R1, R).
+
+row([], _, _, _, []).
+row([X|Xs], Wt, Ys, V, [Z|Zs]) :-
+    (   Wt > 0
+    ->  Z = X, Wt1 is Wt - 1, row(Xs, Wt1, Ys, V, Zs)
+    ;   Ys = [Y|Ys1], Z is max(X, Y + V), row(Xs, 0, Ys1, V, Zs)
+    ).
+
+bench :-
+    member(Kind, [array, setarg, nb_setarg, assert, rebuild]),
+    statistics(cputime, T0),
+    knap(Kind, 1000, 120, Best),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("~w: best ~w, ~3f~n", [Kind, Best, T]),
+    fail.
+bench.
@@ -0,0 +1,46 @@
+% Cost of sound unification: run each test with occurs_check
+% false and true and compare the times.
+%
+%   tpl samples/occurs.pl -g "bench,halt"
+
+% Binding variables to big runtime-built terms...
+
+nrev([], []).
+nrev([H|T], R) :- nrev(T, RT), append(RT, [H], R).
+
+test1(N) :-
+    numlist(1, 400, L),
+    between(1, N, _), nrev(L, _), fail.
+test1(_).
+
+% Binding variables to big ground terms from clauses...
+
+big(f([a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t,u,v,w,x,y,z],
+      g(1,2,3,4,5,6,7,8,9,10), h("some text", [1.0,2.0,3.0]))).
+
+test2(N) :-
+    between(1, N, _), big(X), Y = w(X, X, X), Z = Y, Z = w(_, _, _), fail.
+test2(_).
+
+% Binding to a term with heavily shared subterms...
+
+dag(0, T, T) :- !.
+dag(N, T0, T) :- N1 is N-1, dag(N1, f(T0, T0), T).
+
+test3(N) :-
+    dag(40, a, T),
+    between(1, N, _), X = g(T, _), X = g(_, Y), Y = h(X), fail.
+test3(_).
+
+run(Flag, Goal) :-
+    set_prolog_flag(occurs_check, Flag),
+    statistics(cputime, T0),
+    call(Goal),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    format("~w ~w: ~3f~n", [Goal, Flag, T]).
+
+bench :-
+    forall(member(G, [test1(30), test2(200000), test3(100000)]),
+        (run(false, G), run(true, G))),
+    set_prolog_flag(occurs_check, false).
@@ -0,0 +1,37 @@
+% Parse throughput: writes a file of facts, with comments and quoted
+% atoms, then reads it back term by term and reports MB/s.
+%
+%   tpl samples/parse.pl -g "bench(200000),halt"
+
+file('parse_bench.tmp').
+
+fact(I, fact(I, 'Some quoted atom with spaces', "a string of text", name_with_underscores, [1,2,3], X-Y, f(X,Y), 3.14)).
+
+write_file(N) :-
+	file(F),
+	open(F, write, S),
+	forall(between(1, N, I),
+		(	( I mod 10 =:= 0 -> format(S, "% comment line ~d~n/* block~n comment */~n", [I]) ; true ),
+			fact(I, T),
+			writeq(S, T), write(S, '.'), nl(S)
+		)),
+	close(S).
+
+read_all(S, N0, N) :-
+	read_term(S, T, []),
+	( T == end_of_file -> N = N0 ; N1 is N0 + 1, read_all(S, N1, N) ).
+
+bench(N) :-
+	write_file(N),
+	file(F),
+	size_file(F, Size),
+	open(F, read, S),
+	statistics(cputime, T0),
+	read_all(S, 0, Count),
+	statistics(cputime, T1),
+	close(S),
+	delete_file(F),
+	T is T1 - T0,
+	MB is Size / 1048576,
+	Rate is MB / T,
+	format("~d terms, ~2f MB in ~3f s, ~2f MB/s~n", [Count, MB, T, Rate]).
@@ -0,0 +1,29 @@
+% Keyword search over a large atom with sub_atom/5, counting every
+% place each keyword occurs.
+%
+%   tpl samples/sub_atom.pl -g "bench(100000),halt"
+
+text(N, T) :-
+	numlist(1, N, L),
+	findall(W, (member(I, L), word(I, W)), Ws),
+	atomic_list_concat(Ws, ' ', T).
+
+word(I, W) :- I mod 97 =:= 0, !, W = needle.
+word(I, W) :- I mod 3 =:= 0, !, W = 'héllo'.
+word(I, W) :- number_codes(I, Cs), atom_codes(W, Cs).
+
+count(T, K, N) :-
+	findall(B, sub_atom(T, B, _, _, K), Bs),
+	length(Bs, N).
+
+bench(N) :-
+	text(N, T),
+	atom_length(T, Len),
+	member(K, [needle, 'héllo', '12345', missing]),
+	statistics(cputime, T0),
+	count(T, K, C),
+	statistics(cputime, T1),
+	T2 is T1 - T0,
+	format("~w: ~d found in ~d chars, ~3f~n", [K, C, Len, T2]),
+	fail.
+bench(_).
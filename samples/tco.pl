@@ -0,0 +1,36 @@
+% Deterministic loops whose last call reuses the caller's frame, so
+% they run in constant frame space however many times they go round.
+% Each reports its time and how many of its last calls got a reused
+% frame, and stops with a non-zero exit status if one didn't.
+%
+%   tpl samples/tco.pl -g "bench(100000000),halt"
+
+count(0) :- !.
+count(N) :- N1 is N - 1, count(N1).
+
+sum(0, S, S) :- !.
+sum(N, S0, S) :- S1 is S0 + N, N1 is N - 1, sum(N1, S1, S).
+
+even(0) :- !.
+even(N) :- N1 is N - 1, odd(N1).
+
+odd(0) :- !.
+odd(N) :- N1 is N - 1, even(N1).
+
+run(count, N, count/1) :- count(N).
+run(sum, N, sum/3) :- sum(N, 0, _).
+run(mutual, N, odd/1) :- even(N).
+
+bench(N) :-
+    member(Kind, [count, sum, mutual]),
+    statistics(cputime, T0),
+    run(Kind, N, PI),
+    statistics(cputime, T1),
+    T is T1 - T0,
+    statistics(tco, L),
+    member(PI-tco(Calls, Done, _, _), L),
+    format("~w: ~d last calls, ~d reused, ~3f~n", [Kind, Calls, Done, T]),
+    Calls - Done > 1,
+    format("~w: frames not reused~n", [Kind]),
+    halt(1).
+bench(_).
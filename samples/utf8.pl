@@ -0,0 +1,32 @@
+% Char lengths and offsets in a long non-ASCII atom: atom_length/2
+% and sub_atom/5 at given positions, repeated many times.
+%
+%   tpl samples/utf8.pl -g "bench(100000),halt"
+
+word(I, W) :- X is I mod 4, nth0(X, [abc, 'héllo', 'wörld', '中文'], W).
+
+text(N, T) :-
+	numlist(1, N, L),
+	findall(W, (member(I, L), word(I, W)), Ws),
+	atomic_list_concat(Ws, ' ', T).
+
+loop_length(0, _) :- !.
+loop_length(N, T) :- atom_length(T, _), N1 is N - 1, loop_length(N1, T).
+
+loop_sub(0, _, _) :- !.
+loop_sub(N, T, Len) :-
+	B is (N * 7919) mod (Len - 10),
+	sub_atom(T, B, 10, _, _),
+	N1 is N - 1,
+	loop_sub(N1, T, Len).
+
+bench(N) :-
+	text(N, T),
+	atom_length(T, Len),
+	statistics(cputime, T0),
+	loop_length(N, T),
+	statistics(cputime, T1),
+	loop_sub(N, T, Len),
+	statistics(cputime, T2),
+	D1 is T1 - T0, D2 is T2 - T1,
+	format("atom_length: ~3f, sub_atom: ~3f (~d chars)~n", [D1, D2, Len]).
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "heap.h"
+#include "prolog.h"
+#include "query.h"
+
+// A fixed-size mutable array. Unlike dicts an update is
+// done in place and isn't undone on backtracking, so get and set are
+// O(1) and an atomic value is stored without any allocation.
+//
+// Values are copied in, so must be ground. Indexes start at 1, as
+// with arg/3.
+
+typedef struct {
+	cell c;						// an atomic value
+	cell *cells;				// or else a copy of a compound
+} array_elem;
+
+typedef struct {
+	pl_idx_t nbr;
+	array_elem elems[];
+} array;
+
+#define GET_ARRAY(c) ((array*)(c)->val_blob->ptr)
+
+static void elem_release(array_elem *e)
+{
+	if (e->cells) {
+		chk_cells(e->cells, e->cells->nbr_cells);
+		free(e->cells);
+		e->cells = NULL;
+	} else
+		unshare_cell(&e->c);
+}
+
+static void array_free(void *ptr)
+{
+	array *a = ptr;
+
+	for (pl_idx_t i = 0; i < a->nbr; i++)
+		elem_release(&a->elems[i]);
+
+	free(a);
+}
+
+static bool elem_set(query *q, array_elem *e, cell *c, pl_idx_t c_ctx)
+{
+	if (c->nbr_cells == 1) {
+		share_cell(c);
+		elem_release(e);
+		e->c = *c;
+		return true;
+	}
+
+	if (!init_tmp_heap(q))
+		return false;
+
+	cell *tmp = deep_clone_to_tmp(q, c, c_ctx);
+	if (!tmp) return false;
+	pl_idx_t nbr_cells = tmp_heap_used(q);
+	cell *cells = malloc(sizeof(cell) * nbr_cells);
+	if (!cells) return false;
+	safe_copy_cells(cells, tmp, nbr_cells);
+	elem_release(e);
+	e->cells = cells;
+	return true;
+}
+
+size_t array_count(const cell *c)
+{
+	return GET_ARRAY(c)->nbr;
+}
+
+static bool fn_is_array_1(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	return is_array(p1);
+}
+
+static bool fn_array_new_3(query *q)
+{
+	GET_FIRST_ARG(p1,integer);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,variable);
+
+	if (is_negative(p1))
+		return throw_error(q, p1, p1_ctx, "domain_error", "not_less_than_zero");
+
+	check_heap_error(!is_bigint(p1) && (get_smallint(p1) < UINT32_MAX));
+
+	if (has_vars(q, p2, p2_ctx))
+		return throw_error(q, p2, p2_ctx, "instantiation_error", "not_sufficiently_instantiated");
+
+	pl_idx_t nbr = get_smallint(p1);
+	array *a = calloc(1, sizeof(array) + (sizeof(array_elem) * nbr));
+	blob *b = malloc(sizeof(blob));
+
+	check_heap_error(a && b, free(a); free(b));
+
+	b->refcnt = 1;
+	b->ptr = (char*)a;
+	b->free_fn = array_free;
+	cell tmp = {0};
+	tmp.tag = TAG_BLOB;
+	tmp.nbr_cells = 1;
+	tmp.flags = FLAG_MANAGED | FLAG_BLOB_ARRAY;
+	tmp.val_blob = b;
+
+	for (a->nbr = 0; a->nbr < nbr; a->nbr++)
+		check_heap_error(elem_set(q, &a->elems[a->nbr], p2, p2_ctx), unshare_cell(&tmp));
+
+	bool ok = unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
+	unshare_cell(&tmp);
+	return ok;
+}
+
+static bool fn_array_size_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,integer_or_var);
+
+	if (!is_array(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "array");
+
+	cell tmp;
+	make_int(&tmp, array_count(p1));
+	return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+}
+
+static array_elem *get_elem(cell *p1, cell *p2)
+{
+	if (is_bigint(p2) || (get_smallint(p2) < 1) || (get_smallint(p2) > GET_ARRAY(p1)->nbr))
+		return NULL;
+
+	return &GET_ARRAY(p1)->elems[get_smallint(p2)-1];
+}
+
+static bool fn_array_get_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,integer);
+	GET_NEXT_ARG(p3,any);
+
+	if (!is_array(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "array");
+
+	const array_elem *e = get_elem(p1, p2);
+
+	if (!e)
+		return false;
+
+	if (!e->cells)
+		return unify(q, p3, p3_ctx, (cell*)&e->c, q->st.curr_frame);
+
+	cell *tmp = alloc_on_heap(q, e->cells->nbr_cells);
+	check_heap_error(tmp);
+	safe_copy_cells(tmp, e->cells, e->cells->nbr_cells);
+	return unify(q, p3, p3_ctx, tmp, q->st.curr_frame);
+}
+
+static bool fn_array_set_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,integer);
+	GET_NEXT_ARG(p3,any);
+
+	if (!is_array(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "array");
+
+	if (has_vars(q, p3, p3_ctx))
+		return throw_error(q, p3, p3_ctx, "instantiation_error", "not_sufficiently_instantiated");
+
+	array_elem *e = get_elem(p1, p2);
+
+	if (!e)
+		return false;
+
+	check_heap_error(elem_set(q, e, p3, p3_ctx));
+	return true;
+}
+
+static bool fn_array_to_list_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,list_or_nil_or_var);
+
+	if (!is_array(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "array");
+
+	const array *a = GET_ARRAY(p1);
+
+	if (!a->nbr) {
+		cell tmp;
+		make_atom(&tmp, g_nil_s);
+		return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+	}
+
+	for (pl_idx_t i = 0; i < a->nbr; i++) {
+		const array_elem *e = &a->elems[i];
+		cell *c = e->cells ? e->cells : (cell*)&e->c;
+
+		if (i == 0)
+			allocate_list(q, c);
+		else
+			append_list(q, c);
+	}
+
+	cell *l = end_list(q);
+	check_heap_error(l);
+	return unify(q, p2, p2_ctx, l, q->st.curr_frame);
+}
+
+builtins g_array_bifs[] =
+{
+	{"is_array", 1, fn_is_array_1, "+term", false, BLAH},
+	{"array_new", 3, fn_array_new_3, "+integer,+term,-array", false, BLAH},
+	{"array_size", 2, fn_array_size_2, "+array,-integer", false, BLAH},
+	{"array_get", 3, fn_array_get_3, "+array,+integer,?term", false, BLAH},
+	{"array_set", 3, fn_array_set_3, "+array,+integer,+term", false, BLAH},
+	{"array_to_list", 2, fn_array_to_list_2, "+array,-list", false, BLAH},
+
+	{0}
+};
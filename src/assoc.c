@@ -0,0 +1,664 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "heap.h"
+#include "prolog.h"
+#include "query.h"
+
+// Library(assoc) keeps its t(K,V,Balance,L,R) AVL trees, these just
+// walk and rebuild them in C. An update makes the same new nodes the
+// Prolog code would, and shares the rest of the old tree by binding a
+// new variable to each untouched subtree.
+//
+// Anything not in the expected form makes these fail, and the library
+// then carries on in Prolog, so all the usual semantics are kept.
+
+typedef struct {
+	cell *c, tmp;				// anything but a compound is copied
+	pl_idx_t c_ctx;
+} elem;
+
+typedef struct node_ node;
+
+struct node_ {
+	cell *c;					// the term, while unchanged
+	pl_idx_t c_ctx;
+	elem k, v;
+	node *l, *r;				// NULL for an empty tree
+	char bal;
+	bool expanded;
+};
+
+#define NODES_PER_BLOCK 256
+
+typedef struct block_ block;
+
+struct block_ {
+	block *next;
+	unsigned nbr;
+	node nodes[NODES_PER_BLOCK];
+};
+
+typedef struct {
+	query *q;
+	block *blocks;
+	node *hit;
+	elem key, val;
+	pl_idx_t t_s;
+} tree;
+
+static void set_elem(query *q, elem *e, cell *c, pl_idx_t c_ctx)
+{
+	c = deref(q, c, c_ctx);
+	e->c_ctx = q->latest_ctx;
+
+	if (is_structure(c)) {
+		e->c = c;
+		return;
+	}
+
+	e->tmp = *c;
+	e->c = &e->tmp;
+}
+
+static void copy_elem(elem *dst, const elem *src)
+{
+	*dst = *src;
+
+	if (src->c == &src->tmp)
+		dst->c = &dst->tmp;
+}
+
+static void init_tree(tree *t, query *q)
+{
+	t->q = q;
+	t->blocks = NULL;
+	t->hit = NULL;
+	t->t_s = index_from_pool(q->pl, "t");
+}
+
+static void free_tree(tree *t)
+{
+	while (t->blocks) {
+		block *save = t->blocks;
+		t->blocks = save->next;
+		free(save);
+	}
+}
+
+static node *new_node(tree *t)
+{
+	block *b = t->blocks;
+
+	if (!b || (b->nbr == NODES_PER_BLOCK)) {
+		if (!(b = malloc(sizeof(block))))
+			return NULL;
+
+		b->next = t->blocks;
+		b->nbr = 0;
+		t->blocks = b;
+	}
+
+	return &b->nodes[b->nbr++];
+}
+
+static node *make_node(tree *t, const elem *k, const elem *v, char bal, node *l, node *r)
+{
+	node *n = new_node(t);
+
+	if (!n)
+		return NULL;
+
+	n->c = NULL;
+	copy_elem(&n->k, k);
+	copy_elem(&n->v, v);
+	n->bal = bal;
+	n->l = l;
+	n->r = r;
+	n->expanded = true;
+	return n;
+}
+
+// A subtree is NULL if it's t, else a node to be expanded when
+// needed...
+
+static bool get_tree(tree *t, cell *c, pl_idx_t c_ctx, node **n)
+{
+	query *q = t->q;
+	c = deref(q, c, c_ctx);
+	c_ctx = q->latest_ctx;
+
+	if (!is_interned(c) || (c->val_off != t->t_s))
+		return false;
+
+	if (!c->arity) {
+		*n = NULL;
+		return true;
+	}
+
+	if ((c->arity != 5) || !(*n = new_node(t)))
+		return false;
+
+	(*n)->c = c;
+	(*n)->c_ctx = c_ctx;
+	(*n)->expanded = false;
+	return true;
+}
+
+static bool expand(tree *t, node *n)
+{
+	if (n->expanded)
+		return true;
+
+	query *q = t->q;
+	cell *arg = n->c + 1;
+	set_elem(q, &n->k, arg, n->c_ctx);
+	arg += arg->nbr_cells;
+	set_elem(q, &n->v, arg, n->c_ctx);
+	arg += arg->nbr_cells;
+	cell *b = deref(q, arg, n->c_ctx);
+	arg += arg->nbr_cells;
+
+	if (!is_interned(b) || b->arity)
+		return false;
+
+	if (b->val_off == g_lt_s)
+		n->bal = '<';
+	else if (b->val_off == g_minus_s)
+		n->bal = '-';
+	else if (b->val_off == g_gt_s)
+		n->bal = '>';
+	else
+		return false;
+
+	if (!get_tree(t, arg, n->c_ctx, &n->l))
+		return false;
+
+	arg += arg->nbr_cells;
+
+	if (!get_tree(t, arg, n->c_ctx, &n->r))
+		return false;
+
+	n->expanded = true;
+	return true;
+}
+
+static int compare_key(tree *t, const node *n)
+{
+	return compare(t->q, t->key.c, t->key.c_ctx, n->k.c, n->k.c_ctx);
+}
+
+// The rotations of avl_geq/3, with table2/3...
+
+static void table2(char b1, char *b2, char *b3)
+{
+	*b2 = b1 == '>' ? '<' : '-';
+	*b3 = b1 == '<' ? '>' : '-';
+}
+
+static bool avl_geq(tree *t, node *a, node **out, bool *changed)
+{
+	node *b = a->bal == '>' ? a->r : a->bal == '<' ? a->l : NULL;
+	node *x, *l, *r;
+	char b2, b3;
+
+	if (!b || !expand(t, b))
+		return false;
+
+	if ((a->bal == '>') && (b->bal == '>')) {
+		l = make_node(t, &a->k, &a->v, '-', a->l, b->l);
+		*out = l ? make_node(t, &b->k, &b->v, '-', l, b->r) : NULL;
+		*changed = true;
+	} else if ((a->bal == '>') && (b->bal == '-')) {
+		l = make_node(t, &a->k, &a->v, '>', a->l, b->l);
+		*out = l ? make_node(t, &b->k, &b->v, '<', l, b->r) : NULL;
+		*changed = false;
+	} else if ((a->bal == '<') && (b->bal == '<')) {
+		r = make_node(t, &a->k, &a->v, '-', b->r, a->r);
+		*out = r ? make_node(t, &b->k, &b->v, '-', b->l, r) : NULL;
+		*changed = true;
+	} else if ((a->bal == '<') && (b->bal == '-')) {
+		r = make_node(t, &a->k, &a->v, '<', b->r, a->r);
+		*out = r ? make_node(t, &b->k, &b->v, '>', b->l, r) : NULL;
+		*changed = false;
+	} else if (a->bal == '>') {
+		if (!(x = b->l) || !expand(t, x))
+			return false;
+
+		table2(x->bal, &b2, &b3);
+		l = make_node(t, &a->k, &a->v, b2, a->l, x->l);
+		r = make_node(t, &b->k, &b->v, b3, x->r, b->r);
+		*out = l && r ? make_node(t, &x->k, &x->v, '-', l, r) : NULL;
+		*changed = true;
+	} else {
+		if (!(x = b->r) || !expand(t, x))
+			return false;
+
+		table2(x->bal, &b2, &b3);
+		l = make_node(t, &b->k, &b->v, b2, b->l, x->l);
+		r = make_node(t, &a->k, &a->v, b3, x->r, a->r);
+		*out = l && r ? make_node(t, &x->k, &x->v, '-', l, r) : NULL;
+		*changed = true;
+	}
+
+	return *out;
+}
+
+// As insert/5 with adjust/5 and table/5. 'n' is NULL for t...
+
+static bool insert(tree *t, node *n, node **out, bool *grew)
+{
+	if (!n) {
+		*grew = true;
+		return (*out = make_node(t, &t->key, &t->val, '-', NULL, NULL));
+	}
+
+	if (!expand(t, n))
+		return false;
+
+	int ok = compare_key(t, n);
+
+	if (!ok) {
+		*grew = false;
+		return (*out = make_node(t, &n->k, &t->val, n->bal, n->l, n->r));
+	}
+
+	bool left = ok < 0;
+	node *child;
+
+	if (!insert(t, left ? n->l : n->r, &child, grew))
+		return false;
+
+	node *n2 = make_node(t, &n->k, &n->v, n->bal, left ? child : n->l, left ? n->r : child);
+
+	if (!n2)
+		return false;
+
+	if (!*grew) {
+		*out = n2;
+		return true;
+	}
+
+	bool rebalance = (n->bal == '<') ? left : (n->bal == '>') ? !left : false;
+	*grew = n->bal == '-';
+
+	if (rebalance) {
+		bool changed;
+		return avl_geq(t, n2, out, &changed);
+	}
+
+	n2->bal = n->bal != '-' ? '-' : left ? '<' : '>';
+	*out = n2;
+	return true;
+}
+
+// As deladjust/5 with deltable/5, for a new node 'n' one of whose
+// subtrees may have got shallower...
+
+static bool deladjust(tree *t, node *n, bool shrunk, bool left, node **out, bool *changed)
+{
+	if (!n)
+		return false;
+
+	if (!shrunk) {
+		*out = n;
+		*changed = false;
+		return true;
+	}
+
+	bool rebalance = (n->bal == '<') ? !left : (n->bal == '>') ? left : false;
+
+	if (rebalance)
+		return avl_geq(t, n, out, changed);
+
+	*changed = n->bal != '-';
+	n->bal = n->bal != '-' ? '-' : left ? '>' : '<';
+	*out = n;
+	return true;
+}
+
+// As del_min_assoc/5 or del_max_assoc/5, leaving the removed node
+// in 'hit'...
+
+static bool del_end(tree *t, node *n, bool max, node **hit, node **out, bool *changed)
+{
+	if (!n || !expand(t, n))
+		return false;
+
+	node *next = max ? n->r : n->l;
+
+	if (!next) {
+		*hit = n;
+		*out = max ? n->l : n->r;
+		*changed = true;
+		return true;
+	}
+
+	node *child;
+	bool shrunk;
+
+	if (!del_end(t, next, max, hit, &child, &shrunk))
+		return false;
+
+	node *n2 = make_node(t, &n->k, &n->v, n->bal, max ? n->l : child, max ? child : n->r);
+	return deladjust(t, n2, shrunk, !max, out, changed);
+}
+
+// As delete/5...
+
+static bool delete(tree *t, node *n, node **out, bool *changed)
+{
+	if (!n || !expand(t, n))
+		return false;
+
+	int ok = compare_key(t, n);
+	node *child, *end, *n2;
+	bool shrunk;
+
+	if (!ok) {
+		t->hit = n;
+
+		if (!n->l || !n->r) {
+			*out = n->l ? n->l : n->r;
+			*changed = true;
+			return true;
+		}
+
+		if (n->bal == '>') {
+			if (!del_end(t, n->r, false, &end, &child, &shrunk))
+				return false;
+
+			n2 = make_node(t, &end->k, &end->v, '>', n->l, child);
+			return deladjust(t, n2, shrunk, false, out, changed);
+		}
+
+		if (!del_end(t, n->l, true, &end, &child, &shrunk))
+			return false;
+
+		n2 = make_node(t, &end->k, &end->v, n->bal, child, n->r);
+		return deladjust(t, n2, shrunk, true, out, changed);
+	}
+
+	bool left = ok < 0;
+
+	if (!delete(t, left ? n->l : n->r, &child, &shrunk))
+		return false;
+
+	n2 = make_node(t, &n->k, &n->v, n->bal, left ? child : n->l, left ? n->r : child);
+	return deladjust(t, n2, shrunk, left, out, changed);
+}
+
+static bool elem_var(const elem *e)
+{
+	return is_variable(e->c) || is_structure(e->c);
+}
+
+static pl_idx_t tree_cells(const node *n)
+{
+	return !n || n->c ? 1 : 4 + tree_cells(n->l) + tree_cells(n->r);
+}
+
+static unsigned tree_vars(const node *n)
+{
+	if (!n)
+		return 0;
+
+	if (n->c)
+		return 1;
+
+	return elem_var(&n->k) + elem_var(&n->v) + tree_vars(n->l) + tree_vars(n->r);
+}
+
+// An arg as a single cell in the current frame. Anything but an
+// atomic is bound to a new variable...
+
+static void put_elem(query *q, cell *c, pl_idx_t c_ctx, unsigned *var_nbr, cell *dst)
+{
+	if (!is_variable(c) && !is_structure(c)) {
+		*dst = *c;
+		share_cell(dst);
+		return;
+	}
+
+	make_var(dst, g_anon_s, (*var_nbr)++);
+	unify(q, c, c_ctx, dst, q->st.curr_frame);
+}
+
+static cell *put_tree(tree *t, const node *n, unsigned *var_nbr, cell *dst)
+{
+	if (!n) {
+		make_atom(dst, t->t_s);
+		return dst + 1;
+	}
+
+	if (n->c) {
+		put_elem(t->q, n->c, n->c_ctx, var_nbr, dst);
+		return dst + 1;
+	}
+
+	cell *save_dst = dst++;
+	put_elem(t->q, n->k.c, n->k.c_ctx, var_nbr, dst++);
+	put_elem(t->q, n->v.c, n->v.c_ctx, var_nbr, dst++);
+	make_atom(dst++, n->bal == '<' ? g_lt_s : n->bal == '>' ? g_gt_s : g_minus_s);
+	dst = put_tree(t, n->l, var_nbr, dst);
+	dst = put_tree(t, n->r, var_nbr, dst);
+	make_struct(save_dst, t->t_s, NULL, 5, dst - save_dst - 1);
+	return dst;
+}
+
+// Unifies the last arg with the new tree, or with the old subtree it
+// came down to. Slots may move when the variables are made, so the
+// arg is only got after...
+
+static bool unify_tree(tree *t, const node *root)
+{
+	query *q = t->q;
+
+	if (root && root->c) {
+		cell *p = deref(q, get_raw_arg(q, q->st.curr_cell->arity), q->st.curr_frame);
+		pl_idx_t p_ctx = q->latest_ctx;
+		return unify(q, p, p_ctx, root->c, root->c_ctx);
+	}
+
+	unsigned nbr_vars = tree_vars(root), var_nbr = 0;
+
+	if (nbr_vars && !(var_nbr = create_vars(q, nbr_vars)))
+		return false;
+
+	cell *tmp = alloc_on_heap(q, tree_cells(root));
+	check_heap_error(tmp);
+	put_tree(t, root, &var_nbr, tmp);
+	cell *p = deref(q, get_raw_arg(q, q->st.curr_cell->arity), q->st.curr_frame);
+	pl_idx_t p_ctx = q->latest_ctx;
+	return unify(q, p, p_ctx, tmp, q->st.curr_frame);
+}
+
+// Tree is where the search stopped: t if it got to the key, else a
+// subterm that isn't an assoc and that the caller reports...
+
+static bool fn_sys_assoc_get_4(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+	GET_NEXT_ARG(p4,variable);
+	pl_idx_t t_s = index_from_pool(q->pl, "t");
+
+	while (is_interned(p2) && (p2->val_off == t_s) && (p2->arity == 5)) {
+		CHECK_INTERRUPT();
+		cell *arg = p2 + 1;
+		cell *k = deref(q, arg, p2_ctx);
+		pl_idx_t k_ctx = q->latest_ctx;
+		int ok = compare(q, p1, p1_ctx, k, k_ctx);
+		arg += arg->nbr_cells;
+
+		if (!ok) {
+			cell tmp;
+			make_atom(&tmp, t_s);
+			unify(q, p4, p4_ctx, &tmp, q->st.curr_frame);
+			cell *v = deref(q, arg, p2_ctx);
+			pl_idx_t v_ctx = q->latest_ctx;
+			return unify(q, p3, p3_ctx, v, v_ctx);
+		}
+
+		arg += arg->nbr_cells;
+		arg += arg->nbr_cells;
+
+		if (ok > 0)
+			arg += arg->nbr_cells;
+
+		p2 = deref(q, arg, p2_ctx);
+		p2_ctx = q->latest_ctx;
+	}
+
+	if (is_interned(p2) && (p2->val_off == t_s) && !p2->arity)
+		return false;
+
+	return unify(q, p4, p4_ctx, p2, p2_ctx);
+}
+
+static bool fn_sys_assoc_put_4(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+	tree t;
+	init_tree(&t, q);
+	set_elem(q, &t.key, p2, p2_ctx);
+	set_elem(q, &t.val, p3, p3_ctx);
+	node *root;
+	bool grew;
+	bool ok = get_tree(&t, p1, p1_ctx, &root) && insert(&t, root, &root, &grew);
+	ok = ok && unify_tree(&t, root);
+	free_tree(&t);
+	return ok;
+}
+
+static bool fn_sys_assoc_del_4(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+	tree t;
+	init_tree(&t, q);
+	set_elem(q, &t.key, p2, p2_ctx);
+	node *root;
+	bool shrunk;
+	bool ok = get_tree(&t, p1, p1_ctx, &root) && delete(&t, root, &root, &shrunk);
+	ok = ok && unify(q, p3, p3_ctx, t.hit->v.c, t.hit->v.c_ctx);
+	ok = ok && unify_tree(&t, root);
+	free_tree(&t);
+	return ok;
+}
+
+static cell *put_sorted(tree *t, elem *kvs, size_t nbr, unsigned *var_nbr, cell *dst, unsigned *depth)
+{
+	if (!nbr) {
+		make_atom(dst, t->t_s);
+		*depth = 0;
+		return dst + 1;
+	}
+
+	// As list_to_assoc/5, the left gets any odd one out...
+
+	size_t rn = (nbr - 1) / 2, ln = rn + ((nbr - 1) % 2);
+	cell *save_dst = dst;
+	elem *kv = kvs + (ln * 2);
+	unsigned ldepth, rdepth;
+	dst += 4;
+	dst = put_sorted(t, kvs, ln, var_nbr, dst, &ldepth);
+	dst = put_sorted(t, kv + 2, rn, var_nbr, dst, &rdepth);
+	make_struct(save_dst, t->t_s, NULL, 5, dst - save_dst - 1);
+	put_elem(t->q, kv[0].c, kv[0].c_ctx, var_nbr, save_dst+1);
+	put_elem(t->q, kv[1].c, kv[1].c_ctx, var_nbr, save_dst+2);
+	make_atom(save_dst+3, rdepth < ldepth ? g_lt_s : rdepth > ldepth ? g_gt_s : g_minus_s);
+	*depth = ldepth + 1;
+	return dst;
+}
+
+// Fails if the list isn't of Key-Value pairs in strictly ascending
+// order of key, leaving the caller to report it...
+
+static bool fn_sys_assoc_from_ord_list_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	cell *l = p1, *prev = NULL;
+	pl_idx_t l_ctx = p1_ctx, prev_ctx = 0;
+	size_t nbr = 0;
+	unsigned nbr_vars = 0;
+
+	while (is_iso_list(l)) {
+		CHECK_INTERRUPT();
+		cell *h = deref(q, l+1, l_ctx);
+		pl_idx_t h_ctx = q->latest_ctx;
+
+		if (!is_structure(h) || (h->arity != 2) || (h->val_off != g_minus_s))
+			return false;
+
+		cell *k = deref(q, h+1, h_ctx);
+		pl_idx_t k_ctx = q->latest_ctx;
+
+		if (prev && (compare(q, prev, prev_ctx, k, k_ctx) >= 0))
+			return false;
+
+		if (is_variable(k) || is_structure(k))
+			nbr_vars++;
+
+		cell *v = deref(q, h+1+(h+1)->nbr_cells, h_ctx);
+
+		if (is_variable(v) || is_structure(v))
+			nbr_vars++;
+
+		prev = k;
+		prev_ctx = k_ctx;
+		nbr++;
+		l = deref(q, l+1+(l+1)->nbr_cells, l_ctx);
+		l_ctx = q->latest_ctx;
+	}
+
+	if (!is_nil(l))
+		return false;
+
+	unsigned var_nbr = 0;
+
+	if (nbr_vars && !(var_nbr = create_vars(q, nbr_vars)))
+		return false;
+
+	// Slots may have moved, so get the list again...
+
+	elem *kvs = malloc(sizeof(elem) * (nbr ? nbr * 2 : 1));
+	check_heap_error(kvs);
+	l = deref(q, get_raw_arg(q, 1), q->st.curr_frame);
+	l_ctx = q->latest_ctx;
+
+	for (size_t i = 0; i < nbr; i++) {
+		cell *h = deref(q, l+1, l_ctx);
+		pl_idx_t h_ctx = q->latest_ctx;
+		set_elem(q, &kvs[i*2], h+1, h_ctx);
+		set_elem(q, &kvs[i*2+1], h+1+(h+1)->nbr_cells, h_ctx);
+		l = deref(q, l+1+(l+1)->nbr_cells, l_ctx);
+		l_ctx = q->latest_ctx;
+	}
+
+	tree t;
+	init_tree(&t, q);
+	cell *tmp = alloc_on_heap(q, (nbr * 5) + 1);
+	check_heap_error(tmp, free(kvs));
+	unsigned depth;
+	put_sorted(&t, kvs, nbr, &var_nbr, tmp, &depth);
+	free(kvs);
+	cell *p2 = deref(q, get_raw_arg(q, 2), q->st.curr_frame);
+	pl_idx_t p2_ctx = q->latest_ctx;
+	return unify(q, p2, p2_ctx, tmp, q->st.curr_frame);
+}
+
+builtins g_assoc_bifs[] =
+{
+	{"$assoc_get", 4, fn_sys_assoc_get_4, "+term,+assoc,?term,-term", false, BLAH},
+	{"$assoc_put", 4, fn_sys_assoc_put_4, "+assoc,+term,+term,-assoc", false, BLAH},
+	{"$assoc_del", 4, fn_sys_assoc_del_4, "+assoc,+term,?term,-assoc", false, BLAH},
+	{"$assoc_from_ord_list", 2, fn_sys_assoc_from_ord_list_2, "+list,-assoc", false, BLAH},
+
+	{0}
+};
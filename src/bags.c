@@ -51,7 +51,7 @@ bool fn_iso_findall_3(query *q)
 	if (!q->retry) {
 		grab_queuen(q);
 		assert(q->st.qnbr < MAX_QUEUES);
-		cell *tmp = clone_to_heap(q, true, p2, 2+p1->nbr_cells+2);
+		cell *tmp = clone_to_heap(q, true, p2, q->st.curr_frame, 2+p1->nbr_cells+2);
 		pl_idx_t nbr_cells = 1 + p2->nbr_cells;
 		make_struct(tmp+nbr_cells++, g_sys_queue_s, fn_sys_queuen_2, 2, 1+p1->nbr_cells);
 		make_int(tmp+nbr_cells++, q->st.qnbr);
@@ -82,6 +82,14 @@ bool fn_iso_findall_3(query *q)
 
 	for (cell *c = solns; nbr_cells;
 		nbr_cells -= c->nbr_cells, c += c->nbr_cells) {
+
+		// A ground solution would just copy back to itself...
+
+		if (is_ground_term(c)) {
+			check_heap_error(alloc_on_queuen(q, q->st.qnbr, c));
+			continue;
+		}
+
 		check_heap_error(try_me(q, 64));
 
 		if (unify(q, p1, p1_ctx, c, q->st.fp)) {
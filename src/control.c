@@ -27,7 +27,7 @@ bool fn_sys_drop_barrier(query *q)
 
 void do_cleanup(query *q, cell *p1)
 {
-	cell *tmp = clone_to_heap(q, true, p1, 2);
+	cell *tmp = clone_to_heap(q, true, p1, q->st.curr_frame, 2);
 	ensure(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0); // ???
@@ -76,7 +76,7 @@ bool fn_iso_invoke_2(query *q)
 	if (!m)
 		m = create_module(q->pl, C_STR(q, p1));
 
-	cell *tmp = clone_to_heap(q, true, p2, 1);
+	cell *tmp = clone_to_heap(q, true, p2, p2_ctx, 1);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1;
 
@@ -86,7 +86,6 @@ bool fn_iso_invoke_2(query *q)
 	nbr_cells += p2->nbr_cells;
 	make_return(q, tmp+nbr_cells);
 	q->st.curr_cell = tmp;
-	q->st.curr_frame = p2_ctx;
 	q->st.m = q->save_m = m;
 	return true;
 }
@@ -107,14 +106,13 @@ bool fn_call_0(query *q, cell *p1)
 	if ((tmp2 = check_body_callable(q->st.m->p, p1)) != NULL)
 		return throw_error(q, p1, p1_ctx, "type_error", "callable");
 
-	cell *tmp = clone_to_heap(q, false, p1, 2);
+	cell *tmp = clone_to_heap(q, false, p1, p1_ctx, 2);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 0 + tmp->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_drop_barrier, fn_sys_drop_barrier, 0, 0);
 	make_return(q, tmp+nbr_cells);
 	check_heap_error(push_call_barrier(q));
 	q->st.curr_cell = tmp;
-	q->st.curr_frame = p1_ctx;
 	return true;
 }
 
@@ -125,18 +123,53 @@ bool fn_iso_call_n(query *q)
 
 	GET_FIRST_ARG(p1,callable);
 	check_heap_error(init_tmp_heap(q));
-	check_heap_error(deep_clone_to_tmp(q, p1, p1_ctx));
+	pl_idx_t off = 0;
+
+	// A closure given as module:goal is called as module:(goal+args)...
+
+	if ((p1->arity == 2) && (p1->val_off == g_pair_s) && is_interned(p1)) {
+		cell *pm = deref(q, p1+1, p1_ctx);
+		pl_idx_t pm_ctx = q->latest_ctx;
+
+		if (is_atom(pm)) {
+			cell *tmp = alloc_on_tmp(q, 1);
+			check_heap_error(tmp);
+			make_struct(tmp, g_pair_s, fn_iso_invoke_2, 2, 0);
+			check_heap_error(append_to_tmp(q, pm, pm_ctx));
+			off = tmp_heap_used(q);
+			p1 = deref(q, p1+2, p1_ctx);
+			p1_ctx = q->latest_ctx;
+
+			if (!is_callable(p1))
+				return throw_error(q, p1, p1_ctx, "type_error", "callable");
+		}
+	}
+
 	unsigned arity = p1->arity;
 	unsigned args = 1;
 
+	// The args are passed as they are (see clone_goal_to_tmp), unless
+	// they make up a control construct to be run...
+
+	cell tmp3 = *p1;
+	tmp3.arity += q->st.curr_cell->arity - 1;
+	bool control = is_control(&tmp3);
+	check_heap_error(control ? deep_clone_to_tmp(q, p1, p1_ctx) : append_to_tmp(q, p1, p1_ctx));
+
 	while (args++ < q->st.curr_cell->arity) {
-		GET_NEXT_ARG(p2,any);
-		check_heap_error(deep_clone_to_tmp(q, p2, p2_ctx));
+		if (control) {
+			GET_NEXT_ARG(p2,any);
+			check_heap_error(deep_clone_to_tmp(q, p2, p2_ctx));
+		} else {
+			GET_NEXT_RAW_ARG(p2,any);
+			check_heap_error(append_to_tmp(q, p2, p2_ctx));
+		}
+
 		arity++;
 	}
 
-	cell *tmp2 = get_tmp_heap(q, 0);
-	tmp2->nbr_cells = tmp_heap_used(q);
+	cell *tmp2 = get_tmp_heap(q, off);
+	tmp2->nbr_cells = tmp_heap_used(q) - off;
 	tmp2->arity = arity;
 
 	if (is_cstring(tmp2)) {
@@ -147,8 +180,14 @@ bool fn_iso_call_n(query *q)
 	const char *functor = C_STR(q, tmp2);
 	bool found = false;
 
-	if ((tmp2->fn_ptr = get_builtin(q->pl, C_STR(q, tmp2), tmp2->arity, &found, NULL)), found) {
+	// The closure's functor was resolved for its own arity, if at
+	// all, so resolve it again here and save match_head a search...
+
+	if ((tmp2->fn_ptr = get_builtin(q->pl, functor, tmp2->arity, &found, NULL)), found) {
 		tmp2->flags |= FLAG_BUILTIN;
+	} else {
+		tmp2->flags &= ~FLAG_BUILTIN;
+		tmp2->match = search_predicate(q->st.m, tmp2);
 	}
 
 	if (arity <= 2) {
@@ -161,7 +200,9 @@ bool fn_iso_call_n(query *q)
 	if (check_body_callable(q->st.m->p, tmp2) != NULL)
 		return throw_error(q, tmp2, q->st.curr_frame, "type_error", "callable");
 
-	cell *tmp = clone_to_heap(q, true, tmp2, 2);
+	tmp2 = get_tmp_heap(q, 0);
+	tmp2->nbr_cells = tmp_heap_used(q);
+	cell *tmp = clone_to_heap(q, true, tmp2, q->st.curr_frame, 2);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1+tmp2->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_drop_barrier, fn_sys_drop_barrier, 0, 0);
@@ -178,7 +219,7 @@ bool fn_iso_call_1(query *q)
 
 	GET_FIRST_ARG(p1,callable);
 	check_heap_error(init_tmp_heap(q));
-	cell *tmp2 = deep_clone_to_tmp(q, p1, p1_ctx);
+	cell *tmp2 = clone_goal_to_tmp(q, p1, p1_ctx);
 	check_heap_error(tmp2);
 	const char *functor = C_STR(q, tmp2);
 
@@ -195,7 +236,7 @@ bool fn_iso_call_1(query *q)
 	if (check_body_callable(q->st.m->p, tmp2) != NULL)
 		return throw_error(q, tmp2, q->st.curr_frame, "type_error", "callable");
 
-	cell *tmp = clone_to_heap(q, true, tmp2, 2);
+	cell *tmp = clone_to_heap(q, true, tmp2, q->st.curr_frame, 2);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1+tmp2->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_drop_barrier, fn_sys_drop_barrier, 0, 0);
@@ -212,7 +253,7 @@ bool fn_iso_once_1(query *q)
 
 	GET_FIRST_ARG(p1,callable);
 	check_heap_error(init_tmp_heap(q));
-	cell *tmp2 = deep_clone_to_tmp(q, p1, p1_ctx);
+	cell *tmp2 = clone_goal_to_tmp(q, p1, p1_ctx);
 	check_heap_error(tmp2);
 
 	const char *functor = C_STR(q, tmp2);
@@ -230,7 +271,7 @@ bool fn_iso_once_1(query *q)
 	if (check_body_callable(q->st.m->p, tmp2) != NULL)
 		return throw_error(q, tmp2, q->st.curr_frame, "type_error", "callable");
 
-	cell *tmp = clone_to_heap(q, true, tmp2, 2);
+	cell *tmp = clone_to_heap(q, true, tmp2, q->st.curr_frame, 2);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1+tmp2->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0);
@@ -247,7 +288,7 @@ bool fn_ignore_1(query *q)
 
 	GET_FIRST_ARG(p1,callable);
 	check_heap_error(init_tmp_heap(q));
-	cell *tmp2 = deep_clone_to_tmp(q, p1, p1_ctx);
+	cell *tmp2 = clone_goal_to_tmp(q, p1, p1_ctx);
 	check_heap_error(tmp2);
 
 	const char *functor = C_STR(q, tmp2);
@@ -265,7 +306,7 @@ bool fn_ignore_1(query *q)
 	if (check_body_callable(q->st.m->p, tmp2) != NULL)
 		return throw_error(q, tmp2, q->st.curr_frame, "type_error", "callable");
 
-	cell *tmp = clone_to_heap(q, true, tmp2, 2);
+	cell *tmp = clone_to_heap(q, true, tmp2, q->st.curr_frame, 2);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1+tmp2->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0);
@@ -284,7 +325,7 @@ bool fn_iso_if_then_2(query *q)
 
 	GET_FIRST_ARG(p1,callable);
 	GET_NEXT_ARG(p2,callable);
-	cell *tmp = clone_to_heap(q, true, p1, 1+p2->nbr_cells+1);
+	cell *tmp = clone_to_heap(q, true, p1, q->st.curr_frame, 1+p2->nbr_cells+1);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0);
@@ -304,7 +345,7 @@ bool fn_if_2(query *q)
 
 	GET_FIRST_ARG(p1,callable);
 	GET_NEXT_ARG(p2,callable);
-	cell *tmp = clone_to_heap(q, true, p1, 1+p2->nbr_cells+1);
+	cell *tmp = clone_to_heap(q, true, p1, q->st.curr_frame, 1+p2->nbr_cells+1);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_soft_cut_s, fn_sys_soft_inner_cut_0, 0, 0);
@@ -320,7 +361,7 @@ bool fn_if_2(query *q)
 static bool do_if_then_else(query *q, cell *p1, cell *p2, cell *p3)
 {
 	if (q->retry) {
-		cell *tmp = clone_to_heap(q, true, p3, 1);
+		cell *tmp = clone_to_heap(q, true, p3, q->st.curr_frame, 1);
 		check_heap_error(tmp);
 		pl_idx_t nbr_cells = 1 + p3->nbr_cells;
 		make_return(q, tmp+nbr_cells);
@@ -328,7 +369,7 @@ static bool do_if_then_else(query *q, cell *p1, cell *p2, cell *p3)
 		return true;
 	}
 
-	cell *tmp = clone_to_heap(q, true, p1, 1+p2->nbr_cells+1);
+	cell *tmp = clone_to_heap(q, true, p1, q->st.curr_frame, 1+p2->nbr_cells+1);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0);
@@ -344,7 +385,7 @@ static bool do_if_then_else(query *q, cell *p1, cell *p2, cell *p3)
 static bool do_if_else(query *q, cell *p1, cell *p2, cell *p3)
 {
 	if (q->retry) {
-		cell *tmp = clone_to_heap(q, true, p3, 1);
+		cell *tmp = clone_to_heap(q, true, p3, q->st.curr_frame, 1);
 		check_heap_error(tmp);
 		pl_idx_t nbr_cells = 1 + p3->nbr_cells;
 		make_return(q, tmp+nbr_cells);
@@ -352,7 +393,7 @@ static bool do_if_else(query *q, cell *p1, cell *p2, cell *p3)
 		return true;
 	}
 
-	cell *tmp = clone_to_heap(q, true, p1, 1+p2->nbr_cells+1);
+	cell *tmp = clone_to_heap(q, true, p1, q->st.curr_frame, 1+p2->nbr_cells+1);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_soft_cut_s, fn_sys_soft_inner_cut_0, 0, 0);
@@ -397,7 +438,7 @@ bool fn_iso_disjunction_2(query *q)
 	GET_NEXT_ARG(p2,callable);
 
 	if (q->retry) {
-		cell *tmp = clone_to_heap(q, true, p2, 1);
+		cell *tmp = clone_to_heap(q, true, p2, q->st.curr_frame, 1);
 		check_heap_error(tmp);
 		pl_idx_t nbr_cells = 1 + p2->nbr_cells;
 		make_return(q, tmp+nbr_cells);
@@ -405,7 +446,7 @@ bool fn_iso_disjunction_2(query *q)
 		return true;
 	}
 
-	cell *tmp = clone_to_heap(q, true, p1, 1);
+	cell *tmp = clone_to_heap(q, true, p1, q->st.curr_frame, 1);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_return(q, tmp+nbr_cells);
@@ -422,7 +463,7 @@ bool fn_iso_negation_1(query *q)
 		return true;
 
 	GET_FIRST_ARG(p1,callable);
-	cell *tmp = clone_to_heap(q, true, p1, 3);
+	cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 3);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0);
@@ -490,7 +531,7 @@ bool fn_iso_catch_3(query *q)
 	if (q->retry == QUERY_EXCEPTION) {
 		GET_NEXT_ARG(p3,callable);
 		q->retry = QUERY_OK;
-		cell *tmp = clone_to_heap(q, true, p3, 2);
+		cell *tmp = clone_to_heap(q, true, p3, p3_ctx, 2);
 		check_heap_error(tmp);
 		pl_idx_t nbr_cells = 1+p3->nbr_cells;
 		make_struct(tmp+nbr_cells++, g_sys_drop_barrier, fn_sys_drop_barrier, 0, 0);
@@ -506,7 +547,7 @@ bool fn_iso_catch_3(query *q)
 	// First time through? Try the primary goal...
 
 	pl_idx_t cp = q->cp;
-	cell *tmp = clone_to_heap(q, true, p1, 3);
+	cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 3);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1+p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_block_catcher_s, fn_sys_block_catcher_1, 1, 1);
@@ -533,7 +574,7 @@ bool fn_sys_call_cleanup_3(query *q)
 	if (q->retry == QUERY_EXCEPTION) {
 		GET_NEXT_ARG(p3,callable);
 		q->retry = QUERY_OK;
-		cell *tmp = clone_to_heap(q, true, p3, 2);
+		cell *tmp = clone_to_heap(q, true, p3, p3_ctx, 2);
 		check_heap_error(tmp);
 		pl_idx_t nbr_cells = 1+p3->nbr_cells;
 		make_struct(tmp+nbr_cells++, g_sys_cleanup_if_det_s, fn_sys_cleanup_if_det_0, 0, 0);
@@ -548,7 +589,7 @@ bool fn_sys_call_cleanup_3(query *q)
 
 	// First time through? Try the primary goal...
 
-	cell *tmp = clone_to_heap(q, true, p1, 2);
+	cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 2);
 	check_heap_error(tmp);
 	pl_idx_t nbr_cells = 1+p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_cleanup_if_det_s, fn_sys_cleanup_if_det_0, 0, 0);
@@ -928,9 +969,10 @@ bool throw_error(query *q, cell *c, pl_idx_t c_ctx, const char *err_type, const
 	make_atom(&top_level, index_from_pool(q->pl, "top_level"));
 	cell *goal;
 
-	if (q->st.curr_dbe && !is_builtin(q->st.curr_cell))
-		goal = get_head(q->st.curr_dbe->cl.cells);
-	else if (!q->last_arg)
+	if (q->st.curr_dbe && !is_builtin(q->st.curr_cell)) {
+		predicate *pr = q->st.curr_dbe->owner;
+		goal = is_interned(&pr->alias) ? &pr->alias : get_head(q->st.curr_dbe->cl.cells);
+	} else if (!q->last_arg)
 		goal = &top_level;
 	else
 		goal = q->st.curr_cell;
@@ -0,0 +1,824 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "heap.h"
+#include "prolog.h"
+#include "query.h"
+
+// A persistent hash array mapped trie. An update copies the path from
+// the root down to the changed slot and shares everything else, so
+// older versions stay valid (and cheap) across backtracking.
+//
+// Keys and values are copied in, so must be ground.
+
+#define HAMT_BITS 5
+#define HAMT_MASK ((1U << HAMT_BITS) - 1)
+#define HAMT_HASH_BITS 32
+
+typedef struct hamt_kv_ hamt_kv;
+typedef struct hamt_node_ hamt_node;
+
+struct hamt_kv_ {
+	int64_t refcnt;
+	uint32_t hash;
+	pl_idx_t nbr_cells;
+	cell cells[];				// the key then the value
+};
+
+#define KV_KEY(kv) ((kv)->cells)
+#define KV_VAL(kv) ((kv)->cells + (kv)->cells->nbr_cells)
+
+typedef struct {
+	hamt_node *child;			// either a sub-trie...
+	hamt_kv *kv;				// or an entry
+} hamt_slot;
+
+// Nodes past the last hash bits hold colliding keys in no order and
+// don't use the bitmap...
+
+struct hamt_node_ {
+	int64_t refcnt;
+	uint32_t bitmap;
+	unsigned nbr;
+	hamt_slot slots[];
+};
+
+typedef struct {
+	size_t count;
+	hamt_node *root;
+} hamt;
+
+static uint32_t hash_bytes(uint32_t h, const void *ptr, size_t len)
+{
+	const unsigned char *s = ptr;
+
+	while (len--) {
+		h ^= *s++;
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static uint32_t hash_key(query *q, cell *c, pl_idx_t c_ctx)
+{
+	uint32_t h = 2166136261U;
+
+	if (is_smallint(c)) {
+		pl_int_t v = get_smallint(c);
+		return hash_bytes(h, &v, sizeof(v));
+	}
+
+	if (is_float(c)) {
+		double v = get_float(c);
+		return hash_bytes(h, &v, sizeof(v));
+	}
+
+	if (is_interned(c) && !c->arity)
+		return hash_bytes(h, GET_POOL(q, c->val_off), strlen(GET_POOL(q, c->val_off)));
+
+	if (is_cstring(c))
+		return hash_bytes(h, C_STR(q, c), C_STRLEN(q, c));
+
+	char *tmpbuf = print_term_to_strbuf(q, c, c_ctx, 1);
+
+	if (!tmpbuf)
+		return h;
+
+	h = hash_bytes(h, tmpbuf, strlen(tmpbuf));
+	free(tmpbuf);
+	return h;
+}
+
+static bool key_equal(query *q, hamt_kv *kv, cell *key, pl_idx_t key_ctx)
+{
+	return !compare(q, KV_KEY(kv), 0, key, key_ctx);
+}
+
+static hamt_node *node_alloc(unsigned nbr)
+{
+	hamt_node *n = calloc(1, sizeof(hamt_node) + (sizeof(hamt_slot) * nbr));
+	if (!n) return NULL;
+	n->refcnt = 1;
+	n->nbr = nbr;
+	return n;
+}
+
+static void kv_release(hamt_kv *kv)
+{
+	if (--kv->refcnt)
+		return;
+
+	chk_cells(kv->cells, kv->nbr_cells);
+	free(kv);
+}
+
+static void node_release(hamt_node *n)
+{
+	if (!n || --n->refcnt)
+		return;
+
+	for (unsigned i = 0; i < n->nbr; i++) {
+		if (n->slots[i].child)
+			node_release(n->slots[i].child);
+		else
+			kv_release(n->slots[i].kv);
+	}
+
+	free(n);
+}
+
+static void slot_share(const hamt_slot *s)
+{
+	if (s->child)
+		s->child->refcnt++;
+	else
+		s->kv->refcnt++;
+}
+
+// Copy a node sharing its slots, with slot 'idx' replaced (op == 0),
+// inserted (op > 0) or removed (op < 0). The slot passed in is taken
+// over by the new node...
+
+static hamt_node *node_edit(const hamt_node *n, unsigned idx, hamt_slot s, int op)
+{
+	unsigned nbr = n->nbr + (op > 0 ? 1 : op < 0 ? -1 : 0);
+	hamt_node *n2 = node_alloc(nbr);
+	if (!n2) return NULL;
+	n2->bitmap = n->bitmap;
+	unsigned j = 0;
+
+	for (unsigned i = 0; i < n->nbr; i++) {
+		if (i == idx) {
+			if (op >= 0)
+				n2->slots[j++] = s;
+
+			if (op <= 0)
+				continue;
+		}
+
+		slot_share(&n->slots[i]);
+		n2->slots[j++] = n->slots[i];
+	}
+
+	if ((op > 0) && (idx == n->nbr))
+		n2->slots[j++] = s;
+
+	return n2;
+}
+
+static hamt_node *node_pair(hamt_kv *kv1, hamt_kv *kv2, unsigned shift)
+{
+	if (shift >= HAMT_HASH_BITS) {
+		hamt_node *n = node_alloc(2);
+		if (!n) return NULL;
+		n->slots[0].kv = kv1;
+		n->slots[1].kv = kv2;
+		return n;
+	}
+
+	unsigned i1 = (kv1->hash >> shift) & HAMT_MASK;
+	unsigned i2 = (kv2->hash >> shift) & HAMT_MASK;
+
+	if (i1 == i2) {
+		hamt_node *child = node_pair(kv1, kv2, shift + HAMT_BITS);
+		if (!child) return NULL;
+		hamt_node *n = node_alloc(1);
+		if (!n) { node_release(child); return NULL; }
+		n->bitmap = 1U << i1;
+		n->slots[0].child = child;
+		return n;
+	}
+
+	hamt_node *n = node_alloc(2);
+	if (!n) return NULL;
+	n->bitmap = (1U << i1) | (1U << i2);
+	n->slots[i1 < i2 ? 0 : 1].kv = kv1;
+	n->slots[i1 < i2 ? 1 : 0].kv = kv2;
+	return n;
+}
+
+// Returns a new node holding kv, which it takes over...
+
+static hamt_node *node_put(query *q, const hamt_node *n, unsigned shift, hamt_kv *kv, bool *replaced)
+{
+	hamt_slot s = {.kv = kv};
+
+	if (shift >= HAMT_HASH_BITS) {
+		for (unsigned i = 0; i < n->nbr; i++) {
+			if (key_equal(q, n->slots[i].kv, KV_KEY(kv), 0)) {
+				*replaced = true;
+				return node_edit(n, i, s, 0);
+			}
+		}
+
+		return node_edit(n, n->nbr, s, 1);
+	}
+
+	uint32_t bit = 1U << ((kv->hash >> shift) & HAMT_MASK);
+	unsigned idx = __builtin_popcount(n->bitmap & (bit - 1));
+
+	if (!(n->bitmap & bit)) {
+		hamt_node *n2 = node_edit(n, idx, s, 1);
+		if (n2) n2->bitmap |= bit;
+		return n2;
+	}
+
+	const hamt_slot *old = &n->slots[idx];
+
+	if (old->child) {
+		hamt_node *child = node_put(q, old->child, shift + HAMT_BITS, kv, replaced);
+		if (!child) return NULL;
+		s.kv = NULL;
+		s.child = child;
+	} else if (key_equal(q, old->kv, KV_KEY(kv), 0)) {
+		*replaced = true;
+	} else {
+		old->kv->refcnt++;
+		hamt_node *child = node_pair(old->kv, kv, shift + HAMT_BITS);
+		if (!child) { old->kv->refcnt--; return NULL; }
+		s.kv = NULL;
+		s.child = child;
+	}
+
+	return node_edit(n, idx, s, 0);
+}
+
+static hamt_kv *node_get(query *q, const hamt_node *n, uint32_t hash, cell *key, pl_idx_t key_ctx)
+{
+	for (unsigned shift = 0; n; shift += HAMT_BITS) {
+		if (shift >= HAMT_HASH_BITS) {
+			for (unsigned i = 0; i < n->nbr; i++) {
+				if (key_equal(q, n->slots[i].kv, key, key_ctx))
+					return n->slots[i].kv;
+			}
+
+			return NULL;
+		}
+
+		uint32_t bit = 1U << ((hash >> shift) & HAMT_MASK);
+
+		if (!(n->bitmap & bit))
+			return NULL;
+
+		const hamt_slot *s = &n->slots[__builtin_popcount(n->bitmap & (bit - 1))];
+
+		if (!s->child)
+			return (s->kv->hash == hash) && key_equal(q, s->kv, key, key_ctx) ? s->kv : NULL;
+
+		n = s->child;
+	}
+
+	return NULL;
+}
+
+// Returns the node unchanged (with an extra reference) if the key
+// isn't there, or NULL with 'removed' set if the node became empty.
+// A sub-trie left holding a single entry is pulled up into its parent
+// so that the shape stays canonical...
+
+static hamt_node *node_del(query *q, hamt_node *n, unsigned shift, uint32_t hash, cell *key, pl_idx_t key_ctx, bool *removed, bool *oom)
+{
+	unsigned idx;
+
+	if (shift >= HAMT_HASH_BITS) {
+		for (idx = 0; idx < n->nbr; idx++) {
+			if (key_equal(q, n->slots[idx].kv, key, key_ctx))
+				break;
+		}
+
+		if (idx == n->nbr) {
+			n->refcnt++;
+			return n;
+		}
+
+		*removed = true;
+
+		if (n->nbr == 1)
+			return NULL;
+
+		hamt_node *n2 = node_edit(n, idx, (hamt_slot){0}, -1);
+		if (!n2) *oom = true;
+		return n2;
+	}
+
+	uint32_t bit = 1U << ((hash >> shift) & HAMT_MASK);
+
+	if (!(n->bitmap & bit)) {
+		n->refcnt++;
+		return n;
+	}
+
+	idx = __builtin_popcount(n->bitmap & (bit - 1));
+	const hamt_slot *old = &n->slots[idx];
+	hamt_slot s = {0};
+
+	if (old->child) {
+		hamt_node *child = node_del(q, old->child, shift + HAMT_BITS, hash, key, key_ctx, removed, oom);
+
+		if (*oom)
+			return NULL;
+
+		if (!*removed) {
+			node_release(child);
+			n->refcnt++;
+			return n;
+		}
+
+		if (child && (child->nbr == 1) && !child->slots[0].child) {
+			s.kv = child->slots[0].kv;
+			s.kv->refcnt++;
+			node_release(child);
+		} else
+			s.child = child;
+	} else if ((old->kv->hash != hash) || !key_equal(q, old->kv, key, key_ctx)) {
+		n->refcnt++;
+		return n;
+	} else
+		*removed = true;
+
+	hamt_node *n2;
+
+	if (s.child || s.kv)
+		n2 = node_edit(n, idx, s, 0);
+	else if (n->nbr == 1)
+		return NULL;
+	else if ((n2 = node_edit(n, idx, s, -1)) != NULL)
+		n2->bitmap &= ~bit;
+
+	if (!n2) *oom = true;
+	return n2;
+}
+
+typedef bool (*hamt_visit)(query *q, hamt_kv *kv, void *arg);
+
+static bool node_walk(query *q, const hamt_node *n, hamt_visit fn, void *arg)
+{
+	for (unsigned i = 0; n && (i < n->nbr); i++) {
+		const hamt_slot *s = &n->slots[i];
+
+		if (s->child) {
+			if (!node_walk(q, s->child, fn, arg))
+				return false;
+		} else if (!fn(q, s->kv, arg))
+			return false;
+	}
+
+	return true;
+}
+
+static void hamt_free(void *ptr)
+{
+	hamt *h = ptr;
+	node_release(h->root);
+	free(h);
+}
+
+#define GET_HAMT(c) ((hamt*)(c)->val_blob->ptr)
+
+static bool make_dict(cell *c, hamt_node *root, size_t count)
+{
+	hamt *h = malloc(sizeof(hamt));
+	blob *b = malloc(sizeof(blob));
+
+	if (!h || !b) {
+		free(h);
+		free(b);
+		node_release(root);
+		return false;
+	}
+
+	h->count = count;
+	h->root = root;
+	b->refcnt = 1;
+	b->ptr = (char*)h;
+	b->free_fn = hamt_free;
+	*c = (cell){0};
+	c->tag = TAG_BLOB;
+	c->nbr_cells = 1;
+	c->flags = FLAG_MANAGED | FLAG_BLOB_DICT;
+	c->val_blob = b;
+	return true;
+}
+
+size_t dict_count(const cell *c)
+{
+	return GET_HAMT(c)->count;
+}
+
+static bool entry_equal(query *q, hamt_kv *kv, void *arg)
+{
+	const hamt *h = arg;
+	hamt_kv *kv2 = node_get(q, h->root, kv->hash, KV_KEY(kv), 0);
+	return kv2 && !compare(q, KV_VAL(kv), 0, KV_VAL(kv2), 0);
+}
+
+bool dict_equal(query *q, const cell *p1, const cell *p2)
+{
+	const hamt *h1 = GET_HAMT(p1), *h2 = GET_HAMT(p2);
+
+	if (h1 == h2)
+		return true;
+
+	if (h1->count != h2->count)
+		return false;
+
+	return node_walk(q, h1->root, entry_equal, (void*)h2);
+}
+
+// Entries in standard order of their keys, for comparing and printing.
+// The query goes along with each so that qsort can use compare()...
+
+typedef struct {
+	hamt_kv *kv;
+	query *q;
+} kvpair;
+
+typedef struct {
+	kvpair *pairs;
+	size_t nbr;
+} kvlist;
+
+static bool collect_kv(query *q, hamt_kv *kv, void *arg)
+{
+	kvlist *l = arg;
+	l->pairs[l->nbr].kv = kv;
+	l->pairs[l->nbr++].q = q;
+	return true;
+}
+
+static int kvcmp(const void *ptr1, const void *ptr2)
+{
+	const kvpair *p1 = ptr1, *p2 = ptr2;
+	return compare(p1->q, KV_KEY(p1->kv), 0, KV_KEY(p2->kv), 0);
+}
+
+static kvpair *sorted_kvs(query *q, const hamt *h)
+{
+	kvlist l = {0};
+	l.pairs = malloc(sizeof(kvpair) * (h->count ? h->count : 1));
+	if (!l.pairs) return NULL;
+	node_walk(q, h->root, collect_kv, &l);
+	qsort(l.pairs, l.nbr, sizeof(kvpair), kvcmp);
+	return l.pairs;
+}
+
+// By size, then entry by entry in key order comparing the key and
+// then the value. Keys are unique so this is a total order...
+
+int dict_compare(query *q, const cell *p1, const cell *p2)
+{
+	const hamt *h1 = GET_HAMT(p1), *h2 = GET_HAMT(p2);
+
+	if (h1 == h2)
+		return 0;
+
+	if (h1->count != h2->count)
+		return h1->count < h2->count ? -1 : 1;
+
+	kvpair *s1 = sorted_kvs(q, h1), *s2 = sorted_kvs(q, h2);
+	int ok = 0;
+
+	if (!s1 || !s2) {
+		free(s1);
+		free(s2);
+		return dict_equal(q, p1, p2) ? 0 : h1 < h2 ? -1 : 1;
+	}
+
+	for (size_t i = 0; !ok && (i < h1->count); i++) {
+		ok = compare(q, KV_KEY(s1[i].kv), 0, KV_KEY(s2[i].kv), 0);
+
+		if (!ok)
+			ok = compare(q, KV_VAL(s1[i].kv), 0, KV_VAL(s2[i].kv), 0);
+	}
+
+	free(s1);
+	free(s2);
+	return ok;
+}
+
+// The external form is the list of Key:Value pairs that library(dict)
+// takes anyway, in key order, so it reads back as an equivalent dict.
+// The cells are malloc'd and not reference counted, just free them...
+
+cell *dict_to_term(query *q, const cell *c)
+{
+	const hamt *h = GET_HAMT(c);
+	kvpair *s = sorted_kvs(q, h);
+	if (!s) return NULL;
+	pl_idx_t nbr_cells = 1, colon = index_from_pool(q->pl, ":");
+
+	for (size_t i = 0; i < h->count; i++)
+		nbr_cells += 2 + s[i].kv->nbr_cells;
+
+	cell *tmp = malloc(sizeof(cell) * nbr_cells), *dst = tmp;
+
+	if (!tmp) {
+		free(s);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < h->count; i++) {
+		const hamt_kv *kv = s[i].kv;
+		make_struct(dst, g_dot_s, NULL, 2, nbr_cells - (dst - tmp) - 1);
+		dst++;
+		make_struct(dst, colon, NULL, 2, kv->nbr_cells);
+		SET_OP(dst, OP_XFY);
+		dst++;
+		copy_cells(dst, kv->cells, kv->nbr_cells);
+		dst += kv->nbr_cells;
+	}
+
+	make_atom(dst, g_nil_s);
+	free(s);
+	return tmp;
+}
+
+// Keys and values are copied off the heap. Strings, bigints and
+// nested dicts are shared by reference count...
+
+static hamt_kv *make_kv(query *q, cell *key, pl_idx_t key_ctx, cell *val, pl_idx_t val_ctx)
+{
+	if (!init_tmp_heap(q))
+		return NULL;
+
+	cell *tmp = deep_clone_to_tmp(q, key, key_ctx);
+	if (!tmp) return NULL;
+	pl_idx_t nbr_cells = tmp->nbr_cells;
+	cell *save = malloc(sizeof(cell) * nbr_cells);
+	if (!save) return NULL;
+	copy_cells(save, tmp, nbr_cells);
+
+	if (!init_tmp_heap(q)) {
+		free(save);
+		return NULL;
+	}
+
+	tmp = deep_clone_to_tmp(q, val, val_ctx);
+
+	if (!tmp) {
+		free(save);
+		return NULL;
+	}
+
+	hamt_kv *kv = malloc(sizeof(hamt_kv) + (sizeof(cell) * (nbr_cells + tmp->nbr_cells)));
+
+	if (!kv) {
+		free(save);
+		return NULL;
+	}
+
+	kv->refcnt = 1;
+	kv->hash = hash_key(q, key, key_ctx);
+	kv->nbr_cells = nbr_cells + tmp->nbr_cells;
+	safe_copy_cells(kv->cells, save, nbr_cells);
+	safe_copy_cells(kv->cells + nbr_cells, tmp, tmp->nbr_cells);
+	free(save);
+	return kv;
+}
+
+static bool check_ground(query *q, cell *c, pl_idx_t c_ctx)
+{
+	if (has_vars(q, c, c_ctx))
+		return throw_error(q, c, c_ctx, "instantiation_error", "args_not_sufficiently_instantiated");
+
+	return true;
+}
+
+static bool fn_is_dict_1(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	return is_dict(p1);
+}
+
+static bool fn_sys_dict_new_1(query *q)
+{
+	GET_FIRST_ARG(p1,variable);
+	hamt_node *root = node_alloc(0);
+	check_heap_error(root);
+	cell tmp;
+	check_heap_error(make_dict(&tmp, root, 0));
+	bool ok = unify(q, p1, p1_ctx, &tmp, q->st.curr_frame);
+	unshare_cell(&tmp);
+	return ok;
+}
+
+static bool fn_sys_dict_size_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,integer_or_var);
+
+	if (!is_dict(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "dict");
+
+	cell tmp;
+	make_int(&tmp, dict_count(p1));
+	return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+}
+
+static bool fn_sys_dict_get_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+
+	if (!is_dict(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "dict");
+
+	if (!check_ground(q, p2, p2_ctx))
+		return false;
+
+	hamt_kv *kv = node_get(q, GET_HAMT(p1)->root, hash_key(q, p2, p2_ctx), p2, p2_ctx);
+
+	if (!kv)
+		return false;
+
+	cell *val = KV_VAL(kv);
+	cell *tmp = alloc_on_heap(q, val->nbr_cells);
+	check_heap_error(tmp);
+	safe_copy_cells(tmp, val, val->nbr_cells);
+	return unify(q, p3, p3_ctx, tmp, q->st.curr_frame);
+}
+
+static bool dict_put(query *q, cell *d, cell *key, pl_idx_t key_ctx, cell *val, pl_idx_t val_ctx, cell *tmp)
+{
+	if (!check_ground(q, key, key_ctx) || !check_ground(q, val, val_ctx))
+		return false;
+
+	hamt_kv *kv = make_kv(q, key, key_ctx, val, val_ctx);
+	check_heap_error(kv);
+	bool replaced = false;
+	const hamt *h = GET_HAMT(d);
+	hamt_node *root = node_put(q, h->root, 0, kv, &replaced);
+	check_heap_error(root, kv_release(kv));
+	check_heap_error(make_dict(tmp, root, h->count + (replaced ? 0 : 1)));
+	return true;
+}
+
+static bool fn_sys_dict_set_4(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+	GET_NEXT_ARG(p4,any);
+
+	if (!is_dict(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "dict");
+
+	cell tmp;
+
+	if (!dict_put(q, p1, p2, p2_ctx, p3, p3_ctx, &tmp))
+		return false;
+
+	bool ok = unify(q, p4, p4_ctx, &tmp, q->st.curr_frame);
+	unshare_cell(&tmp);
+	return ok;
+}
+
+static bool fn_sys_dict_del_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+
+	if (!is_dict(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "dict");
+
+	if (!check_ground(q, p2, p2_ctx))
+		return false;
+
+	const hamt *h = GET_HAMT(p1);
+	bool removed = false, oom = false;
+	hamt_node *root = node_del(q, h->root, 0, hash_key(q, p2, p2_ctx), p2, p2_ctx, &removed, &oom);
+	check_heap_error(!oom);
+
+	if (!removed) {
+		node_release(root);
+		return unify(q, p3, p3_ctx, p1, p1_ctx);
+	}
+
+	if (!root)
+		root = node_alloc(0);
+
+	check_heap_error(root);
+	cell tmp;
+	check_heap_error(make_dict(&tmp, root, h->count - 1));
+	bool ok = unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
+	unshare_cell(&tmp);
+	return ok;
+}
+
+static bool append_pair(query *q, hamt_kv *kv, void *arg)
+{
+	unsigned *nbr = arg;
+	cell *tmp = malloc(sizeof(cell) * (1 + kv->nbr_cells));
+	if (!tmp) return false;
+	make_struct(tmp, index_from_pool(q->pl, ":"), NULL, 2, kv->nbr_cells);
+	SET_OP(tmp, OP_XFY);
+	safe_copy_cells(tmp+1, kv->cells, kv->nbr_cells);
+
+	if ((*nbr)++ == 0)
+		allocate_list(q, tmp);
+	else
+		append_list(q, tmp);
+
+	free(tmp);
+	return true;
+}
+
+static bool fn_sys_dict_to_list_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,list_or_nil_or_var);
+
+	if (!is_dict(p1))
+		return throw_error(q, p1, p1_ctx, "type_error", "dict");
+
+	unsigned nbr = 0;
+	check_heap_error(node_walk(q, GET_HAMT(p1)->root, append_pair, &nbr));
+
+	if (!nbr) {
+		cell tmp;
+		make_atom(&tmp, g_nil_s);
+		return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+	}
+
+	cell *l = end_list(q);
+	check_heap_error(l);
+	return unify(q, p2, p2_ctx, l, q->st.curr_frame);
+}
+
+// Pairs can be Key:Value or Key-Value, later keys win...
+
+static bool fn_sys_dict_from_list_2(query *q)
+{
+	GET_FIRST_ARG(p1,list_or_nil);
+	GET_NEXT_ARG(p2,any);
+	hamt_node *root = node_alloc(0);
+	check_heap_error(root);
+	size_t count = 0;
+	pl_idx_t colon = index_from_pool(q->pl, ":");
+	LIST_HANDLER(p1);
+
+	while (is_list(p1)) {
+		CHECK_INTERRUPT();
+		cell *h = LIST_HEAD(p1);
+		h = deref(q, h, p1_ctx);
+		pl_idx_t h_ctx = q->latest_ctx;
+
+		if (!is_structure(h) || (h->arity != 2)
+			|| ((h->val_off != colon) && (h->val_off != g_minus_s))) {
+			node_release(root);
+			return throw_error(q, h, h_ctx, "type_error", "pair");
+		}
+
+		cell *key = h + 1, *val = key + key->nbr_cells;
+		key = deref(q, key, h_ctx);
+		pl_idx_t key_ctx = q->latest_ctx;
+		val = deref(q, val, h_ctx);
+		pl_idx_t val_ctx = q->latest_ctx;
+
+		if (!check_ground(q, key, key_ctx) || !check_ground(q, val, val_ctx)) {
+			node_release(root);
+			return false;
+		}
+
+		hamt_kv *kv = make_kv(q, key, key_ctx, val, val_ctx);
+		check_heap_error(kv, node_release(root));
+		bool replaced = false;
+		hamt_node *root2 = node_put(q, root, 0, kv, &replaced);
+		node_release(root);
+		check_heap_error(root2, kv_release(kv));
+		root = root2;
+		count += replaced ? 0 : 1;
+		p1 = LIST_TAIL(p1);
+		p1 = deref(q, p1, p1_ctx);
+		p1_ctx = q->latest_ctx;
+	}
+
+	if (!is_nil(p1)) {
+		node_release(root);
+		return throw_error(q, p1, p1_ctx, "type_error", "list");
+	}
+
+	cell tmp;
+	check_heap_error(make_dict(&tmp, root, count));
+	bool ok = unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+	unshare_cell(&tmp);
+	return ok;
+}
+
+builtins g_dict_bifs[] =
+{
+	{"is_dict", 1, fn_is_dict_1, "+term", false, BLAH},
+	{"$dict_new", 1, fn_sys_dict_new_1, "-dict", false, BLAH},
+	{"$dict_size", 2, fn_sys_dict_size_2, "+dict,-integer", false, BLAH},
+	{"$dict_get", 3, fn_sys_dict_get_3, "+dict,+term,?term", false, BLAH},
+	{"$dict_set", 4, fn_sys_dict_set_4, "+dict,+term,+term,-dict", false, BLAH},
+	{"$dict_del", 3, fn_sys_dict_del_3, "+dict,+term,-dict", false, BLAH},
+	{"$dict_to_list", 2, fn_sys_dict_to_list_2, "+dict,-list", false, BLAH},
+	{"$dict_from_list", 2, fn_sys_dict_from_list_2, "+list,-dict", false, BLAH},
+
+	{0}
+};
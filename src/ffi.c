@@ -9,6 +9,7 @@
 #include <ffi.h>
 #endif
 
+#include "heap.h"
 #include "prolog.h"
 #include "query.h"
 
@@ -24,10 +25,16 @@ enum {
 	TAG_UINT32,
 	TAG_UINT64,
 	TAG_FLOAT32,
-	TAG_CCSTR
+	TAG_CCSTR,
+	TAG_ARRAY,
+	TAG_STRUCT
 };
 
-#define MARK_OUT(t) (((unsigned)(t) << 2) | 1)
+#define MARK_OUT(t) ((t) | 0x80)
+#define UNMARK_OUT(t) ((t) & 0x7f)
+#define IS_OUT(t) ((t) & 0x80)
+
+#define MAX_FFI_FIELDS 32
 
 union result_ {
 	float f32;
@@ -45,6 +52,429 @@ union result_ {
 };
 
 #if USE_FFI
+// The call interface and the type of each argument are worked out
+// once, when the foreign function is registered, and kept alongside
+// its builtins entry. A call then only has to check and marshal its
+// args...
+
+typedef struct {
+	uint8_t elem;						// of an array
+	uint8_t size_arg;					// giving the length of an out array
+	uint8_t nbr_fields;					// of a struct
+	uint8_t fields[MAX_FFI_FIELDS];
+	uint16_t offsets[MAX_FFI_FIELDS];
+	uint16_t size;
+} ffi_desc;
+
+typedef struct {
+	ffi_cif cif;
+	ffi_type *arg_types[MAX_ARITY];
+	ffi_desc *args;						// if any are arrays or structs
+	bool ok;
+} ffi_plan;
+
+static ffi_plan g_ffi_plans[MAX_FFI];
+
+static ffi_type *ffi_type_of(uint8_t type)
+{
+	if (IS_OUT(type))
+		return &ffi_type_pointer;
+
+	switch (type) {
+	case TAG_UINT8: return &ffi_type_uint8;
+	case TAG_UINT16: return &ffi_type_uint16;
+	case TAG_UINT32: return &ffi_type_uint32;
+	case TAG_UINT64: return &ffi_type_uint64;
+	case TAG_INT8: return &ffi_type_sint8;
+	case TAG_INT16: return &ffi_type_sint16;
+	case TAG_INT32: return &ffi_type_sint32;
+	case TAG_INT64: return &ffi_type_sint64;
+	case TAG_FLOAT32: return &ffi_type_float;
+	case TAG_FLOAT: return &ffi_type_double;
+	case TAG_PTR: return &ffi_type_pointer;
+	case TAG_CSTR: return &ffi_type_pointer;
+	case TAG_CCSTR: return &ffi_type_pointer;
+	case TAG_ARRAY: return &ffi_type_pointer;
+	case TAG_STRUCT: return &ffi_type_pointer;
+	default: return &ffi_type_void;
+	}
+}
+
+static void prepare_ffi(builtins *ptr, unsigned nbr_args, const ffi_desc *args)
+{
+	ffi_plan *plan = &g_ffi_plans[ptr - g_ffi_bifs];
+	ffi_type *ret_type = ffi_type_of(ptr->ret_type);
+	bool any = false;
+
+	for (unsigned i = 0; i < nbr_args; i++) {
+		plan->arg_types[i] = ffi_type_of(ptr->types[i]);
+
+		if ((UNMARK_OUT(ptr->types[i]) == TAG_ARRAY) || (UNMARK_OUT(ptr->types[i]) == TAG_STRUCT))
+			any = true;
+	}
+
+	free(plan->args);
+	plan->args = NULL;
+
+	if (any && (plan->args = malloc(sizeof(ffi_desc) * nbr_args)) != NULL)
+		memcpy(plan->args, args, sizeof(ffi_desc) * nbr_args);
+	else if (any) {
+		plan->ok = false;
+		return;
+	}
+
+	plan->ok = (ret_type != &ffi_type_void)
+		&& (ffi_prep_cif(&plan->cif, FFI_DEFAULT_ABI, nbr_args, ret_type, plan->arg_types) == FFI_OK);
+}
+
+static const char *type_name_of(uint8_t type)
+{
+	switch (type) {
+	case TAG_UINT8: case TAG_UINT16: case TAG_UINT32: case TAG_UINT64:
+	case TAG_INT8: case TAG_INT16: case TAG_INT32: case TAG_INT64:
+		return "integer";
+	case TAG_FLOAT32: case TAG_FLOAT:
+		return "float";
+	case TAG_PTR:
+		return "stream";
+	case TAG_CSTR: case TAG_CCSTR:
+		return "atom";
+	case TAG_ARRAY: case TAG_STRUCT:
+		return "list";
+	default:
+		return "invalid";
+	}
+}
+
+static bool is_type(const cell *c, uint8_t type)
+{
+	switch (type) {
+	case TAG_UINT8: case TAG_UINT16: case TAG_UINT32: case TAG_UINT64:
+	case TAG_INT8: case TAG_INT16: case TAG_INT32: case TAG_INT64:
+	case TAG_PTR:
+		return is_smallint(c);
+	case TAG_FLOAT32: case TAG_FLOAT:
+		return is_float(c);
+	case TAG_CSTR: case TAG_CCSTR:
+		return is_atom(c);
+	default:
+		return false;
+	}
+}
+
+// Convert an arg to the width the function expects, in the spare
+// cell 'v', and return a pointer to the value for ffi_call()...
+
+static void *marshal_arg(query *q, const cell *c, uint8_t type, cell *v, void **s_arg)
+{
+	switch (type) {
+	case TAG_UINT8: v->val_uint8 = c->val_int; return &v->val_uint8;
+	case TAG_UINT16: v->val_uint16 = c->val_int; return &v->val_uint16;
+	case TAG_UINT32: v->val_uint32 = c->val_int; return &v->val_uint32;
+	case TAG_UINT64: v->val_uint = c->val_int; return &v->val_uint;
+	case TAG_INT8: v->val_int8 = c->val_int; return &v->val_int8;
+	case TAG_INT16: v->val_int16 = c->val_int; return &v->val_int16;
+	case TAG_INT32: v->val_int32 = c->val_int; return &v->val_int32;
+	case TAG_INT64: v->val_int64 = c->val_int; return &v->val_int64;
+	case TAG_FLOAT32: v->val_float32 = c->val_float; return &v->val_float32;
+	case TAG_FLOAT: v->val_float = c->val_float; return &v->val_float;
+	case TAG_PTR: v->val_ptr = (void*)c->val_int; return &v->val_ptr;
+	case TAG_CSTR: case TAG_CCSTR: *s_arg = C_STR(q, c); return s_arg;
+	default: return NULL;
+	}
+}
+
+// Make a term of an out arg, or of a result...
+
+static bool unmarshal_arg(cell *tmp, uint8_t type, const cell *v)
+{
+	switch (type) {
+	case TAG_UINT8: make_int(tmp, v->val_uint8); return true;
+	case TAG_UINT16: make_int(tmp, v->val_uint16); return true;
+	case TAG_UINT32: make_int(tmp, v->val_uint32); return true;
+	case TAG_UINT64: make_int(tmp, v->val_uint); return true;
+	case TAG_INT8: make_int(tmp, v->val_int8); return true;
+	case TAG_INT16: make_int(tmp, v->val_int16); return true;
+	case TAG_INT32: make_int(tmp, v->val_int32); return true;
+	case TAG_INT64: make_int(tmp, v->val_int64); return true;
+	case TAG_FLOAT32: make_float(tmp, v->val_float32); return true;
+	case TAG_FLOAT: make_float(tmp, v->val_float); return true;
+	case TAG_PTR: make_ptr(tmp, v->val_ptr); return true;
+	case TAG_CSTR: case TAG_CCSTR: return make_cstring(tmp, v->val_str);
+	default: return false;
+	}
+}
+
+static uint8_t scalar_type(const char *src)
+{
+	static const struct { const char *name; uint8_t type; } s_types[] = {
+		{"uint8", TAG_UINT8}, {"uint16", TAG_UINT16},
+		{"uint32", TAG_UINT32}, {"uint64", TAG_UINT64},
+		{"int8", TAG_INT8}, {"int16", TAG_INT16},
+		{"int32", TAG_INT32}, {"int64", TAG_INT64},
+		{"fp32", TAG_FLOAT32}, {"fp64", TAG_FLOAT},
+		{"ptr", TAG_PTR}, {"cstr", TAG_CSTR},
+		{"const_cstr", TAG_CCSTR},
+		{0}
+	};
+
+	for (unsigned i = 0; s_types[i].name; i++) {
+		if (!strcmp(src, s_types[i].name))
+			return s_types[i].type;
+	}
+
+	return 0;
+}
+
+// The size of an element of an array or a field of a struct, or 0
+// if it can't be one...
+
+static size_t size_of(uint8_t type)
+{
+	switch (type) {
+	case TAG_UINT8: case TAG_INT8: return 1;
+	case TAG_UINT16: case TAG_INT16: return 2;
+	case TAG_UINT32: case TAG_INT32: case TAG_FLOAT32: return 4;
+	case TAG_UINT64: case TAG_INT64: case TAG_FLOAT: return 8;
+	case TAG_PTR: return sizeof(void*);
+	default: return 0;
+	}
+}
+
+// A type is a name, array(Type), struct([Type,...]) or, for an out
+// arg, -Type. An out array is array(Type,N), its length being the
+// value of the N'th arg at call time...
+
+static uint8_t parse_type(query *q, cell *h, pl_idx_t h_ctx, bool out_ok, ffi_desc *arg)
+{
+	bool out = false;
+
+	if (out_ok && is_compound(h) && (h->arity == 1) && !strcmp(C_STR(q, h), "-")) {
+		h = deref(q, h+1, h_ctx);
+		h_ctx = q->latest_ctx;
+		out = true;
+	}
+
+	uint8_t type = 0;
+
+	if (is_atom(h))
+		type = scalar_type(C_STR(q, h));
+	else if (is_compound(h) && (h->arity <= 2) && !strcmp(C_STR(q, h), "array")) {
+		cell *e = deref(q, h+1, h_ctx);
+		arg->elem = is_atom(e) ? scalar_type(C_STR(q, e)) : 0;
+
+		if (!size_of(arg->elem) || (arg->elem == TAG_PTR))
+			return 0;
+
+		if (h->arity == 2) {
+			cell *n = deref(q, h+1+(h+1)->nbr_cells, h_ctx);
+
+			if (!is_smallint(n) || (get_smallint(n) < 1) || (get_smallint(n) > MAX_ARITY))
+				return 0;
+
+			arg->size_arg = get_smallint(n);
+		}
+
+		if (out != !!arg->size_arg)
+			return 0;
+
+		type = TAG_ARRAY;
+	} else if (is_compound(h) && (h->arity == 1) && !strcmp(C_STR(q, h), "struct")) {
+		LIST_HANDLER(l);
+		cell *l = deref(q, h+1, h_ctx);
+		pl_idx_t l_ctx = q->latest_ctx;
+		size_t offset = 0, align = 1;
+
+		while (is_iso_list(l)) {
+			cell *f = LIST_HEAD(l);
+			f = deref(q, f, l_ctx);
+			uint8_t ftype = is_atom(f) ? scalar_type(C_STR(q, f)) : 0;
+			size_t size = size_of(ftype);
+
+			if (!size || (arg->nbr_fields == MAX_FFI_FIELDS))
+				return 0;
+
+			offset = (offset + size - 1) & ~(size - 1);
+			arg->fields[arg->nbr_fields] = ftype;
+			arg->offsets[arg->nbr_fields++] = offset;
+			offset += size;
+
+			if (size > align)
+				align = size;
+
+			l = LIST_TAIL(l);
+			l = deref(q, l, l_ctx);
+			l_ctx = q->latest_ctx;
+		}
+
+		if (!is_nil(l) || !arg->nbr_fields)
+			return 0;
+
+		arg->size = (offset + align - 1) & ~(align - 1);
+		type = TAG_STRUCT;
+	}
+
+	if (!type)
+		return 0;
+
+	return out ? MARK_OUT(type) : type;
+}
+
+// Buffers passed for array and struct args are freed after the
+// call...
+
+typedef struct {
+	void *ptrs[MAX_ARITY];
+	unsigned nbr;
+} ffi_bufs;
+
+static void free_bufs(ffi_bufs *bufs)
+{
+	for (unsigned i = 0; i < bufs->nbr; i++)
+		free(bufs->ptrs[i]);
+}
+
+static void *alloc_buf(ffi_bufs *bufs, size_t size)
+{
+	void *buf = calloc(1, size ? size : 1);
+	if (!buf) return NULL;
+	bufs->ptrs[bufs->nbr++] = buf;
+	return buf;
+}
+
+// An array is filled from a list in one pass. A string or atom is
+// passed as a uint8 array as is, without a copy, and an integer is
+// taken to be the address of a buffer already made in C...
+
+static bool marshal_array(query *q, cell *c, pl_idx_t c_ctx, const ffi_desc *arg, ffi_bufs *bufs, void **s_arg)
+{
+	if ((arg->elem == TAG_UINT8) && is_atom(c)) {
+		*s_arg = C_STR(q, c);
+		return true;
+	}
+
+	if (is_smallint(c)) {
+		*s_arg = (void*)c->val_int;
+		return true;
+	}
+
+	size_t size = size_of(arg->elem), nbr = 0, max = 64;
+	char *buf = malloc(size * max);
+	check_heap_error(buf);
+	LIST_HANDLER(c);
+
+	while (is_iso_list(c)) {
+		cell *h = LIST_HEAD(c);
+		h = deref(q, h, c_ctx);
+
+		if (!is_type(h, arg->elem)) {
+			free(buf);
+			return throw_error(q, h, q->latest_ctx, "type_error", type_name_of(arg->elem));
+		}
+
+		if (nbr == max) {
+			char *tmp = realloc(buf, size * (max *= 2));
+			check_heap_error(tmp, free(buf));
+			buf = tmp;
+		}
+
+		cell v;
+		void *s;
+		memcpy(buf + (size * nbr++), marshal_arg(q, h, arg->elem, &v, &s), size);
+		c = LIST_TAIL(c);
+		c = deref(q, c, c_ctx);
+		c_ctx = q->latest_ctx;
+	}
+
+	if (!is_nil(c)) {
+		free(buf);
+		return throw_error(q, c, c_ctx, "type_error", "list");
+	}
+
+	bufs->ptrs[bufs->nbr++] = buf;
+	*s_arg = buf;
+	return true;
+}
+
+static bool marshal_struct(query *q, cell *c, pl_idx_t c_ctx, const ffi_desc *arg, ffi_bufs *bufs, void **s_arg)
+{
+	char *buf = alloc_buf(bufs, arg->size);
+	check_heap_error(buf);
+	cell *save_c = c;
+	pl_idx_t save_c_ctx = c_ctx;
+	unsigned i = 0;
+	LIST_HANDLER(c);
+
+	while (is_iso_list(c) && (i < arg->nbr_fields)) {
+		cell *h = LIST_HEAD(c);
+		h = deref(q, h, c_ctx);
+		uint8_t ftype = arg->fields[i];
+
+		if (!is_type(h, ftype))
+			return throw_error(q, h, q->latest_ctx, "type_error", type_name_of(ftype));
+
+		cell v;
+		void *s;
+		memcpy(buf + arg->offsets[i++], marshal_arg(q, h, ftype, &v, &s), size_of(ftype));
+		c = LIST_TAIL(c);
+		c = deref(q, c, c_ctx);
+		c_ctx = q->latest_ctx;
+	}
+
+	if (!is_nil(c) || (i != arg->nbr_fields))
+		return throw_error(q, save_c, save_c_ctx, "domain_error", "struct");
+
+	*s_arg = buf;
+	return true;
+}
+
+static bool marshal_buffer(query *q, cell *c, pl_idx_t c_ctx, uint8_t type, const ffi_desc *arg, ffi_bufs *bufs, void **s_arg)
+{
+	if (type == TAG_STRUCT)
+		return marshal_struct(q, c, c_ctx, arg, bufs, s_arg);
+
+	return marshal_array(q, c, c_ctx, arg, bufs, s_arg);
+}
+
+// An out array of uint8 comes back as a string, any other as a list,
+// as does an out struct...
+
+static bool unify_buffer(query *q, cell *c, pl_idx_t c_ctx, uint8_t type, const ffi_desc *arg, const char *buf, size_t nbr)
+{
+	cell tmp;
+
+	if (type == TAG_STRUCT)
+		nbr = arg->nbr_fields;
+	else if (arg->elem == TAG_UINT8) {
+		check_heap_error(make_stringn(&tmp, buf, nbr));
+		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
+		unshare_cell(&tmp);
+		return ok;
+	}
+
+	if (!nbr) {
+		make_atom(&tmp, g_nil_s);
+		return unify(q, c, c_ctx, &tmp, q->st.curr_frame);
+	}
+
+	for (size_t i = 0; i < nbr; i++) {
+		uint8_t etype = type == TAG_STRUCT ? arg->fields[i] : arg->elem;
+		const char *src = buf + (type == TAG_STRUCT ? arg->offsets[i] : size_of(etype) * i);
+		cell v;
+		memcpy(&v.val_int64, src, size_of(etype));
+		unmarshal_arg(&tmp, etype, &v);
+
+		if (i == 0)
+			allocate_list(q, &tmp);
+		else
+			append_list(q, &tmp);
+	}
+
+	cell *l = end_list(q);
+	check_heap_error(l);
+	return unify(q, c, c_ctx, l, q->st.curr_frame);
+}
+
 USE_RESULT bool fn_sys_dlopen_3(query *q)
 {
 	GET_FIRST_ARG(p1,atom);
@@ -129,7 +559,8 @@ USE_RESULT bool fn_sys_register_function_4(query *q)
 	void *func = dlsym((void*)handle, symbol);
 	if (!func) return false;
 
-	uint8_t arg_types[MAX_ARITY], ret_type = 0;
+	uint8_t arg_types[MAX_ARITY];
+	ffi_desc args[MAX_ARITY] = {0};
 	LIST_HANDLER(l);
 	cell *l = p3;
 	pl_idx_t l_ctx = p3_ctx;
@@ -138,74 +569,26 @@ USE_RESULT bool fn_sys_register_function_4(query *q)
 	while (is_iso_list(l) && (idx < MAX_ARITY)) {
 		cell *h = LIST_HEAD(l);
 		h = deref(q, h, l_ctx);
-		const char *src = C_STR(q, h);
-
-		if (!strcmp(src, "uint8"))
-			arg_types[idx++] = TAG_UINT8;
-		else if (!strcmp(src, "uint16"))
-			arg_types[idx++] = TAG_UINT16;
-		else if (!strcmp(src, "uint32"))
-			arg_types[idx++] = TAG_UINT32;
-		else if (!strcmp(src, "uint64"))
-			arg_types[idx++] = TAG_UINT64;
-		else if (!strcmp(src, "int8"))
-			arg_types[idx++] = TAG_INT8;
-		else if (!strcmp(src, "int16"))
-			arg_types[idx++] = TAG_INT16;
-		else if (!strcmp(src, "int32"))
-			arg_types[idx++] = TAG_INT32;
-		else if (!strcmp(src, "int64"))
-			arg_types[idx++] = TAG_INT64;
-		else if (!strcmp(src, "fp32"))
-			arg_types[idx++] = TAG_FLOAT32;
-		else if (!strcmp(src, "fp64"))
-			arg_types[idx++] = TAG_FLOAT;
-		else if (!strcmp(src, "ptr"))
-			arg_types[idx++] = TAG_PTR;
-		else if (!strcmp(src, "cstr"))
-			arg_types[idx++] = TAG_CSTR;
-		else if (!strcmp(src, "const_cstr"))
-			arg_types[idx++] = TAG_CCSTR;
-		else
-			arg_types[idx++] = 0;
+		pl_idx_t h_ctx = q->latest_ctx;
+		arg_types[idx] = parse_type(q, h, h_ctx, false, &args[idx]);
 
+		if (!arg_types[idx])
+			return throw_error(q, h, h_ctx, "domain_error", "ffi_type");
+
+		idx++;
 		l = LIST_TAIL(l);
 		l = deref(q, l, l_ctx);
 		l_ctx = q->latest_ctx;
 	}
 
-	const char *src = C_STR(q, p4);
+	uint8_t ret_type = scalar_type(C_STR(q, p4));
 
-	if (!strcmp(src, "uint8"))
-		ret_type = TAG_UINT8;
-	else if (!strcmp(src, "uint16"))
-		ret_type = TAG_UINT16;
-	else if (!strcmp(src, "uint32"))
-		ret_type = TAG_UINT32;
-	else if (!strcmp(src, "uint64"))
-		ret_type = TAG_UINT64;
-	else if (!strcmp(src, "int8"))
-		ret_type = TAG_INT8;
-	else if (!strcmp(src, "int16"))
-		ret_type = TAG_INT16;
-	else if (!strcmp(src, "int32"))
-		ret_type = TAG_INT32;
-	else if (!strcmp(src, "int64"))
-		ret_type = TAG_INT64;
-	else if (!strcmp(src, "fp32"))
-		ret_type = TAG_FLOAT32;
-	else if (!strcmp(src, "fp64"))
-		ret_type = TAG_FLOAT;
-	else if (!strcmp(src, "ptr"))
-		ret_type = TAG_PTR;
-	else if (!strcmp(src, "cstr"))
-		ret_type = TAG_CSTR;
-	else if (!strcmp(src, "const_cstr"))
-		ret_type = TAG_CCSTR;
-	else
-		ret_type = 0;
+	if (!ret_type)
+		return throw_error(q, p4, p4_ctx, "domain_error", "ffi_type");
 
-	register_ffi(q->pl, symbol, idx, (void*)func, arg_types, ret_type, true);
+	builtins *ptr = register_ffi(q->pl, symbol, idx, (void*)func, arg_types, ret_type, true);
+	check_heap_error(ptr);
+	prepare_ffi(ptr, idx, args);
 	return true;
 }
 
@@ -225,77 +608,39 @@ USE_RESULT bool fn_sys_register_predicate_4(query *q)
 	if (!func) return false;
 
 	uint8_t arg_types[MAX_ARITY], ret_type = 0;
-	bool arg_vars[MAX_ARITY];
+	ffi_desc args[MAX_ARITY] = {0};
 	LIST_HANDLER(l);
 	cell *l = p3;
 	pl_idx_t l_ctx = p3_ctx;
 	int idx = 0;
 
-	while (is_iso_list(l) && (idx < MAX_ARITY)) {
+	cell *types[MAX_ARITY];
+	pl_idx_t types_ctx[MAX_ARITY];
+
+	while (is_iso_list(l) && (idx < (MAX_ARITY-1))) {
 		cell *h = LIST_HEAD(l);
 		h = deref(q, h, l_ctx);
-		const char *src = C_STR(q, h);
-
-		if (!strcmp(src, "uint8"))
-			arg_types[idx++] = TAG_UINT8;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "uint8"))
-			arg_types[idx++] = MARK_OUT(TAG_UINT8);
-		else if (!strcmp(src, "uint16"))
-			arg_types[idx++] = TAG_UINT16;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "uint16"))
-			arg_types[idx++] = MARK_OUT(TAG_UINT16);
-		else if (!strcmp(src, "uint32"))
-			arg_types[idx++] = TAG_UINT32;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "uint32"))
-			arg_types[idx++] = MARK_OUT(TAG_UINT32);
-		else if (!strcmp(src, "uint64"))
-			arg_types[idx++] = TAG_UINT64;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "uint64"))
-			arg_types[idx++] = MARK_OUT(TAG_UINT64);
-		else if (!strcmp(src, "int8"))
-			arg_types[idx++] = TAG_INT8;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "int8"))
-			arg_types[idx++] = MARK_OUT(TAG_INT8);
-		else if (!strcmp(src, "int16"))
-			arg_types[idx++] = TAG_INT16;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "int16"))
-			arg_types[idx++] = MARK_OUT(TAG_INT16);
-		else if (!strcmp(src, "int32"))
-			arg_types[idx++] = TAG_INT32;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "int32"))
-			arg_types[idx++] = MARK_OUT(TAG_INT32);
-		else if (!strcmp(src, "int64"))
-			arg_types[idx++] = TAG_INT64;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "int64"))
-			arg_types[idx++] = MARK_OUT(TAG_INT64);
-		else if (!strcmp(src, "fp32"))
-			arg_types[idx++] = TAG_FLOAT32;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "fp32"))
-			arg_types[idx++] = MARK_OUT(TAG_FLOAT32);
-		else if (!strcmp(src, "fp64"))
-			arg_types[idx++] = TAG_FLOAT;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "fp64"))
-			arg_types[idx++] = MARK_OUT(TAG_FLOAT);
-		else if (!strcmp(src, "ptr"))
-			arg_types[idx++] = TAG_PTR;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "ptr"))
-			arg_types[idx++] = MARK_OUT(TAG_PTR);
-		else if (!strcmp(src, "cstr"))
-			arg_types[idx++] = TAG_CSTR;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "cstr"))
-			arg_types[idx++] = MARK_OUT(TAG_CSTR);
-		else if (!strcmp(src, "const_cstr"))
-			arg_types[idx++] = TAG_CCSTR;
-		else if (!strcmp(src, "-") && !strcmp(C_STR(q, h+1), "const_cstr"))
-			arg_types[idx++] = MARK_OUT(TAG_CCSTR);
-		else
-			arg_types[idx++] = 0;
+		pl_idx_t h_ctx = q->latest_ctx;
+		arg_types[idx] = parse_type(q, h, h_ctx, true, &args[idx]);
 
+		if (!arg_types[idx])
+			return throw_error(q, h, h_ctx, "domain_error", "ffi_type");
+
+		types[idx] = h;
+		types_ctx[idx] = h_ctx;
+		idx++;
 		l = LIST_TAIL(l);
 		l = deref(q, l, l_ctx);
 		l_ctx = q->latest_ctx;
 	}
 
+	// An out array's length must come from one of the other args...
+
+	for (int i = 0; i < idx; i++) {
+		if (args[i].size_arg > idx)
+			return throw_error(q, types[i], types_ctx[i], "domain_error", "ffi_type");
+	}
+
 	const char *src = C_STR(q, p4);
 
 	if (!strcmp(src, "uint8")) {
@@ -330,19 +675,19 @@ USE_RESULT bool fn_sys_register_predicate_4(query *q)
 		ret_type = TAG_FLOAT;
 	} else if (!strcmp(src, "ptr")) {
 		arg_types[idx++] = MARK_OUT(TAG_PTR);
-		ret_type = TAG_FLOAT;
+		ret_type = TAG_PTR;
 	} else if (!strcmp(src, "cstr")) {
 		arg_types[idx++] = MARK_OUT(TAG_CSTR);
 		ret_type = TAG_CSTR;
 	} else if (!strcmp(src, "const_cstr")) {
 		arg_types[idx++] = MARK_OUT(TAG_CCSTR);
 		ret_type = TAG_CCSTR;
-	} else {
-		arg_types[idx++] = 0;
-		ret_type = 0;
-	}
+	} else
+		return throw_error(q, p4, p4_ctx, "domain_error", "ffi_type");
 
-	register_ffi(q->pl, symbol, idx, (void*)func, arg_types, ret_type, false);
+	builtins *ptr = register_ffi(q->pl, symbol, idx, (void*)func, arg_types, ret_type, false);
+	check_heap_error(ptr);
+	prepare_ffi(ptr, idx-1, args);
 	return true;
 }
 
@@ -352,168 +697,60 @@ bool wrapper_for_function(query *q, builtins *ptr)
 	GET_FIRST_ARG(p1, any);
 	cell *c = p1;
 	pl_idx_t c_ctx = p1_ctx;
-
-	ffi_cif cif;
-	ffi_type *arg_types[MAX_ARITY];
-	ffi_status status;
+	ffi_plan *plan = &g_ffi_plans[ptr - g_ffi_bifs];
 	void *arg_values[MAX_ARITY];
+	void *s_args[MAX_ARITY];
+	cell cells[MAX_ARITY];
+	ffi_bufs bufs;
+	bufs.nbr = 0;
+
+	if (!plan->ok)
+		return false;
 
 	for (unsigned i = 0; i < ptr->arity; i++) {
-		if ((ptr->types[i] == TAG_INT64) && is_smallint(c))
-			;
-		else if ((ptr->types[i] == TAG_PTR) && is_smallint(c))
-			;
-		else if (ptr->types[i] != c->tag)
-			return throw_error(q, c, c_ctx, "type_error",
-			ptr->types[i] == TAG_UINT8 ? "integer" :
-			ptr->types[i] == TAG_UINT16 ? "integer" :
-			ptr->types[i] == TAG_UINT32 ? "integer" :
-			ptr->types[i] == TAG_UINT64 ? "integer" :
-			ptr->types[i] == TAG_INT8 ? "integer" :
-			ptr->types[i] == TAG_INT16 ? "integer" :
-			ptr->types[i] == TAG_INT32 ? "integer" :
-			ptr->types[i] == TAG_INT64 ? "integer" :
-			ptr->types[i] == TAG_FLOAT32 ? "float" :
-			ptr->types[i] == TAG_FLOAT ? "float" :
-			ptr->types[i] == TAG_PTR ? "stream" :
-			ptr->types[i] == TAG_CSTR ? "atom" :
-			ptr->types[i] == TAG_CCSTR ? "atom" :
-			ptr->types[i] == TAG_VAR ? "variable" :
-			"invalid"
-			);
-
-		const char *src = C_STR(q, c);
-
-		if (ptr->types[i] == TAG_UINT8)
-			arg_types[i] = &ffi_type_uint8;
-		else if (ptr->types[i] == TAG_UINT16)
-			arg_types[i] = &ffi_type_uint16;
-		else if (ptr->types[i] == TAG_UINT32)
-			arg_types[i] = &ffi_type_uint32;
-		else if (ptr->types[i] == TAG_UINT64)
-			arg_types[i] = &ffi_type_uint64;
-		else if (ptr->types[i] == TAG_INT8)
-			arg_types[i] = &ffi_type_sint8;
-		else if (ptr->types[i] == TAG_INT16)
-			arg_types[i] = &ffi_type_sint16;
-		else if (ptr->types[i] == TAG_INT32)
-			arg_types[i] = &ffi_type_sint32;
-		else if (ptr->types[i] == TAG_INT64)
-			arg_types[i] = &ffi_type_sint64;
-		else if (ptr->types[i] == TAG_FLOAT32)
-			arg_types[i] = &ffi_type_float;
-		else if (ptr->types[i] == TAG_FLOAT)
-			arg_types[i] = &ffi_type_double;
-		else if (ptr->types[i] == TAG_PTR)
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_CSTR)
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_CCSTR)
-			arg_types[i] = &ffi_type_pointer;
-		else
-			arg_types[i] = &ffi_type_void;
-
-		if (ptr->types[i] == TAG_UINT8)
-			arg_values[i] = &c->val_uint8;
-		else if (ptr->types[i] == TAG_UINT16)
-			arg_values[i] = &c->val_uint16;
-		else if (ptr->types[i] == TAG_UINT32)
-			arg_values[i] = &c->val_uint32;
-		else if (ptr->types[i] == TAG_UINT64)
-			arg_values[i] = &c->val_uint64;
-		else if (ptr->types[i] == TAG_INT8)
-			arg_values[i] = &c->val_int8;
-		else if (ptr->types[i] == TAG_INT16)
-			arg_values[i] = &c->val_int16;
-		else if (ptr->types[i] == TAG_INT32)
-			arg_values[i] = &c->val_int32;
-		else if (ptr->types[i] == TAG_INT64)
-			arg_values[i] = &c->val_int64;
-		else if (ptr->types[i] == TAG_FLOAT32)
-			arg_values[i] = &c->val_float32;
-		else if (ptr->types[i] == TAG_FLOAT)
-			arg_values[i] = &c->val_float;
-		else if (ptr->types[i] == TAG_PTR)
-			arg_values[i] = &c->val_ptr;
-		else if (ptr->types[i] == TAG_CSTR)
-			arg_values[i] = C_STR(q, c);
-		else if (ptr->types[i] == TAG_CCSTR)
-			arg_values[i] = C_STR(q, c);
-		else
-			arg_values[i] = NULL;
+		uint8_t type = ptr->types[i];
+
+		if ((type == TAG_ARRAY) || (type == TAG_STRUCT)) {
+			bool ok = marshal_buffer(q, c, c_ctx, type, &plan->args[i], &bufs, &s_args[i]);
+
+			if (!ok || q->did_throw) {
+				free_bufs(&bufs);
+				return ok;
+			}
+
+			arg_values[i] = &s_args[i];
+		} else if (!is_type(c, type)) {
+			free_bufs(&bufs);
+			return throw_error(q, c, c_ctx, "type_error", type_name_of(type));
+		} else
+			arg_values[i] = marshal_arg(q, c, type, &cells[i], &s_args[i]);
 
 		GET_NEXT_ARG(p2, any);
 		c = p2;
 		c_ctx = p2_ctx;
 	}
 
-	ffi_type *ret_type = NULL;
-
-	if (ptr->ret_type == TAG_UINT8)
-		ret_type = &ffi_type_uint8;
-	else if (ptr->ret_type == TAG_UINT16)
-		ret_type = &ffi_type_uint16;
-	else if (ptr->ret_type == TAG_UINT32)
-		ret_type = &ffi_type_uint32;
-	else if (ptr->ret_type == TAG_UINT64)
-		ret_type = &ffi_type_uint64;
-	else if (ptr->ret_type == TAG_INT8)
-		ret_type = &ffi_type_sint8;
-	else if (ptr->ret_type == TAG_INT16)
-		ret_type = &ffi_type_sint16;
-	else if (ptr->ret_type == TAG_INT32)
-		ret_type = &ffi_type_sint32;
-	else if (ptr->ret_type == TAG_INT64)
-		ret_type = &ffi_type_sint64;
-	else if (ptr->ret_type == TAG_FLOAT32)
-		ret_type = &ffi_type_float;
-	else if (ptr->ret_type == TAG_FLOAT)
-		ret_type = &ffi_type_double;
-	else if (ptr->ret_type == TAG_PTR)
-		ret_type = &ffi_type_pointer;
-	else if (ptr->ret_type == TAG_CSTR)
-		ret_type = &ffi_type_pointer;
-	else if (ptr->ret_type == TAG_CCSTR)
-		ret_type = &ffi_type_pointer;
-	else
-		return false;
-
-	if (ffi_prep_cif(&cif, FFI_DEFAULT_ABI, ptr->arity, ret_type, arg_types) != FFI_OK)
-		return false;
-
 	union result_ result;
-	ffi_call(&cif, FFI_FN(ptr->fn), &result, arg_values);
-
+	ffi_call(&plan->cif, FFI_FN(ptr->fn), &result, arg_values);
+	free_bufs(&bufs);
 	cell tmp;
 
-	if (ptr->ret_type == TAG_UINT8)
-		make_int(&tmp, result.u8);
-	else if (ptr->ret_type == TAG_UINT16)
-		make_int(&tmp, result.u16);
-	else if (ptr->ret_type == TAG_UINT32)
-		make_int(&tmp, result.u32);
-	else if (ptr->ret_type == TAG_UINT64)
-		make_int(&tmp, result.u64);
-	else if (ptr->ret_type == TAG_INT8)
-		make_int(&tmp, result.i8);
-	else if (ptr->ret_type == TAG_INT16)
-		make_int(&tmp, result.i16);
-	else if (ptr->ret_type == TAG_INT32)
-		make_int(&tmp, result.i32);
-	else if (ptr->ret_type == TAG_INT64)
-		make_int(&tmp, result.i64);
-	else if (ptr->ret_type == TAG_FLOAT32)
-		make_float(&tmp, result.f32);
-	else if (ptr->ret_type == TAG_FLOAT)
-		make_float(&tmp, result.f64);
-	else if (ptr->ret_type == TAG_PTR)
-		make_cstring(&tmp, result.p);
-	else if (ptr->ret_type == TAG_CSTR)
-		make_cstring(&tmp, result.p);
-	else if (ptr->ret_type == TAG_CCSTR)
-		make_cstring(&tmp, result.p);
-	else
-		return false;
+	switch (ptr->ret_type) {
+	case TAG_UINT8: make_int(&tmp, result.u8); break;
+	case TAG_UINT16: make_int(&tmp, result.u16); break;
+	case TAG_UINT32: make_int(&tmp, result.u32); break;
+	case TAG_UINT64: make_int(&tmp, result.u64); break;
+	case TAG_INT8: make_int(&tmp, result.i8); break;
+	case TAG_INT16: make_int(&tmp, result.i16); break;
+	case TAG_INT32: make_int(&tmp, result.i32); break;
+	case TAG_INT64: make_int(&tmp, result.i64); break;
+	case TAG_FLOAT32: make_float(&tmp, result.f32); break;
+	case TAG_FLOAT: make_float(&tmp, result.f64); break;
+	case TAG_PTR: make_cstring(&tmp, result.p); break;
+	case TAG_CSTR: make_cstring(&tmp, result.p); break;
+	case TAG_CCSTR: make_cstring(&tmp, result.p); break;
+	default: return false;
+	}
 
 	q->accum = tmp;
 	return true;
@@ -524,265 +761,88 @@ bool wrapper_for_predicate(query *q, builtins *ptr)
 	GET_FIRST_ARG(p1, any);
 	cell *c = p1;
 	pl_idx_t c_ctx = p1_ctx;
-
-	ffi_cif cif;
-	ffi_type *arg_types[MAX_ARITY];
-	ffi_status status;
+	ffi_plan *plan = &g_ffi_plans[ptr - g_ffi_bifs];
 	void *arg_values[MAX_ARITY];
 	void *s_args[MAX_ARITY];
 	cell cells[MAX_ARITY];
+	ffi_bufs bufs;
+	bufs.nbr = 0;
+
+	if (!plan->ok)
+		return false;
 
 	for (unsigned i = 0; i < (ptr->arity-1); i++) {
-		if ((ptr->types[i] == TAG_INT64) && is_smallint(c))
-			;
-		else if ((ptr->types[i] == TAG_PTR) && is_smallint(c))
-			;
-		else if ((ptr->types[i] != c->tag) && !is_variable(c))
-			return throw_error(q, c, c_ctx, "type_error",
-			ptr->types[i] == TAG_UINT8 ? "integer" :
-			ptr->types[i] == TAG_UINT16 ? "integer" :
-			ptr->types[i] == TAG_UINT32 ? "integer" :
-			ptr->types[i] == TAG_UINT64 ? "integer" :
-			ptr->types[i] == TAG_INT8 ? "integer" :
-			ptr->types[i] == TAG_INT16 ? "integer" :
-			ptr->types[i] == TAG_INT32 ? "integer" :
-			ptr->types[i] == TAG_INT64 ? "integer" :
-			ptr->types[i] == TAG_FLOAT32 ? "float" :
-			ptr->types[i] == TAG_FLOAT ? "float" :
-			ptr->types[i] == TAG_CSTR ? "atom" :
-			ptr->types[i] == TAG_CCSTR ? "atom" :
-			ptr->types[i] == TAG_PTR ? "stream" :
-			ptr->types[i] == TAG_VAR ? "variable" :
-			"invalid"
-			);
-
-		const char *src = C_STR(q, c);
-
-		if (ptr->types[i] == TAG_UINT8)
-			arg_types[i] = &ffi_type_uint8;
-		else if (ptr->types[i] == MARK_OUT(TAG_UINT8))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_UINT16)
-			arg_types[i] = &ffi_type_uint16;
-		else if (ptr->types[i] == MARK_OUT(TAG_UINT16))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_UINT32)
-			arg_types[i] = &ffi_type_uint32;
-		else if (ptr->types[i] == MARK_OUT(TAG_UINT32))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_UINT64)
-			arg_types[i] = &ffi_type_uint64;
-		else if (ptr->types[i] == MARK_OUT(TAG_UINT64))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_INT8)
-			arg_types[i] = &ffi_type_sint8;
-		else if (ptr->types[i] == MARK_OUT(TAG_INT8))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_INT16)
-			arg_types[i] = &ffi_type_sint16;
-		else if (ptr->types[i] == MARK_OUT(TAG_INT16))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_INT32)
-			arg_types[i] = &ffi_type_sint32;
-		else if (ptr->types[i] == MARK_OUT(TAG_INT32))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_INT64)
-			arg_types[i] = &ffi_type_sint64;
-		else if (ptr->types[i] == MARK_OUT(TAG_INT64))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_FLOAT32)
-			arg_types[i] = &ffi_type_float;
-		else if (ptr->types[i] == MARK_OUT(TAG_FLOAT32))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_FLOAT)
-			arg_types[i] = &ffi_type_double;
-		else if (ptr->types[i] == MARK_OUT(TAG_FLOAT))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_PTR)
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == MARK_OUT(TAG_PTR))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_CSTR)
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == MARK_OUT(TAG_CSTR))
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == TAG_CCSTR)
-			arg_types[i] = &ffi_type_pointer;
-		else if (ptr->types[i] == MARK_OUT(TAG_CCSTR))
-			arg_types[i] = &ffi_type_pointer;
-		else
-			arg_types[i] = &ffi_type_void;
-
-		if (ptr->types[i] == TAG_UINT8) {
-			arg_values[i] = &c->val_uint8;
-		} else if (ptr->types[i] == MARK_OUT(TAG_UINT8)) {
-			s_args[i] = &cells[i].val_uint8;
-			arg_values[i] = &cells[i].val_uint8;
-		} else if (ptr->types[i] == TAG_UINT16) {
-			arg_values[i] = &c->val_uint16;
-		} else if (ptr->types[i] == MARK_OUT(TAG_UINT16)) {
-			s_args[i] = &cells[i].val_uint16;
-			arg_values[i] = &cells[i].val_uint16;
-		} else if (ptr->types[i] == TAG_UINT32) {
-			arg_values[i] = &c->val_uint32;
-		} else if (ptr->types[i] == MARK_OUT(TAG_UINT32)) {
-			s_args[i] = &cells[i].val_uint32;
-			arg_values[i] = &cells[i].val_uint32;
-		} else if (ptr->types[i] == TAG_UINT64) {
-			arg_values[i] = &c->val_uint64;
-		} else if (ptr->types[i] == MARK_OUT(TAG_UINT64)) {
-			s_args[i] = &cells[i].val_uint64;
-			arg_values[i] = &cells[i].val_uint64;
-		} else if (ptr->types[i] == TAG_INT8) {
-			arg_values[i] = &c->val_int8;
-		} else if (ptr->types[i] == MARK_OUT(TAG_INT8)) {
-			s_args[i] = &cells[i].val_int8;
-			arg_values[i] = &cells[i].val_int8;
-		} else if (ptr->types[i] == TAG_INT16) {
-			arg_values[i] = &c->val_int16;
-		} else if (ptr->types[i] == MARK_OUT(TAG_INT16)) {
-			s_args[i] = &cells[i].val_int16;
-			arg_values[i] = &cells[i].val_int16;
-		} else if (ptr->types[i] == TAG_INT32) {
-			arg_values[i] = &c->val_int32;
-		} else if (ptr->types[i] == MARK_OUT(TAG_INT32)) {
-			s_args[i] = &cells[i].val_int32;
-			arg_values[i] = &cells[i].val_int32;
-		} else if (ptr->types[i] == TAG_INT64) {
-			arg_values[i] = &c->val_int64;
-		} else if (ptr->types[i] == MARK_OUT(TAG_INT64)) {
-			s_args[i] = &cells[i].val_int64;
-			arg_values[i] = &cells[i].val_int64;
-		} else if (ptr->types[i] == TAG_FLOAT32) {
-			arg_values[i] = &c->val_float32;
-		} else if (ptr->types[i] == MARK_OUT(TAG_FLOAT32)) {
-			s_args[i] = &cells[i].val_float32;
-			arg_values[i] = &s_args[i];
-		} else if (ptr->types[i] == TAG_FLOAT) {
-			arg_values[i] = &c->val_float;
-		} else if (ptr->types[i] == MARK_OUT(TAG_FLOAT)) {
-			s_args[i] = &cells[i].val_float;
+		uint8_t type = ptr->types[i], base = UNMARK_OUT(type);
+		const ffi_desc *arg = plan->args ? &plan->args[i] : NULL;
+
+		if (IS_OUT(type) && (base == TAG_ARRAY)) {
+			cell *n = deref(q, get_raw_arg(q, arg->size_arg), q->st.curr_frame);
+
+			if (!is_smallint(n) || is_negative(n)) {
+				free_bufs(&bufs);
+				return throw_error(q, n, q->latest_ctx, "type_error", "integer");
+			}
+
+			cells[i].val_uint = get_smallint(n);
+			s_args[i] = alloc_buf(&bufs, size_of(arg->elem) * cells[i].val_uint);
 			arg_values[i] = &s_args[i];
-		} else if (ptr->types[i] == TAG_PTR) {
-			arg_values[i] = &c->val_ptr;
-		} else if (ptr->types[i] == MARK_OUT(TAG_PTR)) {
-			s_args[i] = &cells[i].val_ptr;
+			check_heap_error(s_args[i], free_bufs(&bufs));
+		} else if (IS_OUT(type) && (base == TAG_STRUCT)) {
+			s_args[i] = alloc_buf(&bufs, arg->size);
 			arg_values[i] = &s_args[i];
-		} else if (ptr->types[i] == TAG_CSTR) {
-			cells[i].val_str = C_STR(q, c);
-			s_args[i] = &cells[i].val_str;
-			arg_values[i] = &cells[i].val_str;
-		} else if (ptr->types[i] == MARK_OUT(TAG_CSTR)) {
-			cells[i].val_str = C_STR(q, c);
-			s_args[i] = &cells[i].val_str;
+			check_heap_error(s_args[i], free_bufs(&bufs));
+		} else if (IS_OUT(type)) {
+			memset(&cells[i], 0, sizeof(cell));
+			s_args[i] = &cells[i].val_int64;
 			arg_values[i] = &s_args[i];
-		} else if (ptr->types[i] == TAG_CCSTR) {
-			cells[i].val_str = C_STR(q, c);
-			s_args[i] = &cells[i].val_str;
-			arg_values[i] = &cells[i].val_str;
-		} else if (ptr->types[i] == MARK_OUT(TAG_CCSTR)) {
-			cells[i].val_str = C_STR(q, c);
-			s_args[i] = &cells[i].val_str;
+		} else if (is_variable(c)) {
+			memset(&cells[i], 0, sizeof(cell));
+			arg_values[i] = &cells[i].val_int64;
+		} else if ((base == TAG_ARRAY) || (base == TAG_STRUCT)) {
+			bool ok = marshal_buffer(q, c, c_ctx, type, arg, &bufs, &s_args[i]);
+
+			if (!ok || q->did_throw) {
+				free_bufs(&bufs);
+				return ok;
+			}
+
 			arg_values[i] = &s_args[i];
+		} else if (!is_type(c, type)) {
+			free_bufs(&bufs);
+			return throw_error(q, c, c_ctx, "type_error", type_name_of(type));
 		} else
-			arg_values[i] = NULL;
+			arg_values[i] = marshal_arg(q, c, type, &cells[i], &s_args[i]);
 
 		GET_NEXT_ARG(p2, any);
 		c = p2;
 		c_ctx = p2_ctx;
 	}
 
-	ffi_type *ret_type = NULL;
-
-	if (ptr->ret_type == TAG_UINT8)
-		ret_type = &ffi_type_uint8;
-	else if (ptr->ret_type == TAG_UINT16)
-		ret_type = &ffi_type_uint16;
-	else if (ptr->ret_type == TAG_UINT32)
-		ret_type = &ffi_type_uint32;
-	else if (ptr->ret_type == TAG_UINT64)
-		ret_type = &ffi_type_uint64;
-	else if (ptr->ret_type == TAG_INT8)
-		ret_type = &ffi_type_sint8;
-	else if (ptr->ret_type == TAG_INT16)
-		ret_type = &ffi_type_sint16;
-	else if (ptr->ret_type == TAG_INT32)
-		ret_type = &ffi_type_sint32;
-	else if (ptr->ret_type == TAG_INT64)
-		ret_type = &ffi_type_sint64;
-	else if (ptr->ret_type == TAG_FLOAT32)
-		ret_type = &ffi_type_float;
-	else if (ptr->ret_type == TAG_FLOAT)
-		ret_type = &ffi_type_double;
-	else if (ptr->ret_type == TAG_PTR)
-		ret_type = &ffi_type_pointer;
-	else if (ptr->ret_type == TAG_CSTR)
-		ret_type = &ffi_type_pointer;
-	else if (ptr->ret_type == TAG_CCSTR)
-		ret_type = &ffi_type_pointer;
-	else
-		return false;
-
-	if (ffi_prep_cif(&cif, FFI_DEFAULT_ABI, ptr->arity-1, ret_type, arg_types) != FFI_OK)
-		return false;
-
 	union result_ result;
-	ffi_call(&cif, FFI_FN(ptr->fn), &result, arg_values);
+	ffi_call(&plan->cif, FFI_FN(ptr->fn), &result, arg_values);
 
 	GET_FIRST_ARG(p11, any);
 	c = p11;
 	c_ctx = p11_ctx;
 
 	for (unsigned i = 0; i < (ptr->arity-1); i++) {
-		if (is_variable(c)) {
+		uint8_t type = ptr->types[i], base = UNMARK_OUT(type);
+		bool ok = true;
+
+		if (!IS_OUT(type) || !is_variable(c))
+			;
+		else if ((base == TAG_ARRAY) || (base == TAG_STRUCT))
+			ok = unify_buffer(q, c, c_ctx, base, &plan->args[i], s_args[i], cells[i].val_uint);
+		else {
 			cell tmp;
+			check_heap_error(unmarshal_arg(&tmp, base, &cells[i]), free_bufs(&bufs));
+			ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
+			unshare_cell(&tmp);
+		}
 
-			if (ptr->types[i] == MARK_OUT(TAG_INT8)) {
-				make_int(&tmp, cells[i].val_int8);
-				bool ok = unify (q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_INT16)) {
-				make_int(&tmp, cells[i].val_int16);
-				bool ok = unify (q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_INT32)) {
-				make_int(&tmp, cells[i].val_int32);
-				bool ok = unify (q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_INT64)) {
-				make_int(&tmp, cells[i].val_int64);
-				bool ok = unify (q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_FLOAT32)) {
-				make_float(&tmp, cells[i].val_float32);
-				bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_FLOAT)) {
-				make_float(&tmp, cells[i].val_float);
-				bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_PTR)) {
-				make_ptr(&tmp, cells[i].val_ptr);
-				bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_CSTR)) {
-				check_heap_error(make_cstring(&tmp, cells[i].val_str));
-				bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			} else if (ptr->types[i] == MARK_OUT(TAG_CCSTR)) {
-				check_heap_error(make_cstring(&tmp, cells[i].val_str));
-				bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-				unshare_cell(&tmp);
-				if (ok != true) return ok;
-			}
+		if (!ok || q->did_throw) {
+			free_bufs(&bufs);
+			return ok;
 		}
 
 		GET_NEXT_ARG(p2, any);
@@ -790,57 +850,32 @@ bool wrapper_for_predicate(query *q, builtins *ptr)
 		c_ctx = p2_ctx;
 	}
 
+	free_bufs(&bufs);
+
 	cell tmp;
 
-	if (ptr->ret_type == TAG_INT8) {
-		make_int(&tmp, result.i8);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_INT16) {
-		make_int(&tmp, result.i16);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_INT32) {
-		make_int(&tmp, result.i32);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_INT64) {
-		make_int(&tmp, result.i64);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_FLOAT32) {
-		make_float(&tmp, result.f32);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_FLOAT) {
-		make_float(&tmp, result.f64);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_PTR) {
-		make_ptr(&tmp, result.p);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_CSTR) {
+	switch (ptr->ret_type) {
+	case TAG_INT8: make_int(&tmp, result.i8); break;
+	case TAG_INT16: make_int(&tmp, result.i16); break;
+	case TAG_INT32: make_int(&tmp, result.i32); break;
+	case TAG_INT64: make_int(&tmp, result.i64); break;
+	case TAG_FLOAT32: make_float(&tmp, result.f32); break;
+	case TAG_FLOAT: make_float(&tmp, result.f64); break;
+	case TAG_PTR: make_ptr(&tmp, result.p); break;
+	case TAG_CSTR:
 		check_heap_error(make_cstring(&tmp, result.s));
 		free(result.s);
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
-	} else if (ptr->ret_type == TAG_CCSTR) {
+		break;
+	case TAG_CCSTR:
 		check_heap_error(make_cstring(&tmp, result.s));
-		bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
-		unshare_cell(&tmp);
-		if (ok != true) return ok;
+		break;
+	default:
+		return true;
 	}
 
-	return true;
+	bool ok = unify(q, c, c_ctx, &tmp, q->st.curr_frame);
+	unshare_cell(&tmp);
+	return ok;
 }
 #endif
 
@@ -8,6 +8,9 @@
 
 static int format_integer(char *dst, pl_int_t v, int grouping, int sep, int decimals, int radix)
 {
+	if (!grouping && !decimals && (radix == 10))
+		return sprint_int(dst, 40, v, radix);
+
 	char tmpbuf1[1024], tmpbuf2[1024];
 	sprint_int(tmpbuf1, sizeof(tmpbuf1), v, radix);
 	const char *src = tmpbuf1 + strlen(tmpbuf1) - 1;	// start from back
@@ -38,12 +41,32 @@ static int format_integer(char *dst, pl_int_t v, int grouping, int sep, int deci
 	return dst2 - dst;
 }
 
+// A format text is compiled the first time it is seen to a program
+// of literal runs and directives, which is kept by text in a small
+// cache. A directive taking its value from the args ('*') still
+// takes it at run time...
+
+typedef struct {
+	const char *lit;			// a literal run, or else
+	size_t lit_len;
+	int ch, argval, noargval;	// a directive
+	bool star;
+} format_op;
+
+typedef struct format_prog_ {
+	char *text;
+	size_t len;
+	unsigned nbr_ops;
+	format_op ops[];
+} format_prog;
+
 typedef struct {
 	cell *p;
 	pl_idx_t p_ctx;
 	const char *srcbuf;
 	const char *src;
 	size_t srclen;
+	const format_op *op, *end;
 }
  list_reader_t;
 
@@ -97,6 +120,9 @@ static bool is_more_data(query *q, list_reader_t *fmt)
 {
 	(void)q;
 
+	if (fmt->op)
+		return fmt->op != fmt->end;
+
 	if (fmt->src)
 		return fmt->srclen;
 
@@ -106,18 +132,155 @@ static bool is_more_data(query *q, list_reader_t *fmt)
 	return is_list(fmt->p);
 }
 
+// Read a directive after its '~', returning the directive char...
+
+static int get_directive(query *q, list_reader_t *fmt, int *argval, int *noargval, bool *star)
+{
+	int ch = get_next_char(q, fmt);
+	*star = false;
+
+	if (ch == '*') {
+		*star = true;
+		*noargval = 0;
+		ch = get_next_char(q, fmt);
+	} else if (ch == '`') {
+		ch = get_next_char(q, fmt);
+		*argval = ch;
+		ch = get_next_char(q, fmt);
+	} else {
+		while (isdigit(ch)) {
+			*noargval = 0;
+			*argval *= 10;
+			*argval += ch - '0';
+			ch = get_next_char(q, fmt);
+		}
+	}
+
+	return ch;
+}
+
+static unsigned format_hash(const char *src, size_t len)
+{
+	unsigned h = 2166136261U;
+
+	while (len--) {
+		h ^= (unsigned char)*src++;
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+// Returns NULL if the text can't be compiled, such as when a directive
+// runs off the end, leaving it to be interpreted as before...
+
+static format_prog *compile_format(query *q, const char *src, size_t len)
+{
+	unsigned nbr_ops = 1;
+
+	for (size_t i = 0; i < len; i++) {
+		if (src[i] == '~')
+			nbr_ops += 2;
+	}
+
+	format_prog *prog = malloc(sizeof(format_prog) + (sizeof(format_op) * nbr_ops));
+	if (!prog) return NULL;
+	prog->text = malloc(len + 1);
+	if (!prog->text) { free(prog); return NULL; }
+	memcpy(prog->text, src, len);
+	prog->text[len] = '\0';
+	prog->len = len;
+	prog->nbr_ops = 0;
+	const char *end = prog->text + len;
+	list_reader_t fmt = {0};
+	fmt.src = prog->text;
+	fmt.srclen = len;
+
+	while (fmt.src < end) {
+		format_op *op = &prog->ops[prog->nbr_ops++];
+		*op = (format_op){0};
+
+		if (*fmt.src != '~') {
+			const char *ptr = memchr(fmt.src, '~', end - fmt.src);
+			if (!ptr) ptr = end;
+			op->lit = fmt.src;
+			op->lit_len = ptr - fmt.src;
+			fmt.srclen -= op->lit_len;
+			fmt.src = ptr;
+			continue;
+		}
+
+		fmt.src++;
+		fmt.srclen--;
+		op->noargval = 1;
+		op->ch = get_directive(q, &fmt, &op->argval, &op->noargval, &op->star);
+
+		if ((fmt.src > end) || (op->ch <= 0)) {
+			free(prog->text);
+			free(prog);
+			return NULL;
+		}
+	}
+
+	return prog;
+}
+
+static const format_prog *get_format(query *q, const char *src, size_t len)
+{
+	if (len > MAX_FORMAT_LEN)
+		return NULL;
+
+	format_prog **slot = &q->pl->fmt_cache[format_hash(src, len) & (MAX_FMT_CACHE-1)];
+
+	if (*slot && ((*slot)->len == len) && !memcmp((*slot)->text, src, len))
+		return *slot;
+
+	format_prog *prog = compile_format(q, src, len);
+
+	if (!prog)
+		return NULL;
+
+	if (*slot) {
+		free((*slot)->text);
+		free(*slot);
+	}
+
+	*slot = prog;
+	return prog;
+}
+
+void clear_format_cache(prolog *pl)
+{
+	for (unsigned i = 0; i < MAX_FMT_CACHE; i++) {
+		if (!pl->fmt_cache[i])
+			continue;
+
+		free(pl->fmt_cache[i]->text);
+		free(pl->fmt_cache[i]);
+		pl->fmt_cache[i] = NULL;
+	}
+}
+
+// Output is built in a buffer on the stack, moving to the heap only if
+// it outgrows it...
+
 #define CHECK_BUF(len) {									\
-    int n = (len) > 0 ? len : 1;                            \
-	if (nbytes <= (unsigned)(1+n+1)) {    					\
+	size_t n = (len) > 0 ? (len) : 1;						\
+	if ((bufsiz - (size_t)(dst - tmpbuf)) <= (1+n+1)) {		\
 		size_t save = dst - tmpbuf;							\
-		bufsiz += len;										\
-		tmpbuf = realloc(tmpbuf, bufsiz*=2);				\
-		check_heap_error(tmpbuf);								\
+		bufsiz = (bufsiz + n) * 2;							\
+		char *newbuf = tmpbuf != stackbuf ?					\
+			realloc(tmpbuf, bufsiz) : malloc(bufsiz);		\
+		check_heap_error(newbuf, FREE_BUF);					\
+		if (tmpbuf == stackbuf)								\
+			memcpy(newbuf, stackbuf, save);					\
+		tmpbuf = newbuf;									\
 		dst = tmpbuf + save;								\
-		nbytes = bufsiz - save;								\
-	}                                                       \
+	}														\
 }
 
+#define FREE_BUF if (tmpbuf != stackbuf) free(tmpbuf)
+
 bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
 {
 	list_reader_t fmt1 = {0}, fmt2 = {0};
@@ -130,12 +293,20 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 	fmt2.p = p2;
 	fmt2.p_ctx = p2_ctx;
 
-	size_t bufsiz = 1024*8;
-	char *tmpbuf = malloc(bufsiz);
-	check_heap_error(tmpbuf);
+	if (fmt1.srcbuf) {
+		const format_prog *prog = get_format(q, fmt1.srcbuf, fmt1.srclen);
+
+		if (prog) {
+			fmt1.op = prog->ops;
+			fmt1.end = prog->ops + prog->nbr_ops;
+		}
+	}
+
+	char stackbuf[1024*2];
+	size_t bufsiz = sizeof(stackbuf);
+	char *tmpbuf = stackbuf;
 	char *dst = tmpbuf;
 	*dst = '\0';
-	size_t nbytes = bufsiz;
 	bool redo = false, start_of_line = true;
 	int tab_at = 1, tabs = 0, diff = 0, last_at = 0, tab_char = ' ';
 	save_fmt1 = fmt1;
@@ -145,41 +316,46 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		int argval = 0, noargval = 1;
 		int pos = dst - tmpbuf + 1;
         list_reader_t tmp_fmt1 = fmt1, tmp_fmt2 = fmt2;
+		bool star;
+		int ch;
 
-		int ch = get_next_char(q, &fmt1);
+		if (fmt1.op) {
+			const format_op *op = fmt1.op++;
 
-		if (ch != '~') {
-            CHECK_BUF(MAX_BYTES_PER_CODEPOINT);
-			dst += put_char_utf8(dst, ch);
-			start_of_line = ch == '\n';
-			continue;
-		}
+			if (op->lit_len) {
+				CHECK_BUF(op->lit_len);
+				memcpy(dst, op->lit, op->lit_len);
+				dst += op->lit_len;
+				start_of_line = op->lit[op->lit_len-1] == '\n';
+				continue;
+			}
 
-		ch = get_next_char(q, &fmt1);
+			ch = op->ch;
+			argval = op->argval;
+			noargval = op->noargval;
+			star = op->star;
+		} else {
+			ch = get_next_char(q, &fmt1);
+
+			if (ch != '~') {
+				CHECK_BUF(MAX_BYTES_PER_CODEPOINT);
+				dst += put_char_utf8(dst, ch);
+				start_of_line = ch == '\n';
+				continue;
+			}
+
+			ch = get_directive(q, &fmt1, &argval, &noargval, &star);
+		}
 
-		if (ch == '*') {
+		if (star) {
 			cell *c = get_next_cell(q, &fmt2);
-			noargval = 0;
 
 			if (!c || !is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
 			argval = get_smallint(c);
-			ch = get_next_char(q, &fmt1);
-		} else if (ch == '`') {
-			ch = get_next_char(q, &fmt1);
-			argval = ch;
-			ch = get_next_char(q, &fmt1);
-		} else {
-			while (isdigit(ch)) {
-				noargval = 0;
-				argval *= 10;
-				argval += ch - '0';
-				ch = get_next_char(q, &fmt1);
-				continue;
-			}
 		}
 
 		CHECK_BUF(argval);
@@ -294,6 +470,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		}
 
 		if (!p2 || !is_list(p2)) {
+			FREE_BUF;
 			cell tmp;
 			make_atom(&tmp, g_nil_s);
 			return throw_error(q, &tmp, q->st.curr_frame, "domain_error", "missing_args");
@@ -301,8 +478,10 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		cell *c = get_next_cell(q, &fmt2);
 
-		if (!c)
+		if (!c) {
+			FREE_BUF;
 			return throw_error(q, p2, p2_ctx, "domain_error", "missing_args");
+		}
 
 		if (ch == 'i')
 			continue;
@@ -312,7 +491,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		size_t len = 0;
 
 		if ((ch == 'a') && !is_atom(c)) {
-			free(tmpbuf);
+			FREE_BUF;
 			return throw_error(q, c, q->st.curr_frame, "type_error", "atom");
 		}
 
@@ -345,7 +524,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'c':
 			if (!is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
@@ -362,7 +541,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		case 'e':
 		case 'E':
 			if (!is_float(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "float");
 			}
 
@@ -386,7 +565,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		case 'g':
 		case 'G':
 			if (!is_float(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "float");
 			}
 
@@ -409,7 +588,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'f':
 			if (!is_float(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "float");
 			}
 
@@ -425,7 +604,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'I':
 			if (!is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
@@ -436,7 +615,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'd':
 			if (!is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
@@ -447,7 +626,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'D':
 			if (!is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
@@ -458,12 +637,12 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'r':
 			if (!noargval && ((argval < 2) || (argval > 36))) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, p1, p1_ctx, "domain_error", "radix_invalid");
 			}
 
 			if (!is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
@@ -474,12 +653,12 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 		case 'R':
 			if (!noargval && ((argval < 2) || (argval > 36))) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, p1, p1_ctx, "domain_error", "radix_invalid");
 			}
 
 			if (!is_integer(c)) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "type_error", "integer");
 			}
 
@@ -493,6 +672,17 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		case 'w':
 		case 'a':
         {
+			// A plain atom prints as its text...
+
+			if (((ch == 'a') || (ch == 'w')) && noargval && is_atom(c) && !is_string(c)
+				&& iswalpha(peek_char_utf8(C_STR(q, c)))) {
+				len = C_STRLEN(q, c);
+				CHECK_BUF(len);
+				memcpy(dst, C_STR(q, c), len);
+				q->last_thing_was_symbol = false;
+				break;
+			}
+
 			int saveq = q->quoted;
 			bool canonical = false, quoted = false;
 			q->numbervars = true;
@@ -518,7 +708,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 				len = print_term_to_buf(q, NULL, 0, c, c_ctx, 1, false, 0);
 
 			if (q->cycle_error) {
-				free(tmpbuf);
+				FREE_BUF;
 				return throw_error(q, c, q->st.curr_frame, "resource_error", "cyclic");
             }
 
@@ -535,12 +725,11 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
         }
 
         default:
-			free(tmpbuf);
+			FREE_BUF;
 			return throw_error(q, c, q->st.curr_frame, "existence_error", "format_character");
 		}
 
 		dst += len;
-		nbytes -= len;
 	}
 
 	*dst = '\0';
@@ -548,14 +737,14 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 	if (str == NULL) {
 		int n = q->st.m->pl->current_output;
-		stream *str = &q->pl->streams[n];
+		stream *str = q->pl->streams[n];
 		net_write(tmpbuf, len, str);
 	} else if (is_structure(str)
 		&& ((CMP_STR_CSTR(q, str, "atom")
 		&& CMP_STR_CSTR(q, str, "chars")
 		&& CMP_STR_CSTR(q, str, "string"))
 		|| (str->arity > 1) || !is_variable(str+1))) {
-		free(tmpbuf);
+		FREE_BUF;
 		return throw_error(q, str, str_ctx, "type_error", "structure");
 	} else if (is_structure(str) && !CMP_STR_CSTR(q, str, "atom")) {
 		cell *c = deref(q, str+1, str_ctx);
@@ -576,7 +765,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 		unshare_cell(&tmp);
 	} else if (is_stream(str)) {
 		int n = get_stream(q, str);
-		stream *str = &q->pl->streams[n];
+		stream *str = q->pl->streams[n];
 		const char *tmpsrc = tmpbuf;
 
 		while (len) {
@@ -584,7 +773,7 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 
 			if (!nbytes) {
 				if (feof(str->fp) || ferror(str->fp)) {
-					free(tmpbuf);
+					FREE_BUF;
 					fprintf(stdout, "Error: end of file on write\n");
 					return false;
 				}
@@ -595,11 +784,11 @@ bool do_format(query *q, cell *str, pl_idx_t str_ctx, cell *p1, pl_idx_t p1_ctx,
 			tmpsrc += nbytes;
 		}
 	} else {
-		free(tmpbuf);
+		FREE_BUF;
 		return throw_error(q, str, str_ctx, "domain_error", "stream_or_alias");
 	}
 
-	free(tmpbuf);
+	FREE_BUF;
 	return true;
 }
 
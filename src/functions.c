@@ -12,20 +12,59 @@
 #include "prolog.h"
 #include "query.h"
 
+// A result that fits is made a smallint, so that a bigint calculation
+// which comes back into range carries on without allocating. Not so
+// -2^63, it has no smallint negation and the parser keeps it a bigint.
+// The size is looked at first, most bigint results don't fit...
+
+static inline bool bigint_to_smallint(mp_int z, mp_small *v)
+{
+#if USE_GMP
+	if (!mpz_fits_slong_p(z))
+		return false;
+
+	*v = mpz_get_si(z);
+	return *v != LONG_MIN;
+#else
+	mp_size used = MP_USED(z);
+
+	if ((used * MP_DIGIT_BIT) > 64)
+		return false;
+
+	const mp_digit *d = MP_DIGITS(z);
+	uint64_t uv = 0;
+
+	for (mp_size i = used; i > 0; i--)
+		uv = (uv << MP_DIGIT_BIT) | d[i-1];
+
+	if (uv > INT64_MAX)
+		return false;
+
+	*v = MP_SIGN(z) == MP_NEG ? -(mp_small)uv : (mp_small)uv;
+	return true;
+#endif
+}
+
 #define SET_ACCUM() {											\
 	if (errno == ENOMEM)										\
 		return throw_error(q, &p1, q->st.curr_frame, "resource_error", "memory"); \
-	q->accum.tag = TAG_INTEGER;										\
-	q->accum.flags = FLAG_MANAGED;								\
-	q->accum.val_bigint = malloc(sizeof(bigint));				\
-	if (errno == ENOMEM)										\
-		return throw_error(q, &p1, q->st.curr_frame, "resource_error", "memory"); \
-	q->accum.val_bigint->refcnt = 0;							\
-	if (mp_int_init_copy(&q->accum.val_bigint->ival, &q->tmp_ival) == MP_MEMORY) {\
-		return throw_error(q, &q->accum, q->st.curr_frame, "resource_error", "memory"); \
-	} \
-	if (errno == ENOMEM)										\
-		return throw_error(q, &p1, q->st.curr_frame, "resource_error", "memory"); \
+	mp_small v_;												\
+	if (bigint_to_smallint(&q->tmp_ival, &v_)) {				\
+		q->accum.tag = TAG_INTEGER;								\
+		q->accum.flags = 0;										\
+		q->accum.val_int = v_;									\
+	} else {													\
+		q->accum.tag = TAG_INTEGER;								\
+		q->accum.flags = FLAG_MANAGED;							\
+		q->accum.val_bigint = malloc(sizeof(bigint));			\
+		if (errno == ENOMEM)									\
+			return throw_error(q, &p1, q->st.curr_frame, "resource_error", "memory"); \
+		q->accum.val_bigint->refcnt = 0;						\
+		if (mp_int_init_copy(&q->accum.val_bigint->ival, &q->tmp_ival) == MP_MEMORY) \
+			return throw_error(q, &q->accum, q->st.curr_frame, "resource_error", "memory"); \
+		if (errno == ENOMEM)									\
+			return throw_error(q, &p1, q->st.curr_frame, "resource_error", "memory"); \
+	}															\
 }
 
 void clr_accum(cell *p)
@@ -46,7 +85,7 @@ void clr_accum(cell *p)
 
 #define ON_OVERFLOW(op,v1,v2)									\
 	__int128_t tmp = (__int128_t)v1 op v2;						\
-	if ((tmp > INT64_MAX) || (tmp < INT64_MIN))
+	if ((tmp > INT64_MAX) || (tmp <= INT64_MIN))
 #else
 
 #define ON_OVERFLOW(op,v1,v2)									\
@@ -82,10 +121,8 @@ void clr_accum(cell *p)
 		} \
 	} else if (is_bigint(&p2)) { \
 		if (is_smallint(&p1)) { \
-			mpz_t tmp; \
-			mp_int_init_value(&tmp, p1.val_int); \
-			mp_int_##op2(&tmp, &p2.val_bigint->ival, &q->tmp_ival); \
-			mp_int_clear(&tmp); \
+			mp_int_set_value(&q->tmp_small, p1.val_int); \
+			mp_int_##op2(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival); \
 			SET_ACCUM(); \
 		} else if (is_float(&p1)) { \
 			double d = BIGINT_TO_DOUBLE(&p2.val_bigint->ival); \
@@ -134,10 +171,8 @@ void clr_accum(cell *p)
 		} \
 	} else if (is_bigint(&p2)) { \
 		if (is_smallint(&p1)) { \
-			mpz_t tmp; \
-			mp_int_init_value(&tmp, p1.val_int); \
-			mp_int_##op2(&tmp, &p2.val_bigint->ival, &q->tmp_ival); \
-			mp_int_clear(&tmp); \
+			mp_int_set_value(&q->tmp_small, p1.val_int); \
+			mp_int_##op2(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival); \
 			SET_ACCUM(); \
 		} else { \
 			return throw_error(q, &p1, q->st.curr_frame, "type_error", "evaluable"); \
@@ -209,7 +244,7 @@ bool call_userfun(query *q, cell *c, pl_idx_t c_ctx)
 
 	cell *save = q->st.curr_cell;
 	pl_idx_t save_ctx = q->st.curr_frame;
-	cell *tmp = clone_to_heap(q, true, c, 2);
+	cell *tmp = clone_to_heap(q, true, c, q->st.curr_frame, 2);
 	pl_idx_t nbr_cells = 1 + c->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_drop_barrier, fn_sys_drop_barrier, 0, 0);
 	make_return(q, tmp+nbr_cells);
@@ -1368,15 +1403,11 @@ static bool fn_iso_powi_2(query *q)
 		if (is_negative(&p2))
 			return throw_error(q, &p2, q->st.curr_frame, "type_error", "greater_zero");
 
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
 
-		if (mp_int_expt_full(&tmp, &p2.val_bigint->ival, &q->tmp_ival) != MP_OK) {
-			mp_int_clear(&tmp);
+		if (mp_int_expt_full(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival) != MP_OK)
 			return throw_error(q, &p2, q->st.curr_frame, "resource_error", "memory");
-		}
 
-		mp_int_clear(&tmp);
 		SET_ACCUM();
 	} else if (is_smallint(&p1) && is_smallint(&p2)) {
 		if ((p1.val_int == 0) && (p2.val_int < 0))
@@ -1595,6 +1626,19 @@ static bool fn_iso_divint_2(query *q)
 	return true;
 }
 
+static pl_int_t smallint_mod(pl_int_t v1, pl_int_t v2)
+{
+	pl_int_t n = v1 % v2;
+
+	if (v2 < 0)
+		n *= -1;
+
+	if (v1 < 0)
+		n *= -1;
+
+	return n;
+}
+
 static bool fn_iso_mod_2(query *q)
 {
 	CHECK_CALC();
@@ -1607,14 +1651,7 @@ static bool fn_iso_mod_2(query *q)
 		if (p2.val_int == 0)
 			return throw_error(q, &p1, q->st.curr_frame, "evaluation_error", "zero_divisor");
 
-		q->accum.val_int = p1.val_int % p2.val_int;
-
-		if (p2.val_int < 0)
-			q->accum.val_int *= -1;
-
-		if (p1.val_int < 0)
-			q->accum.val_int *= -1;
-
+		q->accum.val_int = smallint_mod(p1.val_int, p2.val_int);
 		q->accum.tag = TAG_INTEGER;
 	} else if (is_bigint(&p1) && is_bigint(&p2)) {
 		mp_int_mod(&p1.val_bigint->ival, &p2.val_bigint->ival, &q->tmp_ival);
@@ -1632,10 +1669,8 @@ static bool fn_iso_mod_2(query *q)
 		q->accum.val_int = n;
 		q->accum.tag = TAG_INTEGER;
 	} else if (is_smallint(&p1) && is_bigint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
-		mp_int_mod(&tmp, &p2.val_bigint->ival, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
+		mp_int_mod(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_variable(&p1) || is_variable(&p2)) {
 		return throw_error(q, &p1, q->st.curr_frame, "instantiation_error", "not_sufficiently_instantiated");
@@ -1662,20 +1697,16 @@ static bool fn_iso_div_2(query *q)
 		mp_int_div(&q->tmp_ival, &p2.val_bigint->ival, &q->tmp_ival, NULL);
 		SET_ACCUM();
 	} else if (is_bigint(&p1) && is_smallint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p2.val_int);
-		mp_int_mod(&p1.val_bigint->ival, &tmp, &q->tmp_ival);
+		mp_int_set_value(&q->tmp_small, p2.val_int);
+		mp_int_mod(&p1.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		mp_int_sub(&p1.val_bigint->ival, &q->tmp_ival, &q->tmp_ival);
-		mp_int_div(&q->tmp_ival, &tmp, &q->tmp_ival, NULL);
+		mp_int_div(&q->tmp_ival, &q->tmp_small, &q->tmp_ival, NULL);
 		SET_ACCUM();
-		mp_int_clear(&tmp);
 	} else if (is_bigint(&p2) && is_smallint(&p1)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
-		mp_int_mod(&tmp, &p2.val_bigint->ival, &q->tmp_ival);
-		mp_int_sub(&tmp, &q->tmp_ival, &q->tmp_ival);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
+		mp_int_mod(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival);
+		mp_int_sub(&q->tmp_small, &q->tmp_ival, &q->tmp_ival);
 		mp_int_div(&q->tmp_ival, &p2.val_bigint->ival, &q->tmp_ival, NULL);
-		mp_int_clear(&tmp);
 		SET_ACCUM();
 	} else if (is_smallint(&p1) && is_smallint(&p2)) {
 		if (p2.val_int == 0)
@@ -1717,16 +1748,12 @@ static bool fn_iso_rem_2(query *q)
 		mp_int_mod(&p1.val_bigint->ival, &p2.val_bigint->ival, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p1) && is_smallint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p2.val_int);
-		mp_int_mod(&p1.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p2.val_int);
+		mp_int_mod(&p1.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_smallint(&p1) && is_bigint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
-		mp_int_mod(&tmp, &p2.val_bigint->ival, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
+		mp_int_mod(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_variable(&p1) || is_variable(&p2)) {
 		return throw_error(q, &p1, q->st.curr_frame, "instantiation_error", "not_sufficiently_instantiated");
@@ -1895,16 +1922,12 @@ static bool fn_iso_xor_2(query *q)
 		mp_int_xor(&p1.val_bigint->ival, &p2.val_bigint->ival, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p1) && is_smallint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p2.val_int);
-		mp_int_xor(&p1.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p2.val_int);
+		mp_int_xor(&p1.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p2) && is_smallint(&p1)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
-		mp_int_xor(&p2.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
+		mp_int_xor(&p2.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_smallint(&p1) && is_smallint(&p2)) {
 		q->accum.val_int = p1.val_int ^ p2.val_int;
@@ -1932,16 +1955,12 @@ static bool fn_iso_or_2(query *q)
 		mp_int_or(&p1.val_bigint->ival, &p2.val_bigint->ival, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p1) && is_smallint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p2.val_int);
-		mp_int_or(&p1.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p2.val_int);
+		mp_int_or(&p1.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p2) && is_smallint(&p1)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
-		mp_int_or(&p2.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
+		mp_int_or(&p2.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_smallint(&p1) && is_smallint(&p2)) {
 		q->accum.val_int = p1.val_int | p2.val_int;
@@ -1969,16 +1988,12 @@ static bool fn_iso_and_2(query *q)
 		mp_int_and(&p1.val_bigint->ival, &p2.val_bigint->ival, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p1) && is_smallint(&p2)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p2.val_int);
-		mp_int_and(&p1.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p2.val_int);
+		mp_int_and(&p1.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_bigint(&p2) && is_smallint(&p1)) {
-		mpz_t tmp;
-		mp_int_init_value(&tmp, p1.val_int);
-		mp_int_and(&p2.val_bigint->ival, &tmp, &q->tmp_ival);
-		mp_int_clear(&tmp);
+		mp_int_set_value(&q->tmp_small, p1.val_int);
+		mp_int_and(&p2.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_smallint(&p1) && is_smallint(&p2)) {
 		q->accum.val_int = p1.val_int & p2.val_int;
@@ -2014,7 +2029,7 @@ static bool fn_iso_shl_2(query *q)
 			return true;
 		}
 
-		mp_int_init_value(&q->tmp_ival, p1.val_int);
+		mp_int_set_value(&q->tmp_ival, p1.val_int);
 		mp_int_mul_pow2(&q->tmp_ival, p2.val_int, &q->tmp_ival);
 		SET_ACCUM();
 	} else if (is_variable(&p1) || is_variable(&p2)) {
@@ -2530,16 +2545,12 @@ static bool fn_gcd_2(query *q)
 			mp_int_gcd(&p1.val_bigint->ival, &p2.val_bigint->ival, &q->tmp_ival);
 			SET_ACCUM();
 		} else if (is_bigint(&p1)) {
-			mpz_t tmp;
-			mp_int_init_value(&tmp, p2.val_int);
-			mp_int_gcd(&p1.val_bigint->ival, &tmp, &q->tmp_ival);
-			mp_int_clear(&tmp);
+			mp_int_set_value(&q->tmp_small, p2.val_int);
+			mp_int_gcd(&p1.val_bigint->ival, &q->tmp_small, &q->tmp_ival);
 			SET_ACCUM();
 		} else if (is_bigint(&p2)) {
-			mpz_t tmp;
-			mp_int_init_value(&tmp, p1.val_int);
-			mp_int_gcd(&tmp, &p2.val_bigint->ival, &q->tmp_ival);
-			mp_int_clear(&tmp);
+			mp_int_set_value(&q->tmp_small, p1.val_int);
+			mp_int_gcd(&q->tmp_small, &p2.val_bigint->ival, &q->tmp_ival);
 			SET_ACCUM();
 		} else {
 			q->accum.val_int = gcd(p1.val_int, p2.val_int);
@@ -2556,6 +2567,216 @@ static bool fn_gcd_2(query *q)
 	return true;
 }
 
+// Modular exponentiation by repeated squaring, without ever making
+// the full power...
+
+static bool fn_powm_3(query *q)
+{
+	CHECK_CALC();
+	GET_FIRST_ARG(p1_tmp,any);
+	GET_NEXT_ARG(p2_tmp,any);
+	GET_NEXT_ARG(p3_tmp,any);
+	CLEANUP cell p1 = eval(q, p1_tmp);
+	CLEANUP cell p2 = eval(q, p2_tmp);
+	CLEANUP cell p3 = eval(q, p3_tmp);
+
+	if (is_variable(&p1) || is_variable(&p2) || is_variable(&p3))
+		return throw_error(q, &p1, q->st.curr_frame, "instantiation_error", "not_sufficiently_instantiated");
+
+	if (!is_integer(&p1))
+		return throw_error(q, &p1, q->st.curr_frame, "type_error", "integer");
+
+	if (!is_integer(&p2))
+		return throw_error(q, &p2, q->st.curr_frame, "type_error", "integer");
+
+	if (!is_integer(&p3))
+		return throw_error(q, &p3, q->st.curr_frame, "type_error", "integer");
+
+	if (is_negative(&p2))
+		return throw_error(q, &p2, q->st.curr_frame, "evaluation_error", "undefined");
+
+	if (is_zero(&p3))
+		return throw_error(q, &p3, q->st.curr_frame, "evaluation_error", "zero_divisor");
+
+	if (is_negative(&p3))
+		return throw_error(q, &p3, q->st.curr_frame, "evaluation_error", "undefined");
+
+	mpz_t tmp1, tmp2, tmp3;
+	mp_int b = &tmp1, e = &tmp2, m = &tmp3;
+
+	if (is_bigint(&p1)) b = &p1.val_bigint->ival; else mp_int_init_value(b, p1.val_int);
+	if (is_bigint(&p2)) e = &p2.val_bigint->ival; else mp_int_init_value(e, p2.val_int);
+	if (is_bigint(&p3)) m = &p3.val_bigint->ival; else mp_int_init_value(m, p3.val_int);
+	mp_result res = mp_int_exptmod(b, e, m, &q->tmp_ival);
+	if (b == &tmp1) mp_int_clear(b);
+	if (e == &tmp2) mp_int_clear(e);
+	if (m == &tmp3) mp_int_clear(m);
+
+	if (res == MP_UNDEF)
+		return throw_error(q, &p3, q->st.curr_frame, "evaluation_error", "zero_divisor");
+
+	if (res == MP_RANGE)
+		return throw_error(q, &p2, q->st.curr_frame, "evaluation_error", "undefined");
+
+	if (res != MP_OK)
+		return throw_error(q, &p1, q->st.curr_frame, "resource_error", "memory");
+
+	SET_ACCUM();
+	return true;
+}
+
+// Arithmetic sub-terms of clause bodies are compiled when the clause
+// is xref'd: each evaluable cell whose arguments are all small
+// integers, variables or other compiled cells gets an opcode. At
+// run-time eval_flat() evaluates such a term in one pass over its
+// cells, last to first, on a small value stack and without going
+// through call_builtin(). Anything it can't do (a variable bound to
+// a non-smallint, overflow, zero divisor) makes it give up and the
+// normal path runs instead, which also raises any errors.
+
+enum {
+	EVAL_NONE=0, EVAL_NEG, EVAL_ABS, EVAL_ADD, EVAL_SUB, EVAL_MUL,
+	EVAL_DIVINT, EVAL_MOD, EVAL_REM, EVAL_MIN, EVAL_MAX, EVAL_AND,
+	EVAL_OR
+};
+
+#define MAX_EVAL_CELLS 64
+
+unsigned eval_opcode(const cell *c)
+{
+	if (!c->fn_ptr || (c->nbr_cells > MAX_EVAL_CELLS))
+		return EVAL_NONE;
+
+	const cell *p = c + 1;
+
+	for (unsigned i = 0; i < c->arity; i++, p += p->nbr_cells) {
+		if (!is_smallint(p) && !is_variable(p)
+			&& !(is_function(p) && p->eval_op))
+			return EVAL_NONE;
+	}
+
+	bool (*fn)(query*) = c->fn_ptr->fn;
+
+	if (c->arity == 1) {
+		if (fn == fn_iso_negative_1) return EVAL_NEG;
+		if (fn == fn_iso_abs_1) return EVAL_ABS;
+		return EVAL_NONE;
+	}
+
+	if (fn == fn_iso_add_2) return EVAL_ADD;
+	if (fn == fn_iso_sub_2) return EVAL_SUB;
+	if (fn == fn_iso_mul_2) return EVAL_MUL;
+	if (fn == fn_iso_divint_2) return EVAL_DIVINT;
+	if (fn == fn_iso_mod_2) return EVAL_MOD;
+	if (fn == fn_iso_rem_2) return EVAL_REM;
+	if (fn == fn_iso_min_2) return EVAL_MIN;
+	if (fn == fn_iso_max_2) return EVAL_MAX;
+	if (fn == fn_iso_and_2) return EVAL_AND;
+	if (fn == fn_iso_or_2) return EVAL_OR;
+	return EVAL_NONE;
+}
+
+bool eval_flat(query *q, cell *c, pl_idx_t c_ctx)
+{
+	pl_int_t stack[MAX_EVAL_CELLS], *sp = stack;
+
+	for (cell *p = c + c->nbr_cells - 1; p >= c; p--) {
+		if (is_smallint(p)) {
+			*sp++ = p->val_int;
+			continue;
+		}
+
+		if (is_variable(p)) {
+			cell *v = deref(q, p, c_ctx);
+
+			if (!is_smallint(v))
+				return false;
+
+			*sp++ = v->val_int;
+			continue;
+		}
+
+		pl_int_t v1 = *--sp, v2 = 0, n;
+
+		if (p->arity == 2)
+			v2 = *--sp;
+
+		switch (p->eval_op) {
+		case EVAL_NEG:
+			if (v1 == PL_INT_MIN)
+				return false;
+
+			n = -v1;
+			break;
+		case EVAL_ABS:
+			if (v1 == PL_INT_MIN)
+				return false;
+
+			n = v1 < 0 ? -v1 : v1;
+			break;
+		case EVAL_ADD:
+			if (__builtin_add_overflow(v1, v2, &n))
+				return false;
+
+			break;
+		case EVAL_SUB:
+			if (__builtin_sub_overflow(v1, v2, &n))
+				return false;
+
+			break;
+		case EVAL_MUL:
+			if (__builtin_mul_overflow(v1, v2, &n))
+				return false;
+
+			break;
+		case EVAL_DIVINT:
+			if (!v2 || ((v1 == PL_INT_MIN) && (v2 == -1)))
+				return false;
+
+			n = v1 / v2;
+			break;
+		case EVAL_MOD:
+			if (!v2 || (v2 == -1))
+				return false;
+
+			n = smallint_mod(v1, v2);
+			break;
+		case EVAL_REM:
+			if (!v2 || (v2 == -1))
+				return false;
+
+			n = v1 % v2;
+			break;
+		case EVAL_MIN:
+			n = v1 <= v2 ? v1 : v2;
+			break;
+		case EVAL_MAX:
+			n = v1 >= v2 ? v1 : v2;
+			break;
+		case EVAL_AND:
+			n = v1 & v2;
+			break;
+		case EVAL_OR:
+			n = v1 | v2;
+			break;
+		default:
+			return false;
+		}
+
+		// -2^63 is always a bigint, the normal path makes one...
+
+		if (n == PL_INT_MIN)
+			return false;
+
+		*sp++ = n;
+	}
+
+	q->accum.tag = TAG_INTEGER;
+	q->accum.flags = 0;
+	q->accum.val_int = stack[0];
+	return true;
+}
+
 builtins g_functions_bifs[] =
 {
 	// Predicate...
@@ -2648,6 +2869,7 @@ builtins g_functions_bifs[] =
 	{"random_float", 0, fn_random_float_0, NULL, true, BLAH},
 	{"rand", 0, fn_rand_0, NULL, true, BLAH},
 	{"gcd", 2, fn_gcd_2, "?integer,?integer", true, BLAH},
+	{"powm", 3, fn_powm_3, "+integer,+integer,+integer", true, BLAH},
 
 	{"$set_prob", 1, fn_sys_set_prob_1, "+real", false, BLAH},
 	{"$get_prob", 1, fn_sys_get_prob_1, "-real", false, BLAH},
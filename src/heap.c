@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "heap.h"
+#include "prolog.h"
 #include "query.h"
 
 static int accum_slot(const query *q, pl_idx_t slot_nbr, unsigned var_nbr)
@@ -122,10 +123,10 @@ cell *alloc_on_heap(query *q, pl_idx_t nbr_cells)
 	return c;
 }
 
-bool is_in_ref_list(cell *c, pl_idx_t c_ctx, reflist *rlist)
+static bool is_in_ref_list2(cell *c, pl_idx_t c_ctx, reflist *rlist)
 {
 	while (rlist) {
-		if ((c->var_nbr == rlist->var_nbr)
+		if ((c == rlist->ptr)
 			&& (c_ctx == rlist->ctx))
 			return true;
 
@@ -135,17 +136,38 @@ bool is_in_ref_list(cell *c, pl_idx_t c_ctx, reflist *rlist)
 	return false;
 }
 
-static bool is_in_ref_list2(cell *c, pl_idx_t c_ctx, reflist *rlist)
+// A compound flagged as ground has no vars to rename or cycles to
+// look for, so is copied as is...
+
+static cell *copy_ground_to_tmp(query *q, const cell *p1)
 {
-	while (rlist) {
-		if ((c == rlist->ptr)
-			&& (c_ctx == rlist->ctx))
-			return true;
+	cell *tmp = alloc_on_tmp(q, p1->nbr_cells);
+	if (!tmp) return NULL;
+	copy_cells(tmp, p1, p1->nbr_cells);
+	return tmp;
+}
 
-		rlist = rlist->next;
-	}
+// Flag the compounds in a new copy that have no vars, as is done for
+// clauses, so that copying them again later is cheap...
 
-	return false;
+static void mark_ground(cell *c)
+{
+	pl_idx_t next_var = c->nbr_cells;
+
+	for (pl_idx_t i = c->nbr_cells; i > 0; i--) {
+		cell *tmp = c + i - 1;
+
+		if (is_variable(tmp))
+			next_var = i - 1;
+
+		if (!is_interned(tmp) || !tmp->arity)
+			continue;
+
+		if (next_var >= (i - 1 + tmp->nbr_cells))
+			tmp->flags |= FLAG_INTERNED_GROUND;
+		else
+			tmp->flags &= ~FLAG_INTERNED_GROUND;
+	}
 }
 
 // FIXME: rewrite this using efficient sweep/mark methodology...
@@ -163,6 +185,9 @@ static cell *deep_copy2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, bool copy_at
 	p1 = deref(q, p1, p1_ctx);
 	p1_ctx = q->latest_ctx;
 
+	if (is_ground_term(p1))
+		return copy_ground_to_tmp(q, p1);
+
 	cell *tmp = alloc_on_tmp(q, 1);
 	if (!tmp) return NULL;
 	copy_cells(tmp, p1, 1);
@@ -210,7 +235,7 @@ static cell *deep_copy2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, bool copy_at
 	if (is_iso_list(p1)) {
 		LIST_HANDLER(p1);
 
-		while (is_iso_list(p1)) {
+		while (is_iso_list(p1) && !is_ground_term(p1)) {
 			if (g_tpl_interrupt) {
 				if (check_interrupt(q))
 					break;
@@ -261,7 +286,7 @@ static cell *deep_copy2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, bool copy_at
 				break;
 			}
 
-			if (is_iso_list(p1)) {
+			if (is_iso_list(p1) && !is_ground_term(p1)) {
 				cell *tmp = alloc_on_tmp(q, 1);
 				if (!tmp) return NULL;
 				copy_cells(tmp, p1, 1);
@@ -328,6 +353,7 @@ cell *deep_raw_copy_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx)
 	map_destroy(q->vars);
 	q->vars = NULL;
 	if (!rec) return rec;
+	mark_ground(q->tmp_heap);
 	return q->tmp_heap;
 }
 
@@ -376,6 +402,7 @@ static cell *deep_copy_to_tmp_with_replacement(query *q, cell *p1, pl_idx_t p1_c
 	cell *rec = deep_copy2_to_tmp(q, c, c_ctx, copy_attrs, from, from_ctx, to, to_ctx, 0, !q->lists_ok ? &nlist : NULL);
 	q->lists_ok = false;
 	if (!rec) return rec;
+	mark_ground(get_tmp_heap_start(q));
 	int cnt = q->varno - f->nbr_vars;
 
 #if 0
@@ -471,6 +498,10 @@ cell *deep_clone2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, unsigned depth, re
 	pl_idx_t save_p1_ctx = p1_ctx;
 	p1 = deref(q, p1, p1_ctx);
 	p1_ctx = q->latest_ctx;
+
+	if (is_ground_term(p1))
+		return copy_ground_to_tmp(q, p1);
+
 	cell *tmp = alloc_on_tmp(q, 1);
 	if (!tmp) return NULL;
 	copy_cells(tmp, p1, 1);
@@ -488,7 +519,7 @@ cell *deep_clone2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, unsigned depth, re
 	if (is_iso_list(p1)) {
 		LIST_HANDLER(p1);
 
-		while (is_iso_list(p1)) {
+		while (is_iso_list(p1) && !is_ground_term(p1)) {
 			if (g_tpl_interrupt) {
 				if (check_interrupt(q))
 					break;
@@ -529,7 +560,7 @@ cell *deep_clone2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, unsigned depth, re
 				break;
 			}
 
-			if (is_iso_list(p1)) {
+			if (is_iso_list(p1) && !is_ground_term(p1)) {
 				cell *tmp = alloc_on_tmp(q, 1);
 				if (!tmp) return NULL;
 				copy_cells(tmp, p1, 1);
@@ -584,6 +615,7 @@ cell *deep_clone_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx)
 
 	cell *rec = deep_clone2_to_tmp(q, p1, p1_ctx, 0, &nlist);
 	if (!rec) return rec;
+	mark_ground(q->tmp_heap);
 	return q->tmp_heap;
 }
 
@@ -600,7 +632,7 @@ cell *deep_clone_to_heap(query *q, cell *p1, pl_idx_t p1_ctx)
 	return tmp;
 }
 
-cell *append_to_tmp(query *q, cell *p1)
+cell *append_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx)
 {
 	cell *tmp = alloc_on_tmp(q, p1->nbr_cells);
 	if (!tmp) return NULL;
@@ -613,22 +645,79 @@ cell *append_to_tmp(query *q, cell *p1)
 			continue;
 
 		dst->flags |= FLAG_REF;
-		dst->var_ctx = q->st.curr_frame;
+		dst->var_ctx = p1_ctx;
+	}
+
+	return tmp;
+}
+
+cell *clone_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx)
+{
+	return append_to_tmp(q, p1, p1_ctx);
+}
+
+bool is_control(const cell *c)
+{
+	if (!is_interned(c))
+		return false;
+
+	if (c->arity == 2)
+		return (c->val_off == g_conjunction_s)
+			|| (c->val_off == g_disjunction_s)
+			|| (c->val_off == g_if_then_s)
+			|| (c->val_off == g_soft_cut_s);
+
+	return (c->arity == 1) && (c->val_off == g_negation_s);
+}
+
+static cell *clone_goal2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, unsigned depth)
+{
+	if (depth >= MAX_DEPTH) {
+		q->cycle_error = true;
+		return NULL;
 	}
 
+	p1 = deref(q, p1, p1_ctx);
+	p1_ctx = q->latest_ctx;
+
+	if (!is_control(p1))
+		return append_to_tmp(q, p1, p1_ctx);
+
+	pl_idx_t save_idx = tmp_heap_used(q);
+	cell *tmp = alloc_on_tmp(q, 1);
+	if (!tmp) return NULL;
+	copy_cells(tmp, p1, 1);
+	unsigned arity = p1->arity;
+	p1++;
+
+	while (arity--) {
+		if (!clone_goal2_to_tmp(q, p1, p1_ctx, depth+1))
+			return NULL;
+
+		p1 += p1->nbr_cells;
+	}
+
+	tmp = get_tmp_heap(q, save_idx);
+	tmp->nbr_cells = tmp_heap_used(q) - save_idx;
 	return tmp;
 }
 
-cell *clone_to_tmp(query *q, cell *p1)
+// Meta-calls need the control constructs of a goal copied out so as
+// to run them, but the goals in it are cloned as they are: their args
+// keep any var bound to a term rather than a copy of that term. This
+// is cheaper, and means that a term changed by setarg/3 in the call
+// is the caller's term...
+
+cell *clone_goal_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx)
 {
-	return append_to_tmp(q, p1);
+	q->cycle_error = false;
+	return clone_goal2_to_tmp(q, p1, p1_ctx, 0);
 }
 
-cell *clone_to_heap(query *q, bool prefix, cell *p1, pl_idx_t suffix)
+cell *clone_to_heap(query *q, bool prefix, cell *p1, pl_idx_t p1_ctx, pl_idx_t suffix)
 {
 	cell *tmp = alloc_on_heap(q, (prefix?1:0)+p1->nbr_cells+suffix);
 	if (!tmp) return NULL;
-	frame *f = GET_CURR_FRAME();
 
 	if (prefix) {
 		// Needed for follow() to work
@@ -648,7 +737,7 @@ cell *clone_to_heap(query *q, bool prefix, cell *p1, pl_idx_t suffix)
 			continue;
 
 		dst->flags |= FLAG_REF;
-		dst->var_ctx = q->st.curr_frame;
+		dst->var_ctx = p1_ctx;
 	}
 
 	return tmp;
@@ -781,6 +870,7 @@ cell *end_list_unsafe(query *q)
 	copy_cells(tmp, get_tmp_heap(q, 0), nbr_cells);
 	tmp->nbr_cells = nbr_cells;
 	fix_list(tmp);
+	mark_ground(tmp);
 	return tmp;
 }
 
@@ -4,9 +4,11 @@
 
 size_t alloc_grow(void **addr, size_t elem_size, size_t min_elements, size_t max_elements);
 
-cell *append_to_tmp(query *q, cell *p1);
-cell *clone_to_tmp(query *q, cell *p1);
-cell *clone_to_heap(query *q, bool prefix, cell *p1, pl_idx_t suffix);
+cell *append_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx);
+cell *clone_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx);
+cell *clone_to_heap(query *q, bool prefix, cell *p1, pl_idx_t p1_ctx, pl_idx_t suffix);
+cell *clone_goal_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx);
+bool is_control(const cell *c);
 
 cell *deep_clone_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx);
 cell *deep_clone2_to_tmp(query *q, cell *p1, pl_idx_t p1_ctx, unsigned depth, reflist *list);
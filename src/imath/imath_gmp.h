@@ -0,0 +1,264 @@
+#ifndef IMATH_GMP_H_
+#define IMATH_GMP_H_
+
+// The subset of the imath interface used by the interpreter, done
+// with GMP. Build with 'make GMP=1' to use it in place of imath, for
+// GMP's sub-quadratic multiply and divide and its faster powm.
+//
+// Results follow imath where it differs from GMP: division truncates,
+// mod of two bigints is pinned to be non-negative, and the bitwise operations work on
+// magnitudes of the same sign...
+
+#include <gmp.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Where imath has a struct type GMP has a one-element array, so the
+// name is taken over for the struct and '&x' is then an mpz_ptr...
+
+#define mpz_t __mpz_struct
+
+typedef __mpz_struct *mp_int;
+typedef int mp_result;
+typedef long mp_small;
+typedef unsigned long mp_usmall;
+typedef unsigned int mp_size;
+
+#define MP_OK		0
+#define MP_FALSE	0
+#define MP_TRUE		-1
+#define MP_MEMORY	-2
+#define MP_RANGE	-3
+#define MP_UNDEF	-4
+#define MP_TRUNC	-5
+#define MP_BADARG	-6
+
+#define MP_SMALL_MIN   LONG_MIN
+#define MP_SMALL_MAX   LONG_MAX
+#define MP_USMALL_MAX  ULONG_MAX
+
+static inline int mp_cmp_(int c) { return c < 0 ? -1 : c > 0 ? 1 : 0; }
+
+static inline mp_result mp_int_init(mp_int z) { mpz_init(z); return MP_OK; }
+static inline mp_result mp_int_init_value(mp_int z, mp_small v) { mpz_init_set_si(z, v); return MP_OK; }
+static inline mp_result mp_int_init_copy(mp_int z, mp_int old) { mpz_init_set(z, old); return MP_OK; }
+static inline void mp_int_clear(mp_int z) { mpz_clear(z); }
+static inline mp_result mp_int_copy(mp_int a, mp_int c) { mpz_set(c, a); return MP_OK; }
+static inline mp_result mp_int_set_value(mp_int z, mp_small v) { mpz_set_si(z, v); return MP_OK; }
+
+static inline mp_result mp_int_abs(mp_int a, mp_int c) { mpz_abs(c, a); return MP_OK; }
+static inline mp_result mp_int_neg(mp_int a, mp_int c) { mpz_neg(c, a); return MP_OK; }
+
+static inline mp_result mp_int_add(mp_int a, mp_int b, mp_int c) { mpz_add(c, a, b); return MP_OK; }
+static inline mp_result mp_int_sub(mp_int a, mp_int b, mp_int c) { mpz_sub(c, a, b); return MP_OK; }
+static inline mp_result mp_int_mul(mp_int a, mp_int b, mp_int c) { mpz_mul(c, a, b); return MP_OK; }
+
+static inline mp_result mp_int_add_value(mp_int a, mp_small v, mp_int c)
+{
+	if (v >= 0) mpz_add_ui(c, a, (unsigned long)v);
+	else mpz_sub_ui(c, a, -(unsigned long)v);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_sub_value(mp_int a, mp_small v, mp_int c)
+{
+	if (v >= 0) mpz_sub_ui(c, a, (unsigned long)v);
+	else mpz_add_ui(c, a, -(unsigned long)v);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_mul_value(mp_int a, mp_small v, mp_int c) { mpz_mul_si(c, a, v); return MP_OK; }
+static inline mp_result mp_int_mul_pow2(mp_int a, mp_small p2, mp_int c) { mpz_mul_2exp(c, a, p2); return MP_OK; }
+
+static inline mp_result mp_int_div(mp_int a, mp_int b, mp_int q, mp_int r)
+{
+	if (!mpz_sgn(b)) return MP_UNDEF;
+	if (q && r) mpz_tdiv_qr(q, r, a, b);
+	else if (q) mpz_tdiv_q(q, a, b);
+	else mpz_tdiv_r(r, a, b);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_div_value(mp_int a, mp_small v, mp_int q, mp_small *r)
+{
+	if (r) *r = 0;
+	if (!v) return MP_UNDEF;
+	mpz_t tmp;
+	mpz_init_set_si(&tmp, v);
+	mpz_t rem;
+	mpz_init(&rem);
+	mpz_tdiv_qr(q ? q : &tmp, &rem, a, &tmp);
+	if (r) *r = mpz_get_si(&rem);
+	mpz_clear(&rem);
+	mpz_clear(&tmp);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_div_pow2(mp_int a, mp_small p2, mp_int q, mp_int r)
+{
+	if (q) mpz_tdiv_q_2exp(q, a, p2);
+	if (r) mpz_tdiv_r_2exp(r, a, p2);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_mod(mp_int a, mp_int m, mp_int c)
+{
+	if (!mpz_sgn(m)) return MP_UNDEF;
+	mpz_t tmp;
+	mpz_init(&tmp);
+	mpz_tdiv_r(&tmp, a, m);
+	if (mpz_sgn(&tmp) < 0) mpz_add(c, &tmp, m);
+	else mpz_set(c, &tmp);
+	mpz_clear(&tmp);
+	return MP_OK;
+}
+
+// Like imath this is the remainder of a truncating divide, whatever
+// its documentation says...
+
+static inline mp_result mp_int_mod_value(mp_int a, mp_small v, mp_small *r)
+{
+	return mp_int_div_value(a, v, NULL, r);
+}
+
+static inline mp_result mp_int_expt(mp_int a, mp_small b, mp_int c)
+{
+	if (b < 0) return MP_RANGE;
+	mpz_pow_ui(c, a, b);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_expt_value(mp_small a, mp_small b, mp_int c)
+{
+	if (b < 0) return MP_RANGE;
+	mpz_set_si(c, a);
+	mpz_pow_ui(c, c, b);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_expt_full(mp_int a, mp_int b, mp_int c)
+{
+	if (mpz_sgn(b) < 0) return MP_RANGE;
+
+	if (mpz_fits_ulong_p(b)) {
+		mpz_pow_ui(c, a, mpz_get_ui(b));
+		return MP_OK;
+	}
+
+	if (mpz_cmpabs_ui(a, 1) > 0)
+		return MP_MEMORY;
+
+	if ((mpz_sgn(a) < 0) && mpz_even_p(b)) mpz_set_ui(c, 1);
+	else mpz_set(c, a);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_exptmod(mp_int a, mp_int b, mp_int m, mp_int c)
+{
+	if (mpz_sgn(b) < 0) return MP_RANGE;
+	if (!mpz_sgn(m)) return MP_UNDEF;
+	mpz_powm(c, a, b, m);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_gcd(mp_int a, mp_int b, mp_int c)
+{
+	if (!mpz_sgn(a) && !mpz_sgn(b)) return MP_UNDEF;
+	mpz_gcd(c, a, b);
+	return MP_OK;
+}
+
+static inline int mp_int_compare(mp_int a, mp_int b) { return mp_cmp_(mpz_cmp(a, b)); }
+static inline int mp_int_compare_zero(mp_int z) { return mpz_sgn(z); }
+static inline int mp_int_compare_value(mp_int z, mp_small v) { return mp_cmp_(mpz_cmp_si(z, v)); }
+
+static inline mp_result mp_int_to_int(mp_int z, mp_small *out)
+{
+	if (!mpz_fits_slong_p(z)) return MP_RANGE;
+	if (out) *out = mpz_get_si(z);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_to_double(mp_int z, double *out)
+{
+	if (out) *out = mpz_get_d(z);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_set_double(mp_int a, double b)
+{
+	if (!isfinite(b)) return MP_RANGE;
+	mpz_set_d(a, b);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_string_len(mp_int z, mp_size radix)
+{
+	return mpz_sizeinbase(z, radix) + 1 + (mpz_sgn(z) < 0);
+}
+
+static inline mp_result mp_int_to_string(mp_int z, mp_size radix, char *str, int limit)
+{
+	if (limit < mp_int_string_len(z, radix)) return MP_TRUNC;
+	mpz_get_str(str, radix, z);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_read_cstring(mp_int z, mp_size radix, const char *str, char **end)
+{
+	while ((*str == ' ') || (*str == '\t')) str++;
+	if (*str == '+') str++;
+	size_t len = strlen(str);
+	if (end) *end = (char*)str + len;
+	return mpz_set_str(z, str, radix) ? MP_TRUNC : MP_OK;
+}
+
+// The bitwise operations...
+
+static inline mp_result mp_int_bitop_(mp_int a, mp_int b, mp_int c, int op)
+{
+	if ((mpz_sgn(a) < 0) != (mpz_sgn(b) < 0)) return MP_BADARG;
+	bool neg = mpz_sgn(a) < 0;
+	mpz_t ua, ub;
+	mpz_init(&ua);
+	mpz_init(&ub);
+	mpz_abs(&ua, a);
+	mpz_abs(&ub, b);
+	if (op == '|') mpz_ior(c, &ua, &ub);
+	else if (op == '^') mpz_xor(c, &ua, &ub);
+	else mpz_and(c, &ua, &ub);
+	if (neg) mpz_neg(c, c);
+	mpz_clear(&ua);
+	mpz_clear(&ub);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_or(mp_int a, mp_int b, mp_int c) { return mp_int_bitop_(a, b, c, '|'); }
+static inline mp_result mp_int_xor(mp_int a, mp_int b, mp_int c) { return mp_int_bitop_(a, b, c, '^'); }
+static inline mp_result mp_int_and(mp_int a, mp_int b, mp_int c) { return mp_int_bitop_(a, b, c, '&'); }
+
+static inline mp_result mp_int_popcount(mp_int z, mp_usmall *out)
+{
+	if (mpz_sgn(z) < 0) return MP_UNDEF;
+	if (out) *out = mpz_popcount(z);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_lsb(mp_int z, mp_usmall *out)
+{
+	if (mpz_sgn(z) < 1) return MP_UNDEF;
+	if (out) *out = mpz_scan1(z, 0);
+	return MP_OK;
+}
+
+static inline mp_result mp_int_msb(mp_int z, mp_usmall *out)
+{
+	if (mpz_sgn(z) < 1) return MP_UNDEF;
+	if (out) *out = mpz_sizeinbase(z, 2) - 1;
+	return MP_OK;
+}
+
+#endif
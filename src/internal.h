@@ -41,7 +41,11 @@ typedef uint32_t pl_idx_t;
 #include "map.h"
 #include "trealla.h"
 #include "cdebug.h"
+#if USE_GMP
+#include "imath/imath_gmp.h"
+#else
 #include "imath/imath.h"
+#endif
 
 #if defined(_WIN32) || defined(__wasi__)
 char *realpath(const char *path, char resolved_path[PATH_MAX]);
@@ -60,13 +64,21 @@ extern unsigned g_string_cnt, g_interned_cnt;
 #define MAX_VAR_POOL_SIZE 4000
 #define MAX_ARITY UCHAR_MAX
 #define MAX_QUEUES 16
-#define MAX_STREAMS 1024
+#define INITIAL_NBR_STREAMS 64
 #define MAX_MODULES 1024
 //#define MAX_DEPTH 9999
 #define MAX_DEPTH 6000			// Clang stack size needs this small
 #define MAX_IGNORES 64000
+#define MAX_BIF_HASH 4096		// power of 2, well above the builtins count
+#define MAX_PRED_CACHE 256		// power of 2
+#define MAX_FMT_CACHE 64		// power of 2
+#define MAX_FORMAT_LEN 4096
 
-#define STREAM_BUFLEN 1024
+#define STREAM_BUFLEN (16*1024)			// max TLS record
+#define MAX_HTTP_BODY (256ULL*1024*1024)	// max chunked body
+#define MAX_HTTP_LINE (8*1024)				// max request/header line
+#define MAX_HTTP_HEADERS 100
+#define MAX_HTTP_WAIT (10*1000)				// msecs for the rest of a message
 
 #define MAX_OF(a,b) (a) > (b) ? (a) : (b)
 #define MIN_OF(a,b) (a) < (b) ? (a) : (b)
@@ -96,6 +108,8 @@ extern unsigned g_string_cnt, g_interned_cnt;
 #define is_float(c) ((c)->tag == TAG_FLOAT)
 #define is_indirect(c) ((c)->tag == TAG_PTR)
 #define is_blob(c) ((c)->tag == TAG_BLOB)
+#define is_dict(c) (is_blob(c) && ((c)->flags & FLAG_BLOB_DICT))
+#define is_array(c) (is_blob(c) && ((c)->flags & FLAG_BLOB_ARRAY))
 #define is_end(c) ((c)->tag == TAG_END)
 
 // Derived type...
@@ -112,7 +126,7 @@ extern unsigned g_string_cnt, g_interned_cnt;
 #define get_int(c) (c)->val_int
 #define get_ptr(c) (c)->val_ptr
 
-#define neg_bigint(c) (c)->val_bigint->ival.sign = MP_NEG;
+#define neg_bigint(c) { mp_int_abs(&(c)->val_bigint->ival, &(c)->val_bigint->ival); mp_int_neg(&(c)->val_bigint->ival, &(c)->val_bigint->ival); }
 #define neg_smallint(c) (c)->val_int = -llabs((c)->val_int)
 #define neg_float(c) (c)->val_float = -fabs((c)->val_float)
 
@@ -122,7 +136,7 @@ extern unsigned g_string_cnt, g_interned_cnt;
 	is_float(c) ? get_float(c) == 0.0 : false)
 
 #define is_negative(c) (is_bigint(c) ?						\
-	(c)->val_bigint->ival.sign == MP_NEG :					\
+	mp_int_compare_zero(&(c)->val_bigint->ival) < 0 :		\
 	is_integer(c) ? get_smallint(c) < 0 :					\
 	is_float(c) ? get_float(c) < 0.0 : false)
 
@@ -154,9 +168,11 @@ extern unsigned g_string_cnt, g_interned_cnt;
 #define is_anon(c) ((c)->flags & FLAG_VAR_ANON)
 #define is_builtin(c) ((c)->flags & FLAG_BUILTIN)
 #define is_function(c) ((c)->flags & FLAG_FUNCTION)
-#define is_tail_recursive(c) ((c)->flags & FLAG_TAIL_REC)
+#define is_last_call(c) ((c)->flags & FLAG_LAST_CALL)
 #define is_temporary(c) ((c)->flags & FLAG_VAR_TEMPORARY)
+#define is_first_var(c) ((c)->flags & FLAG_VAR_FIRST)
 #define is_ref(c) ((c)->flags & FLAG_REF)
+#define is_ground_term(c) (is_interned(c) && ((c)->flags & FLAG_INTERNED_GROUND))
 #define is_op(c) (c->flags & 0xE000)
 #define is_callable(c) (is_interned(c) || is_cstring(c))
 #define is_structure(c) (is_interned(c) && (c)->arity)
@@ -165,12 +181,21 @@ extern unsigned g_string_cnt, g_interned_cnt;
 #define is_atomic(c) (is_atom(c) || is_number(c))
 #define is_nonvar(c) !is_variable(c)
 
+// The text follows inline in *cstr* and is always NUL terminated. A
+// long text gets an *idx* of char positions the first time one is
+// needed. There may be room for *size* bytes, so that a concatenation
+// can append to it in place.
+
 typedef struct {
 	int64_t refcnt;
-	size_t len;
+	size_t len, size;
+	struct utf8_index_ *idx;
 	char cstr[];
 } strbuf;
 
+size_t strb_len_utf8(strbuf *strb, size_t off, size_t n);
+size_t strb_offset_at_pos(strbuf *strb, size_t off, size_t n, size_t i);
+
 typedef struct {
 	int64_t refcnt;
 	mpz_t ival;
@@ -179,6 +204,7 @@ typedef struct {
 typedef struct {
 	int64_t refcnt;
 	char *ptr;
+	void (*free_fn)(void *ptr);		// if set, releases ptr
 } blob;
 
 #define SET_STR(c,s,n,off) {									\
@@ -186,7 +212,8 @@ typedef struct {
 	check_error(strb);										\
 	memcpy(strb->cstr, s, n); 									\
 	strb->cstr[n] = 0;											\
-	strb->len = n;												\
+	strb->len = strb->size = n;									\
+	strb->idx = NULL;											\
 	strb->refcnt = 1;											\
 	g_string_cnt++;												\
 	(c)->val_strb = strb;										\
@@ -211,7 +238,15 @@ typedef struct {
 
 #define C_STR(x,c) _C_STR((x)->pl, c)
 #define C_STRLEN(x,c) _C_STRLEN((x)->pl, c)
-#define C_STRLEN_UTF8(c) substrlen_utf8(C_STR(q, c), C_STRLEN(q, c))
+#define C_STRLEN_UTF8(c) 										\
+	( is_strbuf(c) ? strb_len_utf8((c)->val_strb, (c)->strb_off, (c)->strb_len)	\
+	: substrlen_utf8(C_STR(q, c), C_STRLEN(q, c))				\
+	)
+
+#define C_OFFSET_AT_POS(c,i) 									\
+	( is_strbuf(c) ? strb_offset_at_pos((c)->val_strb, (c)->strb_off, (c)->strb_len, i)	\
+	: offset_at_pos(C_STR(q, c), C_STRLEN(q, c), i)			\
+	)
 
 #define GET_POOL(x,off) ((x)->pl->pool + (off))
 
@@ -253,17 +288,23 @@ enum {
 	FLAG_VAR_ANON=1<<0,					// used with TAG_VAR
 	FLAG_VAR_FRESH=1<<1,				// used with TAG_VAR
 	FLAG_VAR_TEMPORARY=1<<2,			// used with TAG_VAR
+	FLAG_VAR_FIRST=1<<3,				// used with TAG_VAR
 
 	FLAG_HANDLE_DLL=1<<0,				// used with TAG_INT_HANDLE
 	FLAG_HANDLE_FUNC=1<<1,				// used with TAG_INT_HANDLE
 
+	FLAG_BLOB_DICT=1<<0,				// used with TAG_BLOB
+	FLAG_BLOB_ARRAY=1<<1,				// used with TAG_BLOB
+
+	FLAG_INTERNED_GROUND=1<<3,			// used with TAG_INTERNED
+
 	FLAG_PROCESSED=1<<5,				// used by bagof
 	FLAG_FFI=1<<6,
 	FLAG_REF=1<<7,
 	FLAG_BUILTIN=1<<8,
 	FLAG_STATIC=1<<9,
 	FLAG_MANAGED=1<<10,					// any ref-counted object
-	FLAG_TAIL_REC=1<<11,
+	FLAG_LAST_CALL=1<<11,
 	FLAG_FUNCTION=1<<12,
 
 	FLAG_END=1<<13
@@ -312,10 +353,11 @@ typedef struct parser_ parser;
 typedef struct page_ page;
 typedef struct stream_ stream;
 typedef struct slot_ slot;
+typedef struct walk_ walk;
+typedef struct walk_mark_ walk_mark;
 typedef struct choice_ choice;
 typedef struct prolog_state_ prolog_state;
 typedef struct prolog_flags_ prolog_flags;
-typedef struct cycle_info_ cycle_info;
 typedef struct reflist_ reflist;
 typedef struct builtins_ builtins;
 
@@ -387,7 +429,10 @@ struct cell_ {
 				cell *tmp_attrs;		// used with TAG_VAR in copy_term
 			};
 
-			uint32_t var_nbr;			// used with TAG_VAR
+			union {
+				uint32_t var_nbr;		// used with TAG_VAR
+				uint32_t eval_op;		// used with FLAG_FUNCTION
+			};
 
 			union {
 				uint32_t val_off;		// used with TAG_VAR & TAG_INTERNED
@@ -449,8 +494,9 @@ struct predicate_ {
 	module *m;
 	map *idx, *idx2;
 	db_entry *dirty_list;
-	cell key;
+	cell key, alias;
 	uint64_t cnt, ref_cnt, db_id;
+	uint64_t tco_calls, tco_done, tco_choice, tco_frame;
 	bool is_prebuilt:1;
 	bool is_public:1;
 	bool is_static:1;
@@ -488,11 +534,21 @@ typedef struct {
 
 // Where *ctx* is the context of the var
 // And *var_nbr* is the slot within that context
+// An entry whose var_ctx is TRAIL_SETARG undoes a setarg/3 and the
+// entry below it holds the saved cell...
+
+#define TRAIL_SETARG ((pl_idx_t)~0)
 
 struct trail_ {
-	cell *attrs;
-	pl_idx_t var_ctx, attrs_ctx;
-	uint32_t var_nbr;
+	union {
+		struct {
+			cell *attrs;
+			pl_idx_t var_ctx, attrs_ctx;
+			uint32_t var_nbr;
+		};
+
+		cell save;
+	};
 };
 
 // It would be nice to find space in a cell to put *mgen* & *mark*
@@ -501,7 +557,24 @@ struct trail_ {
 struct slot_ {
 	cell c;
 	uint32_t mgen;
-	bool mark:1;
+	bool mark:1;						// used by is_cyclic_term
+	bool mark1:1, mark2:1;				// used by unify & compare
+};
+
+// Terms are walked with an explicit stack rather than recursion...
+// Where *p1* & *p2* are the next args to visit
+// Where *marks* is the mark stack height on entry
+// Where *arg_marks* is the height before the current arg's marks
+
+struct walk_ {
+	cell *p1, *p2;
+	pl_idx_t p1_ctx, p2_ctx;
+	unsigned nbr_args, marks, arg_marks;
+};
+
+struct walk_mark_ {
+	slot *e;
+	unsigned which;
 };
 
 // Where *nbr_slots* is the initial number allocated
@@ -517,6 +590,7 @@ struct frame_ {
 	uint16_t mid;
 	bool is_last:1;
 	bool is_active:1;
+	bool is_captured:1;
 };
 
 struct prolog_state_ {
@@ -565,9 +639,10 @@ struct stream_ {
 	char *mode, *filename, *name, *data, *src;
 	void *sslptr;
 	parser *p;
-	char srcbuf[STREAM_BUFLEN];
-	size_t data_len, alloc_nbytes;
-	int ungetch, srclen;
+	char *srcbuf;						// allocated on first use
+	char *wbuf;							// socket write buffer
+	size_t data_len, alloc_nbytes, wbuf_len;
+	int ungetch, srclen, fd;
 	uint8_t level, eof_action;
 	bool ignore:1;
 	bool at_end_of_file:1;
@@ -581,6 +656,8 @@ struct stream_ {
 	bool udp:1;
 	bool ssl:1;
 	bool domain:1;
+	bool netbuf:1;
+	bool corked:1;
 };
 
 struct page_ {
@@ -617,13 +694,14 @@ struct query_ {
 	trail *trails;
 	cell *tmp_heap, *last_arg, *variable_names, *key, *ball;
 	cell *queue[MAX_QUEUES];
-	page *pages;
+	page *pages, *nb_pages;
 	slot *save_e;
 	db_entry *dirty_list;
-	cycle_info *info1, *info2;
+	walk *walks;
+	walk_mark *walk_marks;
 	map *vars;
 	cell accum;
-	mpz_t tmp_ival;
+	mpz_t tmp_ival, tmp_small;
 	prolog_state st;
 	bool ignores[MAX_IGNORES];
 	uint64_t tot_goals, tot_backtracks, tot_retries, tot_matches;
@@ -640,6 +718,7 @@ struct query_ {
 	pl_idx_t cp, before_hook_tp;
 	pl_idx_t h_size, tmph_size, tot_heaps, tot_heapsize, undo_lo_tp, undo_hi_tp;
 	pl_idx_t q_size[MAX_QUEUES], tmpq_size[MAX_QUEUES], qp[MAX_QUEUES];
+	unsigned walks_size, walks_top, walk_marks_size, walk_marks_top;
 	uint32_t mgen;
 	uint8_t nv_mask[MAX_ARITY];
 	prolog_flags flags;
@@ -659,7 +738,6 @@ struct query_ {
 	bool is_dump_vars:1;
 	bool status:1;
 	bool resume:1;
-	bool no_tco:1;
 	bool check_unique:1;
 	bool has_vars:1;
 	bool error:1;
@@ -676,6 +754,7 @@ struct query_ {
 	bool halt:1;
 	bool abort:1;
 	bool cycle_error:1;
+	bool head_shared:1;
 	bool spawned:1;
 	bool run_init:1;
 	bool varnames:1;
@@ -733,8 +812,20 @@ struct parser_ {
 
 typedef struct loaded_file_ loaded_file;
 
+// A direct-mapped cache of predicate searches, keyed by name and
+// arity. An entry is good while the predicate isn't abolished and no
+// predicate has since been created anywhere, nor a module used...
+
+typedef struct {
+	predicate *pr;
+	uint64_t gen;
+	pl_idx_t val_off;
+	unsigned arity, idx_used;
+} pred_cache;
+
 struct module_ {
 	module *used[MAX_MODULES];
+	pred_cache pcache[MAX_PRED_CACHE];
 	module *next, *orig;
 	prolog *pl;
 	query *tasks;
@@ -763,19 +854,28 @@ typedef struct {
 	bool is_anon;
 } var_item;
 
+// The stream table grows on demand. Each stream is allocated
+// separately so a stream pointer stays valid when the table is
+// resized. Closed slots are recycled via the free list.
+
 struct prolog_ {
-	stream streams[MAX_STREAMS];
+	stream **streams;
+	int *free_streams;
 	module *modmap[MAX_MODULES];
 	module *modules, *system_m, *user_m, *curr_m, *dcgs;
 	var_item *tabs;
 	parser *p;
 	map *symtab, *biftab, *keyval;
+	const builtins *bif_hash[MAX_BIF_HASH];
+	struct format_prog_ *fmt_cache[MAX_FMT_CACHE];
 	char *pool;
 	struct { pl_idx_t tab1[MAX_IGNORES], tab2[MAX_IGNORES]; };
 	size_t pool_offset, pool_size, tabs_size;
-	uint64_t s_last, s_cnt, seed, ugen;
+	uint64_t s_last, s_cnt, seed, ugen, pred_gen;
+	uint64_t op_names[64];
 	unsigned next_mod_id;
-	uint8_t current_input, current_output, current_error;
+	unsigned nbr_streams, streams_size, nbr_free_streams;
+	int current_input, current_output, current_error;
 	int8_t halt_code, opt;
 	bool is_redo:1;
 	bool halt:1;
@@ -792,7 +892,7 @@ extern pl_idx_t g_anon_s, g_neck_s, g_eof_s, g_lt_s, g_false_s, g_once_s;
 extern pl_idx_t g_gt_s, g_eq_s, g_sys_elapsed_s, g_sys_queue_s, g_braces_s;
 extern pl_idx_t g_sys_stream_property_s, g_unify_s, g_on_s, g_off_s, g_sys_var_s;
 extern pl_idx_t g_call_s, g_braces_s, g_plus_s, g_minus_s, g_post_unify_hook_s;
-extern pl_idx_t g_sys_soft_cut_s;
+extern pl_idx_t g_sys_soft_cut_s, g_frozen_s, g_dif_s, g_when_s;
 
 extern unsigned g_cpu_count;
 
@@ -813,6 +913,7 @@ inline static void unshare_cell_(const cell *c)
 {
 	if (is_strbuf(c)) {
 		if (--(c)->val_strb->refcnt == 0) {
+			free((c)->val_strb->idx);
 			free((c)->val_strb);
 			g_string_cnt--;
 		}
@@ -823,6 +924,9 @@ inline static void unshare_cell_(const cell *c)
 		}
 	} else if (is_blob(c)) {
 		if (--(c)->val_blob->refcnt == 0) {
+			if ((c)->val_blob->free_fn)
+				(c)->val_blob->free_fn((c)->val_blob->ptr);
+
 			free((c)->val_blob);
 		}
 	}
@@ -871,6 +975,7 @@ uint64_t cpu_time_in_usec(void);
 char *relative_to(const char *basefile, const char *relfile);
 size_t sprint_int(char *dst, size_t size, pl_int_t n, int base);
 void format_property(module *m, char *tmpbuf, size_t buflen, const char *name, unsigned arity, const char *type);
+void clear_format_cache(prolog *pl);
 const char *dump_key(const void *k, const void *v, const void *p);
 
 #define slicecmp2(s1,l1,s2) slicecmp(s1,l1,s2,strlen(s2))
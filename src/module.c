@@ -196,6 +196,7 @@ predicate *create_predicate(module *m, cell *c)
 	pr->key.tag = TAG_INTERNED;
 	pr->key.nbr_cells = 1;
 	pr->is_noindex = m->pl->noindex || !pr->key.arity;
+	m->pl->pred_gen++;
 
 	//printf("*** create %s ==> %s/%u\n", m->filename, C_STR(m, &pr->key), pr->key.arity);
 
@@ -556,7 +557,7 @@ predicate *find_functor(module *m, const char *name, unsigned arity)
 	return find_predicate(m, &tmp);
 }
 
-predicate *search_predicate(module *m, cell *c)
+static predicate *search_predicate_(module *m, cell *c)
 {
 	predicate *pr = find_predicate(m, c);
 
@@ -586,6 +587,31 @@ predicate *search_predicate(module *m, cell *c)
 	return NULL;
 }
 
+predicate *search_predicate(module *m, cell *c)
+{
+	if (!is_interned(c))
+		return search_predicate_(m, c);
+
+	pred_cache *e = &m->pcache[(c->val_off ^ (c->arity << 7)) & (MAX_PRED_CACHE-1)];
+
+	if (e->pr && (e->val_off == c->val_off) && (e->arity == c->arity)
+		&& (e->gen == m->pl->pred_gen) && (e->idx_used == m->idx_used)
+		&& !e->pr->is_abolished)
+		return e->pr;
+
+	predicate *pr = search_predicate_(m, c);
+
+	if (pr) {
+		e->pr = pr;
+		e->gen = m->pl->pred_gen;
+		e->val_off = c->val_off;
+		e->arity = c->arity;
+		e->idx_used = m->idx_used;
+	}
+
+	return pr;
+}
+
 #define DUMP_KEYS 0
 
 #if DUMP_KEYS
@@ -599,6 +625,31 @@ static const char *dump_key(const void *k, const void *v, const void *p)
 }
 #endif
 
+// A bit is set here for the hash of every name ever given an op, in
+// any module, so most atoms are ruled out without a search...
+
+static unsigned op_name_bit(const char *name)
+{
+	unsigned h = 2166136261U;
+
+	while (*name)
+		h = (h ^ (unsigned char)*name++) * 16777619U;
+
+	return h % (64 * 64);
+}
+
+static void add_op_name(prolog *pl, const char *name)
+{
+	unsigned bit = op_name_bit(name);
+	pl->op_names[bit / 64] |= 1ULL << (bit % 64);
+}
+
+static bool is_op_name(const prolog *pl, const char *name)
+{
+	unsigned bit = op_name_bit(name);
+	return pl->op_names[bit / 64] & (1ULL << (bit % 64));
+}
+
 bool set_op(module *m, const char *name, unsigned specifier, unsigned priority)
 {
 	miter *iter = map_find_key(m->ops, name);
@@ -653,6 +704,7 @@ bool set_op(module *m, const char *name, unsigned specifier, unsigned priority)
 	m->loaded_ops = false;
 	m->user_ops = true;
 	map_app(m->ops, tmp->name, tmp);
+	add_op_name(m->pl, tmp->name);
 
 #if DUMP_KEYS
 	sl_dump(m->ops, dump_key, m);
@@ -696,6 +748,9 @@ static unsigned find_op_internal(module *m, const char *name, unsigned specifier
 
 unsigned find_op(module *m, const char *name, unsigned specifier)
 {
+	if (!is_op_name(m->pl, name))
+		return 0;
+
 	unsigned priority = find_op_internal(m, name, specifier);
 
 	if (priority)
@@ -804,6 +859,9 @@ static unsigned search_op_internal(module *m, const char *name, unsigned *specif
 
 unsigned search_op(module *m, const char *name, unsigned *specifier, bool hint_prefix)
 {
+	if (!is_op_name(m->pl, name))
+		return 0;
+
 	unsigned priority = search_op_internal(m, name, specifier, hint_prefix);
 
 	if (priority)
@@ -1185,7 +1243,22 @@ void add_to_dirty_list(db_entry *dbe)
 	pr->dirty_list = dbe;
 }
 
-static void xref_cell(module *m, clause *cl, cell *c, predicate *parent)
+// The goal a clause body finishes with, following conjunctions and
+// the else branch of a disjunction. Goals nested anywhere else, say
+// in \+/1 or findall/3, run while the clause still needs its frame...
+
+static const cell *get_last_goal(const cell *c)
+{
+	while (is_interned(c) && (c->arity == 2)
+		&& ((c->val_off == g_conjunction_s) || (c->val_off == g_disjunction_s))) {
+		c = c + 1;
+		c += c->nbr_cells;
+	}
+
+	return c;
+}
+
+static void xref_cell(module *m, clause *cl, cell *c, predicate *parent, const cell *last)
 {
 	const char *functor = C_STR(m, c);
 	unsigned specifier;
@@ -1210,11 +1283,15 @@ static void xref_cell(module *m, clause *cl, cell *c, predicate *parent)
 	} else
 		c->fn_ptr = NULL;
 
-	if ((c+c->nbr_cells) >= (cl->cells + cl->cidx-1)) {
-		if (parent && (parent->key.val_off == c->val_off) && (parent->key.arity == c->arity)) {
-			c->flags |= FLAG_TAIL_REC;
+	// A call to a user predicate as the last goal of a clause body is
+	// a candidate for reusing the clause's frame. Not so for a query,
+	// its variables are still wanted after it finishes...
+
+	if (c == last) {
+		c->flags |= FLAG_LAST_CALL;
+
+		if ((parent->key.val_off == c->val_off) && (parent->key.arity == c->arity))
 			cl->is_tail_rec = true;
-		}
 	}
 }
 
@@ -1231,15 +1308,59 @@ void xref_rule(module *m, clause *cl, predicate *parent)
 	if (c->val_off == g_sys_record_key_s)
 		return;
 
+	// Flag the first occurrence of each variable in the head, it
+	// can be bound during head unification without an occurs check...
+
+	const cell *head = get_head(cl->cells);
+	const cell *body = head + head->nbr_cells;
+	bool seen[MAX_ARITY] = {0};
+	const cell *last = NULL;
+
+	if (parent && get_body(cl->cells))
+		last = get_last_goal(get_body(cl->cells));
+
 	for (pl_idx_t i = 0; i < cl->cidx; i++) {
 		cell *c = cl->cells + i;
 
-		c->flags &= ~FLAG_TAIL_REC;
+		c->flags &= ~FLAG_LAST_CALL;
+
+		if (is_variable(c)) {
+			c->flags &= ~FLAG_VAR_FIRST;
+
+			if ((c >= head) && (c < body) && (c->var_nbr < MAX_ARITY)
+				&& !seen[c->var_nbr]) {
+				seen[c->var_nbr] = true;
+				c->flags |= FLAG_VAR_FIRST;
+			}
+		}
 
 		if (!is_interned(c))
 			continue;
 
-		xref_cell(m, cl, c, parent);
+		xref_cell(m, cl, c, parent, last);
+	}
+
+	// Compile arithmetic sub-terms, innermost first, and flag
+	// compounds with no variables so the occurs check can skip them...
+
+	pl_idx_t next_var = cl->cidx;
+
+	for (pl_idx_t i = cl->cidx; i > 0; i--) {
+		cell *c = cl->cells + i - 1;
+
+		if (is_variable(c))
+			next_var = i - 1;
+
+		if (!is_interned(c))
+			continue;
+
+		if (is_function(c))
+			c->eval_op = eval_opcode(c);
+
+		if (c->arity && (next_var >= (i - 1 + c->nbr_cells)))
+			c->flags |= FLAG_INTERNED_GROUND;
+		else
+			c->flags &= ~FLAG_INTERNED_GROUND;
 	}
 }
 
@@ -1391,7 +1512,27 @@ module *load_fp(module *m, FILE *fp, const char *filename, bool including)
 	virtual_term(p, "begin_of_file.");
 	tokenize(p, false, false);
 
-	do {
+	// Regular files are tokenized directly over a mapping of the
+	// whole file rather than copying line by line...
+
+	size_t maplen = 0;
+	off_t pos = fp != stdin ? ftello(fp) : -1;
+	char *addr = pos >= 0 ? map_file(fileno(fp), &maplen) : NULL;
+
+	if (addr && ((size_t)pos >= maplen)) {
+		unmap_file(addr, maplen);
+		addr = NULL;
+	}
+
+	if (addr) {
+		p->fp = NULL;
+		p->srcptr = addr + pos;
+		tokenize(p, false, false);
+		ok = !p->error;
+
+		if (ok && !p->already_loaded)
+			virtual_term(p, "end_of_file.");
+	} else do {
 		if (getline(&p->save_line, &p->n_line, p->fp) == -1) {
 			virtual_term(p, "end_of_file.");
 			break;
@@ -1441,6 +1582,9 @@ module *load_fp(module *m, FILE *fp, const char *filename, bool including)
 	destroy_parser(p);
 	m->filename = save_filename;
 
+	if (addr)
+		unmap_file(addr, maplen);
+
 	if (!ok)
 		unload_realfile(m, filename);
 
@@ -1452,8 +1596,8 @@ module *load_file(module *m, const char *filename, bool including)
 	const char *orig_filename = filename;
 
 	if (!strcmp(filename, "user")) {
-		for (int i = 0; i < MAX_STREAMS; i++) {
-			stream *str = &m->pl->streams[i];
+		for (unsigned i = 0; i < m->pl->nbr_streams; i++) {
+			stream *str = m->pl->streams[i];
 			char tmpbuf[256];
 			snprintf(tmpbuf, sizeof(tmpbuf), "user");
 			filename = set_loaded(m, tmpbuf);
@@ -1637,6 +1781,8 @@ void destroy_module(module *m)
 		pr = save;
 	}
 
+	m->pl->pred_gen++;
+
 	if (m->pl->modules == m) {
 		m->pl->modules = m->next;
 	} else {
@@ -1685,6 +1831,7 @@ module *create_module(prolog *pl, const char *name)
 			op_table *tmp = malloc(sizeof(op_table));
 			memcpy(tmp, ptr, sizeof(op_table));
 			map_app(m->defops, tmp->name, tmp);
+			add_op_name(pl, tmp->name);
 		}
 	}
 
@@ -30,6 +30,16 @@
 #include <unistd.h>
 #endif
 
+// Buffered socket I/O needs fopencookie()...
+
+#if defined(__GLIBC__) && !defined(__wasi__)
+#define USE_NETBUF 1
+#include <poll.h>
+#include <sys/uio.h>
+#else
+#define USE_NETBUF 0
+#endif
+
 #if USE_OPENSSL
 #include <openssl/ssl.h>
 #include <openssl/err.h>
@@ -235,7 +245,7 @@ int net_accept(stream *str)
 #if !defined(_WIN32) && !defined(__wasi__)
 	struct sockaddr_in addr = {0};
 	socklen_t len = 0;
-	int fd = accept(fileno(str->fp), (struct sockaddr*)&addr, &len);
+	int fd = accept(str->fd, (struct sockaddr*)&addr, &len);
 
 	if ((fd == -1) && ((errno == EWOULDBLOCK) || (errno == EAGAIN)))
 		return -1;
@@ -258,7 +268,7 @@ void net_set_nonblocking(stream *str)
 {
 #if !defined(_WIN32) && !defined(__wasi__)
 	unsigned long flag = 1;
-	ioctl(fileno(str->fp), FIONBIO, &flag);
+	ioctl(str->fd, FIONBIO, &flag);
 #endif
 }
 
@@ -321,36 +331,270 @@ void *net_enable_ssl(int fd, const char *hostname, bool is_server, int level, co
 #endif
 }
 
-size_t net_write(const void *ptr, size_t nbytes, stream *str)
+#if USE_NETBUF
+
+// Socket streams do their own buffering. The FILE handed out in
+// str->fp is unbuffered and wraps the functions below, so code that
+// uses stdio directly (the parser, print_canonical etc) shares the
+// same buffers as net_getc/net_read/net_write, and stdio's EOF and
+// error indicators stay accurate.
+
+static ssize_t net_writev(stream *str, struct iovec *iov, int iovcnt)
 {
+	ssize_t tot = 0;
+
 #if USE_OPENSSL
-	if (str->ssl)
-		return SSL_write((SSL*)str->sslptr, ptr, nbytes);
+	if (str->ssl) {
+		for (int i = 0; i < iovcnt; i++) {
+			const char *src = iov[i].iov_base;
+			size_t len = iov[i].iov_len;
+
+			while (len) {
+				int wlen = SSL_write((SSL*)str->sslptr, src, len);
+
+				if (wlen <= 0)
+					return -1;
+
+				src += wlen;
+				len -= wlen;
+				tot += wlen;
+			}
+		}
+
+		return tot;
+	}
 #endif
-	return fwrite(ptr, 1, nbytes, str->fp);
+
+	while (iovcnt) {
+		ssize_t wlen = writev(str->fd, iov, iovcnt);
+
+		if (wlen < 0) {
+			if (errno == EINTR)
+				continue;
+
+			// Non-blocking sockets: wait rather than lose data...
+
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				struct pollfd pfd = {.fd = str->fd, .events = POLLOUT};
+				poll(&pfd, 1, -1);
+				continue;
+			}
+
+			return -1;
+		}
+
+		tot += wlen;
+
+		while (iovcnt && ((size_t)wlen >= iov->iov_len)) {
+			wlen -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt) {
+			iov->iov_base = (char*)iov->iov_base + wlen;
+			iov->iov_len -= wlen;
+		}
+	}
+
+	return tot;
 }
 
-int net_getc(stream *str)
+bool net_flush(stream *str)
+{
+	if (!str->netbuf || !str->wbuf_len)
+		return true;
+
+	struct iovec iov[1] = {{str->wbuf, str->wbuf_len}};
+	str->wbuf_len = 0;
+	return net_writev(str, iov, 1) >= 0;
+}
+
+static ssize_t netbuf_read(void *cookie, char *buf, size_t size)
 {
+	stream *str = cookie;
+
+	if (str->srclen > 0) {
+		size_t len = MIN_OF((size_t)str->srclen, size);
+		memcpy(buf, str->src, len);
+		str->src += len;
+		str->srclen -= len;
+		return len;
+	}
+
+	// About to block, so send anything pending first...
+
+	if (!str->corked && !net_flush(str))
+		return -1;
+
+	if (!str->srcbuf) {
+		str->srcbuf = malloc(STREAM_BUFLEN+1);
+
+		if (!str->srcbuf)
+			return -1;
+	}
+
+	ssize_t rlen;
+
 #if USE_OPENSSL
 	if (str->ssl) {
-		size_t len = 1;
-		char ptr[2];
-		char *dst = ptr;
+		rlen = SSL_read((SSL*)str->sslptr, str->srcbuf, STREAM_BUFLEN);
 
-		while (len && str->srclen) {
-			*dst++ = *str->src++;
-			str->srclen--;
-			len--;
+		if (rlen < 0)
+			return -1;
+	} else
+#endif
+	if (size >= STREAM_BUFLEN) {
+
+		// A big read goes straight to the caller, and any read-ahead
+		// lands in our buffer, all in one syscall...
+
+		struct iovec iov[2] = {{buf, size}, {str->srcbuf, STREAM_BUFLEN}};
+
+		do {
+			rlen = readv(str->fd, iov, 2);
 		}
+		 while ((rlen < 0) && (errno == EINTR));
+
+		if (rlen <= (ssize_t)size)
+			return rlen;
 
-		if (dst != ptr)
-			return ptr[0];
+		str->src = str->srcbuf;
+		str->srclen = rlen - size;
+		return size;
+	} else {
+		do {
+			rlen = read(str->fd, str->srcbuf, STREAM_BUFLEN);
+		}
+		 while ((rlen < 0) && (errno == EINTR));
+
+		if (rlen < 0)
+			return -1;
+	}
+
+	if (rlen == 0)
+		return 0;
+
+	size_t len = MIN_OF(size, (size_t)rlen);
+	memcpy(buf, str->srcbuf, len);
+	str->src = str->srcbuf + len;
+	str->srclen = rlen - len;
+	return len;
+}
+
+static ssize_t netbuf_write(void *cookie, const char *buf, size_t size)
+{
+	stream *str = cookie;
+
+	if ((str->wbuf_len + size) <= STREAM_BUFLEN) {
+		memcpy(str->wbuf + str->wbuf_len, buf, size);
+		str->wbuf_len += size;
+		return size;
+	}
+
+	struct iovec iov[2] = {{str->wbuf, str->wbuf_len}, {(void*)buf, size}};
+	str->wbuf_len = 0;
+
+	if (net_writev(str, iov, 2) < 0)
+		return -1;
+
+	return size;
+}
+
+static int netbuf_close(void *cookie)
+{
+	stream *str = cookie;
+	net_flush(str);
+	free(str->wbuf);
+	str->wbuf = NULL;
+	return close(str->fd);
+}
+
+// Refill the read buffer. This goes via stdio so that it sees any EOF
+// or error. The byte it returns came from our buffer, so put it back...
+
+static int net_fill(stream *str)
+{
+	if (fgetc(str->fp) == EOF)
+		return EOF;
 
-		if (SSL_read((SSL*)str->sslptr, ptr, len) == 0)
+	str->src--;
+	str->srclen++;
+	return 0;
+}
+#else
+bool net_flush(stream *str)
+{
+	return !fflush(str->fp);
+}
+#endif
+
+bool net_open(stream *str, int fd, bool is_server)
+{
+	str->fd = fd;
+	str->socket = true;
+
+#if USE_NETBUF
+	if (!str->udp && !is_server) {
+		str->wbuf = malloc(STREAM_BUFLEN);
+
+		if (!str->wbuf)
+			return false;
+
+		cookie_io_functions_t fns = {netbuf_read, netbuf_write, NULL, netbuf_close};
+		str->fp = fopencookie(str, "r+", fns);
+
+		if (!str->fp) {
+			free(str->wbuf);
+			str->wbuf = NULL;
+			return false;
+		}
+
+		setvbuf(str->fp, NULL, _IONBF, 0);
+		str->netbuf = true;
+		return true;
+	}
+#endif
+
+	str->fp = fdopen(fd, "r+");
+	return str->fp != NULL;
+}
+
+void net_cork(stream *str, bool on)
+{
+	str->corked = on;
+
+	if (!on)
+		net_flush(str);
+}
+
+size_t net_write(const void *ptr, size_t nbytes, stream *str)
+{
+#if USE_NETBUF
+	if (str->netbuf && ((str->wbuf_len + nbytes) <= STREAM_BUFLEN)) {
+		memcpy(str->wbuf + str->wbuf_len, ptr, nbytes);
+		str->wbuf_len += nbytes;
+		return nbytes;
+	}
+#endif
+
+#if USE_OPENSSL
+	if (str->ssl && !str->netbuf)
+		return SSL_write((SSL*)str->sslptr, ptr, nbytes);
+#endif
+
+	return fwrite(ptr, 1, nbytes, str->fp);
+}
+
+int net_getc(stream *str)
+{
+#if USE_NETBUF
+	if (str->netbuf) {
+		if ((str->srclen <= 0) && (net_fill(str) == EOF))
 			return EOF;
 
-		return ptr[0];
+		str->srclen--;
+		return (unsigned char)*str->src++;
 	}
 #endif
 
@@ -359,81 +603,130 @@ int net_getc(stream *str)
 
 size_t net_read(void *ptr, size_t len, stream *str)
 {
-#if USE_OPENSSL
-	if (str->ssl) {
+#if USE_NETBUF
+	if (str->netbuf) {
 		char *dst = ptr;
+		size_t nbytes = 0;
 
-		while (len && str->srclen) {
-			*dst++ = *str->src++;
-			str->srclen--;
-			len--;
-		}
+		// Unbuffered fread would come back to us a byte at a time,
+		// so big reads call down directly...
+
+		while (nbytes < len) {
+			if (str->srclen <= 0) {
+				ssize_t rlen = 0;
+
+				if ((len - nbytes) >= STREAM_BUFLEN)
+					rlen = netbuf_read(str, dst + nbytes, len - nbytes);
 
-		if (dst != ptr)
-			return dst - (char*)ptr;
+				if (rlen > 0) {
+					nbytes += rlen;
+					continue;
+				}
 
-		return SSL_read((SSL*)str->sslptr, ptr, len);
+				if (net_fill(str) == EOF)
+					break;
+			}
+
+			size_t n = MIN_OF((size_t)str->srclen, len - nbytes);
+			memcpy(dst + nbytes, str->src, n);
+			str->src += n;
+			str->srclen -= n;
+			nbytes += n;
+		}
+
+		return nbytes;
 	}
 #endif
 
 	return fread(ptr, 1, len, str->fp);
 }
 
-int net_getline(char **lineptr, size_t *n, stream *str)
+// A read that found nothing on a non-blocking socket, as opposed to
+// EOF or a real error, can wait up to msecs for more input...
+
+bool net_wait_input(stream *str, int msecs)
 {
-#if USE_OPENSSL
-	if (str->ssl) {
-		if (!*lineptr) {
-			*lineptr = malloc(*n=1024);
-			ensure(*lineptr);
-		}
+#if USE_NETBUF
+	if (!str->socket || !ferror(str->fp))
+		return false;
 
-		char *dst = *lineptr;
-		size_t dstlen = *n;
-		int done = 0;
+	if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+		return false;
 
-		while (!done) {
-			if (str->srclen <= 0) {
-				int rlen = SSL_read((SSL*)str->sslptr, str->srcbuf, STREAM_BUFLEN);
+	clearerr(str->fp);
+	struct pollfd pfd = {.fd = str->fd, .events = POLLIN};
+	return poll(&pfd, 1, msecs) > 0;
+#else
+	(void) str;
+	(void) msecs;
+	return false;
+#endif
+}
+
+// A line longer than max returns -2. With msecs a line that stops
+// part way waits for the rest, else it is returned as is...
+
+int net_getline_max(char **lineptr, size_t *n, size_t max, int msecs, stream *str)
+{
+#if USE_NETBUF
+	if (str->netbuf) {
+		size_t len = 0;
+
+		for (;;) {
+			if ((str->srclen <= 0) && (net_fill(str) == EOF)) {
+				if (len && msecs && net_wait_input(str, msecs))
+					continue;
 
-				if (rlen <= 0)
+				if (!len || msecs)
 					return -1;
 
-				str->srcbuf[rlen] = '\0';
-				str->src = str->srcbuf;
-				str->srclen = rlen;
+				break;
 			}
 
-			while (str->srclen-- > 0) {
-				int ch = *str->src++;
-				*dst++ = ch;
-
-				if (dstlen-- <= 1) {
-					size_t savelen = dst - *lineptr;
-					*n *= 2;
-					*lineptr = realloc(*lineptr, *n);
-					ensure(*lineptr);
-					dst = *lineptr + savelen;
-					dstlen = *n - savelen;
-				}
+			const char *nl = memchr(str->src, '\n', str->srclen);
+			size_t nbytes = nl ? (size_t)(nl - str->src) + 1 : (size_t)str->srclen;
 
-				if (ch == '\n') {
-					*dst = '\0';
-					done = 1;
-					break;
-				}
+			if ((len + nbytes) > max)
+				return -2;
+
+			if (!*lineptr || ((len + nbytes + 1) > *n)) {
+				*n = (len + nbytes + 1) * 2;
+				*lineptr = realloc(*lineptr, *n);
+				ensure(*lineptr);
 			}
+
+			memcpy(*lineptr + len, str->src, nbytes);
+			str->src += nbytes;
+			str->srclen -= nbytes;
+			len += nbytes;
+
+			if (nl)
+				break;
 		}
 
-		return dst - *lineptr;
+		(*lineptr)[len] = '\0';
+		return len;
 	}
 #endif
 
-	return getline(lineptr, n, str->fp);
+	(void) msecs;
+	ssize_t len = getline(lineptr, n, str->fp);
+
+	if ((len > 0) && ((size_t)len > max))
+		return -2;
+
+	return len;
+}
+
+int net_getline(char **lineptr, size_t *n, stream *str)
+{
+	return net_getline_max(lineptr, n, SIZE_MAX, 0, str);
 }
 
 void net_close(stream *str)
 {
+	net_flush(str);
+
 #if USE_OPENSSL
 	if (str->ssl) {
 		SSL_shutdown((SSL*)str->sslptr);
@@ -456,4 +749,8 @@ void net_close(stream *str)
 #endif
 
 	str->fp = NULL;
+	str->netbuf = false;
+	free(str->srcbuf);
+	str->srcbuf = NULL;
+	str->srclen = 0;
 }
@@ -14,6 +14,11 @@ extern void net_set_nonblocking(stream *str);
 extern void *net_enable_ssl(int fd, const char *hostname, bool is_server, int level, const char *certfile);
 extern size_t net_read(void *ptr, size_t len, stream *str);
 extern int net_getline(char **lineptr, size_t *n, stream *str);
+extern int net_getline_max(char **lineptr, size_t *n, size_t max, int msecs, stream *str);
+extern bool net_wait_input(stream *str, int msecs);
 extern int net_getc(stream *str);
 extern size_t net_write(const void *ptr, size_t nbytes, stream *str);
 extern void net_close(stream *str);
+extern bool net_open(stream *str, int fd, bool is_server);
+extern bool net_flush(stream *str);
+extern void net_cork(stream *str, bool on);
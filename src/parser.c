@@ -48,7 +48,7 @@ cell *list_head(cell *l, cell *tmp)
 	if (!is_string(l))
 		return l + 1;
 
-	const char *src = is_static(l) ? l->val_str : is_strbuf(l) ? (char*)l->val_strb->cstr + l->strb_off : (char*)l->val_chr + l->val_off;
+	const char *src = is_static(l) ? l->val_str : is_strbuf(l) ? l->val_strb->cstr + l->strb_off : (char*)l->val_chr + l->val_off;
 	size_t len = len_char_utf8(src);
 	tmp->tag = TAG_CSTR;
 	tmp->nbr_cells = 1;
@@ -69,8 +69,8 @@ cell *list_tail(cell *l, cell *tmp)
 		return h + h->nbr_cells;
 	}
 
-	const char *src = is_static(l) ? l->val_str : is_strbuf(l) ? (char*)l->val_strb->cstr + l->strb_off : (char*)l->val_chr;
-	size_t str_len = is_static(l) ? (size_t)l->str_len : is_strbuf(l) ? (size_t)l->val_strb->len - l->strb_off : (unsigned)l->chr_len;
+	const char *src = is_static(l) ? l->val_str : is_strbuf(l) ? l->val_strb->cstr + l->strb_off : (char*)l->val_chr;
+	size_t str_len = is_static(l) ? (size_t)l->str_len : is_strbuf(l) ? (size_t)l->strb_len : (unsigned)l->chr_len;
 	size_t len = len_char_utf8(src);
 
 	if (str_len == len) {
@@ -1396,6 +1396,146 @@ static bool dcg_expansion(parser *p)
 	return true;
 }
 
+// Specialization of library(apply). A maplist(inc, L1, L2), say, gets
+// an auxiliary predicate of its own, made in the closure's module on
+// the first call, that calls inc/2 direct instead of through call/3
+// for every element. The closure's args are passed on as extra args,
+// so one predicate does for any closure with that name and arity...
+
+static bool is_apply_closure(const char *name)
+{
+	static const char *s_controls[] = {",", ";", "->", "*->", "\\+", ":", "|", "[]", "!", 0};
+
+	for (const char **ptr = s_controls; *ptr; ptr++) {
+		if (!strcmp(*ptr, name))
+			return false;
+	}
+
+	return strlen(name) < 128;
+}
+
+static unsigned apply_kind(const char *kind, unsigned arity)
+{
+	if (!strcmp(kind, "maplist") && (arity >= 2) && (arity <= 8))
+		return 'm';
+
+	if (!strcmp(kind, "foldl") && (arity >= 4) && (arity <= 7))
+		return 'f';
+
+	if (!strcmp(kind, "include") && (arity == 3))
+		return 'i';
+
+	if (!strcmp(kind, "exclude") && (arity == 3))
+		return 'e';
+
+	return 0;
+}
+
+bool apply_specialize(module *m, const char *kind, unsigned arity, const char *name, unsigned nbr_args, pl_idx_t *aux)
+{
+	unsigned k = apply_kind(kind, arity);
+
+	if (!k || !is_apply_closure(name) || ((arity + nbr_args) > MAX_ARITY))
+		return false;
+
+	unsigned nbr_lists = k == 'm' ? arity - 1 : k == 'f' ? arity - 3 : 1;
+	char tmpbuf[1024], auxbuf[1024], fbuf[1024];
+	snprintf(tmpbuf, sizeof(tmpbuf), "$%s/%u:%s/%u", kind, arity, name, nbr_args);
+	formatted(auxbuf, sizeof(auxbuf), tmpbuf, strlen(tmpbuf), false);
+	formatted(fbuf, sizeof(fbuf), name, strlen(name), false);
+	pl_idx_t off = index_from_pool(m->pl, tmpbuf);		// may move the pool
+
+	if (off == ERR_IDX)
+		return false;
+
+	cell tmp = (cell){0};
+	tmp.tag = TAG_INTERNED;
+	tmp.nbr_cells = 1;
+	tmp.val_off = off;
+	tmp.arity = arity - 1 + nbr_args;
+	*aux = off;
+
+	if (find_predicate(m, &tmp))
+		return true;
+
+	ASTRING(s);
+
+	// The empty list(s) clause...
+
+	ASTRING_sprintf(s, "'%s'(", auxbuf);
+
+	for (unsigned i = 0; i < nbr_lists; i++)
+		ASTRING_sprintf(s, "%s[]", i ? "," : "");
+
+	ASTRING_strcat(s, k == 'f' ? ",V,V" : k != 'm' ? ",[]" : "");
+
+	for (unsigned i = 0; i < nbr_args; i++)
+		ASTRING_strcat(s, ",_");
+
+	// The list cell(s) clause...
+
+	ASTRING_sprintf(s, ").\n'%s'(", auxbuf);
+
+	for (unsigned i = 0; i < nbr_lists; i++)
+		ASTRING_sprintf(s, "%s[E%u|T%u]", i ? "," : "", i, i);
+
+	ASTRING_strcat(s, k == 'f' ? ",V0,V" : k != 'm' ? ",I" : "");
+
+	for (unsigned i = 0; i < nbr_args; i++)
+		ASTRING_sprintf(s, ",A%u", i);
+
+	ASTRING_sprintf(s, ") :- %s'%s'(", k == 'i' || k == 'e' ? "(" : "", fbuf);
+
+	for (unsigned i = 0; i < nbr_args; i++)
+		ASTRING_sprintf(s, "A%u,", i);
+
+	for (unsigned i = 0; i < nbr_lists; i++)
+		ASTRING_sprintf(s, "%sE%u", i ? "," : "", i);
+
+	ASTRING_strcat(s, k == 'f' ? ",V0,V1" : k == 'i' ? ") -> I=[E0|I1] ; I=I1" : k == 'e' ? ") -> I=I1 ; I=[E0|I1]" : "");
+
+	ASTRING_sprintf(s, "), '%s'(", auxbuf);
+
+	for (unsigned i = 0; i < nbr_lists; i++)
+		ASTRING_sprintf(s, "%sT%u", i ? "," : "", i);
+
+	ASTRING_strcat(s, k == 'f' ? ",V1,V" : k != 'm' ? ",I1" : "");
+
+	for (unsigned i = 0; i < nbr_args; i++)
+		ASTRING_sprintf(s, ",A%u", i);
+
+	ASTRING_strcat(s, ").\n");
+	parser *p = create_parser(m);
+	check_error(p, ASTRING_free(s));
+	p->srcptr = ASTRING_cstr(s);
+	p->consulting = true;
+	p->internal = true;
+	tokenize(p, false, false);
+	bool ok = !p->error;
+	destroy_parser(p);
+	ASTRING_free(s);
+	predicate *pr = ok ? find_predicate(m, &tmp) : NULL;
+
+	if (!pr)
+		return false;
+
+	// Errors raised in the auxiliary name the library's own helper,
+	// foldl_/4 say, as they did before...
+
+	snprintf(tmpbuf, sizeof(tmpbuf), "%s_", kind);
+	off = index_from_pool(m->pl, tmpbuf);
+
+	if (off != ERR_IDX) {
+		pr->alias = (cell){0};
+		pr->alias.tag = TAG_INTERNED;
+		pr->alias.nbr_cells = 1;
+		pr->alias.val_off = off;
+		pr->alias.arity = arity;
+	}
+
+	return true;
+}
+
 static cell *goal_expansion(parser *p, cell *goal)
 {
 	if (p->error || p->internal || !is_interned(goal))
@@ -2038,7 +2178,7 @@ static bool parse_number(parser *p, const char **srcptr, bool neg)
 			p->v.val_bigint = malloc(sizeof(bigint));
 			p->v.val_bigint->refcnt = 1;
 			mp_int_init_copy(&p->v.val_bigint->ival, &v2);
-			if (neg) p->v.val_bigint->ival.sign = MP_NEG;
+			if (neg) mp_int_neg(&p->v.val_bigint->ival, &p->v.val_bigint->ival);
 			p->v.flags |= FLAG_MANAGED;
 		} else {
 			set_smallint(&p->v, val);
@@ -2061,7 +2201,7 @@ static bool parse_number(parser *p, const char **srcptr, bool neg)
 			p->v.val_bigint = malloc(sizeof(bigint));
 			p->v.val_bigint->refcnt = 1;
 			mp_int_init_copy(&p->v.val_bigint->ival, &v2);
-			if (neg) p->v.val_bigint->ival.sign = MP_NEG;
+			if (neg) mp_int_neg(&p->v.val_bigint->ival, &p->v.val_bigint->ival);
 			p->v.flags |= FLAG_MANAGED;
 		} else {
 			set_smallint(&p->v, val);
@@ -2084,7 +2224,7 @@ static bool parse_number(parser *p, const char **srcptr, bool neg)
 			p->v.val_bigint = malloc(sizeof(bigint));
 			p->v.val_bigint->refcnt = 1;
 			mp_int_init_copy(&p->v.val_bigint->ival, &v2);
-			if (neg) p->v.val_bigint->ival.sign = MP_NEG;
+			if (neg) mp_int_neg(&p->v.val_bigint->ival, &p->v.val_bigint->ival);
 			p->v.flags |= FLAG_MANAGED;
 		} else {
 			set_smallint(&p->v, val);
@@ -2114,7 +2254,7 @@ static bool parse_number(parser *p, const char **srcptr, bool neg)
 		p->v.val_bigint = malloc(sizeof(bigint));
 		p->v.val_bigint->refcnt = 1;
 		mp_int_init_copy(&p->v.val_bigint->ival, &v2);
-		if (neg) p->v.val_bigint->ival.sign = MP_NEG;
+		if (neg) mp_int_neg(&p->v.val_bigint->ival, &p->v.val_bigint->ival);
 		p->v.flags |= FLAG_MANAGED;
 	} else {
 		set_smallint(&p->v, val);
@@ -2167,6 +2307,54 @@ static bool valid_float(const char *src)
 	return true;
 }
 
+// Scanning is done a byte at a time for the common ASCII cases, the
+// UTF-8 decoding and wide-char classification are only used for
+// anything else...
+
+static bool is_ascii_space(int ch)
+{
+	return (ch == ' ') || (ch == '\t') || (ch == '\r') || (ch == '\f') || (ch == '\v') || (ch == '\n');
+}
+
+static size_t span_ascii_ident(const char *src)
+{
+	const char *s = src;
+
+	while (((unsigned char)*s < 0x80) && (isalnum(*s) || (*s == '_')))
+		s++;
+
+	return s - src;
+}
+
+// Printable ASCII in a quoted atom that stands for itself...
+
+static size_t span_ascii_quoted(const char *src, int quote)
+{
+	const char *s = src;
+
+	while (((unsigned char)*s >= ' ') && ((unsigned char)*s < 0x80) && (*s != quote) && (*s != '\\'))
+		s++;
+
+	return s - src;
+}
+
+static char *append_token(parser *p, char *dst, const char *src, size_t n)
+{
+	size_t offset = dst - p->token;
+
+	if ((offset + n + 1) >= p->token_size) {
+		while ((offset + n + 1) >= p->token_size)
+			p->token_size *= 2;
+
+		p->token = realloc(p->token, p->token_size);
+		if (!p->token) return NULL;
+		dst = p->token + offset;
+	}
+
+	memcpy(dst, src, n);
+	return dst + n;
+}
+
 char *eat_space(parser *p)
 {
 	p->did_getline = false;
@@ -2175,19 +2363,23 @@ char *eat_space(parser *p)
 
 	do {
 		done = true;
-		int ch = peek_char_utf8(src);
 
-		while (iswspace(ch)) {
-			if (ch == '\n')
+		for (;;) {
+			if (*src == '\n')
 				p->line_nbr++;
+			else if (!is_ascii_space(*src)) {
+				if (((unsigned char)*src < 0x80) || !iswspace(peek_char_utf8(src)))
+					break;
 
-			get_char_utf8(&src);
-			ch = peek_char_utf8(src);
+				get_char_utf8(&src);
+				continue;
+			}
+
+			src++;
 		}
 
 		if ((*src == '%') && !p->fp) {
-			while (*src && (*src != '\n'))
-				src++;
+			src += strcspn(src, "\n");
 
 			if (*src == '\n')
 				p->line_nbr++;
@@ -2198,8 +2390,7 @@ char *eat_space(parser *p)
 		}
 
 		if ((!*src || (*src == '%')) && p->fp) {
-			while (*src && (*src != '\n'))
-				src++;
+			src += strcspn(src, "\n");
 
 			if (*src == '\n')
 				p->line_nbr++;
@@ -2220,6 +2411,9 @@ char *eat_space(parser *p)
 		}
 
 		do {
+			if (p->comment)
+				src += strcspn(src, "*\n");
+
 			if (!p->comment && (src[0] == '/') && (src[1] == '*')) {
 				p->comment = true;
 				src += 2;
@@ -2254,6 +2448,21 @@ char *eat_space(parser *p)
 	return (char*)src;
 }
 
+// Look ahead past any layout without consuming it. Lines are only
+// counted once they are actually consumed, unless the look ahead had
+// to read a new line in which case there is no going back...
+
+static char *peek_space(parser *p)
+{
+	unsigned save_line_nbr = p->line_nbr;
+	char *s = eat_space(p);
+
+	if (!p->did_getline)
+		p->line_nbr = save_line_nbr;
+
+	return s;
+}
+
 static bool eat_comment(parser *p)
 {
 	char *src = p->srcptr;
@@ -2285,7 +2494,7 @@ static bool check_space_before_function(parser *p, int ch, const char *src)
 {
 	if (iswspace(ch) && strcmp(p->token, ".")) {
 		p->srcptr = (char*)src;
-		src = eat_space(p);
+		src = peek_space(p);
 
 		if (!src || !*src) {
 			if (DUMP_ERRS || !p->do_read_term)
@@ -2326,10 +2535,8 @@ bool get_token(parser *p, bool last_op, bool was_postfix)
 
 	const char *src = p->srcptr;
 
-	if (!p->token || (strlen(src) >= p->token_size)) {
-		p->token = realloc(p->token, p->token_size = strlen(src)+1);
-		check_error(p->token);
-	}
+	// The token buffer grows as needed below. Don't size it from the
+	// remaining input as that may be a whole (mapped) file...
 
 	char *dst = p->token;
 	*dst = '\0';
@@ -2531,7 +2738,20 @@ bool get_token(parser *p, bool last_op, bool was_postfix)
 		}
 
 		for (;;) {
-			for (int ch; (ch = get_char_utf8(&src));) {
+			for (;;) {
+				size_t n = span_ascii_quoted(src, p->quote_char);
+
+				if (n) {
+					dst = append_token(p, dst, src, n);
+					check_error(dst);
+					src += n;
+				}
+
+				int ch = get_char_utf8(&src);
+
+				if (!ch)
+					break;
+
 				if (ch == '\n') {
 					if (DUMP_ERRS || !p->do_read_term)
 						fprintf(stdout, "Error: syntax error, unterminated quoted atom, line %d\n", p->line_nbr);
@@ -2641,6 +2861,12 @@ bool get_token(parser *p, bool last_op, bool was_postfix)
 	int ch = peek_char_utf8(src);
 
 	if (iswalpha(ch) || (ch == '_')) {
+		size_t n = span_ascii_ident(src);
+		dst = append_token(p, dst, src, n);
+		check_error(dst);
+		src += n;
+		ch = peek_char_utf8(src);
+
 		while (iswalnum(ch) || (ch == '_')) {
 			get_char_utf8(&src);
 			size_t len = (dst + put_len_utf8(ch) + 1) - p->token;
@@ -3263,7 +3489,7 @@ unsigned tokenize(parser *p, bool args, bool consing)
 		int priority = 0;
 
 		if (is_interned(&p->v)) {
-			char *s = eat_space(p);
+			char *s = peek_space(p);
 
 			if (!s || !*s) {
 				if (DUMP_ERRS || !p->do_read_term)
@@ -3300,7 +3526,7 @@ unsigned tokenize(parser *p, bool args, bool consing)
 
 		if (priority && (last_op || last_bar)
 			&& !IS_POSTFIX(specifier)) {
-			char *s = eat_space(p);
+			char *s = peek_space(p);
 
 			if (!s || !*s) {
 				if (DUMP_ERRS || !p->do_read_term)
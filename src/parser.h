@@ -14,6 +14,7 @@ cell *check_body_callable(parser *p, cell *c);
 bool run(parser *p, const char *src, bool dump);
 char *eat_space(parser *p);
 bool virtual_term(parser *p, const char *src);
+bool apply_specialize(module *m, const char *kind, unsigned arity, const char *name, unsigned nbr_args, pl_idx_t *aux);
 bool get_token(parser *p, bool last_op, bool was_postfix);
 void read_integer(parser *p, mp_int v2, int base, const char *src,  const char **srcptr);
 
@@ -278,6 +278,67 @@ static bool make_slice(query *q, cell *d, const cell *orig, size_t off, size_t n
 	return make_cstringn(d, s+off, n);
 }
 
+// Make the text of p1 followed by s2. If p1 ends its buffer and there
+// is room the text is appended in place and the buffer shared, any
+// other cell on it keeps its own length. Otherwise a buffer is made
+// with room to spare if p1 already had one, so building a long text
+// a piece at a time is amortized O(1) a byte rather than a copy each
+// time...
+
+static bool make_concat(query *q, cell *d, const cell *p1, const char *s2, size_t len2, bool is_str)
+{
+	size_t len1 = C_STRLEN(q, p1), len = len1 + len2;
+
+	if (is_strbuf(p1)) {
+		strbuf *strb = p1->val_strb;
+
+		if (((p1->strb_off + len1) == strb->len) && ((strb->len + len2) <= strb->size)) {
+			memcpy(strb->cstr + strb->len, s2, len2);
+			strb->len += len2;
+			strb->cstr[strb->len] = '\0';
+			free(strb->idx);
+			strb->idx = NULL;
+			share_cell(p1);
+			*d = *p1;
+			d->strb_len = len;
+			d->flags = FLAG_MANAGED | FLAG_CSTR_BLOB | (is_str ? FLAG_CSTR_STRING : 0);
+			d->arity = is_str ? 2 : 0;
+			return true;
+		}
+	}
+
+	if (!is_strbuf(p1) || (len < MAX_SMALL_STRING)) {
+		char *tmpbuf = malloc(len + 1);
+		check_error(tmpbuf);
+		memcpy(tmpbuf, C_STR(q, p1), len1);
+		memcpy(tmpbuf + len1, s2, len2);
+		tmpbuf[len] = '\0';
+		bool ok = is_str ? make_stringn(d, tmpbuf, len) : make_cstringn(d, tmpbuf, len);
+		free(tmpbuf);
+		return ok;
+	}
+
+	strbuf *strb = malloc(sizeof(strbuf) + (len * 2) + 1);
+	check_error(strb);
+	memcpy(strb->cstr, C_STR(q, p1), len1);
+	memcpy(strb->cstr + len1, s2, len2);
+	strb->cstr[len] = '\0';
+	strb->len = len;
+	strb->size = len * 2;
+	strb->idx = NULL;
+	strb->refcnt = 1;
+	g_string_cnt++;
+	*d = (cell){0};
+	d->tag = TAG_CSTR;
+	d->nbr_cells = 1;
+	d->flags = FLAG_MANAGED | FLAG_CSTR_BLOB | (is_str ? FLAG_CSTR_STRING : 0);
+	d->arity = is_str ? 2 : 0;
+	d->val_strb = strb;
+	d->strb_off = 0;
+	d->strb_len = len;
+	return true;
+}
+
 static bool fn_iso_unify_with_occurs_check_2(query *q)
 {
 	GET_FIRST_ARG(p1,any);
@@ -310,7 +371,7 @@ static bool fn_iso_notunify_2(query *q)
 	GET_NEXT_RAW_ARG(p2,any);
 	cell tmp2;
 	make_struct(&tmp2, g_unify_s, fn_iso_unify_2, 2, 0);
-	cell *tmp = clone_to_heap(q, true, &tmp2, p1->nbr_cells+p2->nbr_cells+3);
+	cell *tmp = clone_to_heap(q, true, &tmp2, q->st.curr_frame, p1->nbr_cells+p2->nbr_cells+3);
 	pl_idx_t nbr_cells = 1;
 	tmp[nbr_cells].nbr_cells += p1->nbr_cells+p2->nbr_cells;
 	nbr_cells++;
@@ -700,7 +761,7 @@ static bool fn_iso_number_chars_2(query *q)
 		*dst = '\0';
 
 		int n = q->pl->current_input;
-		stream *str = &q->pl->streams[n];
+		stream *str = q->pl->streams[n];
 
 		if (!str->p)
 			str->p = create_parser(q->st.m);
@@ -1254,7 +1315,7 @@ static bool fn_iso_number_codes_2(query *q)
 		*dst = '\0';
 
 		int n = q->pl->current_input;
-		stream *str = &q->pl->streams[n];
+		stream *str = q->pl->streams[n];
 
 		if (!str->p)
 			str->p = create_parser(q->st.m);
@@ -1308,6 +1369,83 @@ static bool fn_iso_number_codes_2(query *q)
 	return unify(q, p2, p2_ctx, l, q->st.curr_frame);
 }
 
+// With Sub known there's no need to try every slice. If Before or
+// After is known it can only be in one place, otherwise search for
+// it, finding the next match before returning this one so the last
+// leaves no choice. The next match's byte and char offsets are kept
+// in the choice...
+
+static bool do_sub_atom_search(query *q, cell *p1, cell *p2, pl_idx_t p2_ctx, cell *p3, pl_idx_t p3_ctx, cell *p4, pl_idx_t p4_ctx, cell *p5)
+{
+	const char *src = C_STR(q, p1), *sub = C_STR(q, p5);
+	const size_t src_len = C_STRLEN(q, p1), sub_len = C_STRLEN(q, p5);
+	const size_t len_p1 = C_STRLEN_UTF8(p1), len = C_STRLEN_UTF8(p5);
+
+	if (len > len_p1)
+		return false;
+
+	if (is_integer(p3) && (is_bigint(p3) || ((size_t)get_smallint(p3) != len)))
+		return false;
+
+	size_t before, off;
+
+	if (!is_variable(p2) || !is_variable(p4)) {
+		if (is_bigint(p2) || is_bigint(p4))
+			return false;
+
+		if (!is_variable(p2))
+			before = get_smallint(p2);
+		else if ((size_t)get_smallint(p4) <= (len_p1 - len))
+			before = len_p1 - len - get_smallint(p4);
+		else
+			return false;
+
+		if (before > (len_p1 - len))
+			return false;
+
+		off = C_OFFSET_AT_POS(p1, before);
+
+		if (memcmp(src+off, sub, sub_len))
+			return false;
+	} else if (!q->retry) {
+		const char *ptr = memmem(src, src_len, sub, sub_len);
+
+		if (!ptr)
+			return false;
+
+		off = ptr - src;
+		before = substrlen_utf8(src, off);
+	} else {
+		off = q->st.v1;
+		before = q->st.v2;
+	}
+
+	if (is_variable(p2) && is_variable(p4) && (off < src_len)) {
+		size_t next = off + len_char_utf8(src+off);
+		const char *ptr = memmem(src+next, src_len-next, sub, sub_len);
+
+		if (ptr) {
+			q->st.v1 = ptr - src;
+			q->st.v2 = before + 1 + substrlen_utf8(src+next, ptr-(src+next));
+			check_heap_error(push_choice(q));
+		}
+	}
+
+	cell tmp;
+	make_int(&tmp, before);
+
+	if (!unify(q, p2, p2_ctx, &tmp, q->st.curr_frame))
+		return false;
+
+	make_int(&tmp, len);
+
+	if (!unify(q, p3, p3_ctx, &tmp, q->st.curr_frame))
+		return false;
+
+	make_int(&tmp, len_p1 - before - len);
+	return unify(q, p4, p4_ctx, &tmp, q->st.curr_frame);
+}
+
 static bool fn_iso_sub_atom_5(query *q)
 {
 	GET_FIRST_ARG(p1,atom);
@@ -1327,6 +1465,9 @@ static bool fn_iso_sub_atom_5(query *q)
 	if (is_integer(p4) && is_negative(p4))
 		return throw_error(q, p4, p4_ctx, "domain_error", "not_less_than_zero");
 
+	if (!is_variable(p5))
+		return do_sub_atom_search(q, p1, p2, p2_ctx, p3, p3_ctx, p4, p4_ctx, p5);
+
 	bool fixed = ((is_integer(p2) ? 1: 0) + (is_integer(p3) ? 1 : 0) + (is_integer(p4) ? 1 : 0)) >= 2;
 
 	if ((!is_variable(p2) || !is_variable(p4)) && !is_variable(p5))
@@ -1395,8 +1536,8 @@ static bool fn_iso_sub_atom_5(query *q)
 				continue;
 			}
 
-			size_t ipos = offset_at_pos(C_STR(q, p1), C_STRLEN(q, p1), i);
-			size_t jpos = offset_at_pos(C_STR(q, p1), C_STRLEN(q, p1), i + j);
+			size_t ipos = C_OFFSET_AT_POS(p1, i);
+			size_t jpos = C_OFFSET_AT_POS(p1, i + j);
 
 			check_heap_error(make_slice(q, &tmp, p1, ipos, jpos - ipos));
 
@@ -1502,12 +1643,8 @@ static bool fn_iso_atom_concat_3(query *q)
 		if (!is_iso_atom(p2))
 			return throw_error(q, p2, p2_ctx, "type_error", "atom");
 
-		ASTRING_alloc(pr,256);
-		ASTRING_strcatn(pr, C_STR(q, p1), C_STRLEN(q, p1));
-		ASTRING_strcatn(pr, C_STR(q, p2), C_STRLEN(q, p2));
 		cell tmp;
-		check_heap_error(make_cstring(&tmp, ASTRING_cstr(pr)), ASTRING_free(pr));
-		ASTRING_free(pr);
+		check_heap_error(make_concat(q, &tmp, p1, C_STR(q, p2), C_STRLEN(q, p2), false));
 		bool ok = unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
 		unshare_cell(&tmp);
 		return ok;
@@ -1573,7 +1710,7 @@ static bool fn_iso_atom_length_2(query *q)
 	if (is_negative(p2))
 		return throw_error(q, p2, p2_ctx, "domain_error", "not_less_than_zero");
 
-	size_t len = substrlen_utf8(C_STR(q, p1), C_STRLEN(q, p1));
+	size_t len = C_STRLEN_UTF8(p1);
 	cell tmp;
 	make_int(&tmp, len);
 	bool ok = unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
@@ -1714,6 +1851,283 @@ static bool fn_iso_arg_3(query *q)
 	return true;
 }
 
+// Terms are only changed in place when on the heap (or a previous
+// nb_setarg/3 copy) and the arg and value are single cells. Otherwise
+// the outermost term holding it is copied once with the new arg, and
+// every var bound to the old term, or to a term in it, is rebound to
+// the copy, which later calls change in place.
+// Returns the start of the page the term is in...
+
+static cell *in_pages(const page *a, const page *end, const cell *c)
+{
+	for (; a != end; a = a->next) {
+		if ((c >= a->heap) && (c < (a->heap + a->h_size)))
+			return a->heap;
+	}
+
+	return NULL;
+}
+
+static cell *is_mutable(const query *q, const cell *c)
+{
+	const page *a = q->pages;
+	cell *heap;
+
+	if (a && (heap = in_pages(a, a->next, c)))
+		return heap;
+
+	if ((heap = in_pages(q->nb_pages, NULL, c)) != NULL)
+		return heap;
+
+	return a ? in_pages(a->next, NULL, c) : NULL;
+}
+
+// A var put in c is also in any compound enclosing it, which must
+// be in the same heap page, so none of them is ground any more...
+
+static void clear_ground(cell *heap, cell *c)
+{
+	for (pl_idx_t i = c - heap + 1; i > 0; i--) {
+		cell *tmp = heap + i - 1;
+
+		if (is_interned(tmp) && tmp->arity && ((tmp + tmp->nbr_cells) > c))
+			tmp->flags &= ~FLAG_INTERNED_GROUND;
+	}
+}
+
+// Copies for nb_setarg/3 must outlive backtracking so are kept for
+// the life of the query. They are bumped off chunks that double in
+// size, so there are never more than a few chunks to search...
+
+static const pl_idx_t INITIAL_NBR_NB_CELLS = 1000;
+
+static cell *alloc_on_nb_heap(query *q, pl_idx_t nbr_cells)
+{
+	page *a = q->nb_pages;
+
+	if (!a || ((a->hp + nbr_cells) > a->h_size)) {
+		pl_idx_t n = a ? a->h_size * 2 : INITIAL_NBR_NB_CELLS;
+
+		while (n < nbr_cells)
+			n *= 2;
+
+		a = calloc(1, sizeof(page));
+		if (!a) return NULL;
+		a->heap = calloc(a->h_size = n, sizeof(cell));
+		if (!a->heap) { free(a); return NULL; }
+		a->next = q->nb_pages;
+		q->nb_pages = a;
+	}
+
+	cell *c = a->heap + a->hp;
+	a->hp = a->max_hp_used = a->hp + nbr_cells;
+	return c;
+}
+
+// Vars hold a compound as an indirect to it. The term may be inside
+// a bigger one that a var is bound to (say it was got with arg/3), so
+// find the outermost one. The vars in a heap term are refs, so a var
+// bound to it in any context is bound to the same term...
+
+static cell *outermost_term(query *q, cell *p, pl_idx_t p_ctx, bool any_ctx)
+{
+	cell *b = p;
+
+	for (pl_idx_t ctx = 0; ctx < q->st.fp; ctx++) {
+		const frame *f = GET_FRAME(ctx);
+
+		for (unsigned i = 0; i < f->nbr_vars; i++) {
+			const slot *e = GET_SLOT(f, i);
+
+			if (!is_indirect(&e->c) || (!any_ctx && (e->c.var_ctx != p_ctx)))
+				continue;
+
+			cell *c = e->c.val_ptr;
+
+			if ((c < b) && ((c + c->nbr_cells) >= (p + p->nbr_cells)))
+				b = c;
+		}
+	}
+
+	return b;
+}
+
+// Copy the term b with the arg c replaced by the n cells at v (which
+// are already shared), then rebind every var bound to b or to a term
+// in it (other than the old arg) to the same place in the copy...
+
+static bool replace_arg(query *q, cell *b, pl_idx_t b_ctx, bool any_ctx, cell *c, cell *v, pl_idx_t n, bool trailing)
+{
+	pl_idx_t off = c - b, old = c->nbr_cells, rest = b->nbr_cells - off - old;
+	pl_idx_t nbr_cells = off + n + rest;
+	cell *tmp = trailing ? alloc_on_heap(q, nbr_cells) : alloc_on_nb_heap(q, nbr_cells);
+	if (!tmp) return false;
+	safe_copy_cells(tmp, b, off);
+	copy_cells(tmp+off, v, n);
+	safe_copy_cells(tmp+off+n, c+old, rest);
+	bool has_var = false;
+
+	for (pl_idx_t i = 0; i < nbr_cells; i++) {
+		cell *c2 = tmp + i;
+
+		if (!is_variable(c2))
+			continue;
+
+		has_var = true;
+
+		if (is_ref(c2))
+			continue;
+
+		c2->flags |= FLAG_REF;
+		c2->var_ctx = b_ctx;
+	}
+
+	// The compounds enclosing the arg change size...
+
+	for (pl_idx_t i = 0; i < off; i++) {
+		cell *c2 = tmp + i;
+
+		if ((i + c2->nbr_cells) <= off)
+			continue;
+
+		c2->nbr_cells = c2->nbr_cells - old + n;
+
+		if (has_var)
+			c2->flags &= ~FLAG_INTERNED_GROUND;
+	}
+
+	cell *end = b + b->nbr_cells;
+
+	for (pl_idx_t ctx = 0; ctx < q->st.fp; ctx++) {
+		frame *f = GET_FRAME(ctx);
+
+		for (unsigned i = 0; i < f->nbr_vars; i++) {
+			const slot *e = GET_SLOT(f, i);
+
+			if (!is_indirect(&e->c) || (!any_ctx && (e->c.var_ctx != b_ctx)))
+				continue;
+
+			if ((e->c.val_ptr < b) || (e->c.val_ptr >= end))
+				continue;
+
+			pl_idx_t i2 = e->c.val_ptr - b;
+
+			if ((i2 >= off) && (i2 < (off + old)))
+				continue;
+
+			if (i2 > off)
+				i2 = i2 - old + n;
+
+			if (trailing && q->cp && !add_trail_cell(q, NULL, ctx, i))
+				return false;
+
+			make_indirect(&GET_SLOT(f, i)->c, tmp+i2, e->c.var_ctx);
+			f->is_active = true;
+		}
+	}
+
+	GET_FRAME(b_ctx)->is_active = true;
+	return true;
+}
+
+static bool do_setarg(query *q, bool trailing)
+{
+	GET_FIRST_ARG(p1,integer);
+	GET_NEXT_ARG(p2,compound);
+	GET_NEXT_ARG(p3,any);
+
+	if (is_negative(p1))
+		return throw_error(q, p1, p1_ctx, "domain_error", "not_less_than_zero");
+
+	if (is_string(p2))
+		return throw_error(q, p2, p2_ctx, "type_error", "compound");
+
+	if (is_bigint(p1))
+		return false;
+
+	pl_int_t arg_nbr = get_smallint(p1);
+
+	if ((arg_nbr == 0) || (arg_nbr > p2->arity))
+		return false;
+
+	cell *c = p2 + 1;
+
+	for (int i = 1; i < arg_nbr; i++)
+		c += c->nbr_cells;
+
+	// For setarg/3 a non-atomic value is bound to a new var in this
+	// frame and the arg refers to that. For nb_setarg/3 it's copied,
+	// as the binding would be undone on backtracking...
+
+	cell v1, *v = &v1;
+	pl_idx_t n = 1;
+
+	if (!trailing && has_vars(q, p3, p3_ctx)) {
+		return throw_error(q, p3, p3_ctx, "instantiation_error", "not_sufficiently_instantiated");
+	} else if (!trailing && (p3->nbr_cells > 1)) {
+		check_heap_error(init_tmp_heap(q));
+		v = deep_clone_to_tmp(q, p3, p3_ctx);
+		check_heap_error(v);
+		n = v->nbr_cells;
+
+		for (pl_idx_t i = 0; i < n; i++)
+			share_cell(v+i);
+	} else if (is_variable(p3) || (p3->nbr_cells > 1)) {
+		unsigned var_nbr;
+
+		if (!(var_nbr = create_vars(q, 1)))
+			return throw_error(q, p3, p3_ctx, "resource_error", "stack");
+
+		// The slots may have moved...
+
+		get_first_arg(q);
+		get_next_arg(q);
+		p3 = get_next_arg(q);
+		p3_ctx = q->latest_ctx;
+		cell tmp;
+		make_var(&tmp, g_anon_s, var_nbr);
+		set_var(q, &tmp, q->st.curr_frame, p3, p3_ctx);
+		make_ref(v, q->st.curr_frame, 0, var_nbr);
+		frame *f = GET_CURR_FRAME();
+		f->is_active = f->is_captured = true;
+	} else {
+		*v = *p3;
+		share_cell(v);
+	}
+
+	cell *heap = is_mutable(q, p2);
+
+	if (heap && (c->nbr_cells == 1) && (n == 1)) {
+		if (trailing && q->cp)
+			check_heap_error(add_trail_cell(q, c, 0, 0), unshare_cell(v));
+		else
+			unshare_cell(c);
+
+		*c = *v;
+
+		if (is_variable(v) && is_ground_term(p2))
+			clear_ground(heap, p2);
+
+		return true;
+	}
+
+	cell *b = outermost_term(q, p2, p2_ctx, heap != NULL);
+
+	check_heap_error(replace_arg(q, b, p2_ctx, heap != NULL, c, v, n, trailing),
+		for (pl_idx_t i = 0; i < n; i++) unshare_cell(v+i));
+	return true;
+}
+
+static bool fn_setarg_3(query *q)
+{
+	return do_setarg(q, true);
+}
+
+static bool fn_nb_setarg_3(query *q)
+{
+	return do_setarg(q, false);
+}
+
 static bool fn_iso_univ_2(query *q)
 {
 	GET_FIRST_ARG(p1,any);
@@ -2007,7 +2421,11 @@ static bool fn_term_singletons_2(query *q)
 	return unify(q, p2, p2_ctx, tmp2, q->st.curr_frame);
 }
 
-static bool fn_iso_copy_term_2(query *q)
+// A ground term isn't copied by copy_term/2 but shared, so a setarg/3
+// on the copy changes the original as well. A duplicate_term/2 always
+// makes a fresh copy...
+
+static bool do_copy_term(query *q, bool dup)
 {
 	GET_FIRST_ARG(p1,any);
 	GET_NEXT_ARG(p2,any);
@@ -2028,6 +2446,9 @@ static bool fn_iso_copy_term_2(query *q)
 			check_heap_error(tmp);
 			e2->c.attrs = tmp;
 			e2->c.attrs_ctx = q->st.curr_frame;
+
+			if (p2_ctx != q->st.curr_frame)
+				GET_CURR_FRAME()->is_captured = true;
 		}
 
 		return true;
@@ -2036,7 +2457,7 @@ static bool fn_iso_copy_term_2(query *q)
 	if (is_atomic(p1) && is_variable(p2))
 		return unify(q, p1, p1_ctx, p2, p2_ctx);
 
-	if (!is_variable(p2) && !has_vars(q, p1, p1_ctx))
+	if (!dup && (is_ground_term(p1) || (!is_variable(p2) && !has_vars(q, p1, p1_ctx))))
 		return unify(q, p1, p1_ctx, p2, p2_ctx);
 
 	GET_FIRST_RAW_ARG(p1_raw,any);
@@ -2053,6 +2474,16 @@ static bool fn_iso_copy_term_2(query *q)
 	return unify(q, p2, p2_ctx, tmp, q->st.curr_frame);
 }
 
+static bool fn_iso_copy_term_2(query *q)
+{
+	return do_copy_term(q, false);
+}
+
+static bool fn_duplicate_term_2(query *q)
+{
+	return do_copy_term(q, true);
+}
+
 static bool fn_copy_term_nat_2(query *q)
 {
 	GET_FIRST_ARG(p1,any);
@@ -2064,7 +2495,7 @@ static bool fn_copy_term_nat_2(query *q)
 	if (is_atomic(p1) && is_variable(p2))
 		return unify(q, p1, p1_ctx, p2, p2_ctx);
 
-	if (!is_variable(p2) && !has_vars(q, p1, p1_ctx))
+	if (is_ground_term(p1) || (!is_variable(p2) && !has_vars(q, p1, p1_ctx)))
 		return unify(q, p1, p1_ctx, p2, p2_ctx);
 
 	GET_FIRST_RAW_ARG(p1_raw,any);
@@ -2542,6 +2973,13 @@ static bool fn_iso_functor_3(query *q)
 		if (arity) {
 			if (!(var_nbr = create_vars(q, arity)))
 				return throw_error(q, p3, p3_ctx, "resource_error", "stack");
+
+			// The slots may have moved...
+
+			p1 = get_first_arg(q);
+			p1_ctx = q->latest_ctx;
+			p2 = get_next_arg(q);
+			p2_ctx = q->latest_ctx;
 		}
 
 		if (is_number(p2)) {
@@ -4026,7 +4464,7 @@ static bool fn_time_1(query *q)
 {
 	GET_FIRST_ARG(p1,callable);
 	fn_sys_timer_0(q);
-	cell *tmp = clone_to_heap(q, true, p1, 2);
+	cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 2);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_elapsed_s, fn_sys_elapsed_0, 0, 0);
 	make_return(q, tmp+nbr_cells);
@@ -4081,6 +4519,53 @@ static bool fn_statistics_2(query *q)
 		return unify(q, p2, p2_ctx, l, q->st.curr_frame);
 	}
 
+	// For each predicate called in last position: how often, how
+	// often its caller's frame was reused and how often that was
+	// refused because of choices left or the frame being in use...
+
+	if (!CMP_STR_CSTR(q, p1, "tco")) {
+		pl_idx_t tco_s = index_from_pool(q->pl, "tco");
+		check_heap_error(tco_s != ERR_IDX);
+		bool first = true;
+
+		for (module *m = q->pl->modules; m; m = m->next) {
+			for (predicate *pr = m->head; pr; pr = pr->next) {
+				if (!pr->tco_calls)
+					continue;
+
+				cell tmp[9];
+				make_struct(tmp, g_minus_s, NULL, 2, 8);
+				SET_OP(tmp, OP_YFX);
+				make_struct(tmp+1, g_slash_s, NULL, 2, 2);
+				SET_OP(tmp+1, OP_YFX);
+				make_atom(tmp+2, pr->key.val_off);
+				make_int(tmp+3, pr->key.arity);
+				make_struct(tmp+4, tco_s, NULL, 4, 4);
+				make_int(tmp+5, pr->tco_calls);
+				make_int(tmp+6, pr->tco_done);
+				make_int(tmp+7, pr->tco_choice);
+				make_int(tmp+8, pr->tco_frame);
+
+				if (first)
+					allocate_list(q, tmp);
+				else
+					append_list(q, tmp);
+
+				first = false;
+			}
+		}
+
+		if (first) {
+			cell tmp;
+			make_atom(&tmp, g_nil_s);
+			return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+		}
+
+		cell *l = end_list(q);
+		check_heap_error(l);
+		return unify(q, p2, p2_ctx, l, q->st.curr_frame);
+	}
+
 	return false;
 }
 
@@ -4225,8 +4710,8 @@ static bool fn_forall_2(query *q)
 	GET_FIRST_ARG(p1,callable);
 	GET_NEXT_ARG(p2,callable);
 	pl_idx_t off = heap_used(q);
-	check_heap_error(clone_to_heap(q, true, p1, 0));
-	check_heap_error(clone_to_heap(q, false, p2, 1));
+	check_heap_error(clone_to_heap(q, true, p1, q->st.curr_frame, 0));
+	check_heap_error(clone_to_heap(q, false, p2, q->st.curr_frame, 1));
 	cell *tmp = get_heap(q, off);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells + p2->nbr_cells;
 	make_struct(tmp+nbr_cells, g_fail_s, fn_iso_fail_0, 0, 0);
@@ -4273,7 +4758,7 @@ static bool fn_split_atom_4(query *q)
 			in_list = 1;
 		}
 
-		start = ptr + 1;
+		start = ptr + len_char_utf8(ptr);
 	}
 
 	if (*start) {
@@ -4792,13 +5277,13 @@ static bool fn_task_n(query *q)
 	cell *p0 = deep_clone_to_heap(q, q->st.curr_cell, q->st.curr_frame);
 	GET_FIRST_RAW_ARG0(p1,callable,p0);
 	check_heap_error(init_tmp_heap(q));
-	check_heap_error(clone_to_tmp(q, p1));
+	check_heap_error(clone_to_tmp(q, p1, q->st.curr_frame));
 	unsigned arity = p1->arity;
 	unsigned args = 1;
 
 	while (args++ < q->st.curr_cell->arity) {
 		GET_NEXT_RAW_ARG(p2,any);
-		check_heap_error(append_to_tmp(q, p2));
+		check_heap_error(append_to_tmp(q, p2, q->st.curr_frame));
 		arity++;
 	}
 
@@ -4814,7 +5299,7 @@ static bool fn_task_n(query *q)
 	}
 
 	q->st.hp = save_hp;
-	cell *tmp = clone_to_heap(q, false, tmp2, 0);
+	cell *tmp = clone_to_heap(q, false, tmp2, q->st.curr_frame, 0);
 	query *task = create_sub_query(q, tmp);
 	task->yielded = task->spawned = true;
 	push_task(q->st.m, task);
@@ -5570,6 +6055,7 @@ static bool fn_atomic_list_concat_3(query *q)
 	GET_NEXT_ARG(p3,atom_or_var);
 	LIST_HANDLER(p1);
 	ASTRING_alloc(pr,256);
+	cell *first = NULL;
 
 	while (is_list(p1)) {
 		cell *h = LIST_HEAD(p1);
@@ -5581,11 +6067,17 @@ static bool fn_atomic_list_concat_3(query *q)
 		if (!is_atomic(h))
 			return throw_error(q, h, q->latest_ctx, "type_error", "atomic");
 
-		q->parens = true;
-		char *dst = print_term_to_strbuf(q, h, q->latest_ctx, 1);
-		q->parens = false;
-		ASTRING_strcat(pr, dst);
-		free(dst);
+		// A long first text can be extended in place...
+
+		if (!first && !ASTRING_strlen(pr) && is_strbuf(h) && !is_string(h)) {
+			first = h;
+		} else {
+			q->parens = true;
+			char *dst = print_term_to_strbuf(q, h, q->latest_ctx, 1);
+			q->parens = false;
+			ASTRING_strcat(pr, dst);
+			free(dst);
+		}
 
 		p1 = LIST_TAIL(p1);
 		p1 = deref(q, p1, p1_ctx);
@@ -5593,7 +6085,7 @@ static bool fn_atomic_list_concat_3(query *q)
 
 		if (is_list(p1)) {
 			q->parens = true;
-			dst = print_term_to_strbuf(q, p2, p2_ctx, 1);
+			char *dst = print_term_to_strbuf(q, p2, p2_ctx, 1);
 			q->parens = false;
 			ASTRING_strcat(pr, dst);
 			free(dst);
@@ -5604,7 +6096,12 @@ static bool fn_atomic_list_concat_3(query *q)
 		return throw_error(q, p1, p1_ctx, "instantiation_error", "atomic_list_concat/3");
 
 	cell tmp;
-	check_heap_error(make_cstring(&tmp, ASTRING_cstr(pr)), ASTRING_free(pr));
+
+	if (first)
+		check_heap_error(make_concat(q, &tmp, first, ASTRING_cstr(pr), ASTRING_strlen(pr), false), ASTRING_free(pr));
+	else
+		check_heap_error(make_cstring(&tmp, ASTRING_cstr(pr)), ASTRING_free(pr));
+
 	ASTRING_free(pr);
 	bool ok = unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
 	unshare_cell(&tmp);
@@ -5948,7 +6445,7 @@ static bool fn_limit_2(query *q)
 {
 	GET_FIRST_ARG(p1,integer);
 	GET_NEXT_ARG(p2,callable);
-	cell *tmp = clone_to_heap(q, true, p2, 4);
+	cell *tmp = clone_to_heap(q, true, p2, p2_ctx, 4);
 	pl_idx_t nbr_cells = 1 + p2->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_fail_s, fn_sys_lt_2, 2, 2);
 	make_int(tmp+nbr_cells++, 1);
@@ -5976,7 +6473,7 @@ static bool fn_offset_2(query *q)
 {
 	GET_FIRST_ARG(p1,integer);
 	GET_NEXT_ARG(p2,callable);
-	cell *tmp = clone_to_heap(q, true, p2, 4);
+	cell *tmp = clone_to_heap(q, true, p2, p2_ctx, 4);
 	pl_idx_t nbr_cells = 1 + p2->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_fail_s, fn_sys_gt_2, 2, 2);
 	make_int(tmp+nbr_cells++, 1);
@@ -6026,7 +6523,7 @@ static bool fn_call_nth_2(query *q)
 		return throw_error(q, p1, p1_ctx, "type_error", "callable");
 
 	if (is_variable(p2)) {
-		cell *tmp = clone_to_heap(q, true, p1, 4);
+		cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 4);
 		pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 		make_struct(tmp+nbr_cells++, g_sys_incr_s, fn_sys_incr_2, 2, 2);
 		GET_RAW_ARG(2,p2_raw);
@@ -6038,7 +6535,7 @@ static bool fn_call_nth_2(query *q)
 		return true;
 	}
 
-	cell *tmp = clone_to_heap(q, true, p1, 4);
+	cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 4);
 	pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 	make_struct(tmp+nbr_cells++, g_sys_ne_s, fn_sys_ne_2, 2, 2);
 	make_int(tmp+nbr_cells++, 1);
@@ -6067,30 +6564,462 @@ static bool fn_sys_lengthchk_2(query *q)
 	return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
 }
 
-static bool fn_sys_unifiable_3(query *q)
+// Deterministic modes of some library(lists) predicates. These fail,
+// leaving the Prolog definitions to take over, if the list isn't a
+// proper list or the elements aren't what the fast path handles...
+
+static bool proper_list(query *q, cell *l, pl_idx_t l_ctx, pl_int_t *len, unsigned *nbr_vars)
 {
-	GET_FIRST_ARG(p1,any);
-	GET_NEXT_ARG(p2,any);
-	GET_NEXT_ARG(p3,list_or_nil_or_var);
-	check_heap_error(push_choice(q));
-	pl_idx_t before_hook_tp = q->st.tp;
-	bool save_hook = q->in_hook;
-	q->in_hook = true;
+	*len = 0;
+	*nbr_vars = 0;
 
-	if (!unify(q, p1, p1_ctx, p2, p2_ctx) && !q->cycle_error) {
-		q->in_hook = save_hook;
-		undo_me(q);
-		drop_choice(q);
-		return false;
+	while (is_iso_list(l)) {
+		CHECK_INTERRUPT();
+		cell *h = deref(q, l+1, l_ctx);
+
+		if (is_variable(h) || is_structure(h))
+			(*nbr_vars)++;
+
+		(*len)++;
+		l = deref(q, l+1+(l+1)->nbr_cells, l_ctx);
+		l_ctx = q->latest_ctx;
 	}
 
-	q->in_hook = save_hook;
-	bool first = true;
+	return is_nil(l);
+}
 
-	// Go thru trail, getting the bindings...
+// An element as a single cell in the current frame. Anything but an
+// atomic is bound to a new variable...
 
-	while (before_hook_tp < q->st.tp) {
-		const trail *tr = q->trails + before_hook_tp;
+static bool list_elem(query *q, cell *c, pl_idx_t c_ctx, unsigned *var_nbr, cell *tmp)
+{
+	if (!is_variable(c) && !is_structure(c)) {
+		*tmp = *c;
+		return true;
+	}
+
+	make_var(tmp, g_anon_s, (*var_nbr)++);
+	return unify(q, c, c_ctx, tmp, q->st.curr_frame);
+}
+
+static bool fn_sys_reverse_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	pl_int_t len;
+	unsigned nbr_vars;
+
+	if (!proper_list(q, p1, p1_ctx, &len, &nbr_vars))
+		return false;
+
+	if (!len) {
+		cell tmp;
+		make_atom(&tmp, g_nil_s);
+		return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+	}
+
+	unsigned var_nbr = 0;
+
+	if (nbr_vars && !(var_nbr = create_vars(q, nbr_vars)))
+		return false;
+
+	cell *elems = malloc(sizeof(cell) * len);
+	check_heap_error(elems);
+
+	for (pl_int_t i = len - 1; i >= 0; i--) {
+		cell *h = deref(q, p1+1, p1_ctx);
+		pl_idx_t h_ctx = q->latest_ctx;
+		list_elem(q, h, h_ctx, &var_nbr, &elems[i]);
+		p1 = deref(q, p1+1+(p1+1)->nbr_cells, p1_ctx);
+		p1_ctx = q->latest_ctx;
+	}
+
+	allocate_list(q, &elems[0]);
+
+	for (pl_int_t i = 1; i < len; i++)
+		append_list(q, &elems[i]);
+
+	free(elems);
+	cell *l = end_list(q);
+	check_heap_error(l);
+	return unify(q, p2, p2_ctx, l, q->st.curr_frame);
+}
+
+static bool fn_sys_append_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+	pl_int_t len;
+	unsigned nbr_vars;
+
+	if (!proper_list(q, p1, p1_ctx, &len, &nbr_vars))
+		return false;
+
+	if (!len)
+		return unify(q, p3, p3_ctx, p2, p2_ctx);
+
+	if (is_variable(p2) || is_structure(p2))
+		nbr_vars++;
+
+	unsigned var_nbr = 0;
+
+	if (nbr_vars && !(var_nbr = create_vars(q, nbr_vars)))
+		return false;
+
+	for (pl_int_t i = 0; i < len; i++) {
+		cell *h = deref(q, p1+1, p1_ctx);
+		pl_idx_t h_ctx = q->latest_ctx;
+		cell tmp;
+		list_elem(q, h, h_ctx, &var_nbr, &tmp);
+
+		if (!i)
+			allocate_list(q, &tmp);
+		else
+			append_list(q, &tmp);
+
+		p1 = deref(q, p1+1+(p1+1)->nbr_cells, p1_ctx);
+		p1_ctx = q->latest_ctx;
+	}
+
+	cell *l = end_list(q);
+	check_heap_error(l);
+	cell *tail = l + l->nbr_cells - 1;
+	list_elem(q, p2, p2_ctx, &var_nbr, tail);
+	share_cell(tail);
+	return unify(q, p3, p3_ctx, l, q->st.curr_frame);
+}
+
+// Unifies the tail with [] if the element was found, or with the rest
+// of the list if Prolog has to carry on from there: at a partial list,
+// or where unifying would wake attributed variables...
+
+static bool fn_sys_memberchk_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,variable);
+
+	while (is_iso_list(p2)) {
+		CHECK_INTERRUPT();
+		cell *h = deref(q, p2+1, p2_ctx);
+		pl_idx_t h_ctx = q->latest_ctx;
+		bool found = false;
+
+		if (!is_variable(p1) && !is_variable(h)
+			&& (!is_structure(p1) || !is_structure(h))) {
+			if (!compare(q, p1, p1_ctx, h, h_ctx))
+				found = true;
+		} else if (is_structure(p1) && is_structure(h)
+			&& ((p1->arity != h->arity) || (p1->val_off != h->val_off))) {
+			;
+		} else {
+			check_heap_error(push_choice(q));
+			bool save_run_hook = q->run_hook;
+			q->run_hook = false;
+			bool ok = unify(q, p1, p1_ctx, h, h_ctx);
+
+			if (ok && !q->run_hook) {
+				q->run_hook = save_run_hook;
+				drop_choice(q);
+				found = true;
+			} else {
+				undo_me(q);
+				drop_choice(q);
+				q->run_hook = save_run_hook;
+
+				if (ok)
+					break;
+			}
+		}
+
+		if (found) {
+			cell tmp;
+			make_atom(&tmp, g_nil_s);
+			return unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
+		}
+
+		p2 = deref(q, p2+1+(p2+1)->nbr_cells, p2_ctx);
+		p2_ctx = q->latest_ctx;
+	}
+
+	if (is_nil(p2))
+		return false;
+
+	return unify(q, p3, p3_ctx, p2, p2_ctx);
+}
+
+// Sums and products follow is/2: integers until the first float...
+
+typedef struct {
+	pl_int_t i;
+	double f;
+	bool is_float;
+} num_acc;
+
+static bool fold_list(query *q, cell *l, pl_idx_t l_ctx, num_acc *acc, char op)
+{
+	while (is_iso_list(l)) {
+		CHECK_INTERRUPT();
+		cell *h = deref(q, l+1, l_ctx);
+
+		if (is_smallint(h)) {
+			pl_int_t v = get_smallint(h);
+
+			if (acc->is_float)
+				acc->f = op == '+' ? acc->f + v : acc->f * v;
+			else if (op == '+' ? __builtin_add_overflow(acc->i, v, &acc->i) : __builtin_mul_overflow(acc->i, v, &acc->i))
+				return false;
+		} else if (is_float(h)) {
+			if (!acc->is_float) {
+				acc->f = acc->i;
+				acc->is_float = true;
+			}
+
+			acc->f = op == '+' ? acc->f + get_float(h) : acc->f * get_float(h);
+		} else
+			return false;
+
+		l = deref(q, l+1+(l+1)->nbr_cells, l_ctx);
+		l_ctx = q->latest_ctx;
+	}
+
+	return is_nil(l);
+}
+
+static bool unify_acc(query *q, cell *p, pl_idx_t p_ctx, const num_acc *acc)
+{
+	cell tmp;
+
+	if (acc->is_float)
+		make_float(&tmp, acc->f);
+	else
+		make_int(&tmp, acc->i);
+
+	return unify(q, p, p_ctx, &tmp, q->st.curr_frame);
+}
+
+static bool fn_sys_sum_list_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	num_acc acc = {0};
+
+	if (!fold_list(q, p1, p1_ctx, &acc, '+'))
+		return false;
+
+	return unify_acc(q, p2, p2_ctx, &acc);
+}
+
+static bool fn_sys_prod_list_2(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	num_acc acc = {.i = 1};
+
+	if (!fold_list(q, p1, p1_ctx, &acc, '*'))
+		return false;
+
+	return unify_acc(q, p2, p2_ctx, &acc);
+}
+
+// Only lists of all integers or all floats, so that the result is
+// the same element is/2 would pick...
+
+static bool extreme_list(query *q, bool max)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+
+	if (!is_iso_list(p1))
+		return false;
+
+	cell *best = deref(q, p1+1, p1_ctx);
+
+	if (!is_smallint(best) && !is_float(best))
+		return false;
+
+	bool ints = is_smallint(best);
+	p1 = deref(q, p1+1+(p1+1)->nbr_cells, p1_ctx);
+	p1_ctx = q->latest_ctx;
+
+	while (is_iso_list(p1)) {
+		CHECK_INTERRUPT();
+		cell *h = deref(q, p1+1, p1_ctx);
+
+		if (ints ? !is_smallint(h) : !is_float(h))
+			return false;
+
+		if (ints) {
+			if (max ? get_smallint(h) > get_smallint(best) : get_smallint(h) < get_smallint(best))
+				best = h;
+		} else if (max ? get_float(h) > get_float(best) : get_float(h) < get_float(best))
+			best = h;
+
+		p1 = deref(q, p1+1+(p1+1)->nbr_cells, p1_ctx);
+		p1_ctx = q->latest_ctx;
+	}
+
+	if (!is_nil(p1))
+		return false;
+
+	cell tmp = *best;
+	return unify(q, p2, p2_ctx, &tmp, q->st.curr_frame);
+}
+
+static bool fn_sys_max_list_2(query *q)
+{
+	return extreme_list(q, true);
+}
+
+static bool fn_sys_min_list_2(query *q)
+{
+	return extreme_list(q, false);
+}
+
+static bool fn_sys_numlist_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,any);
+
+	if (!is_smallint(p1) || !is_smallint(p2) || (get_smallint(p1) > get_smallint(p2)))
+		return false;
+
+	pl_int_t lo = get_smallint(p1), hi = get_smallint(p2);
+	cell tmp;
+	make_int(&tmp, lo);
+	allocate_list(q, &tmp);
+
+	while (lo++ < hi) {
+		CHECK_INTERRUPT();
+		make_int(&tmp, lo);
+		append_list(q, &tmp);
+	}
+
+	cell *l = end_list(q);
+	check_heap_error(l);
+	return unify(q, p3, p3_ctx, l, q->st.curr_frame);
+}
+
+// The library(apply) predicates try these first. With a known closure
+// they unify the last arg with a call to its auxiliary predicate, the
+// args being the lists etc. followed by the closure's own...
+
+static void apply_arg(query *q, cell *c, pl_idx_t c_ctx, unsigned *var_nbr, cell *tmp)
+{
+	c = deref(q, c, c_ctx);
+	c_ctx = q->latest_ctx;
+
+	if (!is_managed(c)) {
+		list_elem(q, c, c_ctx, var_nbr, tmp);
+		return;
+	}
+
+	make_var(tmp, g_anon_s, (*var_nbr)++);
+	unify(q, c, c_ctx, tmp, q->st.curr_frame);
+}
+
+// A closure qualified with a module, as in maplist(m:inc, ..), has its
+// auxiliary made and called in that module. Otherwise it's the module
+// that call/N would use...
+
+static cell *apply_closure(query *q, pl_idx_t *c_ctx, module **m)
+{
+	cell *c = deref(q, get_raw_arg(q, 1), q->st.curr_frame);
+	*c_ctx = q->latest_ctx;
+	*m = q->st.m;
+
+	if (!is_interned(c) || (c->arity != 2) || (c->val_off != g_pair_s))
+		return c;
+
+	cell *c1 = deref(q, c+1, *c_ctx);
+
+	if (!is_atom(c1) || !(*m = find_module(q->pl, C_STR(q, c1))))
+		return NULL;
+
+	c1 = c + 1;
+	c = deref(q, c1+c1->nbr_cells, *c_ctx);
+	*c_ctx = q->latest_ctx;
+	return c;
+}
+
+static bool fn_sys_apply_aux(query *q)
+{
+	const cell *c = q->st.curr_cell;
+	pl_idx_t p1_ctx;
+	module *m;
+	cell *p1 = apply_closure(q, &p1_ctx, &m);
+
+	if (!p1 || !is_callable(p1))
+		return false;
+
+	pl_idx_t aux;
+
+	if (!apply_specialize(m, C_STR(q, c)+1, c->arity-1, C_STR(q, p1), p1->arity, &aux))
+		return false;
+
+	unsigned nbr_args = c->arity - 2 + p1->arity;
+	unsigned var_nbr = create_vars(q, nbr_args);
+
+	if (!var_nbr)
+		return false;
+
+	// Slots may have moved, so get the args again...
+
+	p1 = apply_closure(q, &p1_ctx, &m);
+	bool qualified = m != q->st.m;
+	cell *tmp = alloc_on_heap(q, (qualified?2:0)+1+nbr_args);
+	check_heap_error(tmp);
+	cell *goal = tmp;
+
+	if (qualified) {
+		make_struct(tmp, g_pair_s, fn_iso_invoke_2, 2, 2+nbr_args);
+		make_atom(tmp+1, index_from_pool(q->pl, m->name));
+		goal = tmp + 2;
+	}
+
+	make_struct(goal, aux, NULL, nbr_args, nbr_args);
+	cell *arg = get_raw_arg(q, 2);
+	unsigned i = 1;
+
+	for (unsigned j = 2; j < c->arity; j++, arg += arg->nbr_cells)
+		apply_arg(q, arg, q->st.curr_frame, &var_nbr, &goal[i++]);
+
+	arg = p1 + 1;
+
+	for (unsigned j = 0; j < p1->arity; j++, arg += arg->nbr_cells)
+		apply_arg(q, arg, p1_ctx, &var_nbr, &goal[i++]);
+
+	cell *p2 = deref(q, get_raw_arg(q, c->arity), q->st.curr_frame);
+	pl_idx_t p2_ctx = q->latest_ctx;
+	return unify(q, p2, p2_ctx, tmp, q->st.curr_frame);
+}
+
+static bool fn_sys_unifiable_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,list_or_nil_or_var);
+	check_heap_error(push_choice(q));
+	pl_idx_t before_hook_tp = q->st.tp;
+	bool save_hook = q->in_hook;
+	q->in_hook = true;
+
+	if (!unify(q, p1, p1_ctx, p2, p2_ctx) && !q->cycle_error) {
+		q->in_hook = save_hook;
+		undo_me(q);
+		drop_choice(q);
+		return false;
+	}
+
+	q->in_hook = save_hook;
+	bool first = true;
+
+	// Go thru trail, getting the bindings...
+
+	while (before_hook_tp < q->st.tp) {
+		const trail *tr = q->trails + before_hook_tp;
 		const frame *f = GET_FRAME(tr->var_ctx);
 		slot *e = GET_SLOT(f, tr->var_nbr);
 		cell *c = deref(q, &e->c, e->c.var_ctx);
@@ -6124,6 +7053,64 @@ static bool fn_sys_unifiable_3(query *q)
 	return unify(q, p3, p3_ctx, l, q->st.curr_frame);
 }
 
+// If X == Y then fail, if X \= Y then Vs = [], otherwise Vs is the
+// list of vars in their unifier, those that dif/2 must watch...
+
+static bool fn_sys_dif_3(query *q)
+{
+	GET_FIRST_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	GET_NEXT_ARG(p3,variable);
+	check_heap_error(push_choice(q));
+	pl_idx_t before_tp = q->st.tp;
+	bool save_hook = q->in_hook, save_run_hook = q->run_hook;
+	q->in_hook = true;
+	bool ok = unify(q, p1, p1_ctx, p2, p2_ctx);
+	q->in_hook = save_hook;
+	q->run_hook = save_run_hook;
+
+	if (ok && (before_tp == q->st.tp)) {
+		undo_me(q);
+		drop_choice(q);
+		return false;
+	}
+
+	bool first = true;
+
+	while (ok && (before_tp < q->st.tp)) {
+		const trail *tr = q->trails + before_tp++;
+		const frame *f = GET_FRAME(tr->var_ctx);
+		const slot *e = GET_SLOT(f, tr->var_nbr);
+		cell v;
+		make_ref(&v, tr->var_ctx, 0, tr->var_nbr);
+
+		if (first) {
+			allocate_list(q, &v);
+			first = false;
+		} else
+			append_list(q, &v);
+
+		if (!is_variable(&e->c))
+			continue;
+
+		make_ref(&v, e->c.var_ctx, 0, e->c.var_nbr);
+		append_list(q, &v);
+	}
+
+	undo_me(q);
+	drop_choice(q);
+
+	if (first) {
+		cell tmp;
+		make_atom(&tmp, g_nil_s);
+		return unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
+	}
+
+	cell *l = end_list(q);
+	check_heap_error(l);
+	return unify(q, p3, p3_ctx, l, q->st.curr_frame);
+}
+
 static bool fn_sys_list_attributed_1(query *q)
 {
 	GET_FIRST_ARG(p1,variable);
@@ -6180,6 +7167,10 @@ static bool fn_sys_put_attributes_2(query *q)
 	slot *e = GET_SLOT(f, p1->var_nbr);
 	e->c.attrs = p2;
 	e->c.attrs_ctx = p2_ctx;
+
+	if (p1_ctx != p2_ctx)
+		GET_FRAME(p2_ctx)->is_captured = true;
+
 	return true;
 }
 
@@ -6203,7 +7194,7 @@ static bool fn_get_unbuffered_code_1(query *q)
 {
 	GET_FIRST_ARG(p1,integer_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (is_integer(p1) && (get_int(p1) < -1))
 		return throw_error(q, p1, p1_ctx, "representation_error", "in_character_code");
@@ -6260,7 +7251,7 @@ static bool fn_get_unbuffered_char_1(query *q)
 {
 	GET_FIRST_ARG(p1,in_character_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (is_integer(p1) && (get_int(p1) < -1))
 		return throw_error(q, p1, p1_ctx, "representation_error", "in_character_code");
@@ -6726,7 +7717,7 @@ static bool fn_sys_register_cleanup_1(query *q)
 {
 	if (q->retry) {
 		GET_FIRST_ARG(p1,callable);
-		cell *tmp = clone_to_heap(q, true, p1, 3);
+		cell *tmp = clone_to_heap(q, true, p1, p1_ctx, 3);
 		pl_idx_t nbr_cells = 1 + p1->nbr_cells;
 		make_struct(tmp+nbr_cells++, g_cut_s, fn_sys_inner_cut_0, 0, 0);
 		make_struct(tmp+nbr_cells++, g_fail_s, fn_iso_fail_0, 0, 0);
@@ -6909,6 +7900,33 @@ static void load_properties(module *m)
 		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "native_code"); ASTRING_strcat(pr, tmpbuf);
 	}
 
+	for (const builtins *ptr = g_dict_bifs; ptr->name; ptr++) {
+		map_app(m->pl->biftab, ptr->name, ptr);
+		if (ptr->name[0] == '$') continue;
+		if (ptr->function) continue;
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "built_in"); ASTRING_strcat(pr, tmpbuf);
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "static"); ASTRING_strcat(pr, tmpbuf);
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "native_code"); ASTRING_strcat(pr, tmpbuf);
+	}
+
+	for (const builtins *ptr = g_assoc_bifs; ptr->name; ptr++) {
+		map_app(m->pl->biftab, ptr->name, ptr);
+		if (ptr->name[0] == '$') continue;
+		if (ptr->function) continue;
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "built_in"); ASTRING_strcat(pr, tmpbuf);
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "static"); ASTRING_strcat(pr, tmpbuf);
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "native_code"); ASTRING_strcat(pr, tmpbuf);
+	}
+
+	for (const builtins *ptr = g_array_bifs; ptr->name; ptr++) {
+		map_app(m->pl->biftab, ptr->name, ptr);
+		if (ptr->name[0] == '$') continue;
+		if (ptr->function) continue;
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "built_in"); ASTRING_strcat(pr, tmpbuf);
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "static"); ASTRING_strcat(pr, tmpbuf);
+		format_property(m, tmpbuf, sizeof(tmpbuf), ptr->name, ptr->arity, "native_code"); ASTRING_strcat(pr, tmpbuf);
+	}
+
 	for (const builtins *ptr = g_ffi_bifs; ptr->name; ptr++) {
 		map_app(m->pl->biftab, ptr->name, ptr);
 		if (ptr->name[0] == '$') continue;
@@ -7202,6 +8220,8 @@ builtins g_other_bifs[] =
 	{"abolish", 2, fn_abolish_2, NULL, false, BLAH},
 	{"assert", 1, fn_iso_assertz_1, NULL, false, BLAH},
 	{"copy_term_nat", 2, fn_copy_term_nat_2, NULL, false, BLAH},
+	{"setarg", 3, fn_setarg_3, "+integer,+compound,+term", false, BLAH},
+	{"nb_setarg", 3, fn_nb_setarg_3, "+integer,+compound,+atomic", false, BLAH},
 	{"string", 1, fn_atom_1, "+term", false, BLAH},
 	{"atomic_concat", 3, fn_atomic_concat_3, NULL, false, BLAH},
 	{"atomic_list_concat", 3, fn_atomic_list_concat_3, NULL, false, BLAH},
@@ -7216,6 +8236,7 @@ builtins g_other_bifs[] =
 	{"date_time", 7, fn_date_time_7, "-yyyy,-m,-d,-h,--m,-s,-ms", false, BLAH},
 	{"split_atom", 4, fn_split_atom_4, "+string,+sep,+pad,-list", false, BLAH},
 	{"split_string", 4, fn_split_atom_4, "+string,+sep,+pad,-list", false, BLAH},
+	{"sub_string", 5, fn_iso_sub_atom_5, "+string,?integer,?integer,?integer,?string", false, BLAH},
 	{"split", 4, fn_split_4, "+string,+string,?left,?right", false, BLAH},
 	{"is_list_or_partial_list", 1, fn_is_list_or_partial_list_1, "+term", false, BLAH},
 	{"is_partial_list", 1, fn_is_partial_list_1, "+term", false, BLAH},
@@ -7248,7 +8269,7 @@ builtins g_other_bifs[] =
 	{"unsetenv", 1, fn_unsetenv_1, NULL, false, BLAH},
 	{"statistics", 0, fn_statistics_0, NULL, false, BLAH},
 	{"statistics", 2, fn_statistics_2, "+string,-variable", false, BLAH},
-	{"duplicate_term", 2, fn_iso_copy_term_2, "+term,-variable", false, BLAH},
+	{"duplicate_term", 2, fn_duplicate_term_2, "+term,-variable", false, BLAH},
 	{"call_nth", 2, fn_call_nth_2, "+callable,+integer", false, BLAH},
 	{"limit", 2, fn_limit_2, "+integer,+callable", false, BLAH},
 	{"offset", 2, fn_offset_2, "+integer,+callable", false, BLAH},
@@ -7266,6 +8287,27 @@ builtins g_other_bifs[] =
 	{"$get_level", 1, fn_sys_get_level_1, "-var", false, BLAH},
 	{"$is_partial_string", 1, fn_sys_is_partial_string_1, "+string", false, BLAH},
 	{"$lengthchk", 2, fn_sys_lengthchk_2, NULL, false, BLAH},
+	{"$reverse", 2, fn_sys_reverse_2, NULL, false, BLAH},
+	{"$append", 3, fn_sys_append_3, NULL, false, BLAH},
+	{"$memberchk", 3, fn_sys_memberchk_3, NULL, false, BLAH},
+	{"$sum_list", 2, fn_sys_sum_list_2, NULL, false, BLAH},
+	{"$prod_list", 2, fn_sys_prod_list_2, NULL, false, BLAH},
+	{"$max_list", 2, fn_sys_max_list_2, NULL, false, BLAH},
+	{"$min_list", 2, fn_sys_min_list_2, NULL, false, BLAH},
+	{"$numlist", 3, fn_sys_numlist_3, NULL, false, BLAH},
+	{"$maplist", 3, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$maplist", 4, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$maplist", 5, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$maplist", 6, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$maplist", 7, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$maplist", 8, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$maplist", 9, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$foldl", 5, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$foldl", 6, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$foldl", 7, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$foldl", 8, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$include", 4, fn_sys_apply_aux, NULL, false, BLAH},
+	{"$exclude", 4, fn_sys_apply_aux, NULL, false, BLAH},
 	{"$undo_trail", 1, fn_sys_undo_trail_1, NULL, false, BLAH},
 	{"$redo_trail", 0, fn_sys_redo_trail_0, NULL, false, BLAH},
 	{"between", 3, fn_between_3, "+integer,+integer,-integer", false, BLAH},
@@ -7280,6 +8322,7 @@ builtins g_other_bifs[] =
 	{"$alarm", 1, fn_sys_alarm_1, "+integer", false, BLAH},
 	{"$put_attributes", 2, fn_sys_put_attributes_2, "+variable,+list", false, BLAH},
 	{"$get_attributes", 2, fn_sys_get_attributes_2, "+variable,-list", false, BLAH},
+	{"$dif", 3, fn_sys_dif_3, "+term,+term,-list", false, BLAH},
 	{"$erase_attributes", 1, fn_sys_erase_attributes_1, "+variable", false, BLAH},
 	{"$list_attributed", 1, fn_sys_list_attributed_1, "-list", false, BLAH},
 	{"$dump_keys", 1, fn_sys_dump_keys_1, "+pi", false, BLAH},
@@ -377,6 +377,19 @@ ssize_t print_canonical_to_buf(query *q, char *dst, size_t dstlen, cell *c, pl_i
 	}
 #endif
 
+	if (is_dict(c)) {
+		cell *tmp = dict_to_term(q, c);
+		if (!tmp) return -1;
+		ssize_t res = print_canonical_to_buf(q, dst, dstlen, tmp, c_ctx, running, false, depth+1);
+		free(tmp);
+		return res;
+	}
+
+	if (is_array(c)) {
+		dst += snprintf(dst, dstlen, "'$array'(%zu)", array_count(c));
+		return dst - save_dst;
+	}
+
 	if (is_bigint(c)) {
 		int radix = 10;
 
@@ -850,6 +863,20 @@ ssize_t print_term_to_buf(query *q, char *dst, size_t dstlen, cell *c, pl_idx_t
 	}
 #endif
 
+	if (is_dict(c)) {
+		cell *tmp = dict_to_term(q, c);
+		if (!tmp) return -1;
+		ssize_t res = print_term_to_buf(q, dst, dstlen, tmp, c_ctx, running, false, depth+1);
+		free(tmp);
+		return res;
+	}
+
+	if (is_array(c)) {
+		dst += snprintf(dst, dstlen, "'$array'(%zu)", array_count(c));
+		q->last_thing_was_symbol = false;
+		return dst - save_dst;
+	}
+
 	if (is_bigint(c)) {
 		int radix = 10;
 
@@ -21,7 +21,7 @@ pl_idx_t g_conjunction_s, g_disjunction_s, g_at_s, g_sys_ne_s, g_sys_incr_s;
 pl_idx_t g_dcg_s, g_throw_s, g_sys_block_catcher_s, g_sys_drop_barrier;
 pl_idx_t g_sys_soft_cut_s, g_if_then_s, g_soft_cut_s, g_negation_s;
 pl_idx_t g_error_s, g_slash_s, g_sys_cleanup_if_det_s, g_sys_table_s;
-pl_idx_t g_goal_expansion_s;
+pl_idx_t g_goal_expansion_s, g_frozen_s, g_dif_s, g_when_s;
 
 unsigned g_cpu_count = 4;
 char *g_tpl_lib = NULL;
@@ -152,54 +152,117 @@ static void keyvalfree(const void *key, const void *val, const void *p)
 	free((void*)val);
 }
 
+// Builtins are found by open addressing on a hash of name and arity.
+// The first one added wins, as it would in a search of the biftab...
+
+static unsigned bif_hash(const char *name, unsigned arity)
+{
+	unsigned h = 2166136261U;
+
+	while (*name)
+		h = (h ^ (unsigned char)*name++) * 16777619U;
+
+	return (h ^ arity) * 16777619U;
+}
+
+static void add_builtin(prolog *pl, const builtins *ptr)
+{
+	map_app(pl->biftab, ptr->name, ptr);
+	unsigned i = bif_hash(ptr->name, ptr->arity);
+
+	for (unsigned n = 0; n < MAX_BIF_HASH; n++, i++) {
+		const builtins **slot = &pl->bif_hash[i & (MAX_BIF_HASH-1)];
+
+		if (!*slot) {
+			*slot = ptr;
+			return;
+		}
+
+		if (((*slot)->arity == ptr->arity) && !strcmp((*slot)->name, ptr->name))
+			return;
+	}
+}
+
 builtins *get_builtin(prolog *pl, const char *name, unsigned arity, bool *found, bool *function)
 {
-	miter *iter = map_find_key(pl->biftab, name);
-	builtins *ptr;
+	unsigned i = bif_hash(name, arity);
+
+	for (unsigned n = 0; n < MAX_BIF_HASH; n++, i++) {
+		const builtins *ptr = pl->bif_hash[i & (MAX_BIF_HASH-1)];
 
-	while (map_next_key(iter, (void**)&ptr)) {
-		if (ptr->arity == arity) {
+		if (!ptr)
+			break;
+
+		if ((ptr->arity == arity) && !strcmp(ptr->name, name)) {
 			if (found) *found = true;
 			if (function) *function = ptr->function;
-			map_done(iter);
-			return ptr;
+			return (builtins*)ptr;
 		}
 	}
 
 	if (found) *found = false;
 	if (function) *function = false;
-	map_done(iter);
 	return NULL;
 }
 
-builtins *get_fn_ptr(void *fn)
+// And by function, as make_struct wants for every call/N...
+
+static builtins *g_fn_hash[MAX_BIF_HASH];
+
+static unsigned fn_hash(const void *fn)
 {
-	for (builtins *ptr = g_iso_bifs; ptr->name; ptr++) {
-		if (ptr->fn == fn)
-			return ptr;
-	}
+	uint64_t h = (uint64_t)(size_t)fn * 0x9E3779B97F4A7C15ULL;
+	return h >> 40;
+}
 
-	for (builtins *ptr = g_functions_bifs; ptr->name; ptr++) {
-		if (ptr->fn == fn)
-			return ptr;
-	}
+static void add_fn_ptrs(builtins *ptr)
+{
+	for (; ptr->name; ptr++) {
+		unsigned i = fn_hash(ptr->fn);
 
-	for (builtins *ptr = g_other_bifs; ptr->name; ptr++) {
-		if (ptr->fn == fn)
-			return ptr;
-	}
+		for (unsigned n = 0; n < MAX_BIF_HASH; n++, i++) {
+			builtins **slot = &g_fn_hash[i & (MAX_BIF_HASH-1)];
 
-	for (builtins *ptr = g_files_bifs; ptr->name; ptr++) {
-		if (ptr->fn == fn)
-			return ptr;
-	}
+			if (!*slot) {
+				*slot = ptr;
+				break;
+			}
 
-	for (builtins *ptr = g_ffi_bifs; ptr->name; ptr++) {
-		if (ptr->fn == fn)
-			return ptr;
+			if ((*slot)->fn == ptr->fn)
+				break;
+		}
 	}
+}
+
+static void load_fn_ptrs(void)
+{
+	static bool s_done = false;
+
+	if (s_done)
+		return;
+
+	add_fn_ptrs(g_iso_bifs);
+	add_fn_ptrs(g_functions_bifs);
+	add_fn_ptrs(g_other_bifs);
+	add_fn_ptrs(g_files_bifs);
+	add_fn_ptrs(g_dict_bifs);
+	add_fn_ptrs(g_assoc_bifs);
+	add_fn_ptrs(g_array_bifs);
+	add_fn_ptrs(g_ffi_bifs);
+	add_fn_ptrs(g_contrib_bifs);
+	s_done = true;
+}
+
+builtins *get_fn_ptr(void *fn)
+{
+	unsigned i = fn_hash(fn);
+
+	for (unsigned n = 0; n < MAX_BIF_HASH; n++, i++) {
+		builtins *ptr = g_fn_hash[i & (MAX_BIF_HASH-1)];
+
+		if (!ptr)
+			break;
 
-	for (builtins *ptr = g_contrib_bifs; ptr->name; ptr++) {
 		if (ptr->fn == fn)
 			return ptr;
 	}
@@ -209,10 +272,15 @@ builtins *get_fn_ptr(void *fn)
 
 static int max_ffi_idx = 0;
 
-void register_ffi(prolog *pl, const char *name, unsigned arity, void *fn, uint8_t *types, uint8_t ret_type, bool function)
+// The name is copied, it would otherwise point into the atom pool
+// and that moves when it grows...
+
+builtins *register_ffi(prolog *pl, const char *name, unsigned arity, void *fn, uint8_t *types, uint8_t ret_type, bool function)
 {
+	char *name2 = strdup(name);
+	if (!name2) return NULL;
 	builtins *ptr = &g_ffi_bifs[max_ffi_idx++];
-	ptr->name = name;
+	ptr->name = name2;
 	ptr->arity = arity;
 	ptr->fn = fn;
 	ptr->help = NULL;
@@ -223,34 +291,49 @@ void register_ffi(prolog *pl, const char *name, unsigned arity, void *fn, uint8_
 		ptr->types[i] = types[i];
 
 	ptr->ret_type = ret_type;
-	map_app(pl->biftab, ptr->name, ptr);
+	add_builtin(pl, ptr);
+	return ptr;
 }
 
 void load_builtins(prolog *pl)
 {
+	load_fn_ptrs();
+
 	for (const builtins *ptr = g_iso_bifs; ptr->name; ptr++) {
-		map_app(pl->biftab, ptr->name, ptr);
+		add_builtin(pl, ptr);
 	}
 
 	for (const builtins *ptr = g_functions_bifs; ptr->name; ptr++) {
-		map_app(pl->biftab, ptr->name, ptr);
+		add_builtin(pl, ptr);
 		max_ffi_idx++;
 	}
 
 	for (const builtins *ptr = g_other_bifs; ptr->name; ptr++) {
-		map_app(pl->biftab, ptr->name, ptr);
+		add_builtin(pl, ptr);
 	}
 
 	for (const builtins *ptr = g_files_bifs; ptr->name; ptr++) {
-		map_app(pl->biftab, ptr->name, ptr);
+		add_builtin(pl, ptr);
+	}
+
+	for (const builtins *ptr = g_dict_bifs; ptr->name; ptr++) {
+		add_builtin(pl, ptr);
+	}
+
+	for (const builtins *ptr = g_assoc_bifs; ptr->name; ptr++) {
+		add_builtin(pl, ptr);
+	}
+
+	for (const builtins *ptr = g_array_bifs; ptr->name; ptr++) {
+		add_builtin(pl, ptr);
 	}
 
 	for (const builtins *ptr = g_ffi_bifs; ptr->name; ptr++) {
-		map_app(pl->biftab, ptr->name, ptr);
+		add_builtin(pl, ptr);
 	}
 
 	for (const builtins *ptr = g_contrib_bifs; ptr->name; ptr++) {
-		map_app(pl->biftab, ptr->name, ptr);
+		add_builtin(pl, ptr);
 	}
 }
 
@@ -274,6 +357,7 @@ void pl_destroy(prolog *pl)
 	while (pl->modules)
 		destroy_module(pl->modules);
 
+	clear_format_cache(pl);
 	map_destroy(pl->biftab);
 	map_destroy(pl->symtab);
 	map_destroy(pl->keyval);
@@ -284,8 +368,8 @@ void pl_destroy(prolog *pl)
 	if (!--g_tpl_count)
 		g_destroy();
 
-	for (int i = 0; i < MAX_STREAMS; i++) {
-		stream *str = &pl->streams[i];
+	for (unsigned i = 0; i < pl->nbr_streams; i++) {
+		stream *str = pl->streams[i];
 
 		if (str->fp) {
 			if ((str->fp != stdin)
@@ -301,10 +385,13 @@ void pl_destroy(prolog *pl)
 			free(str->name);
 			free(str->data);
 		}
-	}
 
-	memset(pl->streams, 0, sizeof(pl->streams));
+		free(str->srcbuf);
+		free(str);
+	}
 
+	free(pl->streams);
+	free(pl->free_streams);
 	free(pl);
 }
 
@@ -383,6 +470,9 @@ prolog *pl_create()
 	CHECK_SENTINEL(g_error_s = index_from_pool(pl, "error"), ERR_IDX);
 	CHECK_SENTINEL(g_slash_s = index_from_pool(pl, "/"), ERR_IDX);
 	CHECK_SENTINEL(g_goal_expansion_s = index_from_pool(pl, "goal_expansion"), ERR_IDX);
+	CHECK_SENTINEL(g_frozen_s = index_from_pool(pl, "frozen"), ERR_IDX);
+	CHECK_SENTINEL(g_dif_s = index_from_pool(pl, "dif"), ERR_IDX);
+	CHECK_SENTINEL(g_when_s = index_from_pool(pl, "when"), ERR_IDX);
 
 	CHECK_SENTINEL(g_sys_elapsed_s = index_from_pool(pl, "$elapsed"), ERR_IDX);
 	CHECK_SENTINEL(g_sys_queue_s = index_from_pool(pl, "$queue"), ERR_IDX);
@@ -401,25 +491,32 @@ prolog *pl_create()
 	if (error)
 		return NULL;
 
-	pl->streams[0].fp = stdin;
-	CHECK_SENTINEL(pl->streams[0].filename = strdup("stdin"), NULL);
-	CHECK_SENTINEL(pl->streams[0].name = strdup("user_input"), NULL);
-	CHECK_SENTINEL(pl->streams[0].mode = strdup("read"), NULL);
-	pl->streams[0].eof_action = eof_action_reset;
-
-	pl->streams[1].fp = stdout;
-	CHECK_SENTINEL(pl->streams[1].filename = strdup("stdout"), NULL);
-	CHECK_SENTINEL(pl->streams[1].name = strdup("user_output"), NULL);
-	CHECK_SENTINEL(pl->streams[1].mode = strdup("append"), NULL);
-	pl->streams[1].eof_action = eof_action_reset;
-
-	pl->streams[2].fp = stderr;
-	CHECK_SENTINEL(pl->streams[2].filename = strdup("stderr"), NULL);
-	CHECK_SENTINEL(pl->streams[2].name = strdup("user_error"), NULL);
-	CHECK_SENTINEL(pl->streams[2].mode = strdup("append"), NULL);
-	pl->streams[2].eof_action = eof_action_reset;
-
-	pl->streams[3].ignore = true;;
+	// Streams 0-3 are reserved...
+
+	for (int i = 0; i < 4; i++) {
+		if (new_stream(pl) < 0)
+			return NULL;
+	}
+
+	pl->streams[0]->fp = stdin;
+	CHECK_SENTINEL(pl->streams[0]->filename = strdup("stdin"), NULL);
+	CHECK_SENTINEL(pl->streams[0]->name = strdup("user_input"), NULL);
+	CHECK_SENTINEL(pl->streams[0]->mode = strdup("read"), NULL);
+	pl->streams[0]->eof_action = eof_action_reset;
+
+	pl->streams[1]->fp = stdout;
+	CHECK_SENTINEL(pl->streams[1]->filename = strdup("stdout"), NULL);
+	CHECK_SENTINEL(pl->streams[1]->name = strdup("user_output"), NULL);
+	CHECK_SENTINEL(pl->streams[1]->mode = strdup("append"), NULL);
+	pl->streams[1]->eof_action = eof_action_reset;
+
+	pl->streams[2]->fp = stderr;
+	CHECK_SENTINEL(pl->streams[2]->filename = strdup("stderr"), NULL);
+	CHECK_SENTINEL(pl->streams[2]->name = strdup("user_error"), NULL);
+	CHECK_SENTINEL(pl->streams[2]->mode = strdup("append"), NULL);
+	pl->streams[2]->eof_action = eof_action_reset;
+
+	pl->streams[3]->ignore = true;
 
 	pl->biftab = map_create((void*)fake_strcmp, NULL, NULL);
 	map_allow_dups(pl->biftab, false);
@@ -12,7 +12,7 @@ void load_builtins(prolog *pl);
 void uuid_gen(prolog *pl, uuid *u);
 
 #if USE_FFI
-void register_ffi(prolog *pl, const char *name, unsigned arity, void *fn, uint8_t *types, uint8_t ret_type, bool function);
+builtins *register_ffi(prolog *pl, const char *name, unsigned arity, void *fn, uint8_t *types, uint8_t ret_type, bool function);
 #endif
 
 extern pl_idx_t g_empty_s, g_pair_s, g_dot_s, g_cut_s, g_nil_s, g_true_s, g_fail_s;
@@ -26,6 +26,9 @@ extern pl_idx_t g_sys_soft_cut_s, g_if_then_s, g_soft_cut_s, g_negation_s;
 extern pl_idx_t g_error_s, g_slash_s, g_sys_cleanup_if_det_s, g_sys_table_s;
 extern pl_idx_t g_goal_expansion_s;
 extern void convert_path(char *filename);
+extern int new_stream(prolog *pl);
+extern char *map_file(int fd, size_t *len);
+extern void unmap_file(char *addr, size_t len);
 
 extern void sigfn(int s);
 
@@ -34,5 +37,8 @@ extern builtins g_ffi_bifs[];
 extern builtins g_other_bifs[];
 extern builtins g_contrib_bifs[];
 extern builtins g_files_bifs[];
+extern builtins g_dict_bifs[];
+extern builtins g_assoc_bifs[];
+extern builtins g_array_bifs[];
 extern builtins g_functions_bifs[];
 
@@ -52,6 +52,18 @@ static bool any_choices(const query *q, const frame *f)
 	return ch->cgen > f->cgen;
 }
 
+// A barrier taken on the frame itself means a meta-call, say \+/1
+// or call/1, is running a goal in it and wants the frame back...
+
+static bool in_call(const query *q, const frame *f)
+{
+	if (q->cp == (unsigned)(q->in_commit ? 1 : 0))
+		return false;
+
+	const choice *ch = q->in_commit ? GET_PREV_CHOICE() : GET_CURR_CHOICE();
+	return ch->barrier && (ch->cgen == f->cgen);
+}
+
 void dump_term(query *q, const char *s, const cell *c)
 {
 	unsigned nbr_cells = c->nbr_cells;
@@ -303,10 +315,21 @@ char *chars_list_to_string(query *q, cell *p_chars, pl_idx_t p_chars_ctx, size_t
 	return tmp;
 }
 
+// Big args aren't scanned: a long list (say from findall/3) would
+// otherwise be rescanned on every call that walks down it...
+
+#define MAX_GROUND_SCAN 64
+
 static bool is_ground(const cell *c)
 {
+	if (is_ground_term(c))
+		return true;
+
 	pl_idx_t nbr_cells = c->nbr_cells;
 
+	if (nbr_cells > MAX_GROUND_SCAN)
+		return false;
+
 	for (pl_idx_t i = 0; i < nbr_cells; i++, c++) {
 		if (is_variable(c))
 			return false;
@@ -623,10 +646,55 @@ static void add_trail(query *q, pl_idx_t c_ctx, unsigned c_var_nbr, cell *attrs,
 	tr->attrs_ctx = attrs_ctx;
 }
 
+// Saves the cell *c*, or if that's NULL the slot's cell, so that it
+// gets put back on backtracking...
+
+bool add_trail_cell(query *q, cell *c, pl_idx_t c_ctx, unsigned c_var_nbr)
+{
+	if (!check_trail(q))
+		return false;
+
+	trail *tr = q->trails + q->st.tp++;
+
+	if (c)
+		tr->save = *c;
+	else
+		tr->save = GET_SLOT(GET_FRAME(c_ctx), c_var_nbr)->c;
+
+	if (!check_trail(q)) {
+		q->st.tp--;
+		return false;
+	}
+
+	tr = q->trails + q->st.tp++;
+	tr->var_ctx = TRAIL_SETARG;
+	tr->var_nbr = c_var_nbr;
+	tr->attrs = c;
+	tr->attrs_ctx = c_ctx;
+	return true;
+}
+
+static void unwind_trail_cell(query *q, const trail *tr)
+{
+	cell *c = tr->attrs;
+
+	if (!c)
+		c = &GET_SLOT(GET_FRAME(tr->attrs_ctx), tr->var_nbr)->c;
+
+	unshare_cell(c);
+	*c = q->trails[--q->st.tp].save;
+}
+
 static void unwind_trail(query *q, const choice *ch)
 {
 	while (q->st.tp > ch->st.tp) {
 		const trail *tr = q->trails + --q->st.tp;
+
+		if (tr->var_ctx == TRAIL_SETARG) {
+			unwind_trail_cell(q, tr);
+			continue;
+		}
+
 		const frame *f = GET_FRAME(tr->var_ctx);
 		slot *e = GET_SLOT(f, tr->var_nbr);
 		unshare_cell(&e->c);
@@ -649,6 +717,7 @@ bool try_me(query *q, unsigned nbr_vars)
 	frame *f = GET_FRAME(q->st.fp);
 	f->nbr_slots = f->nbr_vars = nbr_vars;
 	f->is_active = false;
+	f->is_captured = false;
 	f->base = q->st.sp;
 	slot *e = GET_FIRST_SLOT(f);
 
@@ -663,7 +732,6 @@ bool try_me(query *q, unsigned nbr_vars)
 	q->cycle_error = false;
 	q->check_unique = false;
 	q->has_vars = false;
-	q->no_tco = false;
 	q->tot_matches++;
 	return true;
 }
@@ -766,25 +834,48 @@ static frame *push_frame(query *q, clause *cl)
 	return f;
 }
 
-static void reuse_frame(query *q, frame* f, clause *cl)
+// The new frame's slots are slid down over the current frame. A slot
+// bound to a fresh variable in the current frame takes its place, and
+// references to the new frame now refer to the current one...
+
+static void reuse_frame(query *q, frame* f, const clause *cl)
 {
-	const frame *newf = GET_FRAME(q->st.fp);
-	const choice *ch = GET_CURR_CHOICE();
-	q->st.sp = ch->st.sp;
+	frame *newf = GET_FRAME(q->st.fp);
+	pl_idx_t nbr_vars = cl->nbr_vars - cl->nbr_temporaries;
+
+	for (pl_idx_t i = 0; i < nbr_vars; i++) {
+		cell *c = &GET_SLOT(newf, i)->c;
+
+		if ((is_variable(c) || is_indirect(c)) && (c->var_ctx == q->st.fp)) {
+			c->var_ctx = q->st.curr_frame;
+		} else if (is_variable(c) && (c->var_ctx == q->st.curr_frame)) {
+			slot *e = GET_SLOT(f, c->var_nbr);
+
+			if (e->mark) {
+				c->var_nbr = e->c.var_nbr;
+			} else {
+				e->mark = true;
+				e->c.var_nbr = i;
+				c->tag = TAG_EMPTY;
+				c->attrs = NULL;
+			}
+		}
+	}
 
-	for (pl_idx_t i = 0; i < cl->nbr_vars; i++) {
-		const slot *from = GET_SLOT(newf, i);
-		slot *to = GET_SLOT(f, i);
-		unshare_cell(&to->c);
-		*to = *from;
+	for (pl_idx_t i = 0; i < f->nbr_vars; i++) {
+		slot *e = GET_SLOT(f, i);
+		unshare_cell(&e->c);
+		e->mark = false;
 	}
 
-	f->cgen = newf->cgen;
-	f->nbr_slots = cl->nbr_vars - cl->nbr_temporaries;
-	f->nbr_vars = cl->nbr_vars - cl->nbr_temporaries;
+	f->nbr_slots = f->nbr_vars = nbr_vars;
 	f->overflow = 0;
 
-	q->st.sp = f->base + (cl->nbr_vars - cl->nbr_temporaries);
+	for (pl_idx_t i = 0; i < nbr_vars; i++)
+		*GET_SLOT(f, i) = *GET_SLOT(newf, i);
+
+	f->cgen = ++q->cgen;
+	q->st.sp = f->base + nbr_vars;
 	q->tot_tcos++;
 }
 
@@ -811,24 +902,57 @@ void trim_trail(query *q)
 	}
 }
 
+// Can the current frame be overwritten by the new one? Nothing older
+// may still be looking at it, and the new frame may only refer to it
+// through fresh variables (see reuse_frame)...
+
 static bool check_slots(const query *q, const frame *f, const clause *cl)
 {
-	if (cl != NULL) {
-		if (f->nbr_vars != cl->nbr_vars)
-			return false;
-	}
+	if ((q->st.curr_frame != (q->st.fp-1)) || f->is_captured)
+		return false;
+
+	const frame *newf = GET_FRAME(q->st.fp);
+
+	if (newf->is_captured)
+		return false;
 
 	for (unsigned i = 0; i < f->nbr_vars; i++) {
 		const slot *e = GET_SLOT(f, i);
 		const cell *c = &e->c;
 
-		if (is_indirect(c) && (c->var_ctx != q->st.curr_frame))
+		if (is_managed(c))
 			return false;
 
-		if (is_managed(c) || is_variable(c))
+		if ((is_variable(c) || is_indirect(c)) && (c->var_ctx > q->st.curr_frame))
 			return false;
 	}
 
+	pl_idx_t nbr_vars = cl->nbr_vars - cl->nbr_temporaries;
+
+	for (unsigned i = 0; i < nbr_vars; i++) {
+		const slot *e = GET_SLOT(newf, i);
+		const cell *c = &e->c;
+
+		if (!is_variable(c) && !is_indirect(c))
+			continue;
+
+		if (c->var_ctx == q->st.fp) {
+			if (is_indirect(c) || (c->var_nbr >= nbr_vars))
+				return false;
+		} else if (c->var_ctx == q->st.curr_frame) {
+			if (is_indirect(c) && is_ground_term(c->val_ptr))
+				continue;
+
+			if (is_indirect(c) || (c->var_nbr >= f->nbr_vars))
+				return false;
+
+			const slot *e2 = GET_SLOT(f, c->var_nbr);
+
+			if (!is_empty(&e2->c) || e2->c.attrs)
+				return false;
+		}
+	}
+
 	return true;
 }
 
@@ -899,7 +1023,76 @@ void unshare_predicate(query *q, predicate *pr)
 	}
 }
 
-static void commit_me(query *q)
+// Before setting up a frame to unify a goal with a clause head, the
+// goal's first few arguments are checked against the head. Only small
+// integers and interned functors are compared (by value or by
+// name/arity), anything else might unify. The goal's arguments are
+// dereferenced once per call, before any bindings are made...
+
+#define MAX_MATCH_ARGS 4
+
+typedef struct {
+	cell *args[MAX_MATCH_ARGS];
+	unsigned nbr_args;
+} match_key;
+
+static void setup_match_key(query *q, match_key *mk)
+{
+	cell *c = q->st.curr_cell;
+	cell *a = c + 1;
+	mk->nbr_args = c->arity < MAX_MATCH_ARGS ? c->arity : MAX_MATCH_ARGS;
+
+	for (unsigned i = 0; i < mk->nbr_args; i++, a += a->nbr_cells) {
+		cell *tmp = deref(q, a, q->st.curr_frame);
+		mk->args[i] = is_interned(tmp) || is_smallint(tmp) ? tmp : NULL;
+	}
+}
+
+static bool can_match_head(const match_key *mk, const cell *head)
+{
+	const cell *h = head + 1;
+
+	for (unsigned i = 0; i < mk->nbr_args; i++, h += h->nbr_cells) {
+		const cell *c = mk->args[i];
+
+		if (!c || (!is_interned(h) && !is_smallint(h)))
+			continue;
+
+		if (is_interned(c)) {
+			if (!is_interned(h) || (c->val_off != h->val_off) || (c->arity != h->arity))
+				return false;
+		} else if (!is_smallint(h) || (c->val_int != h->val_int))
+			return false;
+	}
+
+	return true;
+}
+
+// Is there a later clause that might match? If not this call can
+// be made deterministic...
+
+static bool is_next_match(query *q, const match_key *mk)
+{
+	if (!is_next_key(q))
+		return false;
+
+	if (q->st.iter || !mk->nbr_args)
+		return true;
+
+	const frame *f = GET_CURR_FRAME();
+
+	for (db_entry *dbe = q->st.curr_dbe->next; dbe; dbe = dbe->next) {
+		if (!can_view(f->ugen, dbe))
+			continue;
+
+		if (can_match_head(mk, get_head(dbe->cl.cells)))
+			return true;
+	}
+
+	return false;
+}
+
+static void commit_me(query *q, const match_key *mk)
 {
 	clause *cl = &q->st.curr_dbe->cl;
 	q->in_commit = true;
@@ -908,25 +1101,25 @@ static void commit_me(query *q)
 	q->st.m = q->st.curr_dbe->owner->m;
 	cell *body = get_body(cl->cells);
 	bool implied_first_cut = q->check_unique && !q->has_vars && cl->is_unique && !q->st.iter;
-	bool last_match = implied_first_cut || cl->is_first_cut || !is_next_key(q);
-	bool recursive = is_tail_recursive(q->st.curr_cell);
-	bool slots_ok = !q->retry && check_slots(q, f, cl);
-	bool choices = any_choices(q, f);
-	bool tco;
-
-	if (q->no_tco && (cl->nbr_vars != cl->nbr_temporaries))
-		tco = false;
-	else
-		tco = last_match && recursive && !choices && slots_ok;
+	bool last_match = implied_first_cut || cl->is_first_cut || !is_next_match(q, mk);
+	bool last_call = is_last_call(q->st.curr_cell);
+	bool choices = !last_match || any_choices(q, f);
+	bool tco = last_call && !choices && !q->retry && q->pl->opt && !in_call(q, f) && check_slots(q, f, cl);
 
-#if 0
-	printf("*** tco=%d, q->no_tco=%d, last_match=%d, rec=%d, any_choices=%d, slots_ok=%d, cl->nbr_vars=%u, cl->nbr_temporaries=%u\n",
-		tco, q->no_tco, last_match, recursive, choices, slots_ok, cl->nbr_vars, cl->nbr_temporaries);
-#endif
+	if (last_call) {
+		predicate *pr = q->st.pr;
+		pr->tco_calls++;
+
+		if (choices)
+			pr->tco_choice++;
+		else if (!tco)
+			pr->tco_frame++;
+	}
 
-	if (tco && q->pl->opt)
+	if (tco) {
+		q->st.pr->tco_done++;
 		reuse_frame(q, f, cl);
-	else
+	} else
 		f = push_frame(q, cl);
 
 	if (last_match) {
@@ -1272,13 +1465,10 @@ void set_var(query *q, const cell *c, pl_idx_t c_ctx, cell *v, pl_idx_t v_ctx)
 		add_trail(q, c_ctx, c->var_nbr, c_attrs, c_attrs_ctx);
 
 	if (is_structure(v)) {
-		if ((c_ctx != q->st.curr_frame) && (v_ctx == q->st.curr_frame))
-			q->no_tco = true;
-
 		make_indirect(&e->c, v, v_ctx);
 	} else if (is_variable(v)) {
 		e->c = *v;
-		e->c.flags &= ~FLAG_REF;
+		e->c.flags &= ~(FLAG_REF|FLAG_VAR_FIRST);
 		e->c.var_ctx = v_ctx;
 	} else {
 		share_cell(v);
@@ -1289,13 +1479,16 @@ void set_var(query *q, const cell *c, pl_idx_t c_ctx, cell *v, pl_idx_t v_ctx)
 		frame *vf = GET_FRAME(v_ctx);
 		vf->is_active = true;
 
+		if ((c_ctx < v_ctx) && !is_ground_term(v))
+			vf->is_captured = true;
+
 		if (c_ctx > q->st.curr_frame)
 			f->is_active = true;
 	} else if (!is_temporary(c))
 		f->is_active = true;
 
-	if (q->flags.occurs_check != OCCURS_CHECK_FALSE)
-		e->mark = true;
+	if (is_variable(v) && (c_ctx < v_ctx))
+		GET_FRAME(v_ctx)->is_captured = true;
 }
 
 void reset_var(query *q, const cell *c, pl_idx_t c_ctx, cell *v, pl_idx_t v_ctx, bool trailing)
@@ -1321,6 +1514,9 @@ void reset_var(query *q, const cell *c, pl_idx_t c_ctx, cell *v, pl_idx_t v_ctx,
 		frame *vf = GET_FRAME(v_ctx);
 		vf->is_active = true;
 		f->is_active = true;
+
+		if ((c_ctx < v_ctx) && !is_ground_term(v))
+			vf->is_captured = true;
 	}
 }
 
@@ -1552,6 +1748,8 @@ static bool match_head(query *q)
 	check_heap_error(push_choice(q));
 	const frame *f = GET_FRAME(q->st.curr_frame);
 	check_heap_error(check_slot(q, MAX_ARITY));
+	match_key mk;
+	setup_match_key(q, &mk);
 
 	for (; q->st.curr_dbe; next_key(q)) {
 		CHECK_INTERRUPT();
@@ -1561,13 +1759,17 @@ static bool match_head(query *q)
 
 		clause *cl = &q->st.curr_dbe->cl;
 		cell *head = get_head(cl->cells);
+
+		if (!can_match_head(&mk, head))
+			continue;
+
 		check_heap_error(try_me(q, cl->nbr_vars));
 
 		if (unify(q, q->st.curr_cell, q->st.curr_frame, head, q->st.fp)) {
 			if (q->error)
 				break;
 
-			commit_me(q);
+			commit_me(q, &mk);
 			return true;
 		}
 
@@ -1926,9 +2128,9 @@ void purge_dirty_list(query *q)
 	//if (cnt) printf("Info: query purged %d\n", cnt);
 }
 
-void destroy_query(query *q)
+static void free_pages(page *a)
 {
-	for (page *a = q->pages; a;) {
+	while (a) {
 		for (pl_idx_t i = 0; i < a->max_hp_used; i++) {
 			cell *c = a->heap + i;
 			unshare_cell(c);
@@ -1939,6 +2141,12 @@ void destroy_query(query *q)
 		free(save->heap);
 		free(save);
 	}
+}
+
+void destroy_query(query *q)
+{
+	free_pages(q->pages);
+	free_pages(q->nb_pages);
 
 	for (int i = 0; i < MAX_QUEUES; i++) {
 		for (pl_idx_t j = 0; j < q->qp[i]; j++) {
@@ -1955,7 +2163,10 @@ void destroy_query(query *q)
 		unshare_cell(&e->c);
 
 	mp_int_clear(&q->tmp_ival);
+	mp_int_clear(&q->tmp_small);
 	purge_dirty_list(q);
+	free(q->walk_marks);
+	free(q->walks);
 	free(q->trails);
 	free(q->choices);
 	free(q->slots);
@@ -1979,6 +2190,7 @@ query *create_query(module *m, bool is_task)
 	q->time_cpu_last_started = q->time_cpu_started = cpu_time_in_usec();
 	q->st.prob = 1.0;
 	mp_int_init(&q->tmp_ival);
+	mp_int_init(&q->tmp_small);
 
 	// Allocate these now...
 
@@ -2018,7 +2230,7 @@ query *create_sub_query(query *q, cell *curr_cell)
 	subq->is_task = true;
 	subq->p = q->p;
 
-	cell *tmp = clone_to_heap(subq, 0, curr_cell, 1);
+	cell *tmp = clone_to_heap(subq, 0, curr_cell, subq->st.curr_frame, 1);
 	pl_idx_t nbr_cells = tmp->nbr_cells;
 	make_end(tmp+nbr_cells);
 	subq->st.curr_cell = tmp;
@@ -2028,7 +2240,7 @@ query *create_sub_query(query *q, cell *curr_cell)
 	fdst->nbr_vars = fsrc->nbr_vars;
 
 	for (unsigned i = 0; i < fsrc->nbr_vars; i++) {
-		slot *e = GET_FIRST_SLOT(fsrc+i);
+		slot *e = GET_SLOT(fsrc, i);
 		cell *c = deref(q, &e->c, e->c.var_ctx);
 		cell tmp = (cell){0};
 		tmp.tag = TAG_VAR;
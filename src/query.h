@@ -36,6 +36,7 @@ bool try_me(query *q, unsigned vars);
 void call_attrs(query *q, cell *attrs);
 void stash_me(query *q, const clause *cl, bool last_match);
 void trim_trail(query *q);
+bool add_trail_cell(query *q, cell *c, pl_idx_t c_ctx, unsigned c_var_nbr);
 bool do_post_unification_hook(query *q, bool is_builtin);
 bool check_redo(query *q);
 void dump_vars(query *q, bool partial);
@@ -60,21 +61,29 @@ size_t slicecpy(char *dst, size_t dstlen, const char *src, size_t len);
 int get_stream(query *q, cell *p1);
 void call_builtin(query *q, cell *c, pl_idx_t c_ctx);
 bool call_userfun(query *q, cell *c, pl_idx_t c_ctx);
+bool eval_flat(query *q, cell *c, pl_idx_t c_ctx);
+unsigned eval_opcode(const cell *c);
 void do_cleanup(query *q, cell *p1);
 bool drop_barrier(query *q);
-bool is_in_ref_list(cell *c, pl_idx_t c_ctx, reflist *rlist);
 void collect_vars(query *q, cell *p1, pl_idx_t p1_ctx);
 bool check_list(query *q, cell *p1, pl_idx_t p1_ctx, bool *is_partial, pl_int_t *skip);
 bool parse_write_params(query *q, cell *c, pl_idx_t c_ctx, cell **vnames, pl_idx_t *vnames_ctx);
 bool has_vars(query *q, cell *p1, pl_idx_t p1_ctx);
 bool accum_var(query *q, const cell *c, pl_idx_t c_ctx);
 int new_stream(prolog *pl);
+void release_stream(prolog *pl, int n);
+bool is_valid_stream(prolog *pl, pl_int_t n);
 
 #ifdef _WIN32
 ssize_t getline(char **lineptr, size_t *n, FILE *stream);
 #endif
 
 int compare(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx);
+size_t dict_count(const cell *c);
+bool dict_equal(query *q, const cell *p1, const cell *p2);
+int dict_compare(query *q, const cell *p1, const cell *p2);
+cell *dict_to_term(query *q, const cell *c);
+size_t array_count(const cell *c);
 bool unify(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx);
 
 ssize_t print_term_to_buf(query *q, char *dst, size_t dstlen, cell *c, pl_idx_t c_ctx, int running, bool cons, unsigned depth);
@@ -156,10 +165,6 @@ struct reflist_ {
 	};
 };
 
-struct cycle_info_ {
-	reflist *r1, *r2;
-};
-
 #define FEOF(str) feof(str->fp) && !str->ungetch
 
 #ifdef _WIN32
@@ -235,8 +235,8 @@ ssize_t getline(char **lineptr, size_t *n, FILE *stream) {
 
 static int get_named_stream(prolog *pl, const char *name, size_t len)
 {
-	for (int i = 0; i < MAX_STREAMS; i++) {
-		stream *str = &pl->streams[i];
+	for (unsigned i = 0; i < pl->nbr_streams; i++) {
+		stream *str = pl->streams[i];
 
 		if (!str->fp)
 			continue;
@@ -258,7 +258,7 @@ static bool is_closed_stream(prolog *pl, cell *p1)
 	if (!(p1->flags&FLAG_INT_STREAM))
 		return false;
 
-	if (pl->streams[get_smallint(p1)].fp)
+	if (is_valid_stream(pl, get_smallint(p1)))
 		return false;
 
 	return true;
@@ -266,7 +266,7 @@ static bool is_closed_stream(prolog *pl, cell *p1)
 
 static void add_stream_properties(query *q, int n)
 {
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char tmpbuf[1024*8];
 	char *dst = tmpbuf;
 	*dst = '\0';
@@ -351,7 +351,7 @@ static bool do_stream_property(query *q)
 	GET_FIRST_ARG(pstr,any);
 	GET_NEXT_ARG(p1,any);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	cell *c = p1 + 1;
 	c = deref(q, c, p1_ctx);
 	pl_idx_t c_ctx = q->latest_ctx;
@@ -542,11 +542,11 @@ static bool fn_iso_stream_property_2(query *q)
 	if (!q->retry) {
 		clear_streams_properties(q);
 
-		for (int i = 0; i < MAX_STREAMS; i++) {
-			if (!q->pl->streams[i].fp)
+		for (unsigned i = 0; i < q->pl->nbr_streams; i++) {
+			if (!q->pl->streams[i]->fp)
 				continue;
 
-			stream *str = &q->pl->streams[i];
+			stream *str = q->pl->streams[i];
 
 			if (!str->socket)
 				add_stream_properties(q, i);
@@ -586,14 +586,80 @@ void convert_path(char *filename)
 	}
 }
 
+// Map a whole file read-only. The kernel zero-fills the tail of the
+// last page, which gives us the terminating NUL for free. That isn't
+// the case when the size is an exact multiple of the page size, so
+// then the caller has to fall back to reading.
+
+char *map_file(int fd, size_t *len)
+{
+#if USE_MMAP
+	struct stat st = {0};
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || !st.st_size)
+		return NULL;
+
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+
+	if (!(st.st_size % pagesize))
+		return NULL;
+
+	void *addr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	*len = st.st_size;
+	return addr;
+#else
+	return NULL;
+#endif
+}
+
+void unmap_file(char *addr, size_t len)
+{
+#if USE_MMAP
+	munmap(addr, len);
+#endif
+}
+
+// Short texts are just scanned...
+
+static const utf8_index *strb_index(strbuf *strb)
+{
+	if (!strb->idx && (strb->len >= UTF8_INDEX_STEP))
+		strb->idx = index_utf8(strb->cstr, strb->len);
+
+	return strb->idx;
+}
+
+size_t strb_len_utf8(strbuf *strb, size_t off, size_t n)
+{
+	const utf8_index *idx = strb_index(strb);
+
+	if (!idx)
+		return substrlen_utf8(strb->cstr + off, n);
+
+	return index_len_utf8(idx, strb->cstr, off, n);
+}
+
+size_t strb_offset_at_pos(strbuf *strb, size_t off, size_t n, size_t i)
+{
+	const utf8_index *idx = strb_index(strb);
+
+	if (!idx)
+		return offset_at_pos(strb->cstr + off, n, i);
+
+	return index_offset_utf8(idx, strb->cstr, off, n, i);
+}
+
 #if !defined(_WIN32) && !defined(__wasi__)
-static bool fn_popen_4(query *q)
+static bool do_popen_4(query *q, int n)
 {
 	GET_FIRST_ARG(p1,atom);
 	GET_NEXT_ARG(p2,atom);
 	GET_NEXT_ARG(p3,variable);
 	GET_NEXT_ARG(p4,list_or_nil);
-	int n = new_stream(q->pl);
 	char *src = NULL;
 
 	if (n < 0)
@@ -618,7 +684,7 @@ static bool fn_popen_4(query *q)
 
 	convert_path(filename);
 
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	str->domain = true;
 	check_heap_error(str->filename = strdup(filename));
 	check_heap_error(str->name = strdup(filename));
@@ -692,15 +758,25 @@ static bool fn_popen_4(query *q)
 	tmp.flags |= FLAG_INT_STREAM | FLAG_INT_HEX;
 	return unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
 }
+
+static bool fn_popen_4(query *q)
+{
+	int n = new_stream(q->pl);
+	bool ok = do_popen_4(q, n);
+
+	if ((n >= 0) && !q->pl->streams[n]->fp)
+		release_stream(q->pl, n);
+
+	return ok;
+}
 #endif
 
-static bool fn_iso_open_4(query *q)
+static bool do_iso_open_4(query *q, int n)
 {
 	GET_FIRST_ARG(p1,atom_or_structure);
 	GET_NEXT_ARG(p2,atom);
 	GET_NEXT_ARG(p3,variable);
 	GET_NEXT_ARG(p4,list_or_nil);
-	int n = new_stream(q->pl);
 	char *src = NULL;
 
 	if (n < 0)
@@ -715,7 +791,7 @@ static bool fn_iso_open_4(query *q)
 		if (oldn < 0)
 			return throw_error(q, p1, p1_ctx, "type_error", "not_a_stream");
 
-		stream *oldstr = &q->pl->streams[oldn];
+		stream *oldstr = q->pl->streams[oldn];
 		filename = oldstr->filename;
 	} else if (is_atom(p1))
 		filename = src = DUP_STR(q, p1);
@@ -732,7 +808,7 @@ static bool fn_iso_open_4(query *q)
 	}
 
 	convert_path(filename);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	check_heap_error(str->filename = strdup(filename));
 	check_heap_error(str->name = strdup(filename));
 	check_heap_error(str->mode = DUP_STR(q, p2));
@@ -932,11 +1008,25 @@ static bool fn_iso_open_4(query *q)
 	return unify(q, p3, p3_ctx, &tmp, q->st.curr_frame);
 }
 
+// A slot left without a file, by an error or a failed open, goes
+// straight back on the free list...
+
+static bool fn_iso_open_4(query *q)
+{
+	int n = new_stream(q->pl);
+	bool ok = do_iso_open_4(q, n);
+
+	if ((n >= 0) && !q->pl->streams[n]->fp)
+		release_stream(q->pl, n);
+
+	return ok;
+}
+
 static bool fn_iso_close_1(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if ((str->fp == stdin)
 		|| (str->fp == stdout)
@@ -959,10 +1049,7 @@ static bool fn_iso_close_1(query *q)
 		del_stream_properties(q, n);
 
 	net_close(str);
-	free(str->mode);
-	free(str->filename);
-	free(str->name);
-	free(str->data);
+	release_stream(q->pl, n);
 	return true;
 }
 
@@ -998,7 +1085,7 @@ static bool fn_iso_close_2(query *q)
 static bool fn_iso_at_end_of_stream_0(query *q)
 {
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!str->ungetch && str->p) {
 		if (str->p->srcptr && *str->p->srcptr) {
@@ -1025,7 +1112,7 @@ static bool fn_iso_at_end_of_stream_1(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (strcmp(str->mode, "read") && strcmp(str->mode, "update"))
 		return throw_error(q, pstr, q->st.curr_frame, "permission_error", "input,stream");
@@ -1054,7 +1141,11 @@ static bool fn_iso_at_end_of_stream_1(query *q)
 static bool fn_iso_flush_output_0(query *q)
 {
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
+
+	if (str->socket && !net_flush(str))
+		return false;
+
 	fflush(str->fp);
 	return !ferror(str->fp);
 }
@@ -1063,11 +1154,14 @@ static bool fn_iso_flush_output_1(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!strcmp(str->mode, "read"))
 		return throw_error(q, pstr, q->st.curr_frame, "permission_error", "output,stream");
 
+	if (str->socket && !net_flush(str))
+		return false;
+
 	fflush(str->fp);
 	return !ferror(str->fp);
 }
@@ -1075,7 +1169,7 @@ static bool fn_iso_flush_output_1(query *q)
 static bool fn_iso_nl_0(query *q)
 {
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	fputc('\n', str->fp);
 	//fflush(str->fp);
 	return !ferror(str->fp);
@@ -1085,7 +1179,7 @@ static bool fn_iso_nl_1(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!strcmp(str->mode, "read"))
 		return throw_error(q, pstr, q->st.curr_frame, "permission_error", "output,stream");
@@ -1099,7 +1193,7 @@ static bool fn_iso_read_1(query *q)
 {
 	GET_FIRST_ARG(p1,any);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -1117,7 +1211,7 @@ static bool fn_iso_read_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 
 	if (strcmp(str->mode, "read"))
@@ -1622,7 +1716,7 @@ static bool fn_iso_read_term_2(query *q)
 	GET_FIRST_ARG(p1,any);
 	GET_NEXT_ARG(p2,list_or_nil);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -1638,7 +1732,7 @@ static bool fn_iso_read_term_3(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 	GET_NEXT_ARG(p2,list_or_nil);
 
@@ -1659,7 +1753,7 @@ static bool fn_iso_write_1(query *q)
 {
 	GET_FIRST_ARG(p1,any);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -1682,7 +1776,7 @@ static bool fn_iso_write_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 
 	if (!strcmp(str->mode, "read"))
@@ -1709,7 +1803,7 @@ static bool fn_iso_writeq_1(query *q)
 {
 	GET_FIRST_ARG(p1,any);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -1734,7 +1828,7 @@ static bool fn_iso_writeq_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 
 	if (!strcmp(str->mode, "read"))
@@ -1763,7 +1857,7 @@ static bool fn_iso_write_canonical_1(query *q)
 {
 	GET_FIRST_ARG(p1,any);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -1784,7 +1878,7 @@ static bool fn_iso_write_canonical_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 
 	if (!strcmp(str->mode, "read"))
@@ -1986,7 +2080,7 @@ static bool fn_iso_write_term_2(query *q)
 	GET_FIRST_ARG(p1,any);
 	GET_NEXT_ARG(p2,list_or_nil);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -2050,7 +2144,7 @@ static bool fn_iso_write_term_3(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 	GET_NEXT_ARG(p2,list_or_nil);
 
@@ -2120,7 +2214,7 @@ static bool fn_iso_put_char_1(query *q)
 {
 	GET_FIRST_ARG(p1,character);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	size_t len = len_char_utf8(C_STR(q, p1));
 
 	if (str->binary) {
@@ -2145,7 +2239,7 @@ static bool fn_iso_put_char_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,character);
 	size_t len = len_char_utf8(C_STR(q, p1));
 
@@ -2174,7 +2268,7 @@ static bool fn_iso_put_code_1(query *q)
 {
 	GET_FIRST_ARG(p1,integer);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -2200,7 +2294,7 @@ static bool fn_iso_put_code_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,integer);
 
 	if (!strcmp(str->mode, "read"))
@@ -2230,7 +2324,7 @@ static bool fn_iso_put_byte_1(query *q)
 {
 	GET_FIRST_ARG(p1,byte);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!str->binary) {
 		cell tmp;
@@ -2256,7 +2350,7 @@ static bool fn_iso_put_byte_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,byte);
 
 	if (!strcmp(str->mode, "read"))
@@ -2282,7 +2376,7 @@ static bool fn_iso_get_char_1(query *q)
 {
 	GET_FIRST_ARG(p1,in_character_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -2351,7 +2445,7 @@ static bool fn_iso_get_char_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,in_character_or_var);
 
 	if (strcmp(str->mode, "read"))
@@ -2424,7 +2518,7 @@ static bool fn_iso_get_code_1(query *q)
 {
 	GET_FIRST_ARG(p1,integer_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (is_integer(p1) && (get_int(p1) < -1))
 		return throw_error(q, p1, p1_ctx, "representation_error", "in_character_code");
@@ -2495,7 +2589,7 @@ static bool fn_iso_get_code_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,integer_or_var);
 
 	if (is_integer(p1) && (get_int(p1) < -1))
@@ -2569,7 +2663,7 @@ static bool fn_iso_get_byte_1(query *q)
 {
 	GET_FIRST_ARG(p1,in_byte_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!str->binary) {
 		cell tmp;
@@ -2629,7 +2723,7 @@ static bool fn_iso_get_byte_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,in_byte_or_var);
 
 	if (strcmp(str->mode, "read"))
@@ -2692,7 +2786,7 @@ static bool fn_iso_peek_char_1(query *q)
 {
 	GET_FIRST_ARG(p1,in_character_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (str->binary) {
 		cell tmp;
@@ -2743,7 +2837,7 @@ static bool fn_iso_peek_char_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,in_character_or_var);
 
 	if (strcmp(str->mode, "read"))
@@ -2797,7 +2891,7 @@ static bool fn_iso_peek_code_1(query *q)
 {
 	GET_FIRST_ARG(p1,integer_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (is_integer(p1) && (get_int(p1) < -1))
 		return throw_error(q, p1, p1_ctx, "representation_error", "in_character_code");
@@ -2848,7 +2942,7 @@ static bool fn_iso_peek_code_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,integer_or_var);
 
 	if (is_integer(p1) && (get_int(p1) < -1))
@@ -2903,7 +2997,7 @@ static bool fn_iso_peek_byte_1(query *q)
 {
 	GET_FIRST_ARG(p1,in_byte_or_var);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!str->binary) {
 		cell tmp;
@@ -2950,7 +3044,7 @@ static bool fn_iso_peek_byte_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,in_byte_or_var);
 
 	if (strcmp(str->mode, "read"))
@@ -2997,16 +3091,71 @@ static bool fn_iso_peek_byte_2(query *q)
 	return unify(q, p1, p1_ctx, &tmp, q->st.curr_frame);
 }
 
+static bool grow_streams(prolog *pl)
+{
+	unsigned new_size = pl->streams_size ? pl->streams_size * 2 : INITIAL_NBR_STREAMS;
+
+	if (new_size > INT_MAX)
+		return false;
+
+	stream **streams = realloc(pl->streams, sizeof(stream*)*new_size);
+	if (!streams) return false;
+	pl->streams = streams;
+
+	int *free_streams = realloc(pl->free_streams, sizeof(int)*new_size);
+	if (!free_streams) return false;
+	pl->free_streams = free_streams;
+
+	pl->streams_size = new_size;
+	return true;
+}
+
 int new_stream(prolog *pl)
 {
-	for (int i = 0; i < MAX_STREAMS; i++) {
-		if (!pl->streams[i].fp && !pl->streams[i].ignore) {
-			memset(&pl->streams[i], 0, sizeof(stream));
-			return i;
+	while (pl->nbr_free_streams) {
+		int n = pl->free_streams[--pl->nbr_free_streams];
+		stream *str = pl->streams[n];
+
+		if (!str->fp && !str->ignore) {
+			memset(str, 0, sizeof(stream));
+			return n;
 		}
 	}
 
-	return -1;
+	if ((pl->nbr_streams == pl->streams_size) && !grow_streams(pl))
+		return -1;
+
+	stream *str = calloc(1, sizeof(stream));
+
+	if (!str)
+		return -1;
+
+	pl->streams[pl->nbr_streams] = str;
+	return pl->nbr_streams++;
+}
+
+void release_stream(prolog *pl, int n)
+{
+	stream *str = pl->streams[n];
+	free(str->srcbuf);
+	free(str->mode);
+	free(str->filename);
+	free(str->name);
+	free(str->data);
+	memset(str, 0, sizeof(stream));
+
+	// The free list can never overflow as it is sized to the
+	// table and each slot is on it at most once...
+
+	pl->free_streams[pl->nbr_free_streams++] = n;
+}
+
+bool is_valid_stream(prolog *pl, pl_int_t n)
+{
+	if ((n < 0) || (n >= pl->nbr_streams))
+		return false;
+
+	return pl->streams[n]->fp ? true : false;
 }
 
 int get_stream(query *q, cell *p1)
@@ -3026,7 +3175,7 @@ int get_stream(query *q, cell *p1)
 	if (!(p1->flags&FLAG_INT_STREAM))
 		return -1;
 
-	if (!q->pl->streams[get_int(p1)].fp)
+	if (!is_valid_stream(q->pl, get_smallint(p1)))
 		return -1;
 
 	return get_smallint(p1);
@@ -3072,7 +3221,7 @@ static bool fn_iso_set_input_1(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (strcmp(str->mode, "read") && strcmp(str->mode, "update"))
 		return throw_error(q, pstr, q->st.curr_frame, "permission_error", "input,stream");
@@ -3085,7 +3234,7 @@ static bool fn_iso_set_output_1(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (!strcmp(str->mode, "read"))
 		return throw_error(q, pstr, q->st.curr_frame, "permission_error", "output,stream");
@@ -3098,7 +3247,7 @@ static bool fn_iso_set_stream_position_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 
 	if (!str->repo)
@@ -3121,7 +3270,7 @@ static bool fn_read_term_from_chars_3(query *q)
 	GET_NEXT_ARG(p_term,any);
 	GET_NEXT_ARG(p_opts,list_or_nil);
 	int n = 3;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char *src = NULL;
 	size_t len;
 	bool has_var, is_partial;
@@ -3198,7 +3347,7 @@ static bool fn_read_term_from_atom_3(query *q)
 	GET_NEXT_ARG(p_term,any);
 	GET_NEXT_ARG(p_opts,list_or_nil);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	char *src;
 	size_t len;
@@ -3229,6 +3378,10 @@ static bool fn_read_term_from_atom_3(query *q)
 	bool ok = do_read_term(q, str, p_term, p_term_ctx, p_opts, p_opts_ctx, src);
 	q->p->no_fp = false;
 	free(src);
+
+	if (str->p)
+		str->p->srcptr = NULL;
+
 	return ok;
 }
 
@@ -3364,7 +3517,7 @@ static bool fn_edin_redo_1(query *q)
 {
 	GET_FIRST_ARG(p1,integer);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (isatty(fileno(str->fp)) && !str->did_getc && !str->ungetch) {
 		fprintf(str->fp, "%s", PROMPT);
@@ -3393,7 +3546,7 @@ static bool fn_edin_redo_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,integer);
 
 	if (isatty(fileno(str->fp)) && !str->did_getc && !str->ungetch) {
@@ -3428,7 +3581,7 @@ static bool fn_edin_tab_1(query *q)
 		return throw_error(q, &p1, p1_tmp_ctx, "type_error", "integer");
 
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	for (int i = 0; i < get_int(&p1); i++)
 		fputc(' ', str->fp);
@@ -3446,7 +3599,7 @@ static bool fn_edin_tab_2(query *q)
 		return throw_error(q, &p1, p1_tmp_ctx, "type_error", "integer");
 
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	for (int i = 0; i < get_int(&p1); i++)
 		fputc(' ', str->fp);
@@ -3457,7 +3610,7 @@ static bool fn_edin_tab_2(query *q)
 static bool fn_edin_seen_0(query *q)
 {
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (n <= 2)
 		return true;
@@ -3467,10 +3620,8 @@ static bool fn_edin_seen_0(query *q)
 		&& (str->fp != stderr))
 		fclose(str->fp);
 
-	free(str->filename);
-	free(str->mode);
-	free(str->name);
-	memset(str, 0, sizeof(stream));
+	str->fp = NULL;
+	release_stream(q->pl, n);
 	q->pl->current_input = 0;
 	return true;
 }
@@ -3478,7 +3629,7 @@ static bool fn_edin_seen_0(query *q)
 static bool fn_edin_told_0(query *q)
 {
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	if (n <= 2)
 		return true;
@@ -3488,10 +3639,8 @@ static bool fn_edin_told_0(query *q)
 		&& (str->fp != stderr))
 		fclose(str->fp);
 
-	free(str->filename);
-	free(str->mode);
-	free(str->name);
-	memset(str, 0, sizeof(stream));
+	str->fp = NULL;
+	release_stream(q->pl, n);
 	q->pl->current_output = 0;
 	return true;
 }
@@ -3499,7 +3648,7 @@ static bool fn_edin_told_0(query *q)
 static bool fn_edin_seeing_1(query *q)
 {
 	GET_FIRST_ARG(p1,variable);
-	char *name = q->pl->current_input==0?"user":q->pl->streams[q->pl->current_input].name;
+	char *name = q->pl->current_input==0?"user":q->pl->streams[q->pl->current_input]->name;
 	cell tmp;
 	check_heap_error(make_cstring(&tmp, name));
 	bool ok = unify(q, p1, p1_ctx, &tmp, q->st.curr_frame);
@@ -3510,7 +3659,7 @@ static bool fn_edin_seeing_1(query *q)
 static bool fn_edin_telling_1(query *q)
 {
 	GET_FIRST_ARG(p1,variable);
-	char *name =q->pl->current_output==1?"user":q->pl->streams[q->pl->current_output].name;
+	char *name =q->pl->current_output==1?"user":q->pl->streams[q->pl->current_output]->name;
 	cell tmp;
 	check_heap_error(make_cstring(&tmp, name));
 	bool ok = unify(q, p1, p1_ctx, &tmp, q->st.curr_frame);
@@ -3523,7 +3672,7 @@ static bool fn_read_line_to_string_2(query *q)
 	GET_FIRST_ARG(pstr,stream);
 	GET_NEXT_ARG(p1,any);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char *line = NULL;
 	size_t len = 0;
 
@@ -3661,7 +3810,7 @@ static bool fn_read_file_to_string_3(query *q)
 		return throw_error(q, p1, p1_ctx, "domain_error", "cannot_read");
 	}
 
-	s[st.st_size] = '\0';
+	s[len] = '\0';
 	fclose(fp);
 	cell tmp;
 	check_heap_error(make_stringn(&tmp, s, len), free(s));
@@ -3875,7 +4024,7 @@ static bool fn_loadfile_2(query *q)
 		return throw_error(q, p1, p1_ctx, "domain_error", "cannot_read");
 	}
 
-	s[st.st_size] = '\0';
+	s[len] = '\0';
 	fclose(fp);
 	cell tmp;
 	check_heap_error(make_stringn(&tmp, s, len), free(s));
@@ -3964,7 +4113,7 @@ static bool fn_getlines_1(query *q)
 {
 	GET_NEXT_ARG(p1,variable);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char *line = NULL;
 	size_t len = 0;
 	int nbr = 1, in_list = 0;
@@ -4014,7 +4163,7 @@ static bool fn_getlines_2(query *q)
 	GET_FIRST_ARG(pstr,stream);
 	GET_NEXT_ARG(p1,variable);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char *line = NULL;
 	size_t len = 0;
 	int nbr = 1, in_list = 0;
@@ -4234,7 +4383,7 @@ static bool fn_getline_1(query *q)
 {
 	GET_FIRST_ARG(p1,any);
 	int n = q->pl->current_input;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char *line = NULL;
 	size_t len = 0;
 
@@ -4273,7 +4422,7 @@ static bool fn_getline_2(query *q)
 	GET_FIRST_ARG(pstr,stream);
 	GET_NEXT_ARG(p1,any);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	char *line = NULL;
 	size_t len = 0;
 
@@ -4934,21 +5083,21 @@ static bool fn_server_3(query *q)
 		return throw_error(q, p1, p1_ctx, "resource_error", "too_many_streams");
 	}
 
-	stream *str = &q->pl->streams[n];
-	check_heap_error(str->filename = DUP_STR(q, p1));
-	check_heap_error(str->name = strdup(hostname));
-	check_heap_error(str->mode = strdup("update"));
+	stream *str = q->pl->streams[n];
+	check_heap_error(str->filename = DUP_STR(q, p1), close(fd), release_stream(q->pl, n));
+	check_heap_error(str->name = strdup(hostname), close(fd), release_stream(q->pl, n));
+	check_heap_error(str->mode = strdup("update"), close(fd), release_stream(q->pl, n));
 	str->nodelay = nodelay;
 	str->nonblock = nonblock;
 	str->udp = udp;
-	str->fp = fdopen(fd, "r+");
 	str->ssl = ssl;
 	str->level = level;
 	str->sslptr = NULL;
 
-	if (str->fp == NULL) {
-		return throw_error(q, p1, p1_ctx, "existence_error", "cannot_open_stream");
+	if (!net_open(str, fd, true)) {
 		close(fd);
+		release_stream(q->pl, n);
+		return throw_error(q, p1, p1_ctx, "existence_error", "cannot_open_stream");
 	}
 
 	if (!str->ssl)
@@ -4965,7 +5114,7 @@ static bool fn_accept_2(query *q)
 	GET_FIRST_ARG(pstr,stream);
 	GET_NEXT_ARG(p1,variable);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 
 	int fd = net_accept(str);
 
@@ -4983,19 +5132,18 @@ static bool fn_accept_2(query *q)
 		return throw_error(q, p1, p1_ctx, "resource_error", "too_many_streams");
 	}
 
-	stream *str2 = &q->pl->streams[n];
-	check_heap_error(str2->filename = strdup(str->filename));
-	check_heap_error(str2->name = strdup(str->name));
-	check_heap_error(str2->mode = strdup("update"));
-	str->socket = true;
+	stream *str2 = q->pl->streams[n];
+	check_heap_error(str2->filename = strdup(str->filename), close(fd), release_stream(q->pl, n));
+	check_heap_error(str2->name = strdup(str->name), close(fd), release_stream(q->pl, n));
+	check_heap_error(str2->mode = strdup("update"), close(fd), release_stream(q->pl, n));
 	str2->nodelay = str->nodelay;
 	str2->nonblock = str->nonblock;
 	str2->udp = str->udp;
 	str2->ssl = str->ssl;
-	str2->fp = fdopen(fd, "r+");
 
-	if (str2->fp == NULL) {
+	if (!net_open(str2, fd, false)) {
 		close(fd);
+		release_stream(q->pl, n);
 		return throw_error(q, p1, p1_ctx, "existence_error", "cannot_open_stream");
 	}
 
@@ -5003,7 +5151,9 @@ static bool fn_accept_2(query *q)
 		str2->sslptr = net_enable_ssl(fd, str->name, 1, str->level, NULL);
 
 		if (!str2->sslptr) {
-			close(fd);
+			str2->ssl = false;
+			net_close(str2);
+			release_stream(q->pl, n);
 			return false;
 		}
 	}
@@ -5118,33 +5268,26 @@ static bool fn_client_5(query *q)
 		return throw_error(q, p1, p1_ctx, "resource_error", "too_many_streams");
 	}
 
-	stream *str = &q->pl->streams[n];
-	check_heap_error(str->filename = DUP_STR(q, p1));
-	check_heap_error(str->name = strdup(hostname));
-	check_heap_error(str->mode = strdup("update"));
+	stream *str = q->pl->streams[n];
+	check_heap_error(str->filename = DUP_STR(q, p1), close(fd), release_stream(q->pl, n));
+	check_heap_error(str->name = strdup(hostname), close(fd), release_stream(q->pl, n));
+	check_heap_error(str->mode = strdup("update"), close(fd), release_stream(q->pl, n));
 	str->socket = true;
 	str->nodelay = nodelay;
 	str->nonblock = nonblock;
 	str->udp = udp;
 	str->ssl = ssl;
 	str->level = level;
-	str->fp = fdopen(fd, "r+");
 
-	if (!str->filename || !str->name || !str->mode) {
-		free(str->filename);
-		free(str->name);
-		free(str->mode); //cehteh: maybe from pool?
-		return false;
-	}
-
-	if (str->fp == NULL) {
+	if (!net_open(str, fd, false)) {
 		close(fd);
+		release_stream(q->pl, n);
 		return throw_error(q, p1, p1_ctx, "existence_error", "cannot_open_stream");
 	}
 
 	if (str->ssl) {
 		str->sslptr = net_enable_ssl(fd, hostname, 0, str->level, certfile);
-		check_heap_error (str->sslptr, close(fd));
+		check_heap_error(str->sslptr, str->ssl = false, net_close(str), release_stream(q->pl, n));
 	}
 
 	if (nonblock && !str->ssl)
@@ -5169,7 +5312,7 @@ static bool fn_bread_3(query *q)
 	GET_NEXT_ARG(p1,integer_or_var);
 	GET_NEXT_ARG(p2,variable);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	size_t len;
 
 	if (is_integer(p1) && is_positive(p1)) {
@@ -5272,7 +5415,7 @@ static bool fn_bwrite_2(query *q)
 	GET_FIRST_ARG(pstr,stream);
 	GET_NEXT_ARG(p1,atom);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	const char *src = C_STR(q, p1);
 	size_t len = C_STRLEN(q, p1);
 
@@ -5295,11 +5438,437 @@ static bool fn_bwrite_2(query *q)
 	return true;
 }
 
+static bool fn_cork_2(query *q)
+{
+	GET_FIRST_ARG(pstr,stream);
+	GET_NEXT_ARG(p1,atom);
+	int n = get_stream(q, pstr);
+	stream *str = q->pl->streams[n];
+
+	if (!str->socket)
+		return throw_error(q, pstr, pstr_ctx, "domain_error", "socket_stream");
+
+	if (!CMP_STR_CSTR(q, p1, "true"))
+		net_cork(str, true);
+	else if (!CMP_STR_CSTR(q, p1, "false"))
+		net_cork(str, false);
+	else
+		return throw_error(q, p1, p1_ctx, "domain_error", "boolean");
+
+	return true;
+}
+
+// HTTP/1.1 message heads are parsed a line at a time as they sit in
+// the stream buffer, without going through Prolog strings. A line
+// over MAX_HTTP_LINE returns -2. Once a message has started we wait
+// for the rest of it rather than take a partial line...
+
+static int http_getline(stream *str, char **line, size_t *len, bool wait)
+{
+	int nbytes;
+
+	while ((nbytes = net_getline_max(line, len, MAX_HTTP_LINE, MAX_HTTP_WAIT, str)) == -1) {
+		if (!wait || !net_wait_input(str, MAX_HTTP_WAIT))
+			return -1;
+	}
+
+	if (nbytes < 0)
+		return nbytes;
+
+	char *s = *line;
+
+	while (nbytes && ((s[nbytes-1] == '\n') || (s[nbytes-1] == '\r')))
+		s[--nbytes] = '\0';
+
+	return nbytes;
+}
+
+static bool make_http_stringn(query *q, cell *c, const char *s, size_t n)
+{
+	if (!n) {
+		make_atom(c, g_nil_s);
+		return true;
+	}
+
+	return make_stringn(c, s, n) == true;
+}
+
+// Headers are returned as a list of Name:Value strings with the
+// name lowercased and the value trimmed, ending at the blank line.
+// Too long a line or too many headers returns a NULL list...
+
+static bool http_read_headers(query *q, stream *str, char **line, size_t *len, cell **l)
+{
+	pl_idx_t colon = index_from_pool(q->pl, ":");
+	unsigned nbr = 0;
+	int nbytes;
+
+	while ((nbytes = http_getline(str, line, len, true)) > 0) {
+		CHECK_INTERRUPT();
+
+		if (nbr == MAX_HTTP_HEADERS) {
+			nbytes = -2;
+			break;
+		}
+
+		char *src = *line, *end = src + nbytes;
+		char *sep = memchr(src, ':', nbytes);
+
+		if (!sep || (sep == src))
+			continue;
+
+		for (char *s = src; s < sep; s++)
+			*s = tolower(*s);
+
+		const char *val = sep + 1;
+
+		while ((val < end) && isspace(*val))
+			val++;
+
+		while ((end > val) && isspace(end[-1]))
+			end--;
+
+		cell tmp[3];
+		make_struct(tmp, colon, NULL, 2, 2);
+		SET_OP(tmp, OP_XFY);
+		check_heap_error(make_http_stringn(q, tmp+1, src, sep-src));
+		check_heap_error(make_http_stringn(q, tmp+2, val, end-val), unshare_cell(tmp+1));
+
+		if (nbr++ == 0)
+			allocate_list(q, tmp);
+		else
+			append_list(q, tmp);
+	}
+
+	if (nbytes == -2) {
+		if (nbr)
+			end_list(q);
+
+		*l = NULL;
+		return true;
+	}
+
+	if (!nbr) {
+		*l = alloc_on_heap(q, 1);
+		check_heap_error(*l);
+		make_atom(*l, g_nil_s);
+		return true;
+	}
+
+	*l = end_list(q);
+	check_heap_error(*l);
+	return true;
+}
+
+static bool fn_http_parse_request_3(query *q)
+{
+	GET_FIRST_ARG(pstr,stream);
+	GET_NEXT_ARG(p1,any);
+	GET_NEXT_ARG(p2,any);
+	int n = get_stream(q, pstr);
+	stream *str = q->pl->streams[n];
+	char *line = NULL;
+	size_t len = 0;
+	int nbytes;
+
+	// Skip any blank lines between pipelined requests. A task yields
+	// while the connection is idle...
+
+	while ((nbytes = http_getline(str, &line, &len, !q->is_task)) == 0)
+		;
+
+	if (nbytes == -2) {
+		free(line);
+		return throw_error(q, pstr, pstr_ctx, "resource_error", "http_headers");
+	}
+
+	if (nbytes < 0) {
+		free(line);
+
+		if (q->is_task && !feof(str->fp) && ferror(str->fp)) {
+			clearerr(str->fp);
+			return do_yield_0(q, 1);
+		}
+
+		return false;
+	}
+
+	// METHOD SP PATH SP HTTP/x.y
+
+	char *path = strchr(line, ' ');
+	char *ver = path ? strchr(path+1, ' ') : NULL;
+
+	if (!ver || strncmp(ver+1, "HTTP/", 5)) {
+		free(line);
+		return false;
+	}
+
+	for (char *s = line; s < path; s++)
+		*s = toupper(*s);
+
+	cell *tmp = alloc_on_heap(q, 4);
+	check_heap_error(tmp, free(line));
+	make_struct(tmp, index_from_pool(q->pl, "request"), NULL, 3, 3);
+	check_heap_error(make_http_stringn(q, tmp+1, line, path-line), free(line));
+	check_heap_error(make_http_stringn(q, tmp+2, path+1, ver-(path+1)), free(line));
+	check_heap_error(make_http_stringn(q, tmp+3, ver+6, strlen(ver+6)), free(line));
+	cell *l;
+
+	if (!http_read_headers(q, str, &line, &len, &l)) {
+		free(line);
+		return false;
+	}
+
+	free(line);
+
+	if (!l)
+		return throw_error(q, pstr, pstr_ctx, "resource_error", "http_headers");
+
+	if (!unify(q, p1, p1_ctx, tmp, q->st.curr_frame))
+		return false;
+
+	return unify(q, p2, p2_ctx, l, q->st.curr_frame);
+}
+
+static bool fn_http_parse_response_3(query *q)
+{
+	GET_FIRST_ARG(pstr,stream);
+	GET_NEXT_ARG(p1,integer_or_var);
+	GET_NEXT_ARG(p2,any);
+	int n = get_stream(q, pstr);
+	stream *str = q->pl->streams[n];
+	char *line = NULL;
+	size_t len = 0;
+
+	// HTTP/x.y SP CODE SP REASON
+
+	if ((http_getline(str, &line, &len, true) < 0) || strncmp(line, "HTTP/", 5)) {
+		free(line);
+		return false;
+	}
+
+	char *src = strchr(line, ' '), *end;
+	long code = src ? strtol(src+1, &end, 10) : 0;
+
+	if (!src || (end == src+1) || (code < 100) || (code > 999)) {
+		free(line);
+		return false;
+	}
+
+	cell *l;
+
+	if (!http_read_headers(q, str, &line, &len, &l)) {
+		free(line);
+		return false;
+	}
+
+	free(line);
+
+	if (!l)
+		return throw_error(q, pstr, pstr_ctx, "resource_error", "http_headers");
+	cell tmp;
+	make_int(&tmp, code);
+
+	if (!unify(q, p1, p1_ctx, &tmp, q->st.curr_frame))
+		return false;
+
+	return unify(q, p2, p2_ctx, l, q->st.curr_frame);
+}
+
+// A chunked body is read straight into one buffer that doubles as
+// needed. Chunk extensions and trailers are skipped...
+
+static bool fn_http_read_chunked_2(query *q)
+{
+	GET_FIRST_ARG(pstr,stream);
+	GET_NEXT_ARG(p1,any);
+	int n = get_stream(q, pstr);
+	stream *str = q->pl->streams[n];
+	char *line = NULL, *buf = NULL;
+	size_t len = 0, size = 0, nbytes = 0;
+
+	for (;;) {
+		CHECK_INTERRUPT();
+
+		if (http_getline(str, &line, &len, true) < 0)
+			break;
+
+		char *end;
+		unsigned long long chunk_len = strtoull(line, &end, 16);
+
+		if (end == line)
+			break;
+
+		if (!chunk_len) {
+			while (http_getline(str, &line, &len, true) > 0)
+				;
+
+			free(line);
+			cell tmp;
+			check_heap_error(make_http_stringn(q, &tmp, buf, nbytes), free(buf));
+			free(buf);
+			bool ok = unify(q, p1, p1_ctx, &tmp, q->st.curr_frame);
+			unshare_cell(&tmp);
+			return ok;
+		}
+
+		// The size comes from the peer, so cap the body before doing
+		// any arithmetic with it...
+
+		if ((chunk_len > MAX_HTTP_BODY) || (nbytes > (MAX_HTTP_BODY - chunk_len)))
+			break;
+
+		if ((nbytes + chunk_len) > size) {
+			while ((nbytes + chunk_len) > size)
+				size = size ? size * 2 : 4096;
+
+			char *tmp = realloc(buf, size);
+			check_heap_error(tmp, free(buf), free(line));
+			buf = tmp;
+		}
+
+		size_t rlen = net_read(buf+nbytes, chunk_len, str);
+		nbytes += rlen;
+
+		if (rlen != chunk_len)
+			break;
+
+		http_getline(str, &line, &len, true);
+	}
+
+	// Truncated or malformed...
+
+	free(line);
+	free(buf);
+	return false;
+}
+
+static const char *http_reason(unsigned code)
+{
+	switch (code) {
+		case 100: return "Continue";
+		case 101: return "Switching Protocols";
+		case 200: return "OK";
+		case 201: return "Created";
+		case 202: return "Accepted";
+		case 204: return "No Content";
+		case 206: return "Partial Content";
+		case 301: return "Moved Permanently";
+		case 302: return "Found";
+		case 303: return "See Other";
+		case 304: return "Not Modified";
+		case 307: return "Temporary Redirect";
+		case 308: return "Permanent Redirect";
+		case 400: return "Bad Request";
+		case 401: return "Unauthorized";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 408: return "Request Timeout";
+		case 409: return "Conflict";
+		case 411: return "Length Required";
+		case 413: return "Content Too Large";
+		case 415: return "Unsupported Media Type";
+		case 429: return "Too Many Requests";
+		case 431: return "Request Header Fields Too Large";
+		case 500: return "Internal Server Error";
+		case 501: return "Not Implemented";
+		case 502: return "Bad Gateway";
+		case 503: return "Service Unavailable";
+		case 504: return "Gateway Timeout";
+		default: return "Unknown";
+	}
+}
+
+static bool http_text(query *q, cell *c, pl_idx_t c_ctx, char *tmpbuf, const char **src, size_t *len)
+{
+	c = deref(q, c, c_ctx);
+
+	if (is_integer(c) && !is_bigint(c)) {
+		*len = sprintf(tmpbuf, "%lld", (long long)get_smallint(c));
+		*src = tmpbuf;
+	} else if (is_nil(c)) {
+		*src = "";
+		*len = 0;
+	} else if (is_atom(c)) {
+		*src = C_STR(q, c);
+		*len = C_STRLEN(q, c);
+	} else
+		return false;
+
+	return true;
+}
+
+// The status line, headers and a Content-Length go out in one write,
+// the body follows from the term without copying...
+
+static bool fn_http_write_response_4(query *q)
+{
+	GET_FIRST_ARG(pstr,stream);
+	GET_NEXT_ARG(p1,integer);
+	GET_NEXT_ARG(p2,list_or_nil);
+	GET_NEXT_ARG(p3,atom);
+	int n = get_stream(q, pstr);
+	stream *str = q->pl->streams[n];
+
+	if (is_bigint(p1) || (get_smallint(p1) < 100) || (get_smallint(p1) > 999))
+		return throw_error(q, p1, p1_ctx, "domain_error", "http_status");
+
+	const char *body = is_nil(p3) ? "" : C_STR(q, p3);
+	size_t body_len = is_nil(p3) ? 0 : C_STRLEN(q, p3);
+	unsigned code = get_smallint(p1);
+	ASTRING_alloc(pr, 256);
+	ASTRING_sprintf(pr, "HTTP/1.1 %u %s\r\n", code, http_reason(code));
+	LIST_HANDLER(p2);
+
+	while (is_list(p2)) {
+		cell *h = LIST_HEAD(p2);
+		cell *c = deref(q, h, p2_ctx);
+		pl_idx_t c_ctx = q->latest_ctx;
+
+		if (!is_structure(c) || (c->arity != 2) || CMP_STR_CSTR(q, c, ":")) {
+			ASTRING_free(pr);
+			return throw_error(q, c, c_ctx, "domain_error", "http_header");
+		}
+
+		char tmpbuf1[32], tmpbuf2[32];
+		const char *name, *val;
+		size_t name_len, val_len;
+
+		if (!http_text(q, c+1, c_ctx, tmpbuf1, &name, &name_len)
+			|| !http_text(q, c+1+c[1].nbr_cells, c_ctx, tmpbuf2, &val, &val_len)) {
+			ASTRING_free(pr);
+			return throw_error(q, c, c_ctx, "domain_error", "http_header");
+		}
+
+		ASTRING_strcatn(pr, name, name_len);
+		ASTRING_strcat(pr, ": ");
+		ASTRING_strcatn(pr, val, val_len);
+		ASTRING_strcat(pr, "\r\n");
+		p2 = LIST_TAIL(p2);
+		p2 = deref(q, p2, p2_ctx);
+		p2_ctx = q->latest_ctx;
+	}
+
+	ASTRING_sprintf(pr, "Content-Length: %zu\r\n\r\n", body_len);
+	size_t len = ASTRING_strlen(pr);
+	bool ok = net_write(ASTRING_cstr(pr), len, str) == len;
+	ASTRING_free(pr);
+
+	if (ok && body_len)
+		ok = net_write(body, body_len, str) == body_len;
+
+	if (!ok)
+		return throw_error(q, pstr, pstr_ctx, "io_error", "write");
+
+	return true;
+}
+
 static bool fn_sys_put_chars_1(query *q)
 {
 	GET_FIRST_ARG(p1,any);
 	int n = q->pl->current_output;
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	size_t len;
 
 	if (is_cstring(p1)) {
@@ -5322,7 +5891,7 @@ static bool fn_sys_put_chars_2(query *q)
 {
 	GET_FIRST_ARG(pstr,stream);
 	int n = get_stream(q, pstr);
-	stream *str = &q->pl->streams[n];
+	stream *str = q->pl->streams[n];
 	GET_NEXT_ARG(p1,any);
 	size_t len;
 
@@ -5443,6 +6012,11 @@ builtins g_files_bifs[] =
 	{"accept", 2, fn_accept_2, "+stream,-stream", false, BLAH},
 	{"bread", 3, fn_bread_3, "+stream,+integer,-string", false, BLAH},
 	{"bwrite", 2, fn_bwrite_2, "+stream,-string", false, BLAH},
+	{"cork", 2, fn_cork_2, "+stream,+boolean", false, BLAH},
+	{"http_parse_request", 3, fn_http_parse_request_3, "+stream,-compound,-list", false, BLAH},
+	{"http_parse_response", 3, fn_http_parse_response_3, "+stream,-integer,-list", false, BLAH},
+	{"http_read_chunked", 2, fn_http_read_chunked_2, "+stream,-string", false, BLAH},
+	{"http_write_response", 4, fn_http_write_response_4, "+stream,+integer,+list,+string", false, BLAH},
 
 
 #if !defined(_WIN32) && !defined(__wasi__)
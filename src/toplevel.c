@@ -394,7 +394,7 @@ void dump_vars(query *q, bool partial)
 		q->tab_idx = 0;
 		cell p1;
 		make_atom(&p1, index_from_pool(q->pl, "dump_attvars"));
-		cell *tmp = clone_to_heap(q, false, &p1, 1);
+		cell *tmp = clone_to_heap(q, false, &p1, q->st.curr_frame, 1);
 		pl_idx_t nbr_cells = 0 + p1.nbr_cells;
 		make_end(tmp+nbr_cells);
 		q->st.curr_cell = tmp;
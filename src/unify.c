@@ -5,13 +5,145 @@
 #include "query.h"
 #include "utf8.h"
 
-static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, unsigned depth)
+// Terms are walked using an explicit stack of frames, one per
+// compound being visited, so there is no limit on depth. The last
+// argument of a compound re-uses its parent's frame so long lists
+// don't grow the stack. Cycles are detected by marking the slots of
+// bound variables on the current path, which are unmarked again when
+// the walk moves on past them...
+
+static bool push_walk(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, unsigned nbr_args)
 {
-	if (depth == MAX_DEPTH) {
-		q->cycle_error = true;
-		return ERR_CYCLE_CMP;
+	if (q->walks_top == q->walks_size) {
+		unsigned n = q->walks_size ? q->walks_size * 2 : 64;
+		walk *w = realloc(q->walks, sizeof(walk)*n);
+
+		if (!w) {
+			q->is_oom = true;
+			return false;
+		}
+
+		q->walks = w;
+		q->walks_size = n;
+	}
+
+	walk *w = q->walks + q->walks_top++;
+	w->p1 = p1;
+	w->p1_ctx = p1_ctx;
+	w->p2 = p2;
+	w->p2_ctx = p2_ctx;
+	w->nbr_args = nbr_args;
+	w->marks = w->arg_marks = q->walk_marks_top;
+	return true;
+}
+
+static bool walk_descend(query *q, unsigned base, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
+{
+	if (q->walks_top > base) {
+		walk *w = q->walks + q->walks_top - 1;
+
+		if (!w->nbr_args) {
+			w->p1 = p1 + 1;
+			w->p1_ctx = p1_ctx;
+			w->p2 = p2 ? p2 + 1 : NULL;
+			w->p2_ctx = p2_ctx;
+			w->nbr_args = p1->arity;
+			w->arg_marks = q->walk_marks_top;
+			return true;
+		}
 	}
 
+	return push_walk(q, p1+1, p1_ctx, p2 ? p2+1 : NULL, p2_ctx, p1->arity);
+}
+
+static bool is_marked(const slot *e, unsigned which)
+{
+	return which == 0 ? e->mark : which == 1 ? e->mark1 : e->mark2;
+}
+
+static void set_mark(slot *e, unsigned which, bool on)
+{
+	if (which == 0)
+		e->mark = on;
+	else if (which == 1)
+		e->mark1 = on;
+	else
+		e->mark2 = on;
+}
+
+static bool push_mark(query *q, slot *e, unsigned which)
+{
+	if (q->walk_marks_top == q->walk_marks_size) {
+		unsigned n = q->walk_marks_size ? q->walk_marks_size * 2 : 256;
+		walk_mark *m = realloc(q->walk_marks, sizeof(walk_mark)*n);
+
+		if (!m) {
+			q->is_oom = true;
+			return false;
+		}
+
+		q->walk_marks = m;
+		q->walk_marks_size = n;
+	}
+
+	walk_mark *m = q->walk_marks + q->walk_marks_top++;
+	m->e = e;
+	m->which = which;
+	set_mark(e, which, true);
+	return true;
+}
+
+static void pop_marks(query *q, unsigned to)
+{
+	while (q->walk_marks_top > to) {
+		const walk_mark *m = q->walk_marks + --q->walk_marks_top;
+		set_mark(m->e, m->which, false);
+	}
+}
+
+// Return the innermost frame with an argument left to visit...
+
+static walk *walk_next(query *q, unsigned base)
+{
+	while (q->walks_top > base) {
+		walk *w = q->walks + q->walks_top - 1;
+		pop_marks(q, w->arg_marks);
+
+		if (w->nbr_args)
+			return w;
+
+		pop_marks(q, w->marks);
+		q->walks_top--;
+	}
+
+	return NULL;
+}
+
+static void walk_done(query *q, unsigned base, unsigned marks)
+{
+	pop_marks(q, marks);
+	q->walks_top = base;
+}
+
+// The slot of a variable argument, this is what gets marked while
+// visiting its value...
+
+static slot *var_slot(query *q, const cell *c, pl_idx_t c_ctx)
+{
+	if (is_ref(c))
+		c_ctx = c->var_ctx;
+
+	const frame *f = GET_FRAME(c_ctx);
+	return GET_SLOT(f, c->var_nbr);
+}
+
+static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx);
+
+// Compare two cells, if they are compounds with the same name and
+// arity then set *descend* so the caller visits the args...
+
+static int compare_cells(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, bool *descend)
+{
 	if (is_variable(p1)) {
 		if (is_variable(p2)) {
 			if (p1_ctx < p2_ctx)
@@ -57,6 +189,29 @@ static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_id
 		return -1;
 	}
 
+	// Blobs sort after atoms and before compounds, dicts then arrays.
+	// Dicts go by size and then entry by entry, arrays are mutable and
+	// go by address...
+
+	if (is_blob(p1) || is_blob(p2)) {
+		if (!is_blob(p2))
+			return is_number(p2) || is_iso_atom(p2) ? 1 : -1;
+
+		if (!is_blob(p1))
+			return is_number(p1) || is_iso_atom(p1) ? -1 : 1;
+
+		unsigned k1 = p1->flags & (FLAG_BLOB_DICT|FLAG_BLOB_ARRAY);
+		unsigned k2 = p2->flags & (FLAG_BLOB_DICT|FLAG_BLOB_ARRAY);
+
+		if (k1 != k2)
+			return k1 < k2 ? -1 : 1;
+
+		if (is_dict(p1))
+			return dict_compare(q, p1, p2);
+
+		return p1->val_blob < p2->val_blob ? -1 : p1->val_blob > p2->val_blob ? 1 : 0;
+	}
+
 	if (is_iso_atom(p1) && is_iso_atom(p2))
 		return CMP_STR_STR(q, p1, p2);
 
@@ -76,9 +231,6 @@ static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_id
 	if (p1->arity > p2->arity)
 		return 1;
 
-	if (is_string(p1) && is_string(p2))
-		return CMP_STR_STR(q, p1, p2);
-
 	if ((is_string(p1) && is_iso_list(p2))
 		|| (is_string(p2) && is_iso_list(p1))) {
 		LIST_HANDLER(p1);
@@ -93,7 +245,7 @@ static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_id
 			h2 = deref(q, h2, p2_ctx);
 			pl_idx_t h2_ctx = q->latest_ctx;
 
-			int val = compare_internal(q, h1, h1_ctx, h2, h2_ctx, depth+1);
+			int val = compare_internal(q, h1, h1_ctx, h2, h2_ctx);
 			if (val) return val;
 
 			p1 = LIST_TAIL(p1);
@@ -110,96 +262,100 @@ static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_id
 		if (is_list(p2))
 			return -1;
 
-		return compare_internal(q, p1, p1_ctx, p2, p2_ctx, depth+1);
+		return compare_internal(q, p1, p1_ctx, p2, p2_ctx);
 	}
 
 	int val = CMP_STR_STR(q, p1, p2);
 	if (val) return val>0?1:-1;
 
-	int arity = p1->arity;
-	p1 = p1 + 1;
-	p2 = p2 + 1;
+	if (!is_interned(p1) || !is_interned(p2))
+		return is_interned(p1) ? 1 : is_interned(p2) ? -1 : 0;
 
-	while (arity--) {
+	*descend = true;
+	return 0;
+}
+
+// If an arg is a variable already on the path in both terms then
+// the rest of that compound compares as equal. If only in one then
+// it compares as the variable itself...
+
+static int compare_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
+{
+	unsigned base = q->walks_top, marks = q->walk_marks_top;
+	int val = 0;
+
+	while (true) {
 		CHECK_INTERRUPT();
-		cell *c1 = deref(q, p1, p1_ctx);
-		pl_idx_t c1_ctx = q->latest_ctx;
-		cell *c2 = deref(q, p2, p2_ctx);
-		pl_idx_t c2_ctx = q->latest_ctx;
-		reflist r1 = {0}, r2 = {0};
-		bool cycle1 = false, cycle2 = false;
-
-		if (q->info1) {
-			if (is_variable(p1)) {
-				if (is_in_ref_list(p1, p1_ctx, q->info1->r1)) {
-					c1 = p1;
-					c1_ctx = p1_ctx;
+		bool descend = false;
+
+		if ((val = compare_cells(q, p1, p1_ctx, p2, p2_ctx, &descend)) != 0)
+			break;
+
+		if (descend && !walk_descend(q, base, p1, p1_ctx, p2, p2_ctx))
+			break;
+
+		walk *w;
+
+		while ((w = walk_next(q, base)) != NULL) {
+			cell *c1 = w->p1, *c2 = w->p2;
+			pl_idx_t c1_ctx = w->p1_ctx, c2_ctx = w->p2_ctx;
+			w->p1 += c1->nbr_cells;
+			w->p2 += c2->nbr_cells;
+			w->nbr_args--;
+			p1 = deref(q, c1, c1_ctx);
+			p1_ctx = q->latest_ctx;
+			p2 = deref(q, c2, c2_ctx);
+			p2_ctx = q->latest_ctx;
+			bool cycle1 = false, cycle2 = false;
+
+			if (is_variable(c1) && is_structure(p1)) {
+				slot *e = var_slot(q, c1, c1_ctx);
+
+				if (e->mark1)
 					cycle1 = true;
-				} else {
-					r1.next = q->info1->r1;
-					r1.var_nbr = p1->var_nbr;
-					r1.ctx = p1_ctx;
-					q->info1->r1 = &r1;
-				}
+				else if (!push_mark(q, e, 1))
+					break;
 			}
-		}
 
-		if (q->info2) {
-			if (is_variable(p2)) {
-				if (is_in_ref_list(p2, p2_ctx, q->info2->r2)) {
-					c2 = p2;
-					c2_ctx = p2_ctx;
+			if (is_variable(c2) && is_structure(p2)) {
+				slot *e = var_slot(q, c2, c2_ctx);
+
+				if (e->mark2)
 					cycle2 = true;
-				} else {
-					r2.next = q->info2->r2;
-					r2.var_nbr = p2->var_nbr;
-					r2.ctx = p2_ctx;
-					q->info2->r2 = &r2;
-				}
+				else if (!push_mark(q, e, 2))
+					break;
 			}
-		}
 
-		if (cycle1 && cycle2)
-			return 0;
+			if (cycle1 && cycle2) {
+				w->nbr_args = 0;
+				continue;
+			}
 
-		int val = compare_internal(q, c1, c1_ctx, c2, c2_ctx, depth+1);
-		if (val) return val;
+			if (cycle1) {
+				p1 = c1;
+				p1_ctx = c1_ctx;
+			}
 
-		if (q->info1) {
-			if (is_variable(p1))
-				q->info1->r1 = r1.next;		// restore
-		}
+			if (cycle2) {
+				p2 = c2;
+				p2_ctx = c2_ctx;
+			}
 
-		if (q->info2) {
-			if (is_variable(p2))
-				q->info2->r2 = r2.next;		// restore
+			break;
 		}
 
-		p1 += p1->nbr_cells;
-		p2 += p2->nbr_cells;
+		if (!w || q->is_oom)
+			break;
 	}
 
-	return 0;
+	walk_done(q, base, marks);
+	return val;
 }
 
-// FIXME: rewrite this using efficient sweep/mark methodology...
-
 int compare(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
 {
 	q->cycle_error = false;
-	bool is_partial;
-
-	if (is_iso_list(p1) && is_iso_list(p2)) {
-		if (check_list(q, p1, p1_ctx, &is_partial, NULL) && check_list(q, p2, p2_ctx, &is_partial, NULL))
-			return compare_internal(q, p1, p1_ctx, p2, p2_ctx, 0);
-	}
-
-	cycle_info info1 = {0}, info2 = {0};
-	q->info1 = &info1;
-	q->info2 = &info2;
-	int ok = compare_internal(q, p1, p1_ctx, p2, p2_ctx, 0);
-	q->info1 = q->info2 = NULL;
-	return ok;
+	return compare_internal(q, p1, p1_ctx, p2, p2_ctx);
 }
 
 bool accum_var(query *q, const cell *c, pl_idx_t c_ctx)
@@ -243,7 +399,7 @@ static void collect_list_vars_internal(query *q, cell *p1, pl_idx_t p1_ctx)
 	pl_idx_t l_ctx = p1_ctx;
 	LIST_HANDLER(l);
 
-	while (is_iso_list(l)) {
+	while (is_iso_list(l) && !is_ground_term(l)) {
 		CHECK_INTERRUPT();
 		cell *c = LIST_HEAD(l);
 		pl_idx_t c_ctx = l_ctx;
@@ -291,7 +447,7 @@ static void collect_vars_internal(query *q, cell *p1, pl_idx_t p1_ctx)
 		return;
 	}
 
-	if (!is_structure(p1))
+	if (!is_structure(p1) || is_ground_term(p1))
 		return;
 
 	if (is_iso_list(p1)) {
@@ -346,7 +502,7 @@ static bool has_list_vars_internal(query *q, cell *p1, pl_idx_t p1_ctx)
 	pl_idx_t l_ctx = p1_ctx;
 	LIST_HANDLER(l);
 
-	while (is_iso_list(l)) {
+	while (is_iso_list(l) && !is_ground_term(l)) {
 		CHECK_INTERRUPT();
 		cell *c = LIST_HEAD(l);
 		pl_idx_t c_ctx = l_ctx;
@@ -395,7 +551,7 @@ static bool has_vars_internal(query *q, cell *p1, pl_idx_t p1_ctx)
 	if (is_variable(p1))
 		return true;
 
-	if (!is_structure(p1))
+	if (!is_structure(p1) || is_ground_term(p1))
 		return false;
 
 	if (is_iso_list(p1))
@@ -440,151 +596,116 @@ bool has_vars(query *q, cell *p1, pl_idx_t p1_ctx)
 	return has_vars_internal(q, p1, p1_ctx);
 }
 
-static bool is_cyclic_term_internal(query *q, cell *p1, pl_idx_t p1_ctx);
-
-static bool is_cyclic_list_internal(query *q, cell *p1, pl_idx_t p1_ctx)
+static bool is_cyclic_term_internal(query *q, cell *p1, pl_idx_t p1_ctx)
 {
-	cell *l = p1;
-	pl_idx_t l_ctx = p1_ctx;
-	bool ret_val = false;
-	LIST_HANDLER(l);
-	unsigned depth = 0;
+	if (!is_structure(p1))
+		return false;
 
-	while (is_iso_list(l)) {
-		CHECK_INTERRUPT();
-		cell *c = LIST_HEAD(l);
-		pl_idx_t c_ctx = l_ctx;
+	unsigned base = q->walks_top, marks = q->walk_marks_top;
+	bool cyclic = false;
 
-		if (is_variable(c)) {
-			const frame *f = GET_FRAME(c_ctx);
-			slot *e = GET_SLOT(f, c->var_nbr);
+	if (!push_walk(q, p1+1, p1_ctx, NULL, 0, p1->arity))
+		return false;
 
-			if (e->mark) {
-				e->mark = false;
-				ret_val = true;
-				break;
-			}
+	walk *w;
 
-			e->mark = true;
+	while ((w = walk_next(q, base)) != NULL) {
+		CHECK_INTERRUPT();
+		cell *c = w->p1;
+		pl_idx_t c_ctx = w->p1_ctx;
+		w->p1 += c->nbr_cells;
+		w->nbr_args--;
 
+		if (is_variable(c)) {
+			slot *e = var_slot(q, c, c_ctx);
 			c = deref(q, c, c_ctx);
 			c_ctx = q->latest_ctx;
 
-			if (is_cyclic_term_internal(q, c, c_ctx)) {
-				e->mark = false;
-				ret_val = true;
-				break;
-			}
-
-			e->mark = false;
-		} else {
-			if (is_cyclic_term_internal(q, c, c_ctx)) {
-				ret_val = true;
-				break;
-			}
-		}
-
-		l = LIST_TAIL(l);
-
-		if (is_variable(l)) {
-			const frame *f = GET_FRAME(l_ctx);
-			slot *e = GET_SLOT(f, l->var_nbr);
-			l = deref(q, l, l_ctx);
-			l_ctx = q->latest_ctx;
+			if (!is_structure(c))
+				continue;
 
 			if (e->mark) {
-				ret_val = true;
+				cyclic = true;
 				break;
 			}
 
-			e->mark = true;
+			if (!push_mark(q, e, 0))
+				break;
 		}
 
-		depth++;
+		if (is_structure(c) && !walk_descend(q, base, c, c_ctx, NULL, 0))
+			break;
 	}
 
-	if (!ret_val)
-		ret_val = is_cyclic_term_internal(q, l, l_ctx);
-
-	l = p1;
-	l_ctx = p1_ctx;
-	unsigned depth2 = 0;
-
-	while (is_iso_list(l)) {
-		CHECK_INTERRUPT();
-		l = LIST_TAIL(l);
-
-		if (is_variable(l)) {
-			const frame *f = GET_FRAME(l_ctx);
-			slot *e = GET_SLOT(f, l->var_nbr);
-			e->mark = false;
-		}
-
-		l = deref(q, l, l_ctx);
-		l_ctx = q->latest_ctx;
+	walk_done(q, base, marks);
+	return cyclic;
+}
 
-		if (depth2++ >= depth)
-			break;
-	}
+bool is_cyclic_term(query *q, cell *p1, pl_idx_t p1_ctx)
+{
+	return is_cyclic_term_internal(q, p1, p1_ctx);
+}
 
-	return ret_val;
+bool is_acyclic_term(query *q, cell *p1, pl_idx_t p1_ctx)
+{
+	return !is_cyclic_term_internal(q, p1, p1_ctx);
 }
 
-static bool is_cyclic_term_internal(query *q, cell *p1, pl_idx_t p1_ctx)
+// Does the variable with slot v occur in p1? Compounds flagged as
+// ground at consult time are skipped, as are shared subterms already
+// seen during this search...
+
+static bool is_occurs(query *q, const slot *v, cell *p1, pl_idx_t p1_ctx)
 {
-	if (!is_structure(p1))
+	if (!is_structure(p1) || is_ground_term(p1))
 		return false;
 
-	if (is_iso_list(p1))
-		return is_cyclic_list_internal(q, p1, p1_ctx);
+	unsigned base = q->walks_top, marks = q->walk_marks_top;
+	bool found = false;
+	q->mgen++;
 
-	pl_idx_t nbr_cells = p1->nbr_cells - 1;
-	unsigned arity = p1->arity;
-	p1++;
+	if (!push_walk(q, p1+1, p1_ctx, NULL, 0, p1->arity))
+		return false;
 
-	while (arity--) {
+	walk *w;
+
+	while ((w = walk_next(q, base)) != NULL) {
 		CHECK_INTERRUPT();
+		cell *c = w->p1;
+		pl_idx_t c_ctx = w->p1_ctx;
+		w->p1 += c->nbr_cells;
+		w->nbr_args--;
 
-		if (is_variable(p1)) {
-			const frame *f = GET_FRAME(p1_ctx);
-			slot *e = GET_SLOT(f, p1->var_nbr);
-			cell *c = deref(q, p1, p1_ctx);
-			pl_idx_t c_ctx = q->latest_ctx;
+		if (is_variable(c)) {
+			slot *e = var_slot(q, c, c_ctx);
 
-			if (!is_variable(c)) {
-				if (e->mark) {
-					e->mark = false;
-					return true;
-				}
+			if (e == v) {
+				found = true;
+				break;
+			}
 
-				e->mark = true;
+			if (e->mgen == q->mgen)
+				continue;
 
-				if (is_cyclic_term_internal(q, c, c_ctx)) {
-					e->mark = false;
-					return true;
-				}
+			e->mgen = q->mgen;
+			c = deref(q, c, c_ctx);
+			c_ctx = q->latest_ctx;
 
-				e->mark = false;
+			if (is_variable(c) && (var_slot(q, c, c_ctx) == v)) {
+				found = true;
+				break;
 			}
-		} else {
-			if (is_cyclic_term_internal(q, p1, p1_ctx))
-				return true;
 		}
 
-		p1 += p1->nbr_cells;
-	}
-
-	return false;
-}
+		if (!is_structure(c) || is_ground_term(c))
+			continue;
 
-bool is_cyclic_term(query *q, cell *p1, pl_idx_t p1_ctx)
-{
-	return is_cyclic_term_internal(q, p1, p1_ctx);
-}
+		if (!walk_descend(q, base, c, c_ctx, NULL, 0))
+			break;
+	}
 
-bool is_acyclic_term(query *q, cell *p1, pl_idx_t p1_ctx)
-{
-	return !is_cyclic_term_internal(q, p1, p1_ctx);
+	walk_done(q, base, marks);
+	return found;
 }
 
 static cell *term_next(query *q, cell *c, pl_idx_t *c_ctx, bool *done)
@@ -817,40 +938,144 @@ bool fn_sys_redo_trail_0(query * q)
 	return true;
 }
 
+// The attributes of library(freeze), library(dif) & library(when)
+// each hold an open-ended list of s(Done,Goal) suspensions, so they
+// are woken here without undoing the trail for verify_attributes/3.
+// A suspension may be on several vars, so waking one binds its Done
+// and it's skipped thereafter. With var_nbr set each live Goal gets
+// bound to a fresh var from there on...
+
+static unsigned wake_suspensions(query *q, bool *other, unsigned var_nbr, bool wake)
+{
+	unsigned cnt = 0;
+
+	for (pl_idx_t i = q->undo_lo_tp; i < q->undo_hi_tp; i++) {
+		const trail *tr = q->trails + i;
+		cell *l = tr->attrs;
+		pl_idx_t l_ctx = tr->attrs_ctx;
+
+		if (!l)
+			continue;
+
+		LIST_HANDLER(l);
+
+		while (is_iso_list(l)) {
+			cell *h = deref(q, LIST_HEAD(l), l_ctx);
+			pl_idx_t h_ctx = q->latest_ctx;
+			l = LIST_TAIL(l);
+			l = deref(q, l, l_ctx);
+			l_ctx = q->latest_ctx;
+
+			if (!is_structure(h) || (h->val_off != g_pair_s) || (h->arity != 2))
+				continue;
+
+			cell *key = deref(q, h+1, h_ctx);
+			cell *attr = deref(q, h+1+h[1].nbr_cells, h_ctx);
+			pl_idx_t attr_ctx = q->latest_ctx;
+
+			if (!is_interned(key) || ((key->val_off != g_frozen_s)
+				&& (key->val_off != g_dif_s) && (key->val_off != g_when_s))) {
+				*other = true;
+				continue;
+			}
+
+			if (!is_structure(attr) || (attr->arity != 1))
+				continue;
+
+			cell *s = deref(q, attr+1, attr_ctx);
+			pl_idx_t s_ctx = q->latest_ctx;
+			LIST_HANDLER(s);
+
+			while (is_iso_list(s)) {
+				cell *c = deref(q, LIST_HEAD(s), s_ctx);
+				pl_idx_t c_ctx = q->latest_ctx;
+				s = LIST_TAIL(s);
+				s = deref(q, s, s_ctx);
+				s_ctx = q->latest_ctx;
+
+				if (!is_structure(c) || (c->arity != 2))
+					continue;
+
+				cell *done = deref(q, c+1, c_ctx);
+				pl_idx_t done_ctx = q->latest_ctx;
+
+				if (!is_variable(done))
+					continue;
+
+				if (wake) {
+					cell *goal = deref(q, c+1+c[1].nbr_cells, c_ctx);
+					pl_idx_t goal_ctx = q->latest_ctx;
+					cell tmp, v;
+					make_atom(&tmp, g_nil_s);
+					set_var(q, done, done_ctx, &tmp, q->st.curr_frame);
+					make_var(&v, g_anon_s, var_nbr+cnt);
+					set_var(q, &v, q->st.curr_frame, goal, goal_ctx);
+				}
+
+				cnt++;
+			}
+		}
+	}
+
+	return cnt;
+}
+
 bool do_post_unification_hook(query *q, bool is_builtin)
 {
 	q->run_hook = false;
 	q->undo_lo_tp = q->before_hook_tp;
 	q->undo_hi_tp = q->st.tp;
 
-	cell *tmp = alloc_on_heap(q, 3);
+	// Count first, as creating the vars can move the slots...
+
+	bool other = false;
+	unsigned cnt = wake_suspensions(q, &other, 0, false);
+
+	if (!cnt && !other)
+		return true;
+
+	unsigned var_nbr = cnt ? create_vars(q, cnt) : 0;
+
+	if (cnt)
+		cnt = wake_suspensions(q, &other, var_nbr, true);
+
+	cell *tmp = alloc_on_heap(q, 1+(other?1:0)+(cnt*2)+1);
 	check_heap_error(tmp);
 	// Needed for follow() to work
 	*tmp = (cell){0};
 	tmp[0].tag = TAG_EMPTY;
 	tmp[0].nbr_cells = 1;
 	tmp[0].flags = FLAG_BUILTIN;
+	pl_idx_t nbr_cells = 1;
 
-	tmp[1].tag = TAG_INTERNED;
-	tmp[1].nbr_cells = 1;
-	tmp[1].arity = 0;
-	tmp[1].flags = 0;
-	tmp[1].val_off = g_post_unify_hook_s;
-	tmp[1].match = search_predicate(q->pl->user_m, tmp+1);
+	if (other) {
+		cell *c = tmp + nbr_cells++;
+		make_atom(c, g_post_unify_hook_s);
+		c->match = search_predicate(q->pl->user_m, c);
 
-	if (!tmp[1].match)
-		return throw_error(q, tmp+1, q->st.curr_frame, "existence_error", "procedure");
+		if (!c->match)
+			return throw_error(q, c, q->st.curr_frame, "existence_error", "procedure");
+	}
+
+	for (unsigned i = 0; i < cnt; i++) {
+		cell *c = tmp + nbr_cells;
+		make_struct(c, g_call_s, fn_iso_call_1, 1, 1);
+		make_var(c+1, g_anon_s, var_nbr+i);
+		c[1].flags |= FLAG_REF;
+		c[1].var_ctx = q->st.curr_frame;
+		nbr_cells += 2;
+	}
 
 	if (is_builtin)
-		make_return(q, tmp+2);
+		make_return(q, tmp+nbr_cells);
 	else
-		make_return2(q, tmp+2, q->st.curr_cell);
+		make_return2(q, tmp+nbr_cells, q->st.curr_cell);
 
 	q->st.curr_cell = tmp;
 	return true;
 }
 
-static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, unsigned depth);
+static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx);
 
 // This is for when one arg is a string & the other an iso-list...
 
@@ -872,7 +1097,7 @@ static bool unify_string_to_list(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2,
 		c2 = deref(q, c2, p2_ctx);
 		pl_idx_t c2_ctx = q->latest_ctx;
 
-		if (!unify_internal(q, c1, c1_ctx, c2, c2_ctx, 0)) {
+		if (!unify_internal(q, c1, c1_ctx, c2, c2_ctx)) {
 			if (q->cycle_error)
 				return true;
 
@@ -890,7 +1115,7 @@ static bool unify_string_to_list(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2,
 		p2_ctx = q->latest_ctx;
 	}
 
-	return unify_internal(q, p1, p1_ctx, p2, p2_ctx, 0);
+	return unify_internal(q, p1, p1_ctx, p2, p2_ctx);
 }
 
 static bool unify_integers(query *q, cell *p1, cell *p2)
@@ -940,6 +1165,20 @@ static bool unify_cstrings(query *q, cell *p1, cell *p2)
 	return false;
 }
 
+static bool unify_blobs(query *q, cell *p1, cell *p2)
+{
+	if (!is_blob(p2))
+		return false;
+
+	if (p1->val_blob == p2->val_blob)
+		return true;
+
+	if (is_dict(p1) && is_dict(p2))
+		return dict_equal(q, p1, p2);
+
+	return false;
+}
+
 struct dispatch {
 	uint8_t tag;
 	bool (*fn)(query*, cell*, cell*);
@@ -953,163 +1192,20 @@ static const struct dispatch g_disp[] =
 	{TAG_CSTR, unify_cstrings},
 	{TAG_INTEGER, unify_integers},
 	{TAG_FLOAT, unify_reals},
+	{TAG_PTR, NULL},
+	{TAG_BLOB, unify_blobs},
 	{0}
 };
 
-static bool unify_lists(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, unsigned depth)
-{
-	if (depth > MAX_DEPTH) {
-		//printf("*** OOPS %s %d\n", __FILE__, __LINE__);
-		return false;
-	}
-
-	cell *save_p1 = p1, *save_p2 = p2;
-	pl_idx_t save_p1_ctx = p1_ctx, save_p2_ctx = p2_ctx;
-	LIST_HANDLER(p1);
-	LIST_HANDLER(p2);
-
-	while (is_iso_list(p1) && is_iso_list(p2)) {
-		CHECK_INTERRUPT();
-		cell *h1 = LIST_HEAD(p1);
-		h1 = deref(q, h1, p1_ctx);
-		pl_idx_t h1_ctx = q->latest_ctx;
-		cell *h2 = LIST_HEAD(p2);
-		h2 = deref(q, h2, p2_ctx);
-		pl_idx_t h2_ctx = q->latest_ctx;
-
-		if ((h1 == save_p1) && (h1_ctx == save_p1_ctx)) {
-			p1 = NULL;
-			break;
-		}
-
-		if ((h2 == save_p2) && (h2_ctx == save_p2_ctx)) {
-			p2 = NULL;
-			break;
-		}
-
-		if (!unify_internal(q, h1, h1_ctx, h2, h2_ctx, depth+1))
-			return false;
-
-		p1 = LIST_TAIL(p1);
-		p1 = deref(q, p1, p1_ctx);
-		p1_ctx = q->latest_ctx;
-		p2 = LIST_TAIL(p2);
-		p2 = deref(q, p2, p2_ctx);
-		p2_ctx = q->latest_ctx;
-
-		if ((p1 == save_p1) && (p1_ctx == save_p1_ctx)) {
-			p1 = NULL;
-			break;
-		}
-
-		if ((p2 == save_p2) && (p2_ctx == save_p2_ctx)) {
-			p2 = NULL;
-			break;
-		}
-	}
-
-	if (!p1 && !p2)
-		return true;
-
-	if (!p1 && is_variable(p2))
-		return true;
-
-	if (!p2 && is_variable(p1))
-		return true;
-
-	if (!p1 || !p2)
-		return false;
-
-	return unify_internal(q, p1, p1_ctx, p2, p2_ctx, depth+1);
-}
-
-static bool unify_structs(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, unsigned depth)
-{
-	if (p1->arity != p2->arity)
-		return false;
-
-	if (p1->val_off != p2->val_off)
-		return false;
-
-	if (depth > MAX_DEPTH) {
-		//printf("*** OOPS %s %d\n", __FILE__, __LINE__);
-		return false;
-	}
-
-	unsigned arity = p1->arity;
-	p1++; p2++;
-
-	while (arity--) {
-		CHECK_INTERRUPT();
-		cell *c1 = deref(q, p1, p1_ctx);
-		pl_idx_t c1_ctx = q->latest_ctx;
-		cell *c2 = deref(q, p2, p2_ctx);
-		pl_idx_t c2_ctx = q->latest_ctx;
-		reflist r1 = {0}, r2 = {0};
-
-		if (q->info1) {
-			int both = 0;
-
-			if (is_variable(p1)) {
-				if (is_in_ref_list(p1, p1_ctx, q->info1->r1)) {
-					//c1 = p1;
-					//c1_ctx = p1_ctx;
-					both++;
-				} else {
-					r1.next = q->info1->r1;
-					r1.var_nbr = p1->var_nbr;
-					r1.ctx = p1_ctx;
-					q->info1->r1 = &r1;
-				}
-			}
+enum { UNIFY_FAIL, UNIFY_OK, UNIFY_DESCEND };
 
-			if (is_variable(p2)) {
-				if (is_in_ref_list(p2, p2_ctx, q->info2->r2)) {
-					//c2 = p2;
-					//c2_ctx = p2_ctx;
-					both++;
-				} else {
-					r2.next = q->info2->r2;
-					r2.var_nbr = p2->var_nbr;
-					r2.ctx = p2_ctx;
-					q->info2->r2 = &r2;
-				}
-			}
+// Unify two cells, if they are compounds with the same name and
+// arity then return UNIFY_DESCEND so the caller visits the args...
 
-			if (both == 2) {
-				return true;
-			}
-		}
-
-		if (!unify_internal(q, c1, c1_ctx, c2, c2_ctx, depth+1))
-			return false;
-
-		if (q->info1) {
-			if (is_variable(p1))
-				q->info1->r1 = r1.next;		// restore
-		}
-
-		if (q->info2) {
-			if (is_variable(p2))
-				q->info2->r2 = r2.next;		// restore
-		}
-
-		p1 += p1->nbr_cells;
-		p2 += p2->nbr_cells;
-	}
-
-	return true;
-}
-
-static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx, unsigned depth)
+static int unify_cells(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
 {
 	if ((p1 == p2) && (p1_ctx == p2_ctx))
-		return true;
-
-	if (depth > MAX_DEPTH) {
-		//printf("*** OOPS %s %d\n", __FILE__, __LINE__);
-		return false;
-	}
+		return UNIFY_OK;
 
 	if (is_variable(p1) && is_variable(p2)) {
 		if (p2_ctx > p1_ctx)
@@ -1121,7 +1217,7 @@ static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx
 		else if (p2->var_nbr < p1->var_nbr)
 			set_var(q, p1, p1_ctx, p2, p2_ctx);
 
-		return true;
+		return UNIFY_OK;
 	}
 
 	if (is_variable(p2)) {
@@ -1135,29 +1231,23 @@ static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx
 		q->has_vars = true;
 
 	if (is_variable(p1)) {
-		bool was_cyclic = false;
-
-		if (q->flags.occurs_check == OCCURS_CHECK_TRUE) {
-			if (is_cyclic_term(q, p2, p2_ctx))
-				was_cyclic = true;
-		} else if (q->flags.occurs_check == OCCURS_CHECK_ERROR) {
-			if (is_cyclic_term(q, p2, p2_ctx))
-				was_cyclic = true;
-		}
+		if (is_structure(p2) && (p2_ctx == q->st.fp))
+			q->head_shared = true;
 
-		set_var(q, p1, p1_ctx, p2, p2_ctx);
+		// A first occurrence in a clause head being matched can't be
+		// in p2 unless a goal var was bound to part of that head...
 
-		if (q->flags.occurs_check == OCCURS_CHECK_TRUE) {
-			if (!was_cyclic && is_cyclic_term(q, p2, p2_ctx))
-				return false;
-		} else if (q->flags.occurs_check == OCCURS_CHECK_ERROR) {
-			if (!was_cyclic && is_cyclic_term(q, p2, p2_ctx)) {
+		if (q->flags.occurs_check != OCCURS_CHECK_FALSE
+			&& !(is_first_var(p1) && (p1_ctx == q->st.fp) && !q->head_shared)
+			&& is_occurs(q, var_slot(q, p1, p1_ctx), p2, p2_ctx)) {
+			if (q->flags.occurs_check == OCCURS_CHECK_ERROR)
 				q->cycle_error = true;
-				return false;
-			}
+
+			return UNIFY_FAIL;
 		}
 
-		return true;
+		set_var(q, p1, p1_ctx, p2, p2_ctx);
+		return UNIFY_OK;
 	}
 
 	q->check_unique = true;
@@ -1171,38 +1261,103 @@ static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx
 	if (is_string(p2) && is_list(p1))
 		return unify_string_to_list(q, p2, p2_ctx, p1, p1_ctx);
 
-	if (q->lists_ok && is_iso_list(p1) && is_iso_list(p2))
-		return unify_lists(q, p1, p1_ctx, p2, p2_ctx, depth+1);
+	if (p1->arity || p2->arity) {
+		if (!is_interned(p1) || !is_interned(p2))
+			return UNIFY_FAIL;
+
+		if ((p1->arity != p2->arity) || (p1->val_off != p2->val_off))
+			return UNIFY_FAIL;
 
-	if (p1->arity || p2->arity)
-		return unify_structs(q, p1, p1_ctx, p2, p2_ctx, depth+1);
+		return UNIFY_DESCEND;
+	}
 
 	return g_disp[p1->tag].fn(q, p1, p2);
 }
 
-// FIXME: rewrite this using efficient sweep/mark methodology...
+// If an arg is a variable already on the path in both terms then
+// the rest of that compound unifies...
 
-bool unify(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
+static bool unify_internal(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
 {
-	q->cycle_error = false;
+	unsigned base = q->walks_top, marks = q->walk_marks_top;
+	bool ok = true;
+
+	while (true) {
+		CHECK_INTERRUPT();
+		int status = unify_cells(q, p1, p1_ctx, p2, p2_ctx);
+
+		if (status == UNIFY_FAIL) {
+			ok = false;
+			break;
+		}
+
+		if ((status == UNIFY_DESCEND) && !walk_descend(q, base, p1, p1_ctx, p2, p2_ctx)) {
+			ok = false;
+			break;
+		}
+
+		walk *w;
+
+		while ((w = walk_next(q, base)) != NULL) {
+			cell *c1 = w->p1, *c2 = w->p2;
+			pl_idx_t c1_ctx = w->p1_ctx, c2_ctx = w->p2_ctx;
+			w->p1 += c1->nbr_cells;
+			w->p2 += c2->nbr_cells;
+			w->nbr_args--;
+
+			// Skip runs of identical atomic args...
+
+			if ((is_smallint(c1) && is_smallint(c2) && (c1->val_int == c2->val_int))
+				|| (is_interned(c1) && is_interned(c2) && !c1->arity && !c2->arity
+					&& (c1->val_off == c2->val_off))) {
+				q->check_unique = true;
+				continue;
+			}
+
+			p1 = deref(q, c1, c1_ctx);
+			p1_ctx = q->latest_ctx;
+			p2 = deref(q, c2, c2_ctx);
+			p2_ctx = q->latest_ctx;
+			int both = 0;
+
+			if (is_variable(c1) && is_structure(p1)) {
+				slot *e = var_slot(q, c1, c1_ctx);
+
+				if (e->mark1)
+					both++;
+				else if (!push_mark(q, e, 1))
+					break;
+			}
+
+			if (is_variable(c2) && is_structure(p2)) {
+				slot *e = var_slot(q, c2, c2_ctx);
 
-	if (is_iso_list(p1) && is_iso_list(p2)) {
-		bool is_partial;
+				if (e->mark2)
+					both++;
+				else if (!push_mark(q, e, 2))
+					break;
+			}
 
-		if (check_list(q, p1, p1_ctx, &is_partial, NULL) && check_list(q, p2, p2_ctx, &is_partial, NULL)) {
-			q->lists_ok = true;
-			bool ok = unify_lists(q, p1, p1_ctx, p2, p2_ctx, 0);
-			q->lists_ok = false;
-			return ok;
+			if (both == 2) {
+				w->nbr_args = 0;
+				continue;
+			}
+
+			break;
+		}
+
+		if (!w || q->is_oom) {
+			ok = ok && !q->is_oom;
+			break;
 		}
-	} else
-		q->lists_ok = true;
-
-	cycle_info info1 = {0}, info2 = {0};
-	q->info1 = &info1;
-	q->info2 = &info2;
-	bool ok = unify_internal(q, p1, p1_ctx, p2, p2_ctx, 0);
-	q->info1 = q->info2 = NULL;
-	q->lists_ok = false;
+	}
+
+	walk_done(q, base, marks);
 	return ok;
 }
+
+bool unify(query *q, cell *p1, pl_idx_t p1_ctx, cell *p2, pl_idx_t p2_ctx)
+{
+	q->cycle_error = q->head_shared = false;
+	return unify_internal(q, p1, p1_ctx, p2, p2_ctx);
+}
@@ -6,6 +6,7 @@
 #include <wctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -27,23 +28,133 @@ size_t strlen_utf8(const char *s)
 	return cnt;
 }
 
+// Chars are counted as bytes that aren't continuation bytes (ie. not
+// 10xxxxxx), 8 at a time...
+
+#define CONT_BITS(w) ((w) & ~((w) << 1) & 0x8080808080808080ULL)
+
 size_t substrlen_utf8(const char *s, size_t n)
 {
-	const char *end = s + n;
-	size_t cnt = 0;
+	const unsigned char *src = (const unsigned char *)s;
+	size_t cnt = n;
 
-	while (s < end) {
-		unsigned char ch = *(const unsigned char *)s++;
+	for (; n >= 8; n -= 8, src += 8) {
+		uint64_t w;
+		memcpy(&w, src, 8);
+		cnt -= __builtin_popcountll(CONT_BITS(w));
+	}
 
-		if ((ch < 0x80) || (ch > 0xBF))
-			cnt++;
+	while (n--) {
+		if ((*src++ & 0xC0) == 0x80)
+			cnt--;
 	}
 
 	return cnt;
 }
 
+bool is_ascii_utf8(const char *s, size_t n)
+{
+	const unsigned char *src = (const unsigned char *)s;
+	uint64_t bits = 0;
+
+	for (; n >= 8; n -= 8, src += 8) {
+		uint64_t w;
+		memcpy(&w, src, 8);
+		bits |= w;
+	}
+
+	while (n--)
+		bits |= *src++;
+
+	return !(bits & 0x8080808080808080ULL);
+}
+
+// For long texts record the number of chars before every so many
+// bytes, so a char count or offset needs at most a short scan...
+
+utf8_index *index_utf8(const char *s, size_t n)
+{
+	if (is_ascii_utf8(s, n)) {
+		utf8_index *idx = calloc(1, sizeof(utf8_index));
+		if (idx) idx->is_ascii = true;
+		return idx;
+	}
+
+	size_t nbr = (n / UTF8_INDEX_STEP) + 1;
+	utf8_index *idx = malloc(sizeof(utf8_index) + (sizeof(size_t) * nbr));
+	if (!idx) return NULL;
+	idx->is_ascii = false;
+	idx->nbr = nbr;
+	idx->chars[0] = 0;
+
+	for (size_t i = 1; i < nbr; i++)
+		idx->chars[i] = idx->chars[i-1] + substrlen_utf8(s + ((i-1) * UTF8_INDEX_STEP), UTF8_INDEX_STEP);
+
+	return idx;
+}
+
+// Chars in the first off bytes...
+
+static size_t index_count_utf8(const utf8_index *idx, const char *s, size_t off)
+{
+	if (idx->is_ascii)
+		return off;
+
+	size_t i = off / UTF8_INDEX_STEP;
+	return idx->chars[i] + substrlen_utf8(s + (i * UTF8_INDEX_STEP), off % UTF8_INDEX_STEP);
+}
+
+size_t index_len_utf8(const utf8_index *idx, const char *s, size_t off, size_t n)
+{
+	return index_count_utf8(idx, s, off+n) - index_count_utf8(idx, s, off);
+}
+
+// Byte offset (from off) of the i'th char of the n bytes at off...
+
+size_t index_offset_utf8(const utf8_index *idx, const char *s, size_t off, size_t n, size_t i)
+{
+	if (idx->is_ascii)
+		return i < n ? i : n;
+
+	size_t want = index_count_utf8(idx, s, off) + i;
+	size_t lo = off / UTF8_INDEX_STEP, hi = idx->nbr;
+
+	while ((hi - lo) > 1) {
+		size_t mid = lo + ((hi - lo) / 2);
+
+		if (idx->chars[mid] <= want)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	size_t pos = lo * UTF8_INDEX_STEP, cnt = idx->chars[lo];
+
+	if (pos < off) {
+		pos = off;
+		cnt = want - i;
+	}
+
+	const unsigned char *src = (const unsigned char *)s;
+
+	for (; pos < (off + n); pos++) {
+		if ((src[pos] & 0xC0) == 0x80)
+			continue;
+
+		if (cnt++ == want)
+			return pos - off;
+	}
+
+	return n;
+}
+
 const char *strchr_utf8(const char *s, int ch)
 {
+	// An ASCII byte can't be part of a multi-byte char...
+
+	if ((ch > 0) && (ch < 0x80))
+		return strchr(s, ch);
+
 	const char *src = s;
 
 	while (*src && (peek_char_utf8(src) != ch))
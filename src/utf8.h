@@ -25,6 +25,7 @@ static inline int fgetc_utf8(FILE *fp) { return xgetc_utf8(fgetc, fp); }
 
 extern size_t strlen_utf8(const char *s);						// returns #chars
 extern size_t substrlen_utf8(const char *s, size_t n);			// returns #chars
+extern bool is_ascii_utf8(const char *s, size_t n);
 extern const char *strchr_utf8(const char *s, int ch);
 extern const char *strrchr_utf8(const char *s, int ch);
 
@@ -45,3 +46,19 @@ extern size_t len_char_utf8(const char *src);					// returns #bytes
 
 extern int character_at_pos(const char *src, size_t srclen, size_t i);
 extern size_t offset_at_pos(const char *src, size_t srclen, size_t i);
+
+/*
+ *  Char counts every UTF8_INDEX_STEP bytes of a long text...
+ */
+
+#define UTF8_INDEX_STEP 1024
+
+typedef struct utf8_index_ {
+	bool is_ascii;
+	size_t nbr;
+	size_t chars[];
+} utf8_index;
+
+extern utf8_index *index_utf8(const char *s, size_t n);
+extern size_t index_len_utf8(const utf8_index *idx, const char *s, size_t off, size_t n);
+extern size_t index_offset_utf8(const utf8_index *idx, const char *s, size_t off, size_t n, size_t i);
@@ -0,0 +1,63 @@
+:- use_module(library(http)).
+
+main :-
+	F = 'test084.tmp',
+	open(F, write, W),
+	format(W, "~s", ["\r\nget /index.html?x=1 HTTP/1.1\r\nHost: example.com\r\nContent-TYPE:  text/plain  \r\nX-Empty:\r\n\r\n"]),
+	format(W, "~s", ["HTTP/1.1 404 Not Found\r\nTransfer-Encoding: chunked\r\n\r\n"]),
+	format(W, "~s", ["5\r\nhello\r\n7;ext=1\r\n, world\r\n0\r\nTrailer: x\r\n\r\n"]),
+	http_write_response(W, 200, ["Content-Type":"text/plain", 'X-Count':3], "abc"),
+	close(W),
+	open(F, read, S),
+	http_parse_request(S, Req, Hdrs),
+	writeq(Req), nl,
+	writeq(Hdrs), nl,
+	http_parse_response(S, Code, Hdrs2),
+	writeq(Code-Hdrs2), nl,
+	http_read_chunked(S, Body),
+	writeq(Body), nl,
+	http_parse_response(S, Code3, Hdrs3),
+	bread(S, 3, Body3),
+	writeq(Code3-Hdrs3-Body3), nl,
+	(http_parse_request(S, _, _) -> true ; writeq(eof)), nl,
+	close(S),
+	delete_file(F),
+	bad_chunk("1\r\nA\r\nffffffffffffffff\r\n"),
+	bad_chunk("10000001\r\nx\r\n"),
+	request("Accept: \t*/*\t \r\nX-Empty:  \r\n"),
+	length(Hs, 101),
+	maplist(=("X: y\r\n"), Hs),
+	append(Hs, Text),
+	request(Text),
+	length(L, 9000),
+	maplist(=(0'a), L),
+	append(["X: ", L, "\r\n"], Text2),
+	request(Text2).
+
+request(Text) :-
+	F = 'test084.tmp',
+	open(F, write, W),
+	format(W, "GET / HTTP/1.0\r\n~s\r\n", [Text]),
+	close(W),
+	open(F, read, S),
+	catch(
+		(http_request(S, _, _, _, Hdrs), writeq(Hdrs)),
+		error(E, _),
+		writeq(E)
+	), nl,
+	close(S),
+	delete_file(F).
+
+bad_chunk(Text) :-
+	F = 'test084.tmp',
+	length(L, 20000),
+	maplist(=(0'x), L),
+	open(F, write, W),
+	format(W, "~s~s", [Text, L]),
+	close(W),
+	open(F, read, S),
+	(http_read_chunked(S, _) -> writeq(accepted) ; writeq(rejected)), nl,
+	close(S),
+	delete_file(F).
+
+:- initialization(main).
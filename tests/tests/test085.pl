@@ -0,0 +1,27 @@
+:- use_module(library(dict)).
+:- dynamic(saved/1).
+
+main :-
+	dict:new(D0),
+	dict:set(D0, name, "trealla", D1),
+	dict:set(D1, version, 2, D2),
+	dict:set(D2, tags, [prolog, wam], D3),
+	dict:set(D3, version, 3, D4),
+	dict:size(D4, N4), writeq(size(N4)), nl,
+	dict:get(D2, version, V2), dict:get(D4, version, V4), writeq(V2/V4), nl,
+	dict:get(D4, missing, M, none), writeq(M), nl,
+	(	member(K, [a,b,c]), dict:set(D4, K, 1, D5), dict:size(D5, N5), writeq(K-N5), nl, fail
+	;	true
+	),
+	dict:size(D4, N4b), writeq(after_backtracking(N4b)), nl,
+	dict:del(D4, tags, D6), dict:del(D6, nothere, D7),
+	dict:to_list(D7, L7), msort(L7, S7), writeq(S7), nl,
+	dict:from_list([version:3, name:"trealla"], D8),
+	(D8 == D7 -> writeq(equal) ; writeq(not_equal)), nl,
+	(D8 = D4 -> writeq(unified) ; writeq(not_unified)), nl,
+	assertz(saved(D4)), saved(D9), dict:get(D9, tags, T9), writeq(T9), nl,
+	findall(X, (member(X, [D4, D8])), [_, X8]), dict:size(X8, N8), writeq(N8), nl,
+	catch(dict:set(D4, _, x, _), E, (writeq(E), nl)),
+	writeq(D4), nl.
+
+:- initialization(main).
@@ -0,0 +1,27 @@
+% Compiled arithmetic must agree with the general evaluator
+
+t1(X) :- X is -7 mod 3 + 7 mod -3 * 10.
+t2(X) :- Y = 9223372036854775807, X is Y + 1.
+t3(X) :- Y = 9223372036854775807, X is Y * 2 - Y.
+t4(X) :- Y = 1+2, X is Y * 2.
+t5(X) :- Y = 2.5, X is Y + 1.
+t6(X) :- Y = -9223372036854775808, X is -Y.
+t7(X) :- X is min(3, max(1,2)) /\ 7 \/ 8 - abs(-4) rem 3.
+t8(X) :- Y = -9223372036854775808, X is Y // -1.
+t9(X) :- Y = 0, X is 5 // Y.
+t10(X) :- X is _ + 1.
+t11(X) :- X is -9223372036854775807 - 1.
+t12(X) :- Y = -4611686018427387904, X is -(Y * 2).
+
+loop(N, N) :- !.
+loop(I, N) :- I1 is I + 1, I1 > I, I1 =< N, loop(I1, N).
+
+main :-
+	t1(A), t2(B), t3(C), t4(D), t5(E), t6(F), t7(G), t8(H),
+	writeq([A,B,C,D,E,F,G,H]), nl,
+	catch(t9(_), E1, true), writeq(E1), nl,
+	catch(t10(_), E2, true), writeq(E2), nl,
+	t11(I), t12(J), writeq([I,J]), nl, (I == -9223372036854775808 -> writeq(yes) ; writeq(no)), nl,
+	loop(0, 100000), writeq(done), nl.
+
+:- initialization(main).
@@ -0,0 +1,26 @@
+% Clause selection with atomic head arguments
+
+p(1, a).
+p(2, b).
+p(foo, c).
+p(f(x), d).
+p(X, e) :- integer(X).
+p("str", f).
+p(2.0, g).
+
+q([], nil).
+q([_|_], cons).
+
+main :-
+	findall(X-Y, p(X, Y), L1), writeq(L1), nl,
+	findall(Y, p(2, Y), L2), writeq(L2), nl,
+	findall(Y, p(foo, Y), L3), writeq(L3), nl,
+	findall(Y, p(f(_), Y), L4), writeq(L4), nl,
+	findall(Y, p(f, Y), L5), writeq(L5), nl,
+	findall(Y, p("str", Y), L6), writeq(L6), nl,
+	findall(Y, p(2.0, Y), L7), writeq(L7), nl,
+	findall(Y, q([a], Y), L8), writeq(L8), nl,
+	findall(Y, q("", Y), L9), writeq(L9), nl,
+	findall(Y, q("ab", Y), L10), writeq(L10), nl.
+
+:- initialization(main).
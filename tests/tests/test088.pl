@@ -0,0 +1,20 @@
+% Unification and comparison of deep and cyclic terms
+
+nest(0, T, T) :- !.
+nest(N, T0, T) :- N1 is N-1, nest(N1, f(T0), T).
+
+main :-
+	nest(100000, a, T1), nest(100000, a, T2), nest(100000, b, T3),
+	( T1 = T2 -> writeq(yes) ; writeq(no) ), nl,
+	( T1 = T3 -> writeq(yes) ; writeq(no) ), nl,
+	compare(O1, T1, T3), writeq(O1), nl,
+	( T1 == T2 -> writeq(yes) ; writeq(no) ), nl,
+	nest(100000, _, T4), T4 = T1, writeq(ok), nl,
+	A = f(A, 1), B = f(B, 1), ( A = B -> writeq(yes) ; writeq(no) ), nl,
+	C = f(C, 1), D = f(D, 2), ( C = D -> writeq(yes) ; writeq(no) ), nl,
+	( acyclic_term(T1) -> writeq(yes) ; writeq(no) ), nl,
+	( acyclic_term(A) -> writeq(yes) ; writeq(no) ), nl,
+	set_prolog_flag(occurs_check, true),
+	( X = f(Y), Y = g(Z), Z = h(X) -> writeq(yes) ; writeq(no) ), nl.
+
+:- initialization(main).
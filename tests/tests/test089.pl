@@ -0,0 +1,22 @@
+% Occurs check on head unification and shared subterms
+
+h(f(V), f(g(V))).
+h2(f(V), W, W).
+
+dag(0, T, T) :- !.
+dag(N, T0, T) :- N1 is N-1, dag(N1, f(T0, T0), T).
+
+main :-
+	set_prolog_flag(occurs_check, true),
+	( h(X1, X1) -> writeq(yes) ; writeq(no) ), nl,
+	( h2(X2, X2, g(X2)) -> writeq(yes) ; writeq(no) ), nl,
+	( append([X3], [Y3], [Y3, f(X3)]) -> writeq(yes) ; writeq(no) ), nl,
+	( X4 = f(Y4), Y4 = g(Z4), Z4 = h(X4) -> writeq(yes) ; writeq(no) ), nl,
+	findall(A-B, append(A, B, [1,2]), L), writeq(L), nl,
+	dag(60, a, T), ( X5 = g(T, Y5), Y5 = h(X5) -> writeq(yes) ; writeq(no) ), nl,
+	( X6 = g(T, Y6), Y6 = T -> writeq(yes) ; writeq(no) ), nl,
+	set_prolog_flag(occurs_check, error),
+	catch(X7 = f(X7), E, true), writeq(E), nl,
+	set_prolog_flag(occurs_check, false).
+
+:- initialization(main).
@@ -0,0 +1,38 @@
+% Native wakeup of freeze/2, dif/2 and when/2
+
+:- use_module(library(dif)).
+:- use_module(library(when)).
+:- use_module(library(freeze)).
+
+t(1) :- dif(X, a), (X = a -> write(bad) ; write(ok)).
+t(2) :- dif(X, a), X = b, write(ok).
+t(3) :- dif(f(A,B), f(1,2)), A = 1, (B = 2 -> write(bad) ; write(ok)).
+t(4) :- dif(f(A,B), f(1,2)), A = 1, B = 3, write(ok).
+t(5) :- dif(A, B), (A = B -> write(bad) ; write(ok)).
+t(6) :- dif(A, B), (B = A -> write(bad) ; write(ok)).
+t(7) :- dif(A, B), A = C, (B = C -> write(bad) ; write(ok)).
+t(8) :- (dif(a, a) -> write(bad) ; write(ok)).
+t(9) :- dif(a, b), write(ok).
+t(10) :- dif([A,B,C], [1,2,3]), A=1, B=2, (C=3 -> write(bad) ; write(ok)).
+t(11) :- when(nonvar(X), write(woke(X))), X = 1.
+t(12) :- when(ground(f(X,Y)), write(woke(X,Y))), X = 1, write(mid), Y = 2.
+t(13) :- when((nonvar(X);nonvar(Y)), write(woke)), X = 1, Y = 2.
+t(14) :- when(?=(X,Y), write(woke)), X = f(A), Y = f(B), write(mid), A = B.
+t(15) :- when(?=(X,Y), write(woke)), X = a, write(mid), Y = b.
+t(16) :- when((nonvar(X),nonvar(Y)), write(woke)), X = 1, write(mid), Y = 2.
+t(17) :- catch(when(foo(_), true), error(E, _), (E = domain_error(D, _), write(D))).
+t(18) :- freeze(X, true), frozen(X, G), G = freeze:freeze(V, true), V == X, write(ok).
+t(19) :- dif(X, Y), X = Y -> write(bad) ; write(ok).
+t(20) :- dif(f(X,Z), f(Y,W)), X = Y, write(a), (Z = W -> write(bad) ; write(ok)).
+t(21) :- freeze(X, Y = 1), frozen(X, G), G = freeze:freeze(_, Y1 = 1), (Y1 == Y -> write(ok) ; write(bad)).
+t(22) :- dif(X, a), frozen(X, G), (G == dif:dif(X, a) -> write(ok) ; write(bad)).
+t(23) :- when(nonvar(X), Y = 1), copy_term(X, _, Gs), (Gs == [when:when(nonvar(X), Y = 1)] -> write(ok) ; write(bad)).
+
+main :-
+	between(1, 23, N),
+	write(N), write(': '),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+
+:- initialization(main).
@@ -0,0 +1,38 @@
+% The C assoc operations, and falling back to Prolog
+
+:- use_module(library(assoc)).
+
+t(1) :- list_to_assoc([c-3,a-1,b-2], A), assoc_to_list(A, L), write(L).
+t(2) :- list_to_assoc([c-3,a-1,b-2], A), get_assoc(b, A, V), write(V).
+t(3) :- list_to_assoc([a-1], A), (get_assoc(z, A, _) -> write(bad) ; write(ok)).
+t(4) :- empty_assoc(E), put_assoc(k, E, 1, A), put_assoc(k, A, 2, A2), assoc_to_list(A2, L), write(L).
+t(5) :- list_to_assoc([a-1,b-2,c-3], A), del_assoc(b, A, V, A2), assoc_to_keys(A2, K), write(V/K).
+t(6) :- list_to_assoc([a-1], A), (del_assoc(b, A, _, _) -> write(bad) ; write(ok)).
+t(7) :- list_to_assoc([a-1,b-2], A), put_assoc(c, A, f(X), A2), X = 3, assoc_to_list(A2, L), write(L).
+t(8) :- list_to_assoc([a-1,b-2,c-3], A), min_assoc(A, K1, V1), max_assoc(A, K2, V2), write(K1-V1/K2-V2).
+t(9) :- list_to_assoc([a-1,b-2,c-3], A), del_min_assoc(A, K1, _, A1), del_max_assoc(A1, K2, _, A2), assoc_to_list(A2, L), write(K1/K2/L).
+t(10) :- empty_assoc(E), empty_assoc(E), put_assoc(a, E, 1, A), (empty_assoc(A) -> write(bad) ; write(ok)).
+t(11) :- list_to_assoc([a-1,b-2], A), findall(K-V, gen_assoc(K, A, V), L), write(L).
+t(12) :- list_to_assoc([a-1,b-2], A), map_assoc(succ, A, A2), assoc_to_values(A2, L), write(L).
+t(13) :- list_to_assoc([a-1,b-2], A), (map_assoc(integer, A) -> write(ok) ; write(bad)).
+t(14) :- list_to_assoc([a-1,b-2], A1), list_to_assoc([b-2,a-1], A2), (A1 == A2, A1 = A2 -> write(ok) ; write(bad)).
+t(15) :- list_to_assoc([a-1], A1), list_to_assoc([a-2], A2), compare(O, A1, A2), write(O).
+t(16) :- catch(list_to_assoc([a-1,a-2], _), error(E, _), write(E)).
+t(17) :- list_to_assoc([a-1,b-2], A), get_assoc(a, A, Old, A2, 9), assoc_to_list(A2, L), write(Old/L).
+t(18) :- list_to_assoc([a-1], A), is_assoc(A), ord_list_to_assoc([a-1,b-2], B), is_assoc(B), write(ok).
+t(19) :- list_to_assoc([k-1], A), put_assoc(k, A, 2, _), get_assoc(k, A, V), write(V).
+t(20) :- numlist(1, 1000, L), foldl(ins, L, t, T), empty_assoc(E), foldl(ins, L, E, A),
+	foldl(del3, L, T, T2), foldl(del3, L, A, A2), assoc_to_list(T2, L1), assoc_to_list(A2, L2),
+	(L1 == L2 -> write(ok) ; write(bad)).
+
+ins(K, A0, A) :- V is K * K, put_assoc(K, A0, V, A).
+del3(K, A0, A) :- (K mod 3 =:= 0 -> del_assoc(K, A0, _, A) ; A = A0).
+
+main :-
+	between(1, 20, N),
+	write(N), write(': '),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+
+:- initialization(main).
@@ -0,0 +1,34 @@
+% Native fast paths of library(lists) and their fallbacks
+
+t(1) :- reverse([1,f(X),"s",Y,a], R), X = 2, Y = b, write(R).
+t(2) :- reverse(X, [1,2,3]), write(X).
+t(3) :- append([1,2], [3|T], L), T = [4], write(L).
+t(4) :- append([a,f(X)], Y, L), X = 1, Y = z, write(L).
+t(5) :- findall(X+Y, append(X, Y, [1,2]), L), write(L).
+t(6) :- append([], Z, Z2), Z = 5, write(Z2).
+t(7) :- memberchk(b, [a,b,c]), write(ok).
+t(8) :- (memberchk(d, [a,b,c]) -> write(bad) ; write(ok)).
+t(9) :- memberchk(f(X), [a,g(1),f(2),f(3)]), write(X).
+t(10) :- memberchk(X, [a,b]), write(X).
+t(11) :- L = [a|_], memberchk(z, L), L = [_,Z|_], write(Z).
+t(12) :- freeze(X, X == c), memberchk(X, [a,b,c,d]), write(X).
+t(13) :- sum_list([1,2,3.5,4], S), write(S).
+t(14) :- sum_list([1,2+3], S), write(S).
+t(15) :- sum_list([9223372036854775807,1], S), write(S).
+t(16) :- max_list([3,1,4,1,5], M), min_list([3,1,4,1,5], N), write(M/N).
+t(17) :- max_list([3,1.5], M), write(M).
+t(18) :- (max_list([], _) -> write(bad) ; write(ok)).
+t(19) :- numlist(1, 5, L), write(L).
+t(20) :- prod_list([2,3,4], P), prod_list([2,0.5], P2), write(P/P2).
+t(21) :- catch(sum_list([a], _), error(E, _), write(E)).
+t(22) :- memberchk(1, [1.0, 1]), write(ok).
+t(23) :- memberchk("ab", [a, "ab"]), write(ok).
+t(24) :- memberchk(f(A,b), [f(a,c), f(x,b)]), write(A).
+t(25) :- reverse([], R), append(R, [], R2), write(R2).
+main :-
+	between(1, 25, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
@@ -0,0 +1,51 @@
+% setarg/3, nb_setarg/3 and mutable arrays
+
+t(1) :- T = f(a,b,c), setarg(2, T, x), write(T).
+t(2) :- T = f(a,b,c), (setarg(2, T, x), fail ; write(T)).
+t(3) :- T = f(a,g(b),c), setarg(2, T, y), setarg(1, T, Z), Z = 1, write(T).
+t(4) :- functor(T, f, 2), setarg(1, T, h(X)), X = 1, arg(1, T, A), write(A).
+t(5) :- T = f(a), (setarg(1, T, b), write(T), fail ; write(T)).
+t(6) :- T = f(0), (between(1, 3, I), setarg(1, T, I), fail ; write(T)).
+t(7) :- T = s(0), (between(1, 100, _), arg(1, T, C0), C is C0+1, nb_setarg(1, T, C), fail ; write(T)).
+t(8) :- functor(T, f, 2), (nb_setarg(2, T, "str"), fail ; arg(2, T, S), write(S)).
+t(9) :- catch(nb_setarg(1, f(a), g(_)), error(E, _), write(E)).
+t(10) :- (setarg(3, f(a,b), x) -> write(bad) ; write(ok)).
+t(11) :- catch(setarg(a, f(a), x), error(E, _), write(E)).
+t(12) :- functor(T, f, 1), X = g(T), setarg(1, T, z), write(X).
+t(13) :- array_new(3, 0, A), array_set(A, 2, f(x,[1])), array_to_list(A, L), write(L).
+t(14) :- array_new(2, a, A), (array_set(A, 1, b), fail ; array_get(A, 1, X), write(X)).
+t(15) :- array_new(2, 0, A), (array_get(A, 3, _) -> write(bad) ; write(ok)).
+t(16) :- array_new(2, 0, A), catch(array_set(A, 1, f(_)), error(E, _), write(E)).
+t(17) :- array_new(4, 0, A), array_size(A, N), (is_array(A) -> write(N) ; true).
+t(18) :- array_new(0, x, A), array_to_list(A, L), write(L).
+t(19) :- array_new(3, 0, A), forall(between(1, 3, I), (J is I*I, array_set(A, I, J))), array_to_list(A, L), write(L).
+t(20) :- catch(array_get(foo, 1, _), error(E, _), write(E)).
+t(21) :- T = f(0), inc(T), inc(T), write(T).
+t(22) :- T = f(0), ninc(T), ninc(T), write(T).
+t(23) :- mk(T), inc(T), ninc(T), write(T).
+t(24) :- T = f(0), (inc(T), fail ; ninc(T), fail ; write(T)).
+t(25) :- T = f(g(1), 0), U = T, setarg(1, T, a), inc2(U), write(T-U).
+t(26) :- T = s(0), forall(between(1, 3, _), ninc(T)), write(T).
+t(27) :- T = f(a), call(setarg(1, T, b)), write(T).
+t(28) :- T = f(X, a), call(setarg(2, T, b)), ( T = f(Y, b), Y == X -> write(ok) ; write(bad) ).
+t(29) :- T = f(g(1)), arg(1, T, G), setarg(1, G, a), write(T).
+t(30) :- T = f(g(1), k), arg(1, T, G), setarg(1, G, A), ( ground(T) -> write(bad) ; A = 2, write(T) ).
+t(31) :- T = s([]), ( member(X, [1,2,3]), arg(1, T, L), nb_setarg(1, T, [X|L]), fail ; arg(1, T, L), write(L) ).
+t(32) :- assertz(d(f(g(1)))), d(T), arg(1, T, G), setarg(1, G, z), d(U), write(T-U).
+t(33) :- L = [f(0),f(0)], maplist(inc, L), write(L).
+t(34) :- T = a(b(c(d))), arg(1, T, B), arg(1, B, C), setarg(1, C, z), setarg(1, B, y), write(T-B-C).
+
+inc(T) :- arg(1, T, X), Y is X + 1, setarg(1, T, Y).
+ninc(T) :- arg(1, T, X), Y is X + 1, nb_setarg(1, T, Y).
+inc2(T) :- arg(2, T, X), Y is X + 1, setarg(2, T, Y).
+mk(T) :- T = f(0).
+
+:- dynamic(d/1).
+
+main :-
+	between(1, 34, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
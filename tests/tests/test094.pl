@@ -0,0 +1,60 @@
+% Frame reuse for deterministic last calls
+
+count(0) :- !.
+count(N) :- N1 is N-1, count(N1).
+
+len([], N, N).
+len([_|T], N0, N) :- N1 is N0+1, len(T, N1, N).
+
+even(0) :- !.
+even(N) :- N1 is N-1, odd(N1).
+odd(0) :- !.
+odd(N) :- N1 is N-1, even(N1).
+
+cut(0) :- !.
+cut(N) :- N1 is N-1, !, cut(N1).
+
+fresh([], A, B) :- X = 1, Y = 2, Z = 3, ( var(A) -> write(var) ; write(A) ), write(B-X-Y-Z).
+fresh([_|T], _, B) :- fresh(T, _, B).
+
+head([], [A|B]) :- A = x, B = [], C = 1, D = 2, C < D.
+head([N|R], [N|T]) :- T = [], Z = [x], head(R, Z).
+
+fz(0, _) :- !.
+fz(N, L) :- freeze(V, (W is V*2, L = [W|T])), V = N, N1 is N-1, fz(N1, T).
+
+% From samples/chess.pl: a goal last in the clause but inside \+/1
+% must not take over the clause's frame...
+
+board([piece(e-4,white,pawn), piece(e-5,black,pawn), piece(d-7,black,pawn)]).
+minus_one(X, Y) :- plus_one(Y, X).
+plus_one(4, 5). plus_one(5, 6). plus_one(6, 7).
+occupied_by(Board, File-Rank, Color, Piece) :-
+	member(piece(File-Rank, Color, Piece), Board).
+can_move(Board, File-F_Rank, File-T_Rank, black, pawn) :-
+	minus_one(F_Rank, T_Rank),
+	\+ occupied_by(Board, File-T_Rank, white, _).
+move(Board, F_File-F_Rank, T_File-T_Rank, Color, Piece) :-
+	occupied_by(Board, F_File-F_Rank, Color, Piece),
+	can_move(Board, F_File-F_Rank, T_File-T_Rank, Color, Piece),
+	\+ occupied_by(Board, T_File-T_Rank, Color, _).
+
+tco(PI, Calls, Done) :-
+	statistics(tco, L),
+	member(PI-tco(Calls, Done, _, _), L).
+
+t(1) :- count(10000), tco(count/1, C, D), write(C-D).
+t(2) :- numlist(1, 10000, L), len(L, 0, N), tco(len/3, C, D), write(N/C-D).
+t(3) :- even(10001), tco(even/1, C1, D1), tco(odd/1, C2, D2), write(C1-D1/C2-D2).
+t(4) :- ( cut(3), fail ; write(done) ).
+t(5) :- fresh([a], a, b).
+t(6) :- head([1], L), write(L).
+t(7) :- fz(3, L), L = [A,B,C|_], write([A,B,C]).
+t(8) :- board(B), bagof(F-T, P^move(B,F,T,black,P), L), write(L).
+main :-
+	between(1, 8, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
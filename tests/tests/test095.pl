@@ -0,0 +1,19 @@
+% Copying terms that are wholly or partly ground
+
+:- dynamic(g/1).
+
+t(1) :- T = f(a,g(b)), duplicate_term(T, C), setarg(1, C, z), write(T-C).
+t(2) :- findall(f(a,g(b)), true, [C]), arg(2, C, G), setarg(1, G, V), copy_term(C, D), arg(2, D, g(W)), ( W == V -> write(shared) ; write(fresh) ), V = 1, write(C).
+t(3) :- findall(X-[1,2], member(X, [a,b]), L), write(L).
+t(4) :- assertz(g(h([1,2,3]))), g(X), write(X).
+t(5) :- findall(L, L = [_,1,2], [C]), C = [H|T], write(T), ( var(H) -> write(var) ; true ).
+t(6) :- copy_term(f(_,g(a),_), C), term_variables(C, Vs), length(Vs, N), write(N).
+t(7) :- findall(f(a), true, [C]), nb_setarg(1, C, b), copy_term(C, D), write(C-D).
+t(8) :- T = f(a,g(b)), copy_term(T, C), setarg(1, C, z), write(T-C).
+main :-
+	between(1, 8, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
@@ -0,0 +1,17 @@
+% sub_atom/5 and sub_string/5 with Sub known
+
+t(1) :- findall(B-L-A, sub_atom(aaaa, B, L, A, aa), X), write(X).
+t(2) :- findall(B-A, sub_atom('héllo wörld ö', B, _, A, 'ö'), X), write(X).
+t(3) :- findall(B, sub_atom(abc, B, _, _, ''), X), write(X).
+t(4) :- sub_atom(abcabc, B, _, 0, abc), write(B).
+t(5) :- \+ sub_atom(abcabc, 1, _, _, abc), \+ sub_atom(abcabc, _, 2, _, abc), write(ok).
+t(6) :- sub_atom(abcab, B, _, _, ab), !, write(B).
+t(7) :- findall(B-S, sub_string("hello", B, 2, _, S), X), write(X).
+t(8) :- findall(B, sub_string("a.b.c", B, _, _, "."), X), write(X).
+main :-
+	between(1, 8, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
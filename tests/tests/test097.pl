@@ -0,0 +1,19 @@
+% Char positions in long atoms (over 1K bytes, so indexed)
+
+w(I, W) :- X is I mod 5, nth0(X, [abc, 'é', 'ö€x', '中文', z], W).
+big(N, A) :- numlist(1, N, L), findall(W, (member(I, L), w(I, W)), Ws), atomic_list_concat(Ws, A).
+ascii(N, A) :- length(L, N), maplist(=(0'x), L), atom_codes(A, L).
+
+t(1) :- big(1000, A), atom_length(A, L), write(L).
+t(2) :- big(1000, A), sub_atom(A, 1234, 7, R, S), write(S/R).
+t(3) :- big(1000, A), sub_atom(A, 100, 1500, _, M), atom_length(M, L), sub_atom(M, 1000, 5, R, S), write(L/S/R).
+t(4) :- big(1000, A), sub_atom(A, B, 4, 0, S), write(B/S).
+t(5) :- big(1000, A), findall(B, sub_atom(A, B, _, _, '中文z'), Bs), length(Bs, N), last(Bs, Last), write(N/Last).
+t(6) :- ascii(3000, A), atom_length(A, L), sub_atom(A, 2990, _, 0, S), write(L/S).
+main :-
+	between(1, 6, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
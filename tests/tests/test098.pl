@@ -0,0 +1,18 @@
+% Tokenizing, user-defined ops and split_string/4
+
+:- op(700, xfx, ===>).
+:- op(200, xfy, zork).
+
+t(1) :- X = (a ===> b), X =.. L, write(L).
+t(2) :- X = (a zork b zork c), write_canonical(X).
+t(3) :- read_term_from_atom('f(\'quoted \\\'atom\\\' here\', "str", name_1, /* c */ 0\'a)', T, []), writeq(T).
+t(4) :- split_string("αβγ→δ→ε", "→", "", L), writeq(L).
+t(5) :- split_string("/home//jan///nice/path", "/", "", L), writeq(L).
+t(6) :- op(0, xfx, ===>), catch(read_term_from_atom('a ===> b', _, []), error(E, _), true), writeq(E).
+main :-
+	between(1, 6, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
@@ -0,0 +1,35 @@
+% Foreign functions and predicates from libm and libc
+
+reg :-
+	'$dlopen'('libm.so.6', 0, M),
+	'$register_function'(M, cbrt, [fp64], fp64),
+	'$register_function'(M, cbrtf, [fp32], fp32),
+	'$register_predicate'(M, fdim, [fp64,fp64], fp64),
+	'$register_predicate'(M, frexp, [fp64,-int32], fp64),
+	'$register_predicate'(M, modf, [fp64,-fp64], fp64),
+	'$dlopen'('libc.so.6', 0, C),
+	'$register_predicate'(C, strlen, [cstr], int64),
+	'$register_predicate'(C, abs, [int32], int32).
+
+% Calls are built with =../2, a clause can't refer to them until
+% they're registered...
+
+t(1) :- E =.. [cbrt, 27.0], X is E, write(X).
+t(2) :- E =.. [cbrtf, 8.0], X is E, write(X).
+t(3) :- G =.. [fdim, 5.0, 2.0, X], call(G), write(X).
+t(4) :- G =.. [frexp, 8.0, E, X], call(G), write(E/X).
+t(5) :- G =.. [modf, 2.5, I, X], call(G), write(I/X).
+t(6) :- G =.. [strlen, abc, X], call(G), write(X).
+t(7) :- G =.. [strlen, "abcd", X], call(G), write(X).
+t(8) :- G =.. [abs, -3, X], call(G), write(X).
+t(9) :- G =.. [strlen, 1, _], catch(call(G), E, true), write(E).
+t(10) :- E =.. [cbrt, a], catch(_ is E, Err, true), write(Err).
+
+main :-
+	reg,
+	between(1, 10, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
@@ -0,0 +1,42 @@
+% Foreign functions taking arrays and structs
+
+% struct tm, as in glibc
+
+tm([int32,int32,int32,int32,int32,int32,int32,int32,int32,int64,ptr]).
+
+reg :-
+	tm(TM),
+	'$dlopen'('libc.so.6', 0, C),
+	'$register_predicate'(C, strlen, [array(uint8)], int64),
+	'$register_function'(C, strlen, [array(uint8)], int64),
+	'$register_predicate'(C, memset, [-array(uint8,3), int32, uint64], ptr),
+	'$register_predicate'(C, wmemcpy, [-array(int32,3), array(int32), uint64], ptr),
+	'$register_predicate'(C, getloadavg, [-array(fp64,2), int32], int32),
+	'$register_predicate'(C, gmtime_r, [array(int64), -struct(TM)], ptr),
+	'$register_predicate'(C, timegm, [struct(TM)], int64).
+
+t(1) :- G =.. [strlen, [104,105,0], N], call(G), write(N).
+t(2) :- G =.. [strlen, "hello", N], call(G), write(N).
+t(3) :- E =.. [strlen, [104,105,106,0]], N is E, write(N).
+t(4) :- G =.. [memset, B, 0'x, 5, _], call(G), writeq(B).
+t(5) :- G =.. [wmemcpy, D, [1,-2,3,4], 3, _], call(G), write(D).
+t(6) :- G =.. [getloadavg, L, 3, N], call(G), length(L, Len), maplist(float, L), write(Len/N).
+t(7) :- G =.. [gmtime_r, [31536000], S, _], call(G), length(F, 9), append(F, _, S), write(F).
+t(8) :- G =.. [timegm, [0,0,0,1,0,71,0,0,0,0,0], T], call(G), write(T).
+t(9) :- G =.. [strlen, [a], _], catch(call(G), E, true), write(E).
+t(10) :- G =.. [timegm, [0,0], _], catch(call(G), E, true), write(E).
+t(11) :- G =.. [memset, _, 0'x, foo, _], catch(call(G), E, true), write(E).
+t(12) :- G =.. [wmemcpy, D, [], 0, _], call(G), writeq(D).
+t(13) :- '$dlopen'('libc.so.6', 0, C), catch('$register_predicate'(C, abs, [int], int32), E, true), write(E).
+t(14) :- '$dlopen'('libc.so.6', 0, C), catch('$register_predicate'(C, memset, [-array(uint8,4), int32, uint64], ptr), E, true), write(E).
+t(15) :- '$dlopen'('libc.so.6', 0, C), catch('$register_function'(C, abs, [int32], int), E, true), write(E).
+t(16) :- '$dlopen'('libc.so.6', 0, C), catch('$register_function'(C, abs, [array(int32,1)], int32), E, true), write(E).
+
+main :-
+	reg,
+	between(1, 16, N),
+	write(N), write(": "),
+	( t(N) -> true ; write(failed) ), nl,
+	fail.
+main.
+:- initialization(main).
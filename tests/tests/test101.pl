@@ -0,0 +1,30 @@
+% Meta-calls still see a predicate defined, redefined or abolished
+% after their closure was first resolved.
+
+:- dynamic(p/2).
+
+p(1, one).
+
+inc(X, Y) :- Y is X + 1.
+
+t(1) :- maplist(inc, [1,2,3], L), write(L).
+t(2) :- foldl(plus, [1,2,3], 0, S), write(S).
+t(3) :- call(p, 1, X), write(X).
+t(4) :- retract(p(1, _)), assertz(p(1, uno)), call(p, 1, X), write(X).
+t(5) :- abolish(p/2), catch(call(p, 1, _), error(E, _), (write(E))).
+t(6) :- assertz(p(1, again)), call(p, 1, X), write(X).
+t(7) :- catch(call(q, 1, _), error(E, _), write(E)), nl,
+	assertz(q(1, new)), call(q, 1, X), write(X).
+t(8) :- catch(call(nl, x), error(E, _), write(E)).
+t(9) :- call(atom_length, abc, N), call(succ, N, M), write(N-M).
+t(10) :- findall(X, call(member, X, [a,b,c]), L), write(L).
+
+main :-
+	between(1, 10, N),
+	write(N), write(': '),
+	(t(N) -> true ; write(failed)),
+	nl,
+	fail.
+main.
+
+:- initialization(main).
@@ -0,0 +1,55 @@
+% library(apply) with the closure given in the clause, passed in at
+% run time, or left for call/N to deal with.
+
+inc(X, Y) :- Y is X + 1.
+add3(X, Y, Z, S) :- S is X + Y + Z.
+even(X) :- 0 is X mod 2.
+sum3(X, Y, Z, S0, S) :- S is S0 + X + Y + Z.
+
+run(G, L1, L2) :- maplist(G, L1, L2).
+
+:- dynamic(stored/2).
+stored(L1, L2) :- maplist(inc, L1, L2).
+
+goal_expansion(maplist(G, L1, L2), maplist(inc, L1, L2)) :- G == twice.
+
+t(1) :- maplist(inc, [1,2,3], L), write(L).
+t(2) :- run(inc, [1,2,3], L), write(L).
+t(3) :- maplist(plus(10), [1,2,3], L), write(L).
+t(4) :- maplist(add3, [1,2], [10,20], [100,200], L), write(L).
+t(5) :- length(L, 2), maplist(=(x), L), write(L).
+t(6) :- findall([X,Y], maplist(between(1,2), [X,Y]), L), write(L).
+t(7) :- maplist(=(a), L), length(L, 2), !, write(L).
+t(8) :- maplist(succ, L, [1,2,3]), write(L).
+t(9) :- foldl(plus, [1,2,3], 0, S), write(S).
+t(10) :- foldl(sum3, [1,2], [10,20], [100,200], 0, S), write(S).
+t(11) :- include(even, [1,2,3,4], I), exclude(even, [1,2,3,4], E), write(I/E).
+t(12) :- G = even, include(G, [1,2,3,4], I), write(I).
+t(13) :- maplist(maplist(inc), [[1],[2,3]], L), write(L).
+t(14) :- catch(maplist(nothing, [1]), error(E, _), true), write(E).
+t(15) :- catch(run(_, [1], _), error(E, _), true), write(E).
+t(16) :- maplist(_, []), write(ok).
+t(17) :- maplist(atom_concat(pre), [a,b], L), write(L).
+t(18) :- \+ maplist(inc, [1,2], [2,4]), write(ok).
+t(19) :- maplist(inc, [1,2], [X,3]), write(X).
+t(20) :- maplist(write, [a,b,c]).
+t(21) :- maplist(=(f(Z)), [A,B]), Z = 1, write(A-B).
+t(22) :- maplist(arg(1), [f(a),g(b)], L), write(L).
+t(23) :- catch(foldl(nothing, [1], 0, _), error(_, C), true), write(C).
+t(24) :- G = nothing(x), catch(maplist(G, [1], _), error(_, C), true), write(C).
+t(25) :- catch(exclude(nothing, [1], _), error(_, C), true), write(C).
+t(26) :- stored([1], L), clause(stored(_, _), B), write(L/B).
+t(27) :- maplist(lists:reverse, [[1,2],[3]], L), write(L).
+t(28) :- G = lists:reverse, maplist(G, [[1,2]], L), write(L).
+t(29) :- catch(maplist(nomod:nothing, [1]), error(E, _), true), write(E).
+t(30) :- maplist(twice, [1,2], L), write(L).
+
+main :-
+	between(1, 30, N),
+	write(N), write(': '),
+	(t(N) -> true ; write(failed)),
+	nl,
+	fail.
+main.
+
+:- initialization(main).
@@ -0,0 +1,24 @@
+walk([], N, N).
+walk([_|T], N0, N) :- N1 is N0+1, walk(T, N1, N).
+
+app(X, A0, A1) :- atomic_list_concat([A0,X], A1).
+
+t(1) :- atom_concat(abcdefghijklmnopqrstu, xyz, A), atom_concat(A, '123', B), atom_concat(A, '456', C), writeq([A,B,C]), nl.
+t(2) :- atom_concat(abcdefghijklmnopqrstu, xyz, A), atom_concat(A, A, B), atom_concat(B, A, C), writeq(C), nl, atom_length(C, L), write(L), nl.
+t(3) :- atomic_list_concat([abcdefghijklmnopqrstu, 1, x, 2.5], '-', A), atomic_list_concat([A, tail], B), atomic_list_concat([A, other], C), writeq([A,B,C]), nl.
+t(4) :- split_string("aaaaaaaaaaaaaaaaaaaaaaa,bbbbbbbbbbbbbbbbbbbbbbbbbbbb,c", ",", "", L), writeq(L), nl, L = [X|_], length(X, N), walk(X, 0, M), write(N/M), nl, X = [H|T], writeq(H-T), nl.
+t(5) :- atom_concat(abcdefghijklmnopqrstu, 'ééé', A), sub_atom(A, B, 2, 0, S), writeq(B-S), nl, atom_concat(A, 'ü', A2), atom_length(A2, L2), sub_atom(A2, 0, 1, _, F), writeq(L2-F), nl.
+t(6) :- atom_concat(abcdefghijklmnopqrstu, xyz, A), atom_concat(X, xyz, A), atom_concat(X, qq, Y), writeq(X/Y/A), nl.
+t(7) :- numlist(1, 2000, L), foldl(app, L, '', A), atom_length(A, N), write(N), nl, sub_atom(A, 0, 12, _, S), writeq(S), nl.
+t(8) :- atom_concat(abcdefghijklmnopqrstu, xyz, A), atom_concat(A, q, A3), A3 == abcdefghijklmnopqrstuxyzq, atom_codes(A, Cs), walk(Cs, 0, N), write(N), nl.
+t(9) :- atom_concat(abcdefghijklmnopqrstu, xyz, A), atom_concat(A, q, B), atom_concat(A, r, C), B \== C, A \== B, write(ok), nl.
+t(10) :- atomic_list_concat([abcdefghijklmnopqrstu, '', xyz], A), atomic_list_concat(['', abcdefghijklmnopqrstu, xyz], B), A == B, writeq(A), nl.
+
+main :-
+	between(1, 10, N),
+	write(N), write(': '),
+	catch(t(N), E, (writeq(E), nl)),
+	fail.
+main.
+
+:- initialization(main).
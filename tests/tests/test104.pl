@@ -0,0 +1,32 @@
+t(1) :- format("~w ~a ~d ~s~n", [foo(a,[1,2]), abc, 42, "str"]).
+t(2) :- format("~a~t~20|~w~n", [name, value]).
+t(3) :- format("~`-t~30|~n").
+t(4) :- format("~t~w~10|~t~d~8+~n", [right, 123]).
+t(5) :- format("~*c~n", [5, 0'x]).
+t(6) :- format("~e ~4f ~g ~2d ~D~n", [1.5, 2.0, 3.0, 1234, 1234567]).
+t(7) :- format("~q ~q ~w~n", ['A b', "s", 'A b']).
+t(8) :- format("ü~wé~n", [ß]).
+t(9) :- format("~i~w~n", [skip, shown]).
+t(10) :- format("~r ~8r ~16R~n", [8, 64, 255]).
+t(11) :- format("~~ ~N~Nnext~n~n", []).
+t(12) :- format("~w~n", []).
+t(13) :- format("abc~", []).
+t(14) :- format(atom(A), "~w-~d", [x, 5]), writeq(A), nl.
+t(15) :- format(string(S), "~a", [abc]), writeq(S), nl, format(chars(C), "~w", [ab]), writeq(C), nl.
+t(16) :- format([0'a, 0'~, 0'w, 0'~, 0'n], [x]).
+t(17) :- format("~a~n", [f(x)]).
+t(18) :- format("~3d~n", [12345]), format("~0d~n", [7]), format("~d~n", [-17]).
+t(19) :- length(L, 3000), maplist(=(abcdefgh), L), atomic_list_concat(L, A), format(atom(B), "~a~a", [A, A]), atom_length(B, N), write(N), nl.
+t(20) :- format("~w and ~w~n", [x, 'hello world']), format("~w~n", ['Über']).
+t(21) :- length(L, 500), maplist(=(0'a), L), atom_codes(F, L), format(F), nl.
+t(22) :- forall(between(1, 3, I), format("~w~t~10|~w~n", [I, x])).
+t(23) :- between(1, 3, _), format("~w~t~10|~w~n", [a, b]), fail ; true.
+
+main :-
+	between(1, 23, N),
+	write(N), write(': '),
+	catch(t(N), E, (writeq(E), nl)),
+	fail.
+main.
+
+:- initialization(main).
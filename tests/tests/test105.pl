@@ -0,0 +1,29 @@
+t(1) :- X is 2^100, Y is X - (X - 5), write(Y), nl, (integer(Y), Y == 5 -> write(small) ; write(big)), nl.
+t(2) :- X is -(2^70), Y is X + 2^70 + 3, write(Y), nl, Z is -X, write(Z), nl.
+t(3) :- fact(30, X), write(X), nl.
+t(4) :- X is powm(3, 200, 1000007), write(X), nl.
+t(5) :- X is powm(2^100+7, 3^50, 2^61-1), write(X), nl.
+t(6) :- X is powm(-7, 5, 11), write(X), nl.
+t(7) :- X is powm(2, -1, 7), write(X), nl.
+t(8) :- X is powm(2, 3, 0), write(X), nl.
+t(9) :- X is powm(a, 3, 5), write(X), nl.
+t(10) :- X is 2^200 // 3^50, Y is 2^200 mod 3^50, write(X), nl, write(Y), nl.
+t(11) :- X is (2^80 \/ 5) /\ (2^80 + 4), Y is xor(2^90, 2^90 + 9), write(X), nl, write(Y), nl.
+t(12) :- X is msb(2^100), Y is gcd(2^100, 6^40), write(X), nl, write(Y), nl.
+t(13) :- X is 10^30, Y is X * X, Z is Y // X, write(Z), nl, W is 7^200 - 7^200, write(W), nl.
+t(14) :- X = 123456789012345678901234567890, Y is -X, write(Y), nl, Z is Y * -1, (Z =:= X -> write(yes) ; write(no)), nl.
+t(15) :- X is powm(2, 3, -7), write(X), nl.
+t(16) :- X is -(2^63), Y is 0 - 9223372036854775808, Z is (2^63) * -1, write([X,Y,Z]), nl, (X == -9223372036854775808 -> write(yes) ; write(no)), nl.
+t(17) :- X is abs(-(2^63)), Y is -(-(2^63)), Z is -(2^63) + 1, W is -Z, write([X,Y,Z,W]), nl.
+
+fact(0, 1) :- !.
+fact(N, F) :- N1 is N - 1, fact(N1, F1), F is N * F1.
+
+main :-
+	between(1,17,N),
+		write(N), write(': '),
+		catch(t(N),E,(writeq(E),nl)),
+	fail.
+main.
+
+:- initialization(main).
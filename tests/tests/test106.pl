@@ -0,0 +1,25 @@
+fail_open(0) :- !.
+fail_open(N) :-
+	catch(open('/nonexistent/x', read, _), _, true),
+	catch(open('/nonexistent/x', bad, _), _, true),
+	catch(open('/nonexistent/x', read, _, [foo(1)]), _, true),
+	catch(open('/nonexistent/x', read, _, [alias(user_input)]), _, true),
+	N1 is N - 1,
+	fail_open(N1).
+
+t(1) :- catch(open('/nonexistent/x', read, _), E, true), writeq(E), nl.
+t(2) :- catch(open('/nonexistent/x', bad, _), E, true), writeq(E), nl.
+t(3) :-
+	open('tests/tests/test106.pl', read, S1), close(S1),
+	fail_open(1000),
+	open('tests/tests/test106.pl', read, S2), close(S2),
+	(S1 == S2 -> write(reused) ; write(leaked)), nl.
+
+main :-
+	between(1,3,N),
+		write(N), write(': '),
+		catch(t(N),E,(writeq(E),nl)),
+	fail.
+main.
+
+:- initialization(main).
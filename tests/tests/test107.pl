@@ -0,0 +1,27 @@
+fill(S, N) :-
+	length(L, N), maplist(=(0'x), L),
+	open('test107.tmp', write, W), format(W, "~s", [L]), close(W),
+	read_file_to_string('test107.tmp', S, []).
+
+t(1) :- fill(S, 100000), length(S, N), write(N), nl.
+t(2) :-
+	fill(S, 100000),
+	open('test107.tmp', write, W), format(W, "changed", []), close(W),
+	sub_string(S, 0, 5, _, Sub), writeq(Sub), nl,
+	length(S, N), write(N), nl.
+t(3) :-
+	fill(S, 100000),
+	loadfile('test107.tmp', L),
+	open('test107.tmp', write, W), close(W),
+	length(S, N), length(L, N2), write(N-N2), nl,
+	sub_string(L, 99995, 5, _, Sub), writeq(Sub), nl.
+
+main :-
+	between(1,3,N),
+		write(N), write(': '),
+		catch(t(N),E,(writeq(E),nl)),
+	fail.
+main :-
+	delete_file('test107.tmp').
+
+:- initialization(main).
@@ -0,0 +1,35 @@
+:- use_module(library(dict)).
+
+d(L, D) :- dict:from_list(L, D).
+
+t(1) :-
+	d([b:2,a:f(x),c:"s"], D),
+	writeq(D), nl,
+	write_canonical(D), nl,
+	dict:new(E), writeq(E), nl.
+t(2) :-
+	d([b:2,a:f(x)], D), d([k:D], N),
+	format(atom(A), "~q", [N]),
+	read_term_from_atom(A, T, []),
+	dict:get(T, k, D2), dict:get(D2, a, V),
+	writeq(V), nl.
+t(3) :-
+	d([a:1,b:2], D1), d([a:1,b:3], D2), d([a:0,c:1], D3),
+	d([b:2,a:1], D4), dict:new(E),
+	msort([D2,D3,D1,E,D4], L), writeq(L), nl,
+	compare(O1, D1, D4), compare(O2, D3, D1), compare(O3, D1, D2),
+	write(O1-O2-O3), nl.
+t(4) :-
+	findall(D, (between(1, 20, I), J is (I * 7) mod 5, d([x:J,y:I], D)), Ds),
+	msort(Ds, S1), reverse(Ds, Rs), msort(Rs, S2),
+	(S1 == S2 -> writeln(same) ; writeln(different)),
+	length(S1, N), writeq(N), nl.
+
+main :-
+	between(1,4,N),
+		write(N), write(': '),
+		catch(t(N),E,(writeq(E),nl)),
+	fail.
+main.
+
+:- initialization(main).
@@ -0,0 +1,54 @@
+:- use_module(library(assoc)).
+
+t(1) :-
+	empty_assoc(A),
+	(A == t -> writeln(yes) ; writeln(no)).
+t(2) :-
+	list_to_assoc([c-3,a-1,b-2,d-4], A),
+	writeq(A), nl,
+	write_canonical(A), nl.
+t(3) :-
+	list_to_assoc([c-3,a-1,b-2,d-4,e-f(x)], A),
+	format(atom(X), "~q", [A]),
+	read_term_from_atom(X, T, []),
+	(is_assoc(T) -> writeln(valid) ; writeln(invalid)),
+	assoc_to_list(T, L), writeq(L), nl,
+	get_assoc(e, T, V), writeq(V), nl.
+t(4) :-
+	empty_assoc(E),
+	put_assoc(k, E, v, A), writeq(A), nl,
+	del_assoc(k, A, _, A2), writeq(A2), nl,
+	(empty_assoc(A2) -> writeln(empty) ; writeln(not_empty)).
+t(5) :-
+	list_to_assoc([], A), writeq(A), nl,
+	put_assoc(x, A, _, B),
+	(B = t(x,V,-,t,t), var(V) -> writeln(ok) ; writeln(B)).
+t(6) :-
+	findall(K-K, between(1, 7, K), Ps),
+	list_to_assoc(Ps, A), writeq(A), nl,
+	list_to_assoc(Ps, B),
+	(A == B -> writeln(eq) ; writeln(neq)).
+t(7) :-
+	list_to_assoc([a-1,b-2], A),
+	(compound(A), \+ atomic(A) -> writeln(compound) ; writeln(not_compound)),
+	functor(A, F, N), arg(1, A, K), A =.. [_,_,_,B|_],
+	writeq(F/N-K-B), nl.
+t(8) :-
+	list_to_assoc([a-1,b-2], A),
+	put_assoc(c, A, 3, A2),
+	(A2 = t(K,_,_,_,_) -> writeq(K) ; write(no)), nl,
+	compare(O, A2, t(z,0,-,t,t)), writeq(O), nl.
+t(9) :-
+	list_to_assoc([a-1], A),
+	put_assoc(b, A, X, A2), X = f(Y), put_assoc(c, A2, Y, A3),
+	Y = 2, writeq(A3), nl,
+	(get_assoc(b, t(b,1,-,foo,t), V) -> writeq(V) ; write(no)), nl.
+
+main :-
+	between(1,9,N),
+		write(N), write(': '),
+		catch(t(N),E,(writeq(E),nl)),
+	fail.
+main.
+
+:- initialization(main).